@@ -22,9 +22,23 @@
 #include <astra/capi/streams/depth_capi.h>
 #include <astra/streams/Image.hpp>
 #include <astra/Vector.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ASTRA_COORDINATEMAPPER_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define ASTRA_COORDINATEMAPPER_NEON
+#endif
 
 namespace astra {
 
+    class DepthFrame;
+
     /*!
       \ingroup cpp_ref
       \brief CoordinateMapper
@@ -129,7 +143,217 @@ namespace astra {
                                          &depthX, &depthY, &depthZ);
         }
 
+        /*!
+          \brief convert a region of a depth16 buffer to world coor
+
+          \details Reads the conversion data once and converts the whole region
+          without a C API call per pixel. Rows are split across threads for
+          large regions. Pixels with zero depth produce (0, 0, 0).
+
+          \param[in] depth depth16 buffer, width * height values
+          \param[in] width depth buffer width
+          \param[in] height depth buffer height
+          \param[in] roiX left column of the region
+          \param[in] roiY top row of the region
+          \param[in] roiWidth region width
+          \param[in] roiHeight region height
+          \param[out] world roiWidth * roiHeight world positions, row-major
+          \param[in] threadCount worker threads, 0 picks the hardware concurrency
+          \return false if the region does not fit in the buffer or the conversion
+          data cannot be read
+         */
+        bool convert_depth_to_world(const int16_t* depth, int width, int height,
+                                    int roiX, int roiY, int roiWidth, int roiHeight,
+                                    Vector3f* world, unsigned threadCount = 0) const
+        {
+            if (depth == nullptr || world == nullptr ||
+                roiX < 0 || roiY < 0 || roiWidth <= 0 || roiHeight <= 0 ||
+                roiX + roiWidth > width || roiY + roiHeight > height)
+            {
+                return false;
+            }
+
+            astra_conversion_cache_t cache;
+            if (astra_depthstream_get_depth_to_world_data(depthStream_, &cache) != ASTRA_STATUS_SUCCESS)
+            {
+                return false;
+            }
+
+            const int minRowsPerThread = 32;
+            unsigned threads = threadCount != 0 ? threadCount : std::thread::hardware_concurrency();
+            threads = std::max(1u, std::min(threads, static_cast<unsigned>(roiHeight / minRowsPerThread)));
+
+            if (threads == 1)
+            {
+                convert_depth_rows_to_world(cache, depth, width, roiX, roiY, roiWidth,
+                                            0, roiHeight, world);
+                return true;
+            }
+
+            std::vector<std::thread> workers;
+            workers.reserve(threads - 1);
+
+            const int rowsPerThread = (roiHeight + static_cast<int>(threads) - 1) / static_cast<int>(threads);
+            for (int first = rowsPerThread; first < roiHeight; first += rowsPerThread)
+            {
+                const int last = std::min(first + rowsPerThread, roiHeight);
+                workers.emplace_back(&CoordinateMapper::convert_depth_rows_to_world,
+                                     cache, depth, width, roiX, roiY, roiWidth,
+                                     first, last, world);
+            }
+
+            convert_depth_rows_to_world(cache, depth, width, roiX, roiY, roiWidth,
+                                        0, std::min(rowsPerThread, roiHeight), world);
+
+            for (auto& worker : workers)
+            {
+                worker.join();
+            }
+
+            return true;
+        }
+
+        /*!
+          \brief convert a whole depth frame to world coor
+
+          \param[in] depthFrame depth frame
+          \param[out] world width * height world positions, row-major
+          \param[in] threadCount worker threads, 0 picks the hardware concurrency
+          \return false if the frame is invalid
+         */
+        bool convert_depth_to_world(const DepthFrame& depthFrame,
+                                    Vector3f* world, unsigned threadCount = 0) const;
+
+        /*!
+          \brief convert a whole depth frame to world coor
+
+          \param[in] depthFrame depth frame
+          \param[in] threadCount worker threads, 0 picks the hardware concurrency
+          \return world positions, row-major; empty if the frame is invalid or
+          the conversion data cannot be read
+         */
+        std::vector<Vector3f> convert_depth_to_world(const DepthFrame& depthFrame,
+                                                     unsigned threadCount = 0) const;
+
+        /*!
+          \brief convert an array of world coor to depth coor
+
+          \details Reads the conversion data once instead of calling the C API
+          per point. Points with zero world z produce (0, 0, 0).
+
+          \param[in] world world positions
+          \param[in] count number of positions
+          \param[out] depth count depth positions
+          \return false if the conversion data cannot be read
+         */
+        bool convert_world_to_depth(const Vector3f* world, size_t count, Vector3f* depth) const
+        {
+            astra_conversion_cache_t cache;
+            if (astra_depthstream_get_depth_to_world_data(depthStream_, &cache) != ASTRA_STATUS_SUCCESS)
+            {
+                return false;
+            }
+
+            const float halfResX = static_cast<float>(cache.halfResX);
+            const float halfResY = static_cast<float>(cache.halfResY);
+
+            for (size_t i = 0; i < count; i++)
+            {
+                const float worldZ = world[i].z;
+                if (worldZ == 0.0f)
+                {
+                    depth[i] = Vector3f(0.0f, 0.0f, 0.0f);
+                    continue;
+                }
+
+                const float invZ = 1.0f / worldZ;
+                depth[i] = Vector3f(cache.coeffX * world[i].x * invZ + halfResX,
+                                    halfResY - cache.coeffY * world[i].y * invZ,
+                                    worldZ);
+            }
+
+            return true;
+        }
+
     private:
+        static void convert_depth_rows_to_world(astra_conversion_cache_t cache,
+                                                const int16_t* depth, int width,
+                                                int roiX, int roiY, int roiWidth,
+                                                int firstRow, int lastRow,
+                                                Vector3f* world)
+        {
+            // worldX = (x / resX - 0.5) * z * xzFactor, worldY = (0.5 - y / resY) * z * yzFactor
+            const float scaleX = cache.xzFactor / static_cast<float>(cache.resolutionX);
+            const float offsetX = -0.5f * cache.xzFactor;
+            const float scaleY = -cache.yzFactor / static_cast<float>(cache.resolutionY);
+            const float offsetY = 0.5f * cache.yzFactor;
+
+            for (int row = firstRow; row < lastRow; row++)
+            {
+                const int y = roiY + row;
+                const int16_t* src = depth + static_cast<size_t>(y) * width + roiX;
+                float* dst = reinterpret_cast<float*>(world + static_cast<size_t>(row) * roiWidth);
+                const float factorY = y * scaleY + offsetY;
+
+                int col = 0;
+#if defined(ASTRA_COORDINATEMAPPER_SSE2)
+                const __m128 vScaleX = _mm_set1_ps(scaleX);
+                const __m128 vOffsetX = _mm_set1_ps(offsetX);
+                const __m128 vFactorY = _mm_set1_ps(factorY);
+                const __m128 vStep = _mm_set1_ps(4.0f);
+                __m128 vX = _mm_setr_ps(static_cast<float>(roiX), static_cast<float>(roiX + 1),
+                                        static_cast<float>(roiX + 2), static_cast<float>(roiX + 3));
+
+                for (; col + 4 <= roiWidth; col += 4, dst += 12)
+                {
+                    const __m128i raw = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + col));
+                    const __m128 z = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(raw, raw), 16));
+                    const __m128 wx = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(vX, vScaleX), vOffsetX), z);
+                    const __m128 wy = _mm_mul_ps(vFactorY, z);
+                    vX = _mm_add_ps(vX, vStep);
+
+                    // interleave x0..x3, y0..y3, z0..z3 into x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3
+                    const __m128 xy01 = _mm_unpacklo_ps(wx, wy);
+                    const __m128 xy23 = _mm_unpackhi_ps(wx, wy);
+                    const __m128 z0x1 = _mm_shuffle_ps(z, xy01, _MM_SHUFFLE(2, 2, 0, 0));
+                    const __m128 y1z1 = _mm_shuffle_ps(xy01, z, _MM_SHUFFLE(1, 1, 3, 3));
+                    const __m128 z2x3 = _mm_shuffle_ps(z, xy23, _MM_SHUFFLE(2, 2, 2, 2));
+                    const __m128 y3z3 = _mm_shuffle_ps(xy23, z, _MM_SHUFFLE(3, 3, 3, 3));
+
+                    _mm_storeu_ps(dst, _mm_shuffle_ps(xy01, z0x1, _MM_SHUFFLE(2, 0, 1, 0)));
+                    _mm_storeu_ps(dst + 4, _mm_shuffle_ps(y1z1, xy23, _MM_SHUFFLE(1, 0, 2, 0)));
+                    _mm_storeu_ps(dst + 8, _mm_shuffle_ps(z2x3, y3z3, _MM_SHUFFLE(2, 0, 2, 0)));
+                }
+#elif defined(ASTRA_COORDINATEMAPPER_NEON)
+                const float32x4_t vScaleX = vdupq_n_f32(scaleX);
+                const float32x4_t vOffsetX = vdupq_n_f32(offsetX);
+                const float32x4_t vFactorY = vdupq_n_f32(factorY);
+                const float32x4_t vStep = vdupq_n_f32(4.0f);
+                const float lanes[4] = { static_cast<float>(roiX), static_cast<float>(roiX + 1),
+                                         static_cast<float>(roiX + 2), static_cast<float>(roiX + 3) };
+                float32x4_t vX = vld1q_f32(lanes);
+
+                for (; col + 4 <= roiWidth; col += 4, dst += 12)
+                {
+                    float32x4x3_t out;
+                    out.val[2] = vcvtq_f32_s32(vmovl_s16(vld1_s16(src + col)));
+                    out.val[0] = vmulq_f32(vmlaq_f32(vOffsetX, vX, vScaleX), out.val[2]);
+                    out.val[1] = vmulq_f32(vFactorY, out.val[2]);
+                    vX = vaddq_f32(vX, vStep);
+
+                    vst3q_f32(dst, out);
+                }
+#endif
+                for (; col < roiWidth; col++, dst += 3)
+                {
+                    const float z = src[col];
+                    dst[0] = ((roiX + col) * scaleX + offsetX) * z;
+                    dst[1] = factorY * z;
+                    dst[2] = z;
+                }
+            }
+        }
+
         astra_depthstream_t depthStream_;
     };
 
@@ -270,6 +494,36 @@ namespace astra {
         {}
 
     };
+
+    inline bool CoordinateMapper::convert_depth_to_world(const DepthFrame& depthFrame,
+                                                         Vector3f* world, unsigned threadCount) const
+    {
+        if (!depthFrame.is_valid())
+        {
+            return false;
+        }
+
+        return convert_depth_to_world(depthFrame.data(), depthFrame.width(), depthFrame.height(),
+                                      0, 0, depthFrame.width(), depthFrame.height(),
+                                      world, threadCount);
+    }
+
+    inline std::vector<Vector3f> CoordinateMapper::convert_depth_to_world(const DepthFrame& depthFrame,
+                                                                          unsigned threadCount) const
+    {
+        std::vector<Vector3f> world;
+        if (!depthFrame.is_valid())
+        {
+            return world;
+        }
+
+        world.resize(depthFrame.length());
+        if (!convert_depth_to_world(depthFrame, world.data(), threadCount))
+        {
+            world.clear();
+        }
+        return world;
+    }
 }
 
 #endif /* ASTRA_DEPTH_HPP */
@@ -71,6 +71,33 @@ ZSA_EXPORT uint32_t zsa_device_get_installed_count(void);
  */
 ZSA_EXPORT zsa_result_t zsa_device_open(uint32_t index, zsa_device_t *device_handle);
 
+/** Open an Azure Kinect device by its serial number.
+ *
+ * \param serial_number
+ * Null terminated serial number of the device to open, as returned by zsa_device_get_serialnum().
+ *
+ * \param device_handle
+ * Output parameter which on success will return a handle to the device.
+ *
+ * \relates zsa_device_t
+ *
+ * \return ::ZSA_RESULT_SUCCEEDED if the device was opened successfully, ::ZSA_RESULT_FAILED if no attached device has
+ * that serial number or it could not be opened.
+ *
+ * \remarks
+ * Device indices change as devices are plugged in and out, the serial number does not. Use this to open a particular
+ * device of a multi device rig.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT zsa_result_t zsa_device_open_by_serialnum(const char *serial_number, zsa_device_t *device_handle);
+
 
 /** Closes an Azure Kinect device.
  *
@@ -149,6 +176,1256 @@ ZSA_EXPORT zsa_result_t zsa_device_start_cameras(zsa_device_t device_handle, con
  */
 ZSA_EXPORT void zsa_device_stop_cameras(zsa_device_t device_handle);
 
+/** Stops delivering captures while keeping the cameras streaming and configured.
+ *
+ * \param device_handle
+ * Handle obtained by zsa_device_open().
+ *
+ * \returns
+ * ::ZSA_RESULT_SUCCEEDED is returned on success. ::ZSA_RESULT_FAILED is returned when the cameras are not streaming or
+ * the device streams as part of a \ref zsa_device_group_t.
+ *
+ * \relates zsa_device_t
+ *
+ * \remarks
+ * A later zsa_device_start_cameras() with the same configuration resumes within a few frames, without the USB round
+ * trips of restarting the sensors. Any other configuration restarts them. zsa_device_stop_cameras() leaves standby and
+ * stops the sensors.
+ *
+ * \remarks
+ * The sensors draw the same power and USB bandwidth in standby as while streaming. Frames are dropped as they arrive,
+ * before they are copied, decoded or allocated for.
+ *
+ * \remarks
+ * Like zsa_device_stop_cameras(), a thread blocking in zsa_device_get_capture() returns a failure.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT zsa_result_t zsa_device_standby_cameras(zsa_device_t device_handle);
+
+/** Reads a sensor capture.
+ *
+ * \param device_handle
+ * Handle obtained by zsa_device_open().
+ *
+ * \param capture_handle
+ * If successful this contains a handle to a capture object. Release it with zsa_capture_release().
+ *
+ * \param timeout_in_ms
+ * Time in milliseconds to wait for a capture, 0 to return immediately or ::ZSA_WAIT_INFINITE.
+ *
+ * \returns
+ * ::ZSA_WAIT_RESULT_SUCCEEDED if a capture was returned, ::ZSA_WAIT_RESULT_TIMEOUT if none arrived in time, or
+ * ::ZSA_WAIT_RESULT_FAILED if the cameras are not streaming or stopped while waiting.
+ *
+ * \relates zsa_device_t
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT zsa_wait_result_t zsa_device_get_capture(zsa_device_t device_handle,
+                                                    zsa_capture_t *capture_handle,
+                                                    int32_t timeout_in_ms);
+
+/** Reads a sensor capture without waiting for it.
+ *
+ * \param device_handle
+ * Handle obtained by zsa_device_open().
+ *
+ * \param capture_ready_cb
+ * Called once with the next capture, or with a failure when the cameras are not streaming or stop first.
+ *
+ * \param capture_ready_cb_context
+ * Passed to \p capture_ready_cb.
+ *
+ * \returns
+ * ::ZSA_RESULT_SUCCEEDED if \p capture_ready_cb will be called. ::ZSA_RESULT_FAILED if the arguments are invalid, the
+ * device streams as part of a \ref zsa_device_group_t, or a previous call has not completed yet.
+ *
+ * \relates zsa_device_t
+ *
+ * \remarks
+ * No thread waits for the capture, see \ref zsa_capture_ready_cb_t for the thread the callback runs on. Captures are
+ * taken from the same queue as zsa_device_get_capture(), each one goes to a single reader.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT zsa_result_t zsa_device_get_capture_async(zsa_device_t device_handle,
+                                                     zsa_capture_ready_cb_t *capture_ready_cb,
+                                                     void *capture_ready_cb_context);
+
+/** Sets what happens to the captures of zsa_device_get_capture() the application does not read in time.
+ *
+ * \param device_handle
+ * Handle obtained by zsa_device_open().
+ *
+ * \param policy
+ * The overflow policy of the capture queue.
+ *
+ * \param max_bytes
+ * Bytes the images of the queued captures may take with ::ZSA_QUEUE_OVERFLOW_BOUNDED_BYTES, ignored otherwise.
+ *
+ * \returns
+ * ::ZSA_RESULT_SUCCEEDED if the policy was set. ::ZSA_RESULT_FAILED if the arguments are invalid or the device streams
+ * as part of a \ref zsa_device_group_t.
+ *
+ * \relates zsa_device_t
+ *
+ * \remarks
+ * The queue keeps its depth of half a second of captures whatever the policy. The setting lasts until the device is
+ * closed.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT zsa_result_t zsa_device_set_capture_overflow_policy(zsa_device_t device_handle,
+                                                               zsa_queue_overflow_policy_t policy,
+                                                               size_t max_bytes);
+
+/** Reads the counters of the queue zsa_device_get_capture() reads from.
+ *
+ * \param device_handle
+ * Handle obtained by zsa_device_open().
+ *
+ * \param stats
+ * Location to write the counters to.
+ *
+ * \returns
+ * ::ZSA_RESULT_SUCCEEDED if the counters were read.
+ *
+ * \relates zsa_device_t
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT zsa_result_t zsa_device_get_capture_queue_stats(zsa_device_t device_handle, zsa_queue_stats_t *stats);
+
+/** Adds a queue receiving every capture of the device, next to the one zsa_device_get_capture() reads from.
+ *
+ * \param device_handle
+ * Handle obtained by zsa_device_open().
+ *
+ * \param queue_depth
+ * Captures the subscriber holds, 0 for a quarter of a second of captures at 30 FPS.
+ *
+ * \param policy
+ * What happens to the captures the subscriber does not read in time.
+ *
+ * \param max_bytes
+ * Bytes the images of the queued captures may take with ::ZSA_QUEUE_OVERFLOW_BOUNDED_BYTES, ignored otherwise.
+ *
+ * \param subscriber_handle
+ * Output parameter which on success will return a handle to the subscriber.
+ *
+ * \returns
+ * ::ZSA_RESULT_SUCCEEDED if the subscriber was added. ::ZSA_RESULT_FAILED if the arguments are invalid or the device
+ * has no room for another subscriber.
+ *
+ * \relates zsa_device_t
+ *
+ * \remarks
+ * Every subscriber holds a reference to the same capture, images are not copied. A subscriber falling behind only
+ * drops its own captures. Subscribers follow zsa_device_start_cameras() and zsa_device_stop_cameras(), and must be
+ * closed with zsa_subscriber_close() before the device is closed.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT zsa_result_t zsa_device_subscribe(zsa_device_t device_handle,
+                                             uint32_t queue_depth,
+                                             zsa_queue_overflow_policy_t policy,
+                                             size_t max_bytes,
+                                             zsa_subscriber_t *subscriber_handle);
+
+/** Reads the next capture of a subscriber.
+ *
+ * \param subscriber_handle
+ * Handle obtained by zsa_device_subscribe().
+ *
+ * \param capture_handle
+ * If successful this contains a handle to a capture object. Release it with zsa_capture_release().
+ *
+ * \param timeout_in_ms
+ * Time in milliseconds to wait for a capture, 0 to return immediately or ::ZSA_WAIT_INFINITE.
+ *
+ * \returns
+ * ::ZSA_WAIT_RESULT_SUCCEEDED if a capture was returned, ::ZSA_WAIT_RESULT_TIMEOUT if none arrived in time, or
+ * ::ZSA_WAIT_RESULT_FAILED if the cameras are not streaming or stopped while waiting.
+ *
+ * \relates zsa_subscriber_t
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT zsa_wait_result_t zsa_subscriber_get_capture(zsa_subscriber_t subscriber_handle,
+                                                        zsa_capture_t *capture_handle,
+                                                        int32_t timeout_in_ms);
+
+/** Reads every capture a subscriber holds, up to capacity, without waiting.
+ *
+ * \param subscriber_handle
+ * Handle obtained by zsa_device_subscribe().
+ *
+ * \param capture_handles
+ * Array receiving the captures, oldest first. Release each one with zsa_capture_release().
+ *
+ * \param capacity
+ * Entries in \p capture_handles.
+ *
+ * \param count
+ * Location to write the number of captures returned to.
+ *
+ * \returns
+ * ::ZSA_WAIT_RESULT_SUCCEEDED if at least one capture was returned, ::ZSA_WAIT_RESULT_TIMEOUT if none is queued, or
+ * ::ZSA_WAIT_RESULT_FAILED if the cameras are not streaming or stopped.
+ *
+ * \relates zsa_subscriber_t
+ *
+ * \remarks
+ * Meant for event loops woken by zsa_subscriber_get_event_fd(), draining the subscriber resets the descriptor.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT zsa_wait_result_t zsa_subscriber_get_captures(zsa_subscriber_t subscriber_handle,
+                                                         zsa_capture_t *capture_handles,
+                                                         uint32_t capacity,
+                                                         uint32_t *count);
+
+/** Gets a file descriptor that is readable while a subscriber holds captures.
+ *
+ * \param subscriber_handle
+ * Handle obtained by zsa_device_subscribe().
+ *
+ * \returns
+ * A descriptor for poll(), select() or epoll, -1 on failure and on Windows.
+ *
+ * \relates zsa_subscriber_t
+ *
+ * \remarks
+ * The descriptor is level triggered and must not be read from. It stays readable until the subscriber is drained with
+ * zsa_subscriber_get_captures() or zsa_subscriber_get_capture(), and once the cameras stop so that the event loop
+ * finds out through a failed read. It is owned by the subscriber and closed by zsa_subscriber_close().
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT int zsa_subscriber_get_event_fd(zsa_subscriber_t subscriber_handle);
+
+/** Reads the counters of a subscriber.
+ *
+ * \param subscriber_handle
+ * Handle obtained by zsa_device_subscribe().
+ *
+ * \param stats
+ * Location to write the counters to.
+ *
+ * \returns
+ * ::ZSA_RESULT_SUCCEEDED if the counters were read.
+ *
+ * \relates zsa_subscriber_t
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT zsa_result_t zsa_subscriber_get_stats(zsa_subscriber_t subscriber_handle, zsa_queue_stats_t *stats);
+
+/** Removes a subscriber and releases the captures it has not read.
+ *
+ * \param subscriber_handle
+ * Handle obtained by zsa_device_subscribe().
+ *
+ * \relates zsa_subscriber_t
+ *
+ * \remarks
+ * No other thread may be reading from the subscriber, zsa_device_stop_cameras() releases threads blocking in
+ * zsa_subscriber_get_capture(). Captures already read stay valid until they are released.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT void zsa_subscriber_close(zsa_subscriber_t subscriber_handle);
+
+/** Shares the captures of a device with other local processes.
+ *
+ * \param device_handle
+ * Handle obtained by zsa_device_open().
+ *
+ * \param name
+ * Name clients pass to zsa_client_open(), unique on the host.
+ *
+ * \param config
+ * Shared memory of the server, NULL for ::ZSA_SERVER_CONFIG_INIT_DEFAULT.
+ *
+ * \returns
+ * ::ZSA_RESULT_SUCCEEDED if the server was started. ::ZSA_RESULT_FAILED if the arguments are invalid, a server already
+ * runs in this process or under \p name, or the platform has no shared memory support.
+ *
+ * \relates zsa_device_t
+ *
+ * \remarks
+ * Only one process can stream from a device. The server lets the device's process publish every capture into shared
+ * memory, where clients in other processes read them with zsa_client_get_capture() without copying images. Captures
+ * stay available to zsa_device_get_capture() as well. Start the server before the cameras so that color and depth
+ * frames are allocated in the shared memory; images allocated elsewhere are copied once when published. While the
+ * server runs it allocates color and depth frames in place of an allocator set with zsa_set_allocator(), which serves
+ * them again once the server stops.
+ *
+ * \remarks
+ * Only supported on Linux.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT zsa_result_t zsa_device_start_server(zsa_device_t device_handle,
+                                                const char *name,
+                                                const zsa_server_configuration_t *config);
+
+/** Stops sharing the captures of a device.
+ *
+ * \param device_handle
+ * Handle obtained by zsa_device_open().
+ *
+ * \relates zsa_device_t
+ *
+ * \remarks
+ * Clients fail their next zsa_client_get_capture(). zsa_device_close() stops the server as well.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT void zsa_device_stop_server(zsa_device_t device_handle);
+
+/** Connects to the camera server of another process.
+ *
+ * \param name
+ * Name the server was started with by zsa_device_start_server().
+ *
+ * \param client_handle
+ * Output parameter which on success will return a handle to the connection.
+ *
+ * \returns
+ * ::ZSA_RESULT_SUCCEEDED if connected. ::ZSA_RESULT_FAILED if no server runs under \p name or it has no room for
+ * another client.
+ *
+ * \relates zsa_client_t
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT zsa_result_t zsa_client_open(const char *name, zsa_client_t *client_handle);
+
+/** Reads the next capture published by a camera server.
+ *
+ * \param client_handle
+ * Handle obtained by zsa_client_open().
+ *
+ * \param capture_handle
+ * If successful this contains a handle to a capture object. Release it with zsa_capture_release().
+ *
+ * \param timeout_in_ms
+ * Specifies the time in milliseconds the function should block waiting for the capture. ::ZSA_WAIT_INFINITE waits
+ * until a capture is published.
+ *
+ * \returns
+ * ::ZSA_WAIT_RESULT_SUCCEEDED if a capture was read, ::ZSA_WAIT_RESULT_TIMEOUT if none was published in time, and
+ * ::ZSA_WAIT_RESULT_FAILED once the server stopped.
+ *
+ * \relates zsa_client_t
+ *
+ * \remarks
+ * The images of the capture map the server's shared memory and must not be written to. The color image is in the
+ * format the server's device captured it in, an MJPEG image is not decoded for the client. A client falling behind by
+ * more than zsa_server_configuration_t::ring_size captures skips to the oldest capture still published.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT zsa_wait_result_t zsa_client_get_capture(zsa_client_t client_handle,
+                                                    zsa_capture_t *capture_handle,
+                                                    int32_t timeout_in_ms);
+
+/** Disconnects from a camera server.
+ *
+ * \param client_handle
+ * Handle obtained by zsa_client_open().
+ *
+ * \relates zsa_client_t
+ *
+ * \remarks
+ * Captures read with zsa_client_get_capture() stay valid until they are released.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT void zsa_client_close(zsa_client_t client_handle);
+
+/** Keeps the last seconds of captures of a device in memory.
+ *
+ * \param device_handle
+ * Handle obtained by zsa_device_open().
+ *
+ * \param config
+ * Window, memory and dump signal of the recorder, NULL for ::ZSA_FLIGHT_RECORDER_CONFIG_INIT_DEFAULT.
+ *
+ * \returns
+ * ::ZSA_RESULT_SUCCEEDED if the recorder was started. ::ZSA_RESULT_FAILED if the arguments are invalid, a recorder
+ * already runs for the device, the memory could not be allocated or the dump signal is handled by another recorder.
+ *
+ * \relates zsa_device_t
+ *
+ * \remarks
+ * The recorder copies the color, depth and IR images of every capture into a ring allocated once, so recording
+ * allocates no memory per capture. Captures older than zsa_flight_recorder_configuration_t::duration_ms are dropped,
+ * and the oldest ones earlier when the ring is full. Color images are kept as the camera sent them when color_format
+ * is ::ZSA_IMAGE_FORMAT_COLOR_MJPG, with or without color_decode_on_demand; with ::ZSA_IMAGE_FORMAT_COLOR_BGRA32 the
+ * recorder decodes each frame.
+ *
+ * \remarks
+ * The captures kept are written with zsa_device_dump_flight_recorder(), or by raising
+ * zsa_flight_recorder_configuration_t::dump_signal. The recorder replaces the handler of that signal while it runs.
+ * Raising the signal only dumps the recorder handling it, recorders of other devices need signals of their own.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT zsa_result_t zsa_device_start_flight_recorder(zsa_device_t device_handle,
+                                                         const zsa_flight_recorder_configuration_t *config);
+
+/** Writes the captures kept by the flight recorder of a device to a file.
+ *
+ * \param device_handle
+ * Handle obtained by zsa_device_open().
+ *
+ * \param path
+ * File to create, replaced if it exists.
+ *
+ * \returns
+ * ::ZSA_RESULT_SUCCEEDED if the file was written. ::ZSA_RESULT_FAILED if no recorder runs or the file could not be
+ * written.
+ *
+ * \relates zsa_device_t
+ *
+ * \remarks
+ * Streaming and recording go on while the file is written. The file starts with a header describing its layout,
+ * followed by the captures oldest first, each with the format, size and timestamps of its images.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT zsa_result_t zsa_device_dump_flight_recorder(zsa_device_t device_handle, const char *path);
+
+/** Stops the flight recorder of a device and frees its memory.
+ *
+ * \param device_handle
+ * Handle obtained by zsa_device_open().
+ *
+ * \relates zsa_device_t
+ *
+ * \remarks
+ * zsa_device_close() stops the recorder as well.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT void zsa_device_stop_flight_recorder(zsa_device_t device_handle);
+
+/** Get the Azure Kinect device serial number.
+ *
+ * \param device_handle
+ * Handle obtained by zsa_device_open().
+ *
+ * \param serial_number
+ * Location to write the serial number to. If the function returns ::ZSA_BUFFER_RESULT_SUCCEEDED, this will be a NULL
+ * terminated string of ASCII characters. If this input is NULL \p serial_number_size will still be updated to return
+ * the size of the buffer needed to store the string.
+ *
+ * \param serial_number_size
+ * On input, the size of the \p serial_number buffer if that pointer is not NULL. On output, this value is set to the
+ * actual number of bytes in the serial number (including the null terminator).
+ *
+ * \returns
+ * A return of ::ZSA_BUFFER_RESULT_SUCCEEDED means that the \p serial_number has been filled in. If the buffer is too
+ * small the function returns ::ZSA_BUFFER_RESULT_TOO_SMALL and the size of the serial number is
+ * returned in the \p serial_number_size parameter. All other failures return ::ZSA_BUFFER_RESULT_FAILED.
+ *
+ * \relates zsa_device_t
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT zsa_buffer_result_t zsa_device_get_serialnum(zsa_device_t device_handle,
+                                                        char *serial_number,
+                                                        size_t *serial_number_size);
+
+/** Get the Azure Kinect color sensor control value.
+ *
+ * \param device_handle
+ * Handle obtained by zsa_device_open().
+ *
+ * \param command
+ * Color sensor control command.
+ *
+ * \param mode
+ * Location to store the color sensor's control mode. This mode represents whether the command is in automatic or
+ * manual mode.
+ *
+ * \param value
+ * Location to store the color sensor's control value. This value is always written, but is only valid when the \p mode
+ * returned is ::ZSA_COLOR_CONTROL_MODE_MANUAL for the current \p command.
+ *
+ * \returns
+ * ::ZSA_RESULT_SUCCEEDED if the value was successfully returned, ::ZSA_RESULT_FAILED if an error occurred
+ *
+ * \relates zsa_device_t
+ *
+ * \remarks
+ * Each control command may be set to manual or automatic. See the definition of \ref zsa_color_control_command_t on
+ * how to interpret the \p value for each command.
+ *
+ * \remarks
+ * Only the first call for a command reads the camera. Later calls return the last value set, or for the exposure time
+ * and white balance in automatic mode the value used for the latest frame, without waiting on the camera or on
+ * streaming, so they are cheap enough to poll.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT zsa_result_t zsa_device_get_color_control(zsa_device_t device_handle,
+                                                     zsa_color_control_command_t command,
+                                                     zsa_color_control_mode_t *mode,
+                                                     int32_t *value);
+
+/** Read the metadata of the color frames that arrived from the device.
+ *
+ * \param device_handle
+ * Handle obtained by zsa_device_open().
+ *
+ * \param frame_index
+ * On input, the zsa_color_frame_metadata_t::frame_index of the first frame to read; 0 starts at the oldest frame held.
+ * On output, the index to pass to the next call.
+ *
+ * \param metadata
+ * Array receiving the metadata of up to \p count frames, oldest first.
+ *
+ * \param count
+ * Number of entries in \p metadata.
+ *
+ * \returns
+ * Number of entries written, 0 when no new frame arrived.
+ *
+ * \relates zsa_device_t
+ *
+ * \remarks
+ * Every color frame is recorded as soon as it arrives, including frames whose captures are dropped later on because a
+ * queue is full or the images are not synchronized, which makes this suited to monitor auto exposure. The metadata of
+ * the last 256 frames is held. A reader that falls further behind misses frames, seen as a gap in frame_index.
+ *
+ * \remarks
+ * The call never waits and never delays streaming, and may be called from any thread.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT uint32_t zsa_device_read_color_metadata(zsa_device_t device_handle,
+                                                   uint64_t *frame_index,
+                                                   zsa_color_frame_metadata_t *metadata,
+                                                   uint32_t count);
+
+/** Set the Azure Kinect color sensor control value.
+ *
+ * \param device_handle
+ * Handle obtained by zsa_device_open().
+ *
+ * \param command
+ * Color sensor control command.
+ *
+ * \param mode
+ * Color sensor control mode to set. This mode represents whether the command is in automatic or manual mode.
+ *
+ * \param value
+ * Value to set the color sensor's control to. The value is only valid if \p mode
+ * is set to ::ZSA_COLOR_CONTROL_MODE_MANUAL, and is otherwise ignored.
+ *
+ * \returns
+ * ::ZSA_RESULT_SUCCEEDED if the value was queued, ::ZSA_RESULT_FAILED if the arguments are invalid
+ *
+ * \relates zsa_device_t
+ *
+ * \remarks
+ * The value is applied to the camera in the background, in the order of the calls, and reported by
+ * zsa_device_get_color_control() once the camera accepted it. Setting a command again before the previous value was
+ * applied replaces that value. A value the camera rejects is logged.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT zsa_result_t zsa_device_set_color_control(zsa_device_t device_handle,
+                                                     zsa_color_control_command_t command,
+                                                     zsa_color_control_mode_t mode,
+                                                     int32_t value);
+
+/** Group devices chained with sync cables so their captures are delivered together.
+ *
+ * \param device_handles
+ * Array of \p device_count handles obtained by zsa_device_open(). The devices must stay open until the group is
+ * destroyed.
+ *
+ * \param device_count
+ * Number of devices in the group.
+ *
+ * \param group_handle
+ * Output parameter which on success will return a handle to the group.
+ *
+ * \relates zsa_device_group_t
+ *
+ * \return ::ZSA_RESULT_SUCCEEDED if the group was created.
+ *
+ * \remarks
+ * Devices that belong to a group deliver their captures through zsa_device_group_get_capture_set() while the group's
+ * cameras are running. Destroy the group with zsa_device_group_destroy() before closing its devices.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT zsa_result_t zsa_device_group_create(const zsa_device_t *device_handles,
+                                                uint32_t device_count,
+                                                zsa_device_group_t *group_handle);
+
+/** Destroys a device group, stopping its cameras if they are running.
+ *
+ * \param group_handle
+ * Handle obtained by zsa_device_group_create().
+ *
+ * \relates zsa_device_group_t
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT void zsa_device_group_destroy(zsa_device_group_t group_handle);
+
+/** Starts the cameras of every device in a group.
+ *
+ * \param group_handle
+ * Handle obtained by zsa_device_group_create().
+ *
+ * \param configs
+ * One configuration per device, in the order the devices were passed to zsa_device_group_create(). A group of more
+ * than one device needs exactly one ::ZSA_WIRED_SYNC_MODE_MASTER and the rest ::ZSA_WIRED_SYNC_MODE_SUBORDINATE, all
+ * at the same camera_fps.
+ *
+ * \returns
+ * ::ZSA_RESULT_SUCCEEDED is returned on success.
+ *
+ * \relates zsa_device_group_t
+ *
+ * \remarks
+ * Subordinates are started before the master so that none of them misses the master's first sync pulse.
+ *
+ * \remarks
+ * Captures are grouped by device timestamp after removing each subordinate's subordinate_delay_off_master_usec. When
+ * synchronized_images_only is set on the master's configuration, only sets with a capture from every device are
+ * delivered.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT zsa_result_t zsa_device_group_start_cameras(zsa_device_group_t group_handle,
+                                                       const zsa_device_configuration_t *configs);
+
+/** Stops the cameras of every device in a group.
+ *
+ * \param group_handle
+ * Handle obtained by zsa_device_group_create().
+ *
+ * \relates zsa_device_group_t
+ *
+ * \remarks
+ * A thread blocked in zsa_device_group_get_capture_set() returns ::ZSA_WAIT_RESULT_FAILED.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT void zsa_device_group_stop_cameras(zsa_device_group_t group_handle);
+
+/** Reads the next set of captures triggered by the same sync pulse.
+ *
+ * \param group_handle
+ * Handle obtained by zsa_device_group_create().
+ *
+ * \param capture_handles
+ * Array with room for one capture per device, filled in device order. A device that missed the pulse gets NULL. The
+ * caller must release every capture returned with zsa_capture_release().
+ *
+ * \param timeout_in_ms
+ * Time in milliseconds to wait for a set, 0 to return immediately or ::ZSA_WAIT_INFINITE.
+ *
+ * \returns
+ * ::ZSA_WAIT_RESULT_SUCCEEDED if a set was returned, ::ZSA_WAIT_RESULT_TIMEOUT if none arrived in time, or
+ * ::ZSA_WAIT_RESULT_FAILED if the group is not streaming.
+ *
+ * \relates zsa_device_group_t
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT zsa_wait_result_t zsa_device_group_get_capture_set(zsa_device_group_t group_handle,
+                                                              zsa_capture_t *capture_handles,
+                                                              int32_t timeout_in_ms);
+
+/** Adds a reference to a capture.
+ *
+ * \param capture_handle
+ * Capture to add a reference to.
+ *
+ * \relates zsa_capture_t
+ *
+ * \remarks
+ * Each reference must be released with zsa_capture_release().
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT void zsa_capture_reference(zsa_capture_t capture_handle);
+
+/** Releases a capture.
+ *
+ * \param capture_handle
+ * Capture to release.
+ *
+ * \relates zsa_capture_t
+ *
+ * \remarks
+ * The capture and its images are freed once every reference is released, images the application still references
+ * stay valid.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT void zsa_capture_release(zsa_capture_t capture_handle);
+
+/** Gets the color image of a capture.
+ *
+ * \param capture_handle
+ * Capture holding the image.
+ *
+ * \returns
+ * A reference to the image, released with zsa_image_release(), or NULL if the capture has no color image.
+ *
+ * \relates zsa_capture_t
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT zsa_image_t zsa_capture_get_color_image(zsa_capture_t capture_handle);
+
+/** Gets the color image of a capture decoded to BGRA32.
+ *
+ * \param capture_handle
+ * Capture holding the image.
+ *
+ * \returns
+ * A reference to the image, released with zsa_image_release(), or NULL if the capture has no color image or it could
+ * not be decoded.
+ *
+ * \relates zsa_capture_t
+ *
+ * \remarks
+ * When the cameras were started with color_decode_on_demand, zsa_capture_get_color_image() returns the MJPEG image
+ * as the camera sent it, and this function decodes it to ::ZSA_IMAGE_FORMAT_COLOR_BGRA32 with color_scale and
+ * color_crop. The decode runs on the thread of the first caller and its result is kept on the capture, so later calls
+ * return the same image without decoding again. Otherwise this function returns the same image as
+ * zsa_capture_get_color_image().
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT zsa_image_t zsa_capture_get_color_decoded_image(zsa_capture_t capture_handle);
+
+/** Creates an image.
+ *
+ * \param format
+ * Format of the image.
+ *
+ * \param width_pixels
+ * Width in pixels.
+ *
+ * \param height_pixels
+ * Height in pixels.
+ *
+ * \param stride_bytes
+ * Bytes per row, at least the width times the bytes per pixel of the format.
+ *
+ * \param image_handle
+ * If successful this contains a handle to the image. Release it with zsa_image_release().
+ *
+ * \returns
+ * ::ZSA_RESULT_SUCCEEDED if the image was created.
+ *
+ * \relates zsa_image_t
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT zsa_result_t zsa_image_create(zsa_image_format_t format,
+                                         int width_pixels,
+                                         int height_pixels,
+                                         int stride_bytes,
+                                         zsa_image_t *image_handle);
+
+/** Gets the image buffer.
+ *
+ * \param image_handle
+ * Image to read.
+ *
+ * \returns
+ * The pixels, valid as long as a reference to the image is held. NULL if the image is invalid.
+ *
+ * \relates zsa_image_t
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT uint8_t *zsa_image_get_buffer(zsa_image_t image_handle);
+
+/** Gets the size of the image buffer in bytes.
+ *
+ * \relates zsa_image_t
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT size_t zsa_image_get_size(zsa_image_t image_handle);
+
+/** Gets the format of an image.
+ *
+ * \relates zsa_image_t
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT zsa_image_format_t zsa_image_get_format(zsa_image_t image_handle);
+
+/** Gets the width of an image in pixels, 0 for compressed formats.
+ *
+ * \relates zsa_image_t
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT int zsa_image_get_width_pixels(zsa_image_t image_handle);
+
+/** Gets the height of an image in pixels, 0 for compressed formats.
+ *
+ * \relates zsa_image_t
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT int zsa_image_get_height_pixels(zsa_image_t image_handle);
+
+/** Gets the bytes per row of an image, 0 for compressed formats.
+ *
+ * \relates zsa_image_t
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT int zsa_image_get_stride_bytes(zsa_image_t image_handle);
+
+/** Gets the device timestamp of an image in microseconds.
+ *
+ * \relates zsa_image_t
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT uint64_t zsa_image_get_device_timestamp_usec(zsa_image_t image_handle);
+
+/** Gets the host timestamp of an image in nanoseconds.
+ *
+ * \relates zsa_image_t
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT uint64_t zsa_image_get_system_timestamp_nsec(zsa_image_t image_handle);
+
+/** Adds a reference to an image.
+ *
+ * \param image_handle
+ * Image to add a reference to.
+ *
+ * \relates zsa_image_t
+ *
+ * \remarks
+ * Each reference must be released with zsa_image_release().
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT void zsa_image_reference(zsa_image_t image_handle);
+
+/** Releases an image.
+ *
+ * \param image_handle
+ * Image to release.
+ *
+ * \relates zsa_image_t
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT void zsa_image_release(zsa_image_t image_handle);
+
+/** Selects the memory serving the images of a memory source.
+ *
+ * \param source
+ * Part of the SDK allocating the images.
+ *
+ * \param backend
+ * Memory the images of \p source are allocated from.
+ *
+ * \param numa_node
+ * NUMA node the memory of ::ZSA_MEMORY_BACKEND_HUGE_PAGES images is bound to, or ::ZSA_NUMA_NODE_ANY.
+ *
+ * \returns
+ * ::ZSA_RESULT_SUCCEEDED if the backend was selected, ::ZSA_RESULT_FAILED for an invalid argument or
+ * ::ZSA_MEMORY_BACKEND_HUGE_PAGES on Windows.
+ *
+ * \remarks
+ * The setting applies to the whole process and to images allocated after the call; images allocated before are freed
+ * with the memory they came from.
+ *
+ * \remarks
+ * ::ZSA_MEMORY_BACKEND_HUGE_PAGES maps every image on its own from reserved huge pages, falling back to regular pages
+ * that the kernel may merge into transparent huge pages when none are reserved. While a device is open, the mappings
+ * of freed images are kept for reuse by the next images of the same size.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT zsa_result_t zsa_set_memory_backend(zsa_memory_source_t source,
+                                               zsa_memory_backend_t backend,
+                                               int numa_node);
+
+/** Reads the counters of the images a memory source allocated from huge pages.
+ *
+ * \param source
+ * Part of the SDK allocating the images.
+ *
+ * \param stats
+ * Location to write the counters to.
+ *
+ * \returns
+ * ::ZSA_RESULT_SUCCEEDED if the counters were read.
+ *
+ * \remarks
+ * The counters start when the process does and are kept across calls to zsa_set_memory_backend().
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT zsa_result_t zsa_get_memory_backend_stats(zsa_memory_source_t source, zsa_memory_backend_stats_t *stats);
+
+/** Sets the memory budget of a memory source.
+ *
+ * \param source
+ * Part of the SDK allocating the images.
+ *
+ * \param budget_bytes
+ * Bytes the images of \p source not freed yet may add up to, 0 for no budget.
+ *
+ * \param policy
+ * What happens over budget.
+ *
+ * \returns
+ * ::ZSA_RESULT_SUCCEEDED if the budget was set.
+ *
+ * \remarks
+ * With ::ZSA_MEMORY_BUDGET_SHED the sensors shed load before it costs memory: the color camera drops frames before
+ * they are copied or decoded and the USB streams keep fewer transfers in flight. Images allocated meanwhile, such as
+ * color images decoded on demand, are still allocated. With ::ZSA_MEMORY_BUDGET_FAIL every allocation that would go
+ * over the budget fails, losing the frame it was for.
+ *
+ * \remarks
+ * Budgets apply to the whole process. Images the application holds on to count until it releases them.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT zsa_result_t zsa_set_memory_budget(zsa_memory_source_t source,
+                                              size_t budget_bytes,
+                                              zsa_memory_budget_policy_t policy);
+
+/** Sets the memory budget of all memory sources together.
+ *
+ * \param budget_bytes
+ * Bytes the images of all sources not freed yet may add up to, 0 for no budget.
+ *
+ * \remarks
+ * Each source applies its policy, see zsa_set_memory_budget(), to this budget as well as its own.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT void zsa_set_total_memory_budget(size_t budget_bytes);
+
+/** Reads the memory used by the SDK.
+ *
+ * \param usage
+ * Location to write the memory in flight, the budgets and the load shed to.
+ *
+ * \returns
+ * ::ZSA_RESULT_SUCCEEDED if the usage was read.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
+ *   <requirement name="Library">zsa.lib</requirement>
+ *   <requirement name="DLL">zsa.dll</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_EXPORT zsa_result_t zsa_get_memory_usage(zsa_memory_usage_t *usage);
+
 
 /**
  * @}
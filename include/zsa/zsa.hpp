@@ -17,6 +17,15 @@
 #include <string>
 #include <vector>
 
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#include <atomic>
+#include <coroutine>
+#include <functional>
+#define ZSA_HPP_COROUTINES 1
+#endif
+#endif
+
 namespace zsa
 {
 
@@ -540,6 +549,16 @@ public:
         return image(zsa_capture_get_color_image(m_handle));
     }
 
+    /** Get the color image associated with the capture, decoded to BGRA32 on the first call when the cameras were
+     * started with color_decode_on_demand
+     *
+     * \sa zsa_capture_get_color_decoded_image
+     */
+    image get_color_decoded_image() const noexcept
+    {
+        return image(zsa_capture_get_color_decoded_image(m_handle));
+    }
+
     /** Get the depth image associated with the capture
      *
      * \sa zsa_capture_get_depth_image
@@ -1065,6 +1084,157 @@ private:
     resolution m_depth_resolution;
 };
 
+/** \class subscriber zsa.hpp <zsa/zsa.hpp>
+ * Wrapper for \ref zsa_subscriber_t
+ *
+ * Wraps a handle for a subscriber. Subscribers must be destroyed before the device they were created from.
+ */
+class subscriber
+{
+public:
+    /** Creates a subscriber from a zsa_subscriber_t
+     * Takes ownership of the handle, i.e. you should not call zsa_subscriber_close on the handle after giving it to the
+     * subscriber; the subscriber will take care of that.
+     */
+    subscriber(zsa_subscriber_t handle = nullptr) noexcept : m_handle(handle) {}
+
+    /** Moves another subscriber into a new subscriber
+     */
+    subscriber(subscriber &&other) noexcept : m_handle(other.m_handle)
+    {
+        other.m_handle = nullptr;
+    }
+
+    subscriber(const subscriber &) = delete;
+
+    ~subscriber()
+    {
+        close();
+    }
+
+    subscriber &operator=(const subscriber &) = delete;
+
+    /** Moves another subscriber into this subscriber; other is set to invalid
+     */
+    subscriber &operator=(subscriber &&other) noexcept
+    {
+        if (this != &other)
+        {
+            close();
+            m_handle = other.m_handle;
+            other.m_handle = nullptr;
+        }
+        return *this;
+    }
+
+    /** Returns true if the subscriber is valid, false otherwise
+     */
+    operator bool() const noexcept
+    {
+        return m_handle != nullptr;
+    }
+
+    /** Returns the underlying zsa_subscriber_t handle
+     */
+    zsa_subscriber_t handle() const noexcept
+    {
+        return m_handle;
+    }
+
+    /** Removes the subscriber from its device.
+     *
+     * \sa zsa_subscriber_close
+     */
+    void close() noexcept
+    {
+        if (m_handle != nullptr)
+        {
+            zsa_subscriber_close(m_handle);
+            m_handle = nullptr;
+        }
+    }
+
+    /** Reads a capture into cap.  Returns true if a capture was read, false if the read timed out.
+     * Throws error on failure.
+     *
+     * \sa zsa_subscriber_get_capture
+     */
+    bool get_capture(capture *cap, std::chrono::milliseconds timeout)
+    {
+        zsa_capture_t capture_handle = nullptr;
+        int32_t timeout_ms = internal::clamp_cast<int32_t>(timeout.count());
+        zsa_wait_result_t result = zsa_subscriber_get_capture(m_handle, &capture_handle, timeout_ms);
+        if (result == ZSA_WAIT_RESULT_FAILED)
+        {
+            throw error("Failed to get capture from subscriber!");
+        }
+        else if (result == ZSA_WAIT_RESULT_TIMEOUT)
+        {
+            return false;
+        }
+
+        *cap = capture(capture_handle);
+        return true;
+    }
+
+    /** Appends every capture queued to caps without waiting.  Returns the number of captures appended.
+     * Throws error on failure.
+     *
+     * \sa zsa_subscriber_get_captures
+     */
+    size_t get_captures(std::vector<capture> *caps)
+    {
+        zsa_capture_t capture_handles[16];
+        size_t total = 0;
+        for (;;)
+        {
+            uint32_t count = 0;
+            zsa_wait_result_t result = zsa_subscriber_get_captures(m_handle, capture_handles, 16, &count);
+            if (result == ZSA_WAIT_RESULT_FAILED)
+            {
+                throw error("Failed to get captures from subscriber!");
+            }
+            for (uint32_t i = 0; i < count; i++)
+            {
+                caps->emplace_back(capture_handles[i]);
+            }
+            total += count;
+            if (result == ZSA_WAIT_RESULT_TIMEOUT || count < 16)
+            {
+                return total;
+            }
+        }
+    }
+
+    /** Returns a file descriptor readable while captures are queued, -1 when there is none.
+     *
+     * \sa zsa_subscriber_get_event_fd
+     */
+    int get_event_fd() const noexcept
+    {
+        return zsa_subscriber_get_event_fd(m_handle);
+    }
+
+    /** Returns the counters of the subscriber
+     * Throws error on failure.
+     *
+     * \sa zsa_subscriber_get_stats
+     */
+    zsa_queue_stats_t get_stats() const
+    {
+        zsa_queue_stats_t stats;
+        zsa_result_t result = zsa_subscriber_get_stats(m_handle, &stats);
+        if (ZSA_RESULT_SUCCEEDED != result)
+        {
+            throw error("Failed to read subscriber counters!");
+        }
+        return stats;
+    }
+
+private:
+    zsa_subscriber_t m_handle;
+};
+
 /** \class device zsa.hpp <zsa/zsa.hpp>
  * Wrapper for \ref zsa_device_t
  *
@@ -1172,6 +1342,141 @@ public:
         return get_capture(cap, std::chrono::milliseconds(ZSA_WAIT_INFINITE));
     }
 
+    /** Sets what happens to the captures get_capture() does not read in time
+     * Throws error on failure.
+     *
+     * \sa zsa_device_set_capture_overflow_policy
+     */
+    void set_capture_overflow_policy(zsa_queue_overflow_policy_t policy, size_t max_bytes = 0)
+    {
+        zsa_result_t result = zsa_device_set_capture_overflow_policy(m_handle, policy, max_bytes);
+        if (ZSA_RESULT_SUCCEEDED != result)
+        {
+            throw error("Failed to set capture overflow policy!");
+        }
+    }
+
+    /** Returns the counters of the queue get_capture() reads from
+     * Throws error on failure.
+     *
+     * \sa zsa_device_get_capture_queue_stats
+     */
+    zsa_queue_stats_t get_capture_queue_stats() const
+    {
+        zsa_queue_stats_t stats;
+        zsa_result_t result = zsa_device_get_capture_queue_stats(m_handle, &stats);
+        if (ZSA_RESULT_SUCCEEDED != result)
+        {
+            throw error("Failed to read capture queue counters!");
+        }
+        return stats;
+    }
+
+    /** Adds a queue receiving every capture of the device
+     * Throws error on failure.
+     *
+     * \sa zsa_device_subscribe
+     */
+    subscriber subscribe(uint32_t queue_depth = 0,
+                         zsa_queue_overflow_policy_t policy = ZSA_QUEUE_OVERFLOW_DROP_OLDEST,
+                         size_t max_bytes = 0)
+    {
+        zsa_subscriber_t handle = nullptr;
+        zsa_result_t result = zsa_device_subscribe(m_handle, queue_depth, policy, max_bytes, &handle);
+        if (ZSA_RESULT_SUCCEEDED != result)
+        {
+            throw error("Failed to subscribe to device!");
+        }
+        return subscriber(handle);
+    }
+
+#ifdef ZSA_HPP_COROUTINES
+    /** Schedules a suspended coroutine on a thread of the application, see device::next_capture()
+     */
+    using capture_executor = std::function<void(std::coroutine_handle<>)>;
+
+    /** Awaitable reading the next capture of a device, returned by device::next_capture()
+     */
+    class capture_awaiter
+    {
+    public:
+        capture_awaiter(zsa_device_t handle, capture_executor executor) noexcept :
+            m_handle(handle),
+            m_executor(std::move(executor))
+        {
+        }
+
+        // The SDK holds the address of the awaiter until the capture arrives
+        capture_awaiter(const capture_awaiter &) = delete;
+        capture_awaiter &operator=(const capture_awaiter &) = delete;
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        bool await_suspend(std::coroutine_handle<> awaiting) noexcept
+        {
+            m_awaiting = awaiting;
+            if (zsa_device_get_capture_async(m_handle, &capture_awaiter::capture_ready, this) != ZSA_RESULT_SUCCEEDED)
+            {
+                m_result = ZSA_WAIT_RESULT_FAILED;
+                return false;
+            }
+
+            // The callback may have run on this thread already, then the coroutine carries on without suspending
+            return !m_completed.exchange(true, std::memory_order_acq_rel);
+        }
+
+        capture await_resume()
+        {
+            if (m_result != ZSA_WAIT_RESULT_SUCCEEDED)
+            {
+                throw error("Failed to get capture from device!");
+            }
+            return capture(m_capture);
+        }
+
+    private:
+        static void capture_ready(void *context, zsa_wait_result_t result, zsa_capture_t capture_handle)
+        {
+            capture_awaiter *awaiter = static_cast<capture_awaiter *>(context);
+            awaiter->m_result = result;
+            awaiter->m_capture = capture_handle;
+
+            // Whichever of await_suspend() and this callback finishes second continues the coroutine. This runs on an
+            // SDK streaming thread, so the coroutine is handed to the executor rather than resumed here.
+            if (awaiter->m_completed.exchange(true, std::memory_order_acq_rel))
+            {
+                awaiter->m_executor(awaiter->m_awaiting);
+            }
+        }
+
+        zsa_device_t m_handle;
+        capture_executor m_executor;
+        std::coroutine_handle<> m_awaiting;
+        std::atomic<bool> m_completed{ false };
+        zsa_wait_result_t m_result = ZSA_WAIT_RESULT_FAILED;
+        zsa_capture_t m_capture = nullptr;
+    };
+
+    /** Reads a sensor capture with co_await, without blocking a thread while waiting for it.
+     * Throws error on failure, including when the cameras stop first.
+     *
+     * The coroutine carries on without suspending when a capture is already queued. Otherwise executor is called with
+     * the suspended coroutine on the SDK thread that delivered the capture, from inside the delivery of the capture. It
+     * must only queue the coroutine to be resumed on a thread of the application, such as an event loop; resuming it
+     * there would stall streaming, and stopping the device from it would deadlock. Only one read may be pending per
+     * device.
+     *
+     * \sa zsa_device_get_capture_async
+     */
+    capture_awaiter next_capture(capture_executor executor) const noexcept
+    {
+        return capture_awaiter(m_handle, std::move(executor));
+    }
+#endif
+
     /** Reads an IMU sample.  Returns true if a sample was read, false if the read timed out.
      * Throws error on failure.
      *
@@ -1226,6 +1531,20 @@ public:
         zsa_device_stop_cameras(m_handle);
     }
 
+    /** Keeps the ZSA device's cameras streaming without delivering captures, for a fast restart
+     * Throws error on failure.
+     *
+     * \sa zsa_device_standby_cameras
+     */
+    void standby_cameras()
+    {
+        zsa_result_t result = zsa_device_standby_cameras(m_handle);
+        if (ZSA_RESULT_SUCCEEDED != result)
+        {
+            throw error("Failed to put cameras in standby!");
+        }
+    }
+
     /** Starts the ZSA IMU
      * Throws error on failure
      *
@@ -1249,6 +1568,43 @@ public:
         zsa_device_stop_imu(m_handle);
     }
 
+    /** Starts keeping the last seconds of captures in memory
+     * Throws error on failure
+     *
+     * \sa zsa_device_start_flight_recorder
+     */
+    void start_flight_recorder(const zsa_flight_recorder_configuration_t &configuration)
+    {
+        zsa_result_t result = zsa_device_start_flight_recorder(m_handle, &configuration);
+        if (ZSA_RESULT_SUCCEEDED != result)
+        {
+            throw error("Failed to start flight recorder!");
+        }
+    }
+
+    /** Writes the captures kept by the flight recorder to a file
+     * Throws error on failure
+     *
+     * \sa zsa_device_dump_flight_recorder
+     */
+    void dump_flight_recorder(const std::string &path)
+    {
+        zsa_result_t result = zsa_device_dump_flight_recorder(m_handle, path.c_str());
+        if (ZSA_RESULT_SUCCEEDED != result)
+        {
+            throw error("Failed to dump flight recorder!");
+        }
+    }
+
+    /** Stops the flight recorder
+     *
+     * \sa zsa_device_stop_flight_recorder
+     */
+    void stop_flight_recorder() noexcept
+    {
+        zsa_device_stop_flight_recorder(m_handle);
+    }
+
     /** Get the ZSA device serial number
      * Throws error on failure.
      *
@@ -1309,6 +1665,21 @@ public:
         }
     }
 
+    /** Read the metadata of the color frames that arrived since \p frame_index
+     *
+     * \sa zsa_device_read_color_metadata
+     */
+    std::vector<zsa_color_frame_metadata_t> read_color_metadata(uint64_t *frame_index) const
+    {
+        std::vector<zsa_color_frame_metadata_t> metadata(256);
+        uint32_t count = zsa_device_read_color_metadata(m_handle,
+                                                        frame_index,
+                                                        metadata.data(),
+                                                        static_cast<uint32_t>(metadata.size()));
+        metadata.resize(count);
+        return metadata;
+    }
+
     /** Get the raw calibration blob for the entire ZSA device.
      * Throws error on failure.
      *
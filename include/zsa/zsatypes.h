@@ -65,6 +65,35 @@ extern "C" {
  */
 ZSA_DECLARE_HANDLE(zsa_device_t);
 
+/** \class zsa_device_group_t zsa.h <zsa/zsa.h>
+ * Handle to a group of Azure Kinect devices chained with sync cables.
+ *
+ * \remarks
+ * Handles are created with zsa_device_group_create() and closed with zsa_device_group_destroy(). Invalid handles are
+ * set to 0.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsatypes.h (include zsa/zsa.h)</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_DECLARE_HANDLE(zsa_device_group_t);
+
+/** \class zsa_client_t zsa.h <zsa/zsa.h>
+ * Handle to a connection to the camera server of another process.
+ *
+ * \remarks
+ * Handles are created with zsa_client_open() and closed with zsa_client_close(). Invalid handles are set to 0.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsatypes.h (include zsa/zsa.h)</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_DECLARE_HANDLE(zsa_client_t);
+
 /** \class zsa_capture_t zsa.h <zsa/zsa.h>
  * Handle to an Azure Kinect capture.
  *
@@ -194,6 +223,20 @@ ZSA_DECLARE_HANDLE(zsa_image_t);
  */
 ZSA_DECLARE_HANDLE(zsa_transformation_t);
 
+/** \class zsa_subscriber_t zsa.h <zsa/zsa.h>
+ * Handle to a queue receiving every capture of a device alongside the application.
+ *
+ * \remarks
+ * Handles are created with zsa_device_subscribe() and closed with zsa_subscriber_close(). Invalid handles are set to 0.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsatypes.h (include zsa/zsa.h)</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+ZSA_DECLARE_HANDLE(zsa_subscriber_t);
+
 /**
  *
  * @}
@@ -317,6 +360,46 @@ typedef enum
     ZSA_COLOR_RESOLUTION_3072P,   /**< 4096 * 3072 4:3  */
 } zsa_color_resolution_t;
 
+/** Scale MJPEG color frames are decoded at.
+ *
+ * \remarks
+ * Only applies when ::ZSA_IMAGE_FORMAT_COLOR_BGRA32 images are produced. The JPEG decoder skips the detail that is not
+ * needed, so decoding at a reduced scale takes about as much less time and memory as the image is smaller.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsatypes.h (include zsa/zsa.h)</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+typedef enum
+{
+    ZSA_COLOR_SCALE_FULL = 0, /**< Color resolution */
+    ZSA_COLOR_SCALE_HALF,     /**< Half the width and height of the color resolution, rounded up */
+    ZSA_COLOR_SCALE_QUARTER,  /**< A quarter of the width and height of the color resolution, rounded up */
+    ZSA_COLOR_SCALE_EIGHTH,   /**< An eighth of the width and height of the color resolution, rounded up */
+} zsa_color_scale_t;
+
+/** Region of the color image to decode.
+ *
+ * \remarks
+ * In pixels of the image after scaling by zsa_device_configuration_t::color_scale. A width or height of 0 decodes the
+ * whole image.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsatypes.h (include zsa/zsa.h)</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+typedef struct _zsa_color_crop_t
+{
+    uint32_t x;      /**< Left column of the region. */
+    uint32_t y;      /**< Top row of the region. */
+    uint32_t width;  /**< Width of the region. */
+    uint32_t height; /**< Height of the region. */
+} zsa_color_crop_t;
+
 /** Image format type.
  *
  * \remarks
@@ -720,6 +803,81 @@ typedef enum
     ZSA_FIRMWARE_SIGNATURE_UNSIGNED /**< Unsigned firmware. */
 } zsa_firmware_signature_t;
 
+/** What happens to captures a reader does not read in time.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsatypes.h (include zsa/zsa.h)</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+typedef enum
+{
+    ZSA_QUEUE_OVERFLOW_DROP_OLDEST = 0, /**< Drop the oldest capture to make room. The default. */
+    ZSA_QUEUE_OVERFLOW_DROP_NEWEST,     /**< Drop the new capture, keeping the ones queued. */
+    ZSA_QUEUE_OVERFLOW_KEEP_LATEST,     /**< Hold only the newest capture. */
+    ZSA_QUEUE_OVERFLOW_BOUNDED_BYTES,   /**< Drop the oldest captures until the queued images fit a number of bytes. */
+} zsa_queue_overflow_policy_t;
+
+/** Code allocating the memory of images.
+ *
+ * \remarks
+ * Passed to zsa_set_memory_backend() to choose the memory of the images one part of the SDK allocates.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsatypes.h (include zsa/zsa.h)</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+typedef enum
+{
+    ZSA_MEMORY_SOURCE_USER = 0,  /**< Images created by the application with zsa_image_create(). */
+    ZSA_MEMORY_SOURCE_DEPTH,     /**< Depth and IR images. */
+    ZSA_MEMORY_SOURCE_COLOR,     /**< Color images, including the ones decoded from MJPEG. */
+    ZSA_MEMORY_SOURCE_IMU,       /**< IMU samples. */
+    ZSA_MEMORY_SOURCE_USB_DEPTH, /**< Transfers of the depth camera. */
+    ZSA_MEMORY_SOURCE_USB_IMU,   /**< Transfers of the IMU. */
+} zsa_memory_source_t;
+
+/** Number of memory sources, the size of zsa_memory_usage_t::sources.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsatypes.h (include zsa/zsa.h)</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+#define ZSA_MEMORY_SOURCE_COUNT (ZSA_MEMORY_SOURCE_USB_IMU + 1)
+
+/** Memory serving the images of a memory source.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsatypes.h (include zsa/zsa.h)</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+typedef enum
+{
+    ZSA_MEMORY_BACKEND_HEAP = 0,   /**< The process heap. The default. */
+    ZSA_MEMORY_BACKEND_HUGE_PAGES, /**< 2 MiB pages mapped by the SDK. Not supported on Windows. */
+} zsa_memory_backend_t;
+
+/** What happens to a memory source over its memory budget.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsatypes.h (include zsa/zsa.h)</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+typedef enum
+{
+    ZSA_MEMORY_BUDGET_SHED = 0, /**< Drop frames and hold back transfers before allocating them. The default. */
+    ZSA_MEMORY_BUDGET_FAIL,     /**< Fail every allocation that would go over the budget. */
+} zsa_memory_budget_policy_t;
+
 /**
  *
  * @}
@@ -873,8 +1031,8 @@ typedef void(zsa_memory_destroy_cb_t)(void *buffer, void *context);
  * Minimum size in bytes needed for the buffer.
  *
  * \param context
- * Output parameter for a context that will be provided in the subsequent call to the \ref zsa_memory_destroy_cb_t
- * callback.
+ * On entry, the context the allocator was registered with, NULL if none. On return, the context that will be provided
+ * in the subsequent call to the \ref zsa_memory_destroy_cb_t callback.
  *
  * \return
  * A pointer to the newly allocated memory.
@@ -891,6 +1049,60 @@ typedef void(zsa_memory_destroy_cb_t)(void *buffer, void *context);
  */
 typedef uint8_t *(zsa_memory_allocate_cb_t)(int size, void **context);
 
+/** Callback function for a memory allocation with an alignment requirement.
+ *
+ * \param size
+ * Minimum size in bytes needed for the buffer.
+ *
+ * \param alignment
+ * Alignment in bytes the buffer must start at, a power of 2 such as 64 for a cache line, 4096 for a page or 2097152
+ * for a huge page.
+ *
+ * \param context
+ * On entry, the context the allocator was registered with, NULL if none. On return, the context that will be provided
+ * in the subsequent call to the \ref zsa_memory_destroy_cb_t callback.
+ *
+ * \return
+ * A pointer to the newly allocated memory, aligned to \p alignment.
+ *
+ * \remarks
+ * A callback of this type is provided when there is an application defined allocator able to honor the alignment of
+ * frame buffers. The SDK keeps its bookkeeping outside of the buffer, so all of the memory returned is image data.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsatypes.h (include zsa/zsa.h)</requirement>
+ * </requirements>
+ * \endxmlonly
+ *
+ */
+typedef uint8_t *(zsa_memory_allocate_aligned_cb_t)(int size, int alignment, void **context);
+
+/** Callback function completing a call to zsa_device_get_capture_async().
+ *
+ * \param context
+ * The context supplied to zsa_device_get_capture_async().
+ *
+ * \param result
+ * ::ZSA_WAIT_RESULT_SUCCEEDED when a capture is returned, ::ZSA_WAIT_RESULT_FAILED when the cameras stopped or failed.
+ *
+ * \param capture_handle
+ * The capture, NULL on failure. The callee owns the reference and must release it with zsa_capture_release().
+ *
+ * \remarks
+ * The callback runs once per call, either on the thread calling zsa_device_get_capture_async() when a capture is
+ * already queued, or on the SDK thread that delivered the capture. Work done in the callback delays the next capture,
+ * so long work should be handed off. The device must not be stopped or closed from the callback.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsatypes.h (include zsa/zsa.h)</requirement>
+ * </requirements>
+ * \endxmlonly
+ *
+ */
+typedef void(zsa_capture_ready_cb_t)(void *context, zsa_wait_result_t result, zsa_capture_t capture_handle);
+
 /**
  *
  * @}
@@ -983,8 +1195,83 @@ typedef struct _zsa_device_configuration_t
      *
      * This setting disables that behavior and keeps the LED in an off state. */
     bool disable_streaming_indicator;
+
+    /** Scale MJPEG frames are decoded at when color_format is ::ZSA_IMAGE_FORMAT_COLOR_BGRA32 or color_decode_on_demand
+     * is set.
+     *
+     * The size of the images produced is reported by zsa_image_get_width_pixels() and zsa_image_get_height_pixels().
+     * Otherwise this setting has no effect. */
+    zsa_color_scale_t color_scale;
+
+    /** Region of the scaled image to decode when color_format is ::ZSA_IMAGE_FORMAT_COLOR_BGRA32 or
+     * color_decode_on_demand is set.
+     *
+     * Rows above and below the region are skipped by the decoder and columns outside it are mostly skipped too. The
+     * region must lie within the scaled image. Otherwise this setting has no effect. */
+    zsa_color_crop_t color_crop;
+
+    /** Offer a BGRA32 image decoded on demand next to each MJPEG color image.
+     *
+     * Requires color_format ::ZSA_IMAGE_FORMAT_COLOR_MJPG. The color image of each capture stays the MJPEG frame sent
+     * by the camera. The BGRA32 image is decoded with color_scale and color_crop when it is first requested from the
+     * capture, on the requesting thread, and kept on the capture for later requests. Captures nobody requests it from
+     * are never decoded. */
+    bool color_decode_on_demand;
 } zsa_device_configuration_t;
 
+/** Shared memory of a camera server.
+ *
+ * \remarks
+ * Used by zsa_device_start_server(). Memory is only committed for the bytes images use, so slots can be sized for the
+ * largest image without holding that much memory for smaller ones.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsatypes.h (include zsa/zsa.h)</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+typedef struct _zsa_server_configuration_t
+{
+    /** Slots holding one image each, up to 64. Slots are held by the captures published and by the images clients
+     * have not released. */
+    uint32_t slot_count;
+
+    /** Bytes of a slot, at least the size of the largest image shared. */
+    size_t slot_size_bytes;
+
+    /** Captures kept published for clients to read, up to 16. */
+    uint32_t ring_size;
+} zsa_server_configuration_t;
+
+/** Memory and dump trigger of a flight recorder.
+ *
+ * \remarks
+ * Used by zsa_device_start_flight_recorder().
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsatypes.h (include zsa/zsa.h)</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+typedef struct _zsa_flight_recorder_configuration_t
+{
+    /** Milliseconds of captures kept, counted back from the newest one. */
+    uint32_t duration_ms;
+
+    /** Bytes of the ring the images are copied into, allocated when the recorder starts. The oldest captures are
+     * dropped early when the window does not fit. */
+    size_t memory_bytes;
+
+    /** Signal writing the captures kept to a file, such as SIGUSR1 on Linux. 0 for none. */
+    int dump_signal;
+
+    /** Path the files written on dump_signal start with, followed by the time of the dump and a counter. Required
+     * with dump_signal. */
+    const char *dump_path;
+} zsa_flight_recorder_configuration_t;
+
 /** Extrinsic calibration data.
  *
  * \remarks
@@ -1205,6 +1492,105 @@ typedef struct _zsa_imu_sample_t
     uint64_t gyro_timestamp_usec; /**< Timestamp of the gyroscope in microseconds */
 } zsa_imu_sample_t;
 
+/** Metadata of one color frame, recorded as the frame arrives from the camera.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsatypes.h (include zsa/zsa.h)</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+typedef struct _zsa_color_frame_metadata_t
+{
+    uint64_t frame_index;           /**< Count of frames that arrived before this one since the device was opened. */
+    uint64_t device_timestamp_usec; /**< Device timestamp of the frame in microseconds. */
+    uint64_t system_timestamp_nsec; /**< Host time the frame finished arriving, in nanoseconds. */
+    uint64_t exposure_usec;         /**< Exposure time in microseconds, 0 when not reported. */
+    uint32_t iso_speed;             /**< ISO speed, 0 when not reported. */
+    uint32_t white_balance;         /**< White balance in Kelvin, 0 when not reported. */
+    uint64_t size_bytes;            /**< Size of the frame as received, before any decoding. */
+} zsa_color_frame_metadata_t;
+
+/** Counters of a capture queue.
+ *
+ * \remarks
+ * Read with zsa_device_get_capture_queue_stats() and zsa_subscriber_get_stats().
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsatypes.h (include zsa/zsa.h)</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+typedef struct _zsa_queue_stats_t
+{
+    uint32_t count;             /**< Captures queued. */
+    uint32_t max_count;         /**< Most captures queued at once. */
+    uint64_t bytes;             /**< Bytes of the images queued. */
+    uint64_t pushed;            /**< Captures queued since the device was opened. */
+    uint64_t popped;            /**< Captures read. */
+    uint64_t dropped_oldest;    /**< Queued captures dropped to make room. */
+    uint64_t dropped_newest;    /**< Captures dropped instead of being queued. */
+    uint64_t lag_usec;          /**< Time the oldest queued capture has been waiting, 0 when empty. */
+    uint64_t last_pop_lag_usec; /**< Time the capture read last spent queued. */
+    uint64_t max_pop_lag_usec;  /**< Longest time a capture read spent queued. */
+} zsa_queue_stats_t;
+
+/** Counters of the images a memory source allocated from huge pages.
+ *
+ * \remarks
+ * Read with zsa_get_memory_backend_stats().
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsatypes.h (include zsa/zsa.h)</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+typedef struct _zsa_memory_backend_stats_t
+{
+    uint64_t allocations;           /**< Images allocated with ZSA_MEMORY_BACKEND_HUGE_PAGES. */
+    uint64_t huge_page_allocations; /**< Images backed by reserved huge pages rather than regular pages. */
+    uint64_t cached_allocations;    /**< Images reusing the mapping of a freed image. */
+    uint64_t numa_bind_failures;    /**< Images that could not be bound to the NUMA node requested. */
+} zsa_memory_backend_stats_t;
+
+/** Memory used by a memory source.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsatypes.h (include zsa/zsa.h)</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+typedef struct _zsa_memory_source_usage_t
+{
+    int64_t bytes_in_flight;                  /**< Bytes of images allocated and not freed yet. */
+    int64_t peak_bytes_in_flight;             /**< Highest bytes_in_flight since the process started. */
+    uint64_t budget_bytes;                    /**< Budget of the source, 0 if none. */
+    zsa_memory_budget_policy_t budget_policy; /**< What happens over budget. */
+    uint64_t shed_count;                      /**< Frames dropped or transfers held back over budget. */
+    uint64_t failed_allocations;              /**< Allocations failed over budget. */
+} zsa_memory_source_usage_t;
+
+/** Memory used by the SDK.
+ *
+ * \remarks
+ * Read with zsa_get_memory_usage().
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsatypes.h (include zsa/zsa.h)</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+typedef struct _zsa_memory_usage_t
+{
+    int64_t bytes_in_flight; /**< Bytes of images allocated and not freed yet by all sources. */
+    uint64_t budget_bytes;   /**< Budget of all sources together, 0 if none. */
+    zsa_memory_source_usage_t sources[ZSA_MEMORY_SOURCE_COUNT]; /**< Usage of each source, by zsa_memory_source_t. */
+} zsa_memory_usage_t;
+
 /**
  *
  * @}
@@ -1239,6 +1625,18 @@ typedef struct _zsa_imu_sample_t
  */
 #define ZSA_WAIT_INFINITE (-1)
 
+/** A NUMA node argument not binding memory to any node.
+ *
+ * Passed as an argument to \ref zsa_set_memory_backend()
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsatypes.h (include zsa/zsa.h)</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+#define ZSA_NUMA_NODE_ANY (-1)
+
 /** Initial configuration setting for disabling all sensors.
  *
  * \remarks
@@ -1258,8 +1656,34 @@ static const zsa_device_configuration_t ZSA_DEVICE_CONFIG_INIT_DISABLE_ALL = { Z
                                                                                0,
                                                                                ZSA_WIRED_SYNC_MODE_STANDALONE,
                                                                                0,
+                                                                               false,
+                                                                               ZSA_COLOR_SCALE_FULL,
+                                                                               { 0, 0, 0, 0 },
                                                                                false };
 
+/** Default shared memory of a camera server, sized for 4096x3072 BGRA32 color images.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsatypes.h (include zsa/zsa.h)</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+static const zsa_server_configuration_t ZSA_SERVER_CONFIG_INIT_DEFAULT = { 32, 4096 * 3072 * 4, 4 };
+
+/** Default flight recorder, keeping 30 seconds of captures in up to 256 MiB without a dump signal.
+ *
+ * \xmlonly
+ * <requirements>
+ *   <requirement name="Header">zsatypes.h (include zsa/zsa.h)</requirement>
+ * </requirements>
+ * \endxmlonly
+ */
+static const zsa_flight_recorder_configuration_t ZSA_FLIGHT_RECORDER_CONFIG_INIT_DEFAULT = { 30000,
+                                                                                              256 * 1024 * 1024,
+                                                                                              0,
+                                                                                              NULL };
+
 /**
  * @}
  */
@@ -35,6 +35,85 @@ typedef enum
     ALLOCATION_SOURCE_COM_IMU,   /**< Memory was allocated by the USB reader */
 } allocation_source_t;
 
+/** Sources allocating frame memory, the ones accepted by \ref allocator_alloc */
+#define ALLOCATION_SOURCE_COUNT (ALLOCATION_SOURCE_USB_IMU + 1)
+
+/** Alignment of buffers allocated with the allocation context placed in front of them */
+#define ALLOCATOR_DEFAULT_ALIGNMENT (16)
+
+/** Alignment of buffers for aligned vector loads of a cache line */
+#define ALLOCATOR_CACHE_LINE_ALIGNMENT (64)
+
+/** Alignment of page aligned buffers, as needed by O_DIRECT and to map buffers */
+#define ALLOCATOR_PAGE_ALIGNMENT (4096)
+
+/** Alignment of buffers starting on a huge page */
+#define ALLOCATOR_HUGE_PAGE_ALIGNMENT (2 * 1024 * 1024)
+
+/** Node argument of \ref allocator_set_backend for buffers not bound to a NUMA node */
+#define ALLOCATOR_NUMA_NODE_ANY (-1)
+
+/** NUMA nodes buffers can be bound to */
+#define ALLOCATOR_MAX_NUMA_NODES (64)
+
+/** Memory serving the buffers of an allocation source
+ */
+typedef enum
+{
+    ALLOCATOR_BACKEND_HEAP = 0,   /**< The allocate callbacks, see \ref allocator_set_allocator */
+    ALLOCATOR_BACKEND_HUGE_PAGES, /**< 2 MiB pages mapped by the SDK */
+} allocator_backend_t;
+
+/** Counts of the buffers served by the huge page backend of an allocation source
+ */
+typedef struct
+{
+    uint64_t allocations;           /**< Buffers served by the huge page backend */
+    uint64_t huge_page_allocations; /**< Buffers backed by reserved huge pages */
+    uint64_t cached_allocations;    /**< Buffers reusing the mapping of a freed buffer */
+    uint64_t numa_bind_failures;    /**< Buffers that could not be bound to the NUMA node requested */
+} allocator_backend_stats_t;
+
+/** What happens to an allocation source over its memory budget
+ */
+typedef enum
+{
+    ALLOCATOR_BUDGET_SHED = 0, /**< The producer sheds load before allocating, see \ref allocator_within_budget */
+    ALLOCATOR_BUDGET_FAIL,     /**< Allocations that would go over the budget fail */
+} allocator_budget_policy_t;
+
+/** Memory used by an allocation source
+ */
+typedef struct
+{
+    int64_t bytes_in_flight;      /**< Bytes allocated and not freed yet */
+    int64_t peak_bytes_in_flight; /**< Highest bytes_in_flight since the process started */
+    size_t budget_bytes;          /**< Budget of the source, 0 if none */
+    allocator_budget_policy_t budget_policy;
+    uint64_t shed_count;         /**< Frames dropped or transfers held back by the producer over budget */
+    uint64_t failed_allocations; /**< Allocations failed over budget */
+} allocator_source_usage_t;
+
+/** Memory used by every allocation source
+ */
+typedef struct
+{
+    int64_t bytes_in_flight; /**< Bytes allocated and not freed yet by all sources */
+    size_t budget_bytes;     /**< Budget of all sources together, 0 if none */
+    allocator_source_usage_t sources[ALLOCATION_SOURCE_COUNT];
+} allocator_memory_usage_t;
+
+/** Callbacks allocating the memory of a source, see \ref allocator_get_source_callbacks
+ */
+typedef struct
+{
+    zsa_memory_allocate_cb_t *alloc;                 /**< NULL when alloc_aligned serves every allocation */
+    zsa_memory_destroy_cb_t *free;                   /**< Frees what alloc returned */
+    zsa_memory_allocate_aligned_cb_t *alloc_aligned; /**< NULL when aligned allocations are padded through alloc */
+    zsa_memory_destroy_cb_t *free_aligned;           /**< Frees what alloc_aligned returned */
+    void *context;                                   /**< Passed to alloc and alloc_aligned */
+} allocator_callbacks_t;
+
 /** Initializes the globals used by the allocator
  *
  */
@@ -71,6 +150,10 @@ void allocator_deinitialize(void);
  * Not all memory allocation by the SDK is performed by this allocate function. Small allocations or allocations
  * from special pools may come from other sources.
  *
+ * \remarks
+ * Applies to every allocation source, replacing callbacks set with \ref allocator_set_source_allocator. Returns once
+ * no allocation still calls the callbacks replaced.
+ *
  * \xmlonly
  * <requirements>
  *   <requirement name="Header">zsa.h (include zsa/zsa.h)</requirement>
@@ -81,6 +164,219 @@ void allocator_deinitialize(void);
  */
 zsa_result_t allocator_set_allocator(zsa_memory_allocate_cb_t allocate, zsa_memory_destroy_cb_t free);
 
+/** Sets callback functions for the SDK allocator that honor the alignment of the buffers
+ *
+ * \param allocate
+ * The callback function to allocate memory, called for every allocation with the alignment it needs.
+ *
+ * \param free
+ * The callback function to free memory allocated by \p allocate.
+ *
+ * \return ::ZSA_RESULT_SUCCEEDED if the callback functions were set or cleared, ::ZSA_RESULT_FAILED if only one of
+ * them is provided.
+ *
+ * \remarks
+ * Replaces callbacks set with \ref allocator_set_allocator and the other way around. Calling with both NULL resets to
+ * the default allocator. An allocator set with \ref allocator_set_allocator gets aligned requests padded with the
+ * alignment instead.
+ */
+zsa_result_t allocator_set_allocator_aligned(zsa_memory_allocate_aligned_cb_t allocate, zsa_memory_destroy_cb_t free);
+
+/** Sets the callback functions allocating the memory of one source
+ *
+ * \param source
+ * The source of code allocating the memory
+ *
+ * \param allocate
+ * The callback function to allocate memory, NULL with \p free NULL for the default allocator.
+ *
+ * \param free
+ * The callback function to free memory allocated by \p allocate.
+ *
+ * \param context
+ * Passed to \p allocate in its context parameter.
+ *
+ * \return ::ZSA_RESULT_SUCCEEDED if the callback functions were set or cleared, ::ZSA_RESULT_FAILED if only one of
+ * them is provided.
+ *
+ * \remarks
+ * Lets frames of a source go to memory of their own, such as color frames to shared memory while IMU samples stay on
+ * the heap. Allocations read the callbacks of their source without taking a lock. Returns once no allocation still
+ * calls the callbacks replaced; buffers they allocated are still freed with the \p free they were allocated with.
+ */
+zsa_result_t allocator_set_source_allocator(allocation_source_t source,
+                                            zsa_memory_allocate_cb_t allocate,
+                                            zsa_memory_destroy_cb_t free,
+                                            void *context);
+
+/** Sets callback functions honoring the alignment of the buffers allocating the memory of one source
+ *
+ * \param source
+ * The source of code allocating the memory
+ *
+ * \param allocate
+ * The callback function to allocate memory, NULL with \p free NULL for the default allocator.
+ *
+ * \param free
+ * The callback function to free memory allocated by \p allocate.
+ *
+ * \param context
+ * Passed to \p allocate in its context parameter.
+ *
+ * \return ::ZSA_RESULT_SUCCEEDED if the callback functions were set or cleared, ::ZSA_RESULT_FAILED if only one of
+ * them is provided.
+ *
+ * \remarks
+ * As \ref allocator_set_source_allocator, with \p allocate called with the alignment each buffer needs.
+ */
+zsa_result_t allocator_set_source_allocator_aligned(allocation_source_t source,
+                                                    zsa_memory_allocate_aligned_cb_t allocate,
+                                                    zsa_memory_destroy_cb_t free,
+                                                    void *context);
+
+/** Reads the callbacks allocating the memory of one source
+ *
+ * \param source
+ * The source of code allocating the memory
+ *
+ * \param callbacks
+ * Location to write the callbacks to
+ *
+ * \return ::ZSA_RESULT_SUCCEEDED if the callbacks were read
+ *
+ * \remarks
+ * Lets code replacing the callbacks for a while put back the ones it found with \ref allocator_set_source_callbacks.
+ */
+zsa_result_t allocator_get_source_callbacks(allocation_source_t source, allocator_callbacks_t *callbacks);
+
+/** Sets the callbacks allocating the memory of one source as read by \ref allocator_get_source_callbacks
+ *
+ * \param source
+ * The source of code allocating the memory
+ *
+ * \param callbacks
+ * The callbacks, as read by \ref allocator_get_source_callbacks
+ *
+ * \return ::ZSA_RESULT_SUCCEEDED if the callbacks were set
+ */
+zsa_result_t allocator_set_source_callbacks(allocation_source_t source, const allocator_callbacks_t *callbacks);
+
+/** Sets the alignment of the buffers allocated by allocator_alloc() for a source
+ *
+ * \param source
+ * The source of code allocating the memory
+ *
+ * \param alignment
+ * A power of 2, \ref ALLOCATOR_DEFAULT_ALIGNMENT up to \ref ALLOCATOR_HUGE_PAGE_ALIGNMENT
+ *
+ * \return ::ZSA_RESULT_SUCCEEDED if the alignment is valid
+ *
+ * \remarks
+ * ALLOCATION_SOURCE_COLOR defaults to \ref ALLOCATOR_CACHE_LINE_ALIGNMENT, the other sources to
+ * \ref ALLOCATOR_DEFAULT_ALIGNMENT. Applies to later allocations only.
+ */
+zsa_result_t allocator_set_alignment(allocation_source_t source, size_t alignment);
+
+/** Selects the memory serving the buffers allocated for a source
+ *
+ * \param source
+ * The source of code allocating the memory
+ *
+ * \param backend
+ * Memory serving later allocations of \p source
+ *
+ * \param numa_node
+ * Node the memory of ALLOCATOR_BACKEND_HUGE_PAGES buffers is allocated on, or ALLOCATOR_NUMA_NODE_ANY. Pass the node
+ * of the thread processing the buffers, see \ref allocator_get_current_numa_node.
+ *
+ * \return ::ZSA_RESULT_SUCCEEDED if the backend was selected
+ *
+ * \remarks
+ * ALLOCATOR_BACKEND_HUGE_PAGES maps every buffer on its own, rounded up to 2 MiB, from reserved huge pages
+ * (vm.nr_hugepages) and otherwise from regular pages advised to be backed by transparent huge pages. Buffers start
+ * at the start of their mapping, unless a great many are live at once, and do not go through the allocate callbacks.
+ * A few mappings of freed buffers are kept for reuse while a device is open. The binding to \p numa_node is
+ * preferred, memory comes from another node when \p numa_node runs out. ALLOCATOR_BACKEND_HUGE_PAGES fails on Windows.
+ */
+zsa_result_t allocator_set_backend(allocation_source_t source, allocator_backend_t backend, int numa_node);
+
+/** Reads the counts of the buffers a source allocated from the huge page backend
+ *
+ * \param source
+ * The source of code allocating the memory
+ *
+ * \param stats [OUT]
+ * Receives the counts since the process started. The huge page hit rate is huge_page_allocations / allocations.
+ *
+ * \return ::ZSA_RESULT_SUCCEEDED if the counts were read
+ */
+zsa_result_t allocator_get_backend_stats(allocation_source_t source, allocator_backend_stats_t *stats);
+
+/** Returns the NUMA node of the processor running the calling thread, ALLOCATOR_NUMA_NODE_ANY if unknown
+ */
+int allocator_get_current_numa_node(void);
+
+/** Sets the memory budget of an allocation source
+ *
+ * \param source
+ * The source of code allocating the memory
+ *
+ * \param budget_bytes
+ * Bytes the buffers of \p source in flight may add up to, 0 for no budget
+ *
+ * \param policy
+ * What happens over budget
+ *
+ * \return ::ZSA_RESULT_SUCCEEDED if the budget was set
+ *
+ * \remarks
+ * With ALLOCATOR_BUDGET_SHED, producers check \ref allocator_within_budget before taking on a frame: the color
+ * reader drops frames before they are copied or decoded and USB streams keep fewer transfers in flight. Buffers
+ * allocated meanwhile, such as images decoded on demand, still succeed. With ALLOCATOR_BUDGET_FAIL every allocation
+ * that would go over the budget fails.
+ */
+zsa_result_t allocator_set_budget(allocation_source_t source, size_t budget_bytes, allocator_budget_policy_t policy);
+
+/** Sets the memory budget of all allocation sources together
+ *
+ * \param budget_bytes
+ * Bytes the buffers of all sources in flight may add up to, 0 for no budget
+ *
+ * \remarks
+ * Each source applies its policy, see \ref allocator_set_budget, to this budget as well as its own.
+ */
+void allocator_set_total_budget(size_t budget_bytes);
+
+/** Checks if a source can take on more memory without going over budget
+ *
+ * \param source
+ * The source of code allocating the memory
+ *
+ * \param bytes
+ * Bytes the source is about to allocate
+ *
+ * \return true if \p bytes more fit the budget of \p source and the total budget
+ *
+ * \remarks
+ * Producers check before they take on a frame, so load is shed where it costs the least. Count the frames or transfers
+ * given up with \ref allocator_record_shed.
+ */
+bool allocator_within_budget(allocation_source_t source, size_t bytes);
+
+/** Counts a frame dropped or a transfer held back by a producer because its source is over budget
+ *
+ * \param source
+ * The source of code allocating the memory
+ */
+void allocator_record_shed(allocation_source_t source);
+
+/** Reads the memory used by every allocation source
+ *
+ * \param usage [OUT]
+ * Receives the memory in flight, budgets and load shed
+ */
+void allocator_get_memory_usage(allocator_memory_usage_t *usage);
+
 /** Allocates memory from the allocator
  *
  * \param source
@@ -93,6 +389,24 @@ zsa_result_t allocator_set_allocator(zsa_memory_allocate_cb_t allocate, zsa_memo
  */
 uint8_t *allocator_alloc(allocation_source_t source, size_t alloc_size);
 
+/** Allocates memory from the allocator starting at a given alignment
+ *
+ * \param source
+ * the source of code allocating the memory
+ *
+ * \param alloc_size
+ * size of the memory to allocate
+ *
+ * \param alignment
+ * A power of 2 up to \ref ALLOCATOR_HUGE_PAGE_ALIGNMENT, 0 for the alignment set for the source
+ *
+ * \remarks
+ * Above \ref ALLOCATOR_DEFAULT_ALIGNMENT the allocation context is kept in padding in front of the aligned buffer, so
+ * a page aligned buffer only holds whole pages of the caller's data. Beyond \ref ALLOCATOR_PAGE_ALIGNMENT it is kept
+ * out of band, so the padding does not take a whole alignment. Free with allocator_free().
+ */
+uint8_t *allocator_alloc_aligned(allocation_source_t source, size_t alloc_size, size_t alignment);
+
 /** Returns a buffer to the allocator
  *
  * \param buffer
@@ -0,0 +1,132 @@
+/** \file camserver.h
+ * Copyright (c) Microsoft Corporation. All rights reserved.
+ * Licensed under the MIT License.
+ * Kinect For Azure SDK.
+ *
+ * Shares the captures of a device with other local processes
+ */
+
+#ifndef CAMSERVER_H
+#define CAMSERVER_H
+
+#include <zsa/zsatypes.h>
+#include <zsainternal/capturesync.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Slots a server can hold images in */
+#define CAMSERVER_MAX_SLOTS (64)
+
+/** Captures a server can keep published */
+#define CAMSERVER_MAX_RING_SIZE (16)
+
+/** Clients a server can serve at the same time */
+#define CAMSERVER_MAX_CLIENTS (30)
+
+/** Images of a capture that are shared */
+#define CAMSERVER_MAX_IMAGES (4)
+
+/** Handle to a camera server.
+ *
+ * The server publishes every capture of a device into shared memory. Color and depth frames are allocated in the
+ * shared memory to begin with, so publishing a capture copies none of its images. Clients in other processes map the
+ * same memory and read the captures with \ref camclient_get_capture.
+ *
+ * Handles are created with \ref camserver_create and closed
+ * with \ref camserver_destroy.
+ * Invalid handles are set to 0.
+ */
+ZSA_DECLARE_HANDLE(camserver_t);
+
+/** Handle to a client of a camera server.
+ *
+ * Handles are created with \ref camclient_open and closed
+ * with \ref camclient_close.
+ * Invalid handles are set to 0.
+ */
+ZSA_DECLARE_HANDLE(camclient_t);
+
+/** Starts sharing the captures of a device.
+ *
+ * \param capturesync_handle [IN]
+ *  Capturesync of the device. The server reads every capture through a subscriber queue of its own.
+ *
+ * \param name [IN]
+ *  Name clients connect with, unique on the host.
+ *
+ * \param config [IN]
+ *  Sizes of the shared memory, NULL for the defaults.
+ *
+ * \param camserver_handle [OUT]
+ *  A pointer to write the server handle to.
+ *
+ * \return ZSA_RESULT_SUCCEEDED if the server was started, otherwise ZSA_RESULT_FAILED
+ *
+ * \remarks
+ * Color and depth allocations go to the shared memory while the server runs, see
+ * \ref allocator_set_source_allocator_aligned. The allocators the sources had are restored by \ref camserver_destroy.
+ * Images allocated elsewhere, or larger than a slot, are copied into a slot when published. A capture is dropped for
+ * the clients when no slot is free. Color images are published in the format they were captured in, clients decode
+ * MJPEG themselves. Only one server can run in a process.
+ */
+zsa_result_t camserver_create(capturesync_t capturesync_handle,
+                              const char *name,
+                              const zsa_server_configuration_t *config,
+                              camserver_t *camserver_handle);
+
+/** Stops sharing captures.
+ *
+ * \remarks
+ * Clients fail their next \ref camclient_get_capture. Images they hold stay valid until they release them.
+ */
+void camserver_destroy(camserver_t camserver_handle);
+
+/** Connects to the camera server of another process.
+ *
+ * \param name [IN]
+ *  Name the server was created with.
+ *
+ * \param camclient_handle [OUT]
+ *  A pointer to write the client handle to.
+ *
+ * \return ZSA_RESULT_SUCCEEDED if connected, ZSA_RESULT_FAILED if no server runs under \p name or it serves
+ * CAMSERVER_MAX_CLIENTS already.
+ */
+zsa_result_t camclient_open(const char *name, camclient_t *camclient_handle);
+
+/** Disconnects from a camera server.
+ *
+ * \remarks
+ * Captures read from the server stay valid until they are released.
+ */
+void camclient_close(camclient_t camclient_handle);
+
+/** Reads the next capture published by a camera server.
+ *
+ * \param camclient_handle [IN]
+ *  Handle from camclient_open().
+ *
+ * \param capture_handle [OUT]
+ *  Receives the capture. Its images map the shared memory and are read only.
+ *
+ * \param timeout_in_ms [IN]
+ *  Time to wait for a capture, ZSA_WAIT_INFINITE to wait until one is published.
+ *
+ * \return ZSA_WAIT_RESULT_SUCCEEDED with a capture, ZSA_WAIT_RESULT_TIMEOUT if none was published in time, or
+ * ZSA_WAIT_RESULT_FAILED once the server stopped.
+ *
+ * \remarks
+ * Captures are read in the order they were published. A client falling more than the ring size behind skips to the
+ * oldest capture still published.
+ */
+zsa_wait_result_t camclient_get_capture(camclient_t camclient_handle,
+                                        zsa_capture_t *capture_handle,
+                                        int32_t timeout_in_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CAMSERVER_H */
@@ -49,13 +49,73 @@ zsa_image_t capture_get_color_image(zsa_capture_t capture_handle);
 zsa_image_t capture_get_depth_image(zsa_capture_t capture_handle);
 zsa_image_t capture_get_imu_image(zsa_capture_t capture_handle);
 zsa_image_t capture_get_ir_image(zsa_capture_t capture_handle);
+zsa_image_t capture_get_height_map_image(zsa_capture_t capture_handle);
 void capture_set_color_image(zsa_capture_t capture_handle, zsa_image_t image_handle);
 void capture_set_depth_image(zsa_capture_t capture_handle, zsa_image_t image_handle);
 void capture_set_imu_image(zsa_capture_t capture_handle, zsa_image_t image_handle);
 void capture_set_ir_image(zsa_capture_t capture_handle, zsa_image_t image_handle);
+void capture_set_height_map_image(zsa_capture_t capture_handle, zsa_image_t image_handle);
 void capture_set_temperature_c(zsa_capture_t capture_handle, float temperature_c);
 float capture_get_temperature_c(zsa_capture_t capture_handle);
 
+/** Gets the number of bytes held by the images of a capture */
+size_t capture_get_size_bytes(zsa_capture_t capture_handle);
+
+typedef struct _capture_color_decoder_t capture_color_decoder_t;
+
+/** Decodes the color image of a capture for \ref capture_get_color_decoded_image
+ *
+ * \param source
+ * Color image of the capture
+ *
+ * \param decoder
+ * Decoder set on the capture with \ref capture_set_color_decoder
+ *
+ * \param decoded
+ * Location to write the decoded image to, with a reference owned by the caller
+ */
+typedef zsa_result_t(capture_decode_cb_t)(zsa_image_t source,
+                                          const capture_color_decoder_t *decoder,
+                                          zsa_image_t *decoded);
+
+/** How the color image of a capture is decoded on demand. Held by value, so it stays valid as long as the capture. */
+struct _capture_color_decoder_t
+{
+    capture_decode_cb_t *decode_cb; /** Decode function, NULL when the color image is not decoded */
+    zsa_color_scale_t scale;        /** Scale to decode at */
+    zsa_color_crop_t crop;          /** Region of the scaled image to decode */
+};
+
+/** Sets how \ref capture_get_color_decoded_image decodes the color image of the capture
+ *
+ * \param capture_handle
+ * The capture handle
+ *
+ * \param decoder
+ * Decoder to copy, NULL to remove it
+ */
+void capture_set_color_decoder(zsa_capture_t capture_handle, const capture_color_decoder_t *decoder);
+
+/** Gets the decoder set on the capture with \ref capture_set_color_decoder
+ *
+ * \return true if the capture has a decoder, which is copied to \p decoder
+ */
+bool capture_get_color_decoder(zsa_capture_t capture_handle, capture_color_decoder_t *decoder);
+
+/** Gets the decoded color image of the capture, decoding it on the first call
+ *
+ * \param capture_handle
+ * The capture handle
+ *
+ * \return The image decoded from the color image by the decoder of the capture, or the color image itself when the
+ * capture has no decoder. NULL if there is no color image or it fails to decode. The caller owns the reference
+ * returned.
+ *
+ * \remarks The decode runs on the thread of the first caller, concurrent callers wait for it. The result is kept on the
+ * capture, so later calls return the same image. Other images of the capture remain accessible during the decode.
+ */
+zsa_image_t capture_get_color_decoded_image(zsa_capture_t capture_handle);
+
 #ifdef __cplusplus
 }
 #endif
@@ -10,11 +10,15 @@
 #define CAPTURESYNC_H
 
 #include <zsa/zsatypes.h>
+#include <zsainternal/queue.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/** Subscribers \ref capturesync_subscribe can add to a capturesync instance */
+#define CAPTURESYNC_MAX_SUBSCRIBERS (8)
+
 /** Handle to the capturesync module
  *
  * Handles are created with capturesync_create() and closed
@@ -85,6 +89,124 @@ zsa_wait_result_t capturesync_get_capture(capturesync_t capturesync_handle,
                                           zsa_capture_t *capture_handle,
                                           int32_t timeout_in_ms);
 
+/** Reads the next synchronized capture through a callback instead of waiting for it
+ *
+ * \param capturesync_handle
+ * The capturesync handle from capturesync_create()
+ *
+ * \param capture_ready_cb
+ * Called once with the capture, or with ::ZSA_WAIT_RESULT_FAILED if capturesync is stopped
+ *
+ * \param capture_ready_cb_context
+ * Passed to capture_ready_cb
+ *
+ * \return ::ZSA_RESULT_SUCCEEDED if capture_ready_cb will be called, ::ZSA_RESULT_FAILED if a previous call is still
+ * pending.
+ *
+ * \remarks
+ * capture_ready_cb runs on the calling thread if a capture is already queued or capturesync is stopped, otherwise on
+ * the thread calling capturesync_add_capture() or capturesync_stop(), after capturesync released its lock.
+ */
+zsa_result_t capturesync_get_capture_async(capturesync_t capturesync_handle,
+                                           zsa_capture_ready_cb_t *capture_ready_cb,
+                                           void *capture_ready_cb_context);
+
+/** Reads every synchronized capture queued, up to capacity, without waiting
+ *
+ * \param capturesync_handle
+ * The capturesync handle from capturesync_create()
+ *
+ * \param capture_handles
+ * Array receiving the captures, oldest first
+ *
+ * \param capacity
+ * Entries in capture_handles
+ *
+ * \param count
+ * Number of captures written
+ *
+ * \remarks
+ * See \ref queue_pop_batch for the results.
+ */
+zsa_wait_result_t capturesync_get_captures(capturesync_t capturesync_handle,
+                                           zsa_capture_t *capture_handles,
+                                           uint32_t capacity,
+                                           uint32_t *count);
+
+/** Gets a file descriptor that is readable while synchronized captures are queued
+ *
+ * \param capturesync_handle
+ * The capturesync handle from capturesync_create()
+ *
+ * \return See \ref queue_get_event_fd, subscribers use queue_get_event_fd() on their own queue.
+ */
+int capturesync_get_event_fd(capturesync_t capturesync_handle);
+
+/** Sets what happens to synchronized captures the application does not read in time
+ *
+ * \param capturesync_handle
+ * The capturesync handle from capturesync_create()
+ *
+ * \param policy
+ * The overflow policy of the synchronized capture queue, see \ref queue_set_overflow_policy
+ *
+ * \param max_bytes
+ * Image bytes held with ::QUEUE_OVERFLOW_BOUNDED_BYTES
+ */
+zsa_result_t capturesync_set_overflow_policy(capturesync_t capturesync_handle,
+                                             queue_overflow_policy_t policy,
+                                             size_t max_bytes);
+
+/** Reads the counters of the synchronized capture queue
+ *
+ * \param capturesync_handle
+ * The capturesync handle from capturesync_create()
+ *
+ * \param stats
+ * Location to write the counters to
+ */
+void capturesync_get_queue_stats(capturesync_t capturesync_handle, queue_stats_t *stats);
+
+/** Adds a consumer receiving every capture delivered by capturesync_get_capture() through a queue of its own
+ *
+ * \param capturesync_handle
+ * The capturesync handle from capturesync_create()
+ *
+ * \param queue_depth
+ * Captures the subscriber's queue holds, 0 for the depth of the synchronized capture queue
+ *
+ * \param policy
+ * What happens to the subscriber's captures it does not read in time
+ *
+ * \param max_bytes
+ * Image bytes held with ::QUEUE_OVERFLOW_BOUNDED_BYTES
+ *
+ * \param subscriber
+ * Location to write the subscriber's queue to. Captures are read with queue_pop() and counters with queue_get_stats().
+ *
+ * \remarks
+ * Every subscriber holds a reference to the same capture, images are not copied. The queue is enabled and disabled
+ * with capturesync and stays valid until capturesync_unsubscribe() or capturesync_destroy().
+ */
+zsa_result_t capturesync_subscribe(capturesync_t capturesync_handle,
+                                   uint32_t queue_depth,
+                                   queue_overflow_policy_t policy,
+                                   size_t max_bytes,
+                                   queue_t *subscriber);
+
+/** Removes a consumer added with capturesync_subscribe() and releases the captures it has not read
+ *
+ * \param capturesync_handle
+ * The capturesync handle from capturesync_create()
+ *
+ * \param subscriber
+ * The queue returned by capturesync_subscribe(), invalid once this returns
+ *
+ * \remarks
+ * A thread blocked in queue_pop() on the subscriber returns ::ZSA_WAIT_RESULT_FAILED.
+ */
+void capturesync_unsubscribe(capturesync_t capturesync_handle, queue_t subscriber);
+
 /** Capturesync module asynchronously accepts new captures from color and depth modules through this API.
  *
  * \param capturesync_handle
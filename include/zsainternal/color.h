@@ -18,6 +18,9 @@
 extern "C" {
 #endif
 
+/** Frames whose metadata \ref color_read_frame_metadata can return, a power of 2 */
+#define COLOR_METADATA_RING_SIZE (256)
+
 /** Delivers a sample to the registered callback function when a capture is ready for processing.
  *
  * \param result
@@ -79,6 +82,16 @@ zsa_result_t color_create(TICK_COUNTER_HANDLE tick_handle,
                           void *capture_ready_cb_context,
                           color_t *color_handle);
 
+/** Counts the color cameras attached to the host.
+ *
+ * \param device_count [OUT]
+ *    Receives the number of color cameras found
+ *
+ * \return ZSA_RESULT_SUCCEEDED if the cameras were counted, ZSA_RESULT_FAILED if the camera stack can not enumerate
+ * devices on this platform.
+ */
+zsa_result_t color_get_device_count(uint32_t *device_count);
+
 /** Closes the handle to the color device.
  *
  * \param color_handle
@@ -86,6 +99,22 @@ zsa_result_t color_create(TICK_COUNTER_HANDLE tick_handle,
  */
 void color_destroy(color_t color_handle);
 
+/** Negotiates the stream format of a configuration with the color camera without starting it
+ *
+ * \param color_handle
+ * Handle to the color camera
+ *
+ * \param config
+ * The configuration settings the color camera will be started with
+ *
+ * \return ::ZSA_RESULT_SUCCESS if successful. ::ZSA_RESULT_FAILED if an error occurs.
+ *
+ * \remarks Optional, \ref color_start negotiates the format itself when it was not prepared. The negotiated format is
+ * kept while the device is open, so restarting in the same mode skips it. It talks to the camera and not the MCU, so it
+ * can run while the MCU is being configured.
+ */
+zsa_result_t color_prepare(color_t color_handle, const zsa_device_configuration_t *config);
+
 /** Starts the color camera streaming
  *
  * \param color_handle
@@ -108,6 +137,19 @@ zsa_result_t color_start(color_t color_handle, const zsa_device_configuration_t
  */
 void color_stop(color_t color_handle);
 
+/** Drops frames as they arrive, while the color camera keeps streaming
+ *
+ * \param color_handle
+ * Handle to the color camera
+ *
+ * \param standby
+ * true to drop frames, false to deliver them again
+ *
+ * \remarks Frames are dropped right after their metadata is recorded, before anything is allocated, copied or decoded
+ * for them. \ref color_stop leaves standby.
+ */
+void color_set_standby(color_t color_handle, bool standby);
+
 /** Returns the system tick count saved by the color camera when it was started.
  *
  * \param color_handle
@@ -157,6 +199,30 @@ zsa_result_t color_get_control_capabilities(const color_t color_handle,
                                             int32_t *default_value,
                                             zsa_color_control_mode_t *default_mode);
 
+/** Reads the metadata of the frames that arrived from the color camera, whether or not their captures were delivered.
+ *
+ * \param color_handle
+ * Handle to the color camera
+ *
+ * \param frame_index [IN/OUT]
+ * Index of the first frame to read, 0 for the oldest one still held. Set to the index following the last frame read.
+ *
+ * \param metadata [OUT]
+ * Array receiving the metadata in arrival order
+ *
+ * \param count
+ * Entries in metadata
+ *
+ * \return Number of entries written
+ *
+ * \remarks The last COLOR_METADATA_RING_SIZE frames are held; a reader falling further behind skips to the oldest one
+ * held, which shows as a gap in zsa_color_frame_metadata_t::frame_index. Reads never block the streaming thread.
+ */
+uint32_t color_read_frame_metadata(const color_t color_handle,
+                                   uint64_t *frame_index,
+                                   zsa_color_frame_metadata_t *metadata,
+                                   uint32_t count);
+
 /** Gets the value of the given color camera's control command setting.
  *
  * \param color_handle
@@ -173,6 +239,10 @@ zsa_result_t color_get_control_capabilities(const color_t color_handle,
  *
  * \return ::ZSA_RESULT_FAILED if the value could not be read. ::ZSA_RESULT_SUCCEEDED if successful. Details of the
  * error can be read from the debug output
+ *
+ * \remarks Only the first read of a control goes to the camera. Later reads return a snapshot holding the values last
+ * written, and the exposure time and white balance of the latest frame while those run in automatic mode, without
+ * taking any lock shared with streaming.
  */
 zsa_result_t color_get_control(const color_t color_handle,
                                const zsa_color_control_command_t command,
@@ -193,8 +263,13 @@ zsa_result_t color_get_control(const color_t color_handle,
  * \param value
  * The value to write to the control command setting.
  *
- * \return ::ZSA_RESULT_FAILED if the value could not be set. ::ZSA_RESULT_SUCCEEDED if successful. Details of the
- * error can be read from the debug output
+ * \return ::ZSA_RESULT_FAILED if the mode or value is outside of the capabilities of the control or the write could not
+ * be queued. ::ZSA_RESULT_SUCCEEDED if successful.
+ *
+ * \remarks The value is checked against the range and step of the control, then the write is applied in order on a
+ * control thread. It shows in \ref color_get_control as soon as this call returns. A write replaces one still queued
+ * for the same control. A write the camera rejects anyway is logged and the control is read back from the camera on
+ * the next \ref color_get_control.
  */
 zsa_result_t color_set_control(const color_t color_handle,
                                const zsa_color_control_command_t command,
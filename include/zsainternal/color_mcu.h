@@ -132,6 +132,15 @@ zsa_buffer_result_t colormcu_get_usb_serialnum(colormcu_t colormcu_handle,
                                                char *serial_number,
                                                size_t *serial_number_size);
 
+/** Get the container ID of the physical device the color mcu belongs to.
+ *
+ * \param colormcu_handle
+ *  Colormcu handle provided by the colormcu_create() call
+ *
+ * \return A pointer to the container ID, valid until the handle is destroyed, or NULL for an invalid handle.
+ */
+const guid_t *colormcu_get_container_id(colormcu_t colormcu_handle);
+
 /** Closes the color mcu module and free's it resources
  * */
 void colormcu_destroy(colormcu_t colormcu_handle);
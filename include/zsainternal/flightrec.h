@@ -0,0 +1,141 @@
+/** \file flightrec.h
+ * Copyright (c) Microsoft Corporation. All rights reserved.
+ * Licensed under the MIT License.
+ * Kinect For Azure SDK.
+ *
+ * Keeps the last seconds of captures in memory and dumps them to a file on demand
+ */
+
+#ifndef FLIGHTREC_H
+#define FLIGHTREC_H
+
+#include <zsa/zsatypes.h>
+#include <zsainternal/capturesync.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** First bytes of a flight recorder file */
+#define FLIGHTREC_FILE_MAGIC "ZSAFREC"
+
+/** Version of the file layout described by the structures below */
+#define FLIGHTREC_FILE_VERSION (1)
+
+/** First field of every capture record */
+#define FLIGHTREC_CAPTURE_MAGIC (0x52504143) // "CAPR"
+
+/** Image of a capture in a flight recorder file */
+typedef enum
+{
+    FLIGHTREC_IMAGE_COLOR = 0, /**< Color image as the camera delivered it, MJPEG unless the cameras decode */
+    FLIGHTREC_IMAGE_DEPTH,     /**< Depth image */
+    FLIGHTREC_IMAGE_IR,        /**< IR image */
+    FLIGHTREC_IMAGE_IMU,       /**< IMU samples, not recorded as IMU captures are not published to subscribers */
+    FLIGHTREC_IMAGE_COUNT,
+} flightrec_image_type_t;
+
+/** Header of a flight recorder file.
+ *
+ * A file is this header followed by capture_count capture records, oldest first. Each record is a
+ * flightrec_capture_header_t, image_count flightrec_image_header_t and the bytes of each image in the same order,
+ * each padded to 8 bytes. The sizes of the headers are stored so that readers can skip fields added later. Fields
+ * are in the byte order of the host that wrote the file.
+ */
+typedef struct
+{
+    char magic[8];                 /**< FLIGHTREC_FILE_MAGIC, 0 terminated */
+    uint32_t version;              /**< FLIGHTREC_FILE_VERSION */
+    uint32_t header_size;          /**< sizeof(flightrec_file_header_t), the first record starts there */
+    uint32_t capture_header_size;  /**< sizeof(flightrec_capture_header_t) */
+    uint32_t image_header_size;    /**< sizeof(flightrec_image_header_t) */
+    uint32_t capture_count;        /**< Records in the file */
+    uint32_t lost_count;           /**< Records overwritten by newer captures while the file was written */
+    uint64_t duration_ms;          /**< Window the recorder was configured to keep */
+    uint64_t first_recorded_nsec;  /**< flightrec_capture_header_t::recorded_nsec of the first record */
+    uint64_t last_recorded_nsec;   /**< flightrec_capture_header_t::recorded_nsec of the last record */
+} flightrec_file_header_t;
+
+/** Header of a capture record */
+typedef struct
+{
+    uint32_t magic;         /**< FLIGHTREC_CAPTURE_MAGIC */
+    uint32_t size_bytes;    /**< Of the record, this header included */
+    uint64_t sequence;      /**< Captures recorded before this one */
+    uint64_t recorded_nsec; /**< System time in nanoseconds the recorder received the capture at */
+    float temperature_c;    /**< NaN if unknown */
+    uint32_t image_count;   /**< Image headers following */
+} flightrec_capture_header_t;
+
+/** Header of an image in a capture record */
+typedef struct
+{
+    uint32_t type;                  /**< flightrec_image_type_t */
+    int32_t format;                 /**< zsa_image_format_t */
+    int32_t width_pixels;
+    int32_t height_pixels;
+    int32_t stride_bytes;
+    uint32_t white_balance;
+    uint64_t size_bytes;            /**< Of the image, without padding */
+    uint64_t device_timestamp_usec;
+    uint64_t system_timestamp_nsec;
+    uint64_t exposure_usec;
+    uint32_t iso_speed;
+    uint32_t reserved;
+} flightrec_image_header_t;
+
+/** Handle to a flight recorder.
+ *
+ * Handles are created with \ref flightrec_create and closed
+ * with \ref flightrec_destroy.
+ * Invalid handles are set to 0.
+ */
+ZSA_DECLARE_HANDLE(flightrec_t);
+
+/** Starts recording the captures of a device into memory.
+ *
+ * \param capturesync_handle [IN]
+ *  Capturesync of the device. The recorder reads every capture through a subscriber queue of its own.
+ *
+ * \param config [IN]
+ *  Window and memory of the recorder, NULL for the defaults.
+ *
+ * \param flightrec_handle [OUT]
+ *  A pointer to write the recorder handle to.
+ *
+ * \return ZSA_RESULT_SUCCEEDED if the recorder was started, otherwise ZSA_RESULT_FAILED
+ *
+ * \remarks
+ * All memory is allocated and committed here; recording a capture copies its images into a ring and allocates
+ * nothing. The oldest captures are dropped once they are older than the window or the ring is full. With a dump
+ * signal, the signal handler only counts the request and a thread of the recorder writes the file. Each signal is
+ * handled by one recorder at a time, so recorders of different devices are dumped with different signals.
+ */
+zsa_result_t flightrec_create(capturesync_t capturesync_handle,
+                              const zsa_flight_recorder_configuration_t *config,
+                              flightrec_t *flightrec_handle);
+
+/** Stops recording and frees the ring. */
+void flightrec_destroy(flightrec_t flightrec_handle);
+
+/** Writes the captures in memory to a file.
+ *
+ * \param flightrec_handle [IN]
+ *  Handle from flightrec_create().
+ *
+ * \param path [IN]
+ *  File to create, replaced if it exists.
+ *
+ * \return ZSA_RESULT_SUCCEEDED if the file was written, otherwise ZSA_RESULT_FAILED
+ *
+ * \remarks
+ * Recording goes on while the file is written. Captures recorded after the call are not written, those overwritten
+ * before they are written are counted in flightrec_file_header_t::lost_count. Dumps are serialized.
+ */
+zsa_result_t flightrec_dump(flightrec_t flightrec_handle, const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FLIGHTREC_H */
@@ -0,0 +1,128 @@
+/** \file floorplane.h
+ * Copyright (c) Microsoft Corporation. All rights reserved.
+ * Licensed under the MIT License.
+ * Kinect For Azure SDK.
+ */
+
+#ifndef FLOORPLANE_H
+#define FLOORPLANE_H
+
+#include <zsa/zsatypes.h>
+#include <zsainternal/pointcloud.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Handle to a floor plane and obstacle height map extractor.
+ *
+ * The extractor remembers the floor found in the previous frame and only searches again when that plane stops
+ * explaining the scene, so it should be fed consecutive frames of a single camera.
+ *
+ * The extractor is a standalone internal library. It is not exposed in zsa.h and the capture path does not run it, so
+ * captures only carry a height map once the caller attaches one with \ref capture_set_height_map_image.
+ *
+ * Handles are created with \ref floorplane_create and closed
+ * with \ref floorplane_destroy.
+ * Invalid handles are set to 0.
+ */
+ZSA_DECLARE_HANDLE(floorplane_t);
+
+/** Floor search and height map settings. */
+typedef struct _floorplane_config_t
+{
+    /** Approximate up direction in the coordinates of the input, e.g. (0, -1, 0) for a level y-down camera. */
+    zsa_float3_t up_hint;
+
+    /** Planes whose normal is further than this from up_hint are not floor candidates. */
+    float max_tilt_degrees;
+
+    /** Largest point to plane distance, in millimeters, for a point to count as floor. */
+    float inlier_threshold_mm;
+
+    /** Random plane hypotheses tested when the previous floor no longer fits. */
+    int ransac_iterations;
+
+    /** Pixel step between the points used to search for the floor, in both directions. */
+    int sample_stride;
+
+    /** Fraction of the sampled points the previous floor must still explain for the search to be skipped. */
+    float min_inlier_ratio;
+
+    /** Edge length of a height map cell in millimeters. */
+    float cell_size_mm;
+
+    /** Height map columns, centered on the sensor. */
+    int grid_width_cells;
+
+    /** Height map rows ahead of the sensor. Row 0 is nearest to the sensor. */
+    int grid_depth_cells;
+
+    /** Points higher than this above the floor, in millimeters, are left out of the height map. */
+    float max_height_mm;
+} floorplane_config_t;
+
+/** Floor found in a frame. */
+typedef struct _floorplane_result_t
+{
+    bool valid;          /**< A floor was found; the other fields are only meaningful when set */
+    bool seeded;         /**< The previous frame's floor still fit and was refined instead of searched for */
+    zsa_float3_t normal; /**< Unit normal pointing up */
+    float offset_mm;     /**< The floor holds the points p with dot(normal, p) + offset_mm == 0 */
+    float inlier_ratio;  /**< Fraction of the sampled points within inlier_threshold_mm of the floor */
+} floorplane_result_t;
+
+/** Create a floor plane extractor.
+ *
+ * \param worker_count [IN]
+ *  Number of worker threads, see \ref threadpool_create. THREADPOOL_DEFAULT_WORKERS picks one per extra processor.
+ *
+ * \param floorplane_handle [OUT]
+ *  A pointer to write the extractor handle to.
+ *
+ * \return ZSA_RESULT_SUCCEEDED if the extractor was created, otherwise ZSA_RESULT_FAILED
+ */
+zsa_result_t floorplane_create(uint32_t worker_count, floorplane_t *floorplane_handle);
+
+/** Destroy a floor plane extractor.
+ */
+void floorplane_destroy(floorplane_t floorplane_handle);
+
+/** Forget the previous floor, e.g. after the camera was moved to another mount.
+ */
+void floorplane_reset(floorplane_t floorplane_handle);
+
+/** Find the floor in an organized cloud and build an obstacle height map on it.
+ *
+ * \param floorplane_handle [IN]
+ *  Extractor handle.
+ *
+ * \param input [IN]
+ *  Organized cloud, typically the XYZ image of a depth image (see \ref pointcloud_input_from_image).
+ *
+ * \param config [IN]
+ *  Search and height map settings.
+ *
+ * \param plane [OUT]
+ *  Receives the floor plane.
+ *
+ * \param height_map [OUT]
+ *  Optional. When a floor was found, receives a new ZSA_IMAGE_FORMAT_CUSTOM image of grid_width_cells x
+ *  grid_depth_cells floats: the greatest height above the floor, in millimeters, of the points over each cell, or NAN
+ *  where no point was seen. Negative heights are drops below the floor. Otherwise receives NULL. Attach it to the
+ *  capture it was computed from with \ref capture_set_height_map_image and release it with \ref image_dec_ref.
+ *
+ * \return ZSA_RESULT_SUCCEEDED if the frame was processed, even when it held no floor, otherwise ZSA_RESULT_FAILED
+ */
+zsa_result_t floorplane_process(floorplane_t floorplane_handle,
+                                const pointcloud_input_t *input,
+                                const floorplane_config_t *config,
+                                floorplane_result_t *plane,
+                                zsa_image_t *height_map);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FLOORPLANE_H */
@@ -130,6 +130,9 @@ void image_set_exposure_usec(zsa_image_t image_handle, uint64_t exposure_usec);
 void image_set_white_balance(zsa_image_t image_handle, uint32_t white_balance);
 void image_set_iso_speed(zsa_image_t image_handle, uint32_t iso_speed);
 
+/** Reads the clock used for image system timestamps, so data from other sources can be stamped on the same clock. */
+zsa_result_t image_get_system_time_nsec(uint64_t *timestamp_nsec);
+
 #ifdef __cplusplus
 }
 #endif
@@ -23,12 +23,27 @@ void math_add_scaled_3(const float in[3], float s, float out[3]);
 
 float math_dot_3(const float a[3], const float b[3]);
 
+/** out = a x b */
+void math_cross_3(const float a[3], const float b[3], float out[3]);
+
+/** Scales in to unit length
+ *
+ * \return  The length of in. out is left untouched when the length is 0
+ */
+float math_normalize_3(const float in[3], float out[3]);
+
 void math_mult_Ax_3x3(const float A[3 * 3], const float x[3], float out[3]);
 
 void math_mult_Atx_3x3(const float A[3 * 3], const float x[3], float out[3]);
 
 void math_mult_AB_3x3x3(const float A[3 * 3], const float B[3 * 3], float out[3 * 3]);
 
+/** out = inverse(A)
+ *
+ * \return  0 if A is singular and out was not written, otherwise 1
+ */
+int math_invert_3x3(const float A[3 * 3], float out[3 * 3]);
+
 /** Evaluates a polynomial up to degree 3 at x
  *
  *  \param x
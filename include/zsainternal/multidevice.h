@@ -0,0 +1,118 @@
+/** \file multidevice.h
+ * Copyright (c) Microsoft Corporation. All rights reserved.
+ * Licensed under the MIT License.
+ * Kinect For Azure SDK.
+ */
+
+#ifndef MULTIDEVICE_H
+#define MULTIDEVICE_H
+
+#include <zsa/zsatypes.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Largest number of devices in one wired sync chain */
+#define MULTIDEVICE_MAX_DEVICES (8)
+
+/** Handle to a multi device capture aggregator.
+ *
+ * The aggregator takes the captures of a master device and its wired subordinates and groups the captures that were
+ * triggered by the same sync pulse into one capture set. Captures are matched on the device timestamp of their color
+ * image, falling back to the depth image, after removing each subordinate's configured delay off the master.
+ *
+ * Handles are created with \ref multidevice_create and closed
+ * with \ref multidevice_destroy.
+ * Invalid handles are set to 0.
+ */
+ZSA_DECLARE_HANDLE(multidevice_t);
+
+/** Aggregator settings. */
+typedef struct _multidevice_config_t
+{
+    /** Devices in the chain, at most MULTIDEVICE_MAX_DEVICES. */
+    uint32_t device_count;
+
+    /** Index of the master device. Every capture set is built around one master capture. */
+    uint32_t master_index;
+
+    /** zsa_device_configuration_t::subordinate_delay_off_master_usec of each device, ignored for the master. */
+    uint32_t subordinate_delay_off_master_usec[MULTIDEVICE_MAX_DEVICES];
+
+    /** Capture period of the chain in microseconds. Captures match when their aligned timestamps are within a quarter
+     * period of the master's. */
+    uint32_t frame_period_usec;
+
+    /** Only release sets holding a capture from every device. Otherwise a set is released with NULL for the devices
+     * that missed the pulse. */
+    bool synchronized_sets_only;
+
+    /** Capture sets held for the reader before the oldest is dropped. */
+    uint32_t queue_depth;
+} multidevice_config_t;
+
+/** Create an aggregator, ready to accept captures.
+ *
+ * \param config [IN]
+ *  Aggregator settings.
+ *
+ * \param multidevice_handle [OUT]
+ *  A pointer to write the aggregator handle to.
+ *
+ * \return ZSA_RESULT_SUCCEEDED if the aggregator was created, otherwise ZSA_RESULT_FAILED
+ */
+zsa_result_t multidevice_create(const multidevice_config_t *config, multidevice_t *multidevice_handle);
+
+/** Destroy an aggregator, releasing any captures it still holds.
+ */
+void multidevice_destroy(multidevice_t multidevice_handle);
+
+/** Stop accepting captures, release the captures held and fail any blocked or later multidevice_get_capture_set().
+ */
+void multidevice_stop(multidevice_t multidevice_handle);
+
+/** Hand a capture of one device to the aggregator. Same contract as capturesync_add_capture().
+ *
+ * \param multidevice_handle [IN]
+ *  Aggregator handle.
+ *
+ * \param device_index [IN]
+ *  Index of the device in the chain the capture came from.
+ *
+ * \param result [IN]
+ *  The result of the operation providing the capture. Failures are logged and otherwise ignored.
+ *
+ * \param capture_handle [IN]
+ *  The capture. The aggregator adds its own reference.
+ */
+void multidevice_add_capture(multidevice_t multidevice_handle,
+                             uint32_t device_index,
+                             zsa_result_t result,
+                             zsa_capture_t capture_handle);
+
+/** Read the oldest complete capture set.
+ *
+ * \param multidevice_handle [IN]
+ *  Aggregator handle.
+ *
+ * \param capture_handles [OUT]
+ *  Array of device_count entries receiving the capture of each device, in device order. The caller owns a reference on
+ *  every non NULL entry.
+ *
+ * \param timeout_in_ms [IN]
+ *  Time to wait for a set, 0 to poll or ZSA_WAIT_INFINITE.
+ *
+ * \return ZSA_WAIT_RESULT_SUCCEEDED with a set, ZSA_WAIT_RESULT_TIMEOUT if none was ready in time, or
+ * ZSA_WAIT_RESULT_FAILED once the aggregator is stopped.
+ */
+zsa_wait_result_t multidevice_get_capture_set(multidevice_t multidevice_handle,
+                                              zsa_capture_t *capture_handles,
+                                              int32_t timeout_in_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MULTIDEVICE_H */
@@ -0,0 +1,89 @@
+/** \file normals.h
+ * Copyright (c) Microsoft Corporation. All rights reserved.
+ * Licensed under the MIT License.
+ * Kinect For Azure SDK.
+ */
+
+#ifndef NORMALS_H
+#define NORMALS_H
+
+#include <zsa/zsatypes.h>
+#include <zsainternal/pointcloud.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Handle to a surface normal estimator.
+ *
+ * The estimator owns its worker threads and integral image buffer. The buffer only grows, so once the estimator has
+ * seen the largest input, \ref normals_compute does not allocate.
+ *
+ * The estimator is internal to the SDK, zsa.h has no wrapper for it.
+ *
+ * Handles are created with \ref normals_create and closed
+ * with \ref normals_destroy.
+ * Invalid handles are set to 0.
+ */
+ZSA_DECLARE_HANDLE(normals_t);
+
+/** Normal estimation settings. */
+typedef struct _normals_config_t
+{
+    /** Half width of the smoothing window in pixels. The gradients are taken between the mean points of boxes of
+     * (window_radius) x (2 * window_radius + 1) pixels on either side of the center pixel. */
+    int window_radius;
+
+    /** Largest difference in mean depth across the window, in millimeters. Pixels on a larger depth edge get no
+     * normal. 0 disables the check. */
+    float max_depth_change_mm;
+} normals_config_t;
+
+/** Create a surface normal estimator.
+ *
+ * \param worker_count [IN]
+ *  Number of worker threads, see \ref threadpool_create. THREADPOOL_DEFAULT_WORKERS picks one per extra processor.
+ *
+ * \param normals_handle [OUT]
+ *  A pointer to write the estimator handle to.
+ *
+ * \return ZSA_RESULT_SUCCEEDED if the estimator was created, otherwise ZSA_RESULT_FAILED
+ */
+zsa_result_t normals_create(uint32_t worker_count, normals_t *normals_handle);
+
+/** Destroy a surface normal estimator.
+ */
+void normals_destroy(normals_t normals_handle);
+
+/** Estimate a normal for every pixel of an organized point cloud.
+ *
+ * Uses the average 3D gradient method: integral images of the points make the mean point of any box a constant time
+ * lookup, and the normal is the cross product of the horizontal and vertical differences of those means. Normals
+ * point towards the sensor.
+ *
+ * \param normals_handle [IN]
+ *  Estimator handle.
+ *
+ * \param input [IN]
+ *  Organized cloud, typically the XYZ image of a depth image (see \ref pointcloud_input_from_image).
+ *
+ * \param config [IN]
+ *  Estimation settings.
+ *
+ * \param normal_image [IN]
+ *  A ZSA_IMAGE_FORMAT_CUSTOM image with the same dimensions as the input and a stride of at least
+ *  width * sizeof(zsa_float3_t). Receives one unit normal per pixel, aligned to the input; pixels without a normal
+ *  are set to (0, 0, 0).
+ *
+ * \return ZSA_RESULT_SUCCEEDED if the normals were computed, otherwise ZSA_RESULT_FAILED
+ */
+zsa_result_t normals_compute(normals_t normals_handle,
+                             const pointcloud_input_t *input,
+                             const normals_config_t *config,
+                             zsa_image_t normal_image);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NORMALS_H */
@@ -0,0 +1,150 @@
+/** \file pointcloud.h
+ * Copyright (c) Microsoft Corporation. All rights reserved.
+ * Licensed under the MIT License.
+ * Kinect For Azure SDK.
+ */
+
+#ifndef POINTCLOUD_H
+#define POINTCLOUD_H
+
+#include <zsa/zsatypes.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Handle to a point cloud filter.
+ *
+ * The filter owns its worker threads and scratch buffers. Scratch buffers only grow, so once the filter has seen the
+ * largest input, \ref pointcloud_filter_process does not allocate.
+ *
+ * The filter is not part of the public API in zsa.h. Code inside the SDK and its tools links zsainternal::pointcloud.
+ *
+ * Handles are created with \ref pointcloud_filter_create and closed
+ * with \ref pointcloud_filter_destroy.
+ * Invalid handles are set to 0.
+ */
+ZSA_DECLARE_HANDLE(pointcloud_filter_t);
+
+/** Memory layout of one organized point. */
+typedef enum
+{
+    POINTCLOUD_POINT_INT16_MM = 0, /**< x, y, z as int16_t millimeters, the layout of XYZ zsa_image_t images */
+    POINTCLOUD_POINT_FLOAT32_MM,   /**< x, y, z as float millimeters, the layout of astra::PointFrame */
+} pointcloud_point_type_t;
+
+/** An organized point cloud, one point per pixel. Points with z == 0 are invalid. */
+typedef struct _pointcloud_input_t
+{
+    const uint8_t *data;                /**< First point of the first row */
+    pointcloud_point_type_t point_type; /**< Layout of each point */
+    int width_pixels;                   /**< Points per row */
+    int height_pixels;                  /**< Number of rows */
+    int stride_bytes;                   /**< Distance between rows */
+} pointcloud_input_t;
+
+/** Filter stages run by \ref pointcloud_filter_process, applied in the order they are listed. */
+typedef struct _pointcloud_filter_config_t
+{
+    /** Pixel region of the organized cloud to use. A width or height of 0 selects the whole cloud. */
+    int roi_x;
+    int roi_y;
+    int roi_width;
+    int roi_height;
+
+    /** Axis aligned box in millimeters; points outside are dropped. Ignored when crop_box_enabled is false. */
+    bool crop_box_enabled;
+    zsa_float3_t crop_box_min_mm;
+    zsa_float3_t crop_box_max_mm;
+
+    /** Distance from the sensor in millimeters; points outside [min, max] are dropped. 0 disables a bound. */
+    float min_range_mm;
+    float max_range_mm;
+
+    /** Radius outlier removal on the organized cloud. A point is kept when at least outlier_min_neighbors points in
+     * the (2 * outlier_window + 1)^2 pixel neighborhood are within outlier_radius_mm. 0 radius disables the stage. */
+    float outlier_radius_mm;
+    int outlier_window;
+    int outlier_min_neighbors;
+
+    /** Voxel grid edge length in millimeters; each occupied voxel emits the centroid of its points. 0 disables the
+     * stage and the surviving points are emitted as is. */
+    float voxel_size_mm;
+} pointcloud_filter_config_t;
+
+/** Initial configuration setting for disabling all filter stages. */
+static const pointcloud_filter_config_t POINTCLOUD_FILTER_CONFIG_INIT_DISABLE_ALL = { 0,
+                                                                                      0,
+                                                                                      0,
+                                                                                      0,
+                                                                                      false,
+                                                                                      { { 0, 0, 0 } },
+                                                                                      { { 0, 0, 0 } },
+                                                                                      0,
+                                                                                      0,
+                                                                                      0,
+                                                                                      0,
+                                                                                      0,
+                                                                                      0 };
+
+/** Create a point cloud filter.
+ *
+ * \param worker_count [IN]
+ *  Number of worker threads, see \ref threadpool_create. THREADPOOL_DEFAULT_WORKERS picks one per extra processor.
+ *
+ * \param filter_handle [OUT]
+ *  A pointer to write the filter handle to.
+ *
+ * \return ZSA_RESULT_SUCCEEDED if the filter was created, otherwise ZSA_RESULT_FAILED
+ */
+zsa_result_t pointcloud_filter_create(uint32_t worker_count, pointcloud_filter_t *filter_handle);
+
+/** Destroy a point cloud filter.
+ */
+void pointcloud_filter_destroy(pointcloud_filter_t filter_handle);
+
+/** Describe an XYZ image as a \ref pointcloud_input_t.
+ *
+ * \param xyz_image [IN]
+ *  A ZSA_IMAGE_FORMAT_CUSTOM image holding int16_t x, y, z millimeter triplets.
+ *
+ * \param input [OUT]
+ *  Receives a description of the image buffer. It is valid for as long as the image is.
+ */
+zsa_result_t pointcloud_input_from_image(zsa_image_t xyz_image, pointcloud_input_t *input);
+
+/** Run the configured filter stages and write the surviving points as a compact array.
+ *
+ * \param filter_handle [IN]
+ *  Filter handle.
+ *
+ * \param input [IN]
+ *  Organized cloud to filter.
+ *
+ * \param config [IN]
+ *  Stages to run.
+ *
+ * \param points [OUT]
+ *  Output array in millimeters. May be NULL to query the number of points.
+ *
+ * \param points_capacity [IN]
+ *  Number of elements in points.
+ *
+ * \param points_count [OUT]
+ *  Number of points produced.
+ *
+ * \return ZSA_BUFFER_RESULT_TOO_SMALL if points is NULL or holds fewer than points_count elements.
+ */
+zsa_buffer_result_t pointcloud_filter_process(pointcloud_filter_t filter_handle,
+                                              const pointcloud_input_t *input,
+                                              const pointcloud_filter_config_t *config,
+                                              zsa_float3_t *points,
+                                              size_t points_capacity,
+                                              size_t *points_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* POINTCLOUD_H */
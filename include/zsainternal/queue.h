@@ -39,6 +39,30 @@ extern "C" {
  */
 ZSA_DECLARE_HANDLE(queue_t);
 
+/** What a push does when the queue is full, see \ref queue_set_overflow_policy */
+typedef enum
+{
+    QUEUE_OVERFLOW_DROP_OLDEST = 0, /**< Drop the oldest capture to make room, the default */
+    QUEUE_OVERFLOW_DROP_NEWEST,     /**< Drop the capture being pushed */
+    QUEUE_OVERFLOW_KEEP_LATEST,     /**< Hold only the capture pushed last, dropping any queued one */
+    QUEUE_OVERFLOW_BOUNDED_BYTES,   /**< Drop the oldest captures until the queued images fit a number of bytes */
+} queue_overflow_policy_t;
+
+/** Counters of a queue, see \ref queue_get_stats */
+typedef struct _queue_stats_t
+{
+    uint32_t count;             /**< Captures queued */
+    uint32_t max_count;         /**< Most captures queued at once */
+    size_t bytes;               /**< Bytes of the images queued */
+    uint64_t pushed;            /**< Captures accepted */
+    uint64_t popped;            /**< Captures handed to the consumer */
+    uint64_t dropped_oldest;    /**< Queued captures dropped to make room */
+    uint64_t dropped_newest;    /**< Captures dropped instead of being queued */
+    uint64_t lag_usec;          /**< Time the oldest queued capture has been waiting, 0 when empty */
+    uint64_t last_pop_lag_usec; /**< Time the capture popped last spent queued */
+    uint64_t max_pop_lag_usec;  /**< Longest time a popped capture spent queued */
+} queue_stats_t;
+
 /** Open a handle to the queue device.
  *
  * \param queue_depth [IN]
@@ -94,10 +118,40 @@ void queue_push(queue_t queue_handle, zsa_capture_t capture_handle);
  *  A pointer to a location to return a capture that would have been dropped by the queue due to insufficient storage
  *
  * The queue has a fixed size, when that size is been reached a capture needs to be dropped for this API to succeed. In
- * this case that dropped capture will be returned with dropped_handle.
+ * this case that dropped capture will be returned with dropped_handle. Depending on the overflow policy, that is the
+ * oldest capture or capture_handle itself, with a reference owned by the caller either way.
  */
 void queue_push_w_dropped(queue_t queue_handle, zsa_capture_t capture_handle, zsa_capture_t *dropped_handle);
 
+/** Selects what a push does when the queue is full.
+ *
+ * \param queue_handle [in]
+ *  A queue handle
+ *
+ * \param policy [in]
+ *  The overflow policy
+ *
+ * \param max_bytes [in]
+ *  For ::QUEUE_OVERFLOW_BOUNDED_BYTES, the bytes the images of the queued captures may take. A capture larger than
+ *  this on its own is still queued once the queue is empty. The queue depth keeps applying.
+ *
+ * \return ZSA_RESULT_SUCCEEDED if the policy was set
+ *
+ * \remarks When a push drops more than one capture, as keeping the latest or bounding bytes can,
+ * \ref queue_push_w_dropped returns the first one and releases the others.
+ */
+zsa_result_t queue_set_overflow_policy(queue_t queue_handle, queue_overflow_policy_t policy, size_t max_bytes);
+
+/** Reads the counters of the queue, including how far its consumer lags behind.
+ *
+ * \param queue_handle [in]
+ *  A queue handle
+ *
+ * \param stats [out]
+ *  Location to write the counters to
+ */
+void queue_get_stats(queue_t queue_handle, queue_stats_t *stats);
+
 /** Removes a \ref zsa_capture_t object from the queue.
  *
  * \param queue_handle [in]
@@ -116,6 +170,40 @@ void queue_push_w_dropped(queue_t queue_handle, zsa_capture_t capture_handle, zs
  */
 zsa_wait_result_t queue_pop(queue_t queue_handle, int32_t wait_in_ms, zsa_capture_t *capture_handle);
 
+/** Removes every queued \ref zsa_capture_t object, up to capacity, without waiting.
+ *
+ * \param queue_handle [in]
+ *  A queue handle
+ *
+ * \param captures [out]
+ * Array receiving the captures, oldest first. The caller owns a reference to each one.
+ *
+ * \param capacity [in]
+ * Entries in captures
+ *
+ * \param count [out]
+ * Number of captures written
+ *
+ * returns \ref ZSA_WAIT_RESULT_SUCCEEDED if at least one capture was returned, \ref ZSA_WAIT_RESULT_TIMEOUT if the
+ * queue was empty, \ref ZSA_WAIT_RESULT_FAILED if the queue is disabled, or empty and stopped.
+ */
+zsa_wait_result_t queue_pop_batch(queue_t queue_handle, zsa_capture_t *captures, uint32_t capacity, uint32_t *count);
+
+/** Gets a file descriptor that is readable while the queue holds captures
+ *
+ * \param queue_handle [in]
+ *  A queue handle
+ *
+ * \return An eventfd for poll(), select() or epoll, -1 if it could not be created or on Windows.
+ *
+ * \remarks
+ * Level triggered, the descriptor stays readable until the queue is drained with \ref queue_pop or
+ * \ref queue_pop_batch, which is the only way to reset it; do not read() it. It also becomes readable when the queue is
+ * stopped so an event loop finds out through the failure of \ref queue_pop_batch. The descriptor is owned by the queue
+ * and closed by \ref queue_destroy.
+ */
+int queue_get_event_fd(queue_t queue_handle);
+
 /** Enables the queue for accepting data
  *
  * \param queue_handle [in]
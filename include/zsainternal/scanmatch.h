@@ -0,0 +1,130 @@
+/** \file scanmatch.h
+ * Copyright (c) Microsoft Corporation. All rights reserved.
+ * Licensed under the MIT License.
+ * Kinect For Azure SDK.
+ */
+
+#ifndef SCANMATCH_H
+#define SCANMATCH_H
+
+#include <zsa/zsatypes.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Handle to a 2D lidar scan matcher.
+ *
+ * The matcher keeps a local map built from the most recent matched scans and aligns every new scan to it, giving the
+ * pose of the sensor in the frame of the first scan. Scans must be fed in order from a single sensor.
+ *
+ * The matcher is internal, there is no public entry point for it in zsa.h.
+ *
+ * Handles are created with \ref scanmatch_create and closed
+ * with \ref scanmatch_destroy.
+ * Invalid handles are set to 0.
+ */
+ZSA_DECLARE_HANDLE(scanmatch_t);
+
+/** Scan matcher settings. */
+typedef struct _scanmatch_config_t
+{
+    /** Edge length of a local map cell in millimeters. */
+    float resolution_mm;
+
+    /** Cells along each side of the square local map, which is centered on the sensor when rebuilt. */
+    int map_size_cells;
+
+    /** Returns outside this range, in millimeters, are ignored. */
+    float min_range_mm;
+    float max_range_mm;
+
+    /** Spread in millimeters of the likelihood around each map return. */
+    float hit_sigma_mm;
+
+    /** The branch and bound search covers this distance, in millimeters, around the predicted position. */
+    float search_linear_mm;
+
+    /** The branch and bound search covers this angle, in degrees, around the predicted heading. */
+    float search_angular_degrees;
+
+    /** Matched scans the local map is built from. */
+    int map_scans;
+
+    /** Matched scans between local map rebuilds. */
+    int map_update_interval;
+
+    /** Smallest mean likelihood, between 0 and 1, of an accepted match. */
+    float min_score;
+} scanmatch_config_t;
+
+/** One return of a scan. */
+typedef struct _scanmatch_point_t
+{
+    float angle_rad; /**< Counter clockwise from the sensor's x axis */
+    float range_mm;  /**< 0 for no return */
+} scanmatch_point_t;
+
+/** One revolution of the sensor. */
+typedef struct _scanmatch_scan_t
+{
+    const scanmatch_point_t *points;
+    uint32_t point_count;
+    uint64_t device_timestamp_usec; /**< Passed through to the pose */
+    uint64_t system_timestamp_nsec; /**< Time of the scan on the image system clock, 0 to use the time of the call */
+} scanmatch_scan_t;
+
+/** Sensor pose estimated for one scan. */
+typedef struct _scanmatch_pose_t
+{
+    bool valid;                     /**< The scan was matched to the local map */
+    uint64_t device_timestamp_usec; /**< Device timestamp of the scan */
+    uint64_t system_timestamp_nsec; /**< Time of the scan on the clock of zsa image system timestamps */
+    float x_mm;                     /**< Position in the frame of the first scan */
+    float y_mm;
+    float theta_rad; /**< Heading in the frame of the first scan */
+    float score;     /**< Mean likelihood of the scan returns in the local map, between 0 and 1 */
+} scanmatch_pose_t;
+
+/** Create a scan matcher.
+ *
+ * \param config [IN]
+ *  Matcher settings.
+ *
+ * \param scanmatch_handle [OUT]
+ *  A pointer to write the matcher handle to.
+ *
+ * \return ZSA_RESULT_SUCCEEDED if the matcher was created, otherwise ZSA_RESULT_FAILED
+ */
+zsa_result_t scanmatch_create(const scanmatch_config_t *config, scanmatch_t *scanmatch_handle);
+
+/** Destroy a scan matcher.
+ */
+void scanmatch_destroy(scanmatch_t scanmatch_handle);
+
+/** Forget the local map and restart at the origin.
+ */
+void scanmatch_reset(scanmatch_t scanmatch_handle);
+
+/** Align a scan to the local map and add it to the map.
+ *
+ * \param scanmatch_handle [IN]
+ *  Matcher handle.
+ *
+ * \param scan [IN]
+ *  The scan. Only read during the call.
+ *
+ * \param pose [OUT]
+ *  Receives the sensor pose. When the scan could not be matched, pose->valid is false and the pose is the motion
+ *  prediction; such scans are left out of the map. The first scan defines the origin and is not valid.
+ *
+ * \return ZSA_RESULT_SUCCEEDED if the scan was processed, otherwise ZSA_RESULT_FAILED
+ */
+zsa_result_t scanmatch_process(scanmatch_t scanmatch_handle, const scanmatch_scan_t *scan, scanmatch_pose_t *pose);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SCANMATCH_H */
@@ -0,0 +1,71 @@
+/** \file threadpool.h
+ * Copyright (c) Microsoft Corporation. All rights reserved.
+ * Licensed under the MIT License.
+ * Kinect For Azure SDK.
+ */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <zsa/zsatypes.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Handle to a pool of worker threads used by the CPU processing stages.
+ *
+ * Handles are created with \ref threadpool_create and closed
+ * with \ref threadpool_destroy.
+ * Invalid handles are set to 0.
+ */
+ZSA_DECLARE_HANDLE(threadpool_t);
+
+/** Task callback run by \ref threadpool_run.
+ *
+ * \param context
+ *  The context passed to \ref threadpool_run.
+ *
+ * \param task_index
+ *  Index of the task, in the range [0, task_count).
+ */
+typedef void(threadpool_task_cb_t)(void *context, uint32_t task_index);
+
+/** Use one worker less than the number of online processors. */
+#define THREADPOOL_DEFAULT_WORKERS (UINT32_MAX)
+
+/** Create a thread pool.
+ *
+ * \param worker_count [IN]
+ *  The number of worker threads to start. The thread calling \ref threadpool_run also executes tasks, so a pool with
+ *  0 workers runs everything on the caller. Pass \ref THREADPOOL_DEFAULT_WORKERS to use one worker less than the
+ *  number of online processors.
+ *
+ * \param pool_handle [OUT]
+ *  A pointer to write the thread pool handle to.
+ *
+ * \return ZSA_RESULT_SUCCEEDED if the pool was created, otherwise ZSA_RESULT_FAILED
+ */
+zsa_result_t threadpool_create(uint32_t worker_count, threadpool_t *pool_handle);
+
+/** Stop the worker threads and free the pool.
+ */
+void threadpool_destroy(threadpool_t pool_handle);
+
+/** Number of threads that execute tasks, including the calling thread.
+ */
+uint32_t threadpool_get_thread_count(threadpool_t pool_handle);
+
+/** Run task_count tasks and block until all of them have completed.
+ *
+ * \remarks
+ * Tasks are handed out in index order to the workers and the calling thread. Calls from multiple threads are
+ * serialized. The callback must not call \ref threadpool_run on the same pool.
+ */
+void threadpool_run(threadpool_t pool_handle, uint32_t task_count, threadpool_task_cb_t *task_cb, void *context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* THREADPOOL_H */
@@ -54,6 +54,42 @@ ZSA_DECLARE_HANDLE(usbcmd_t);
  */
 typedef void(usb_cmd_stream_cb_t)(zsa_result_t result, zsa_image_t image_handle, void *context);
 
+/** One command transaction of a batch handed to \ref usb_cmd_submit or \ref usb_cmd_execute.
+ *
+ * A transaction sends the command packet, then writes tx_data or reads into rx_data if either is set, then reads the
+ * status the device answers with. The output fields are written when the transaction completes.
+ */
+typedef struct _usb_cmd_request_t
+{
+    uint32_t cmd;             /**< Command to send */
+    const void *cmd_data;     /**< Command arguments, copied into the command packet */
+    size_t cmd_data_size;     /**< Size of cmd_data */
+    const void *tx_data;      /**< Data written after the command, or NULL */
+    void *rx_data;            /**< Buffer for data read after the command, or NULL */
+    size_t data_size;         /**< Size of tx_data or rx_data */
+    zsa_result_t result;      /**< ZSA_RESULT_SUCCEEDED if the transaction completed on the wire */
+    uint32_t cmd_status;      /**< Status reported by the device, 0 for success */
+    size_t transfer_count;    /**< Bytes actually written or read */
+} usb_cmd_request_t;
+
+/** Called once all requests of a batch have completed.
+ *
+ * \param result
+ * ZSA_RESULT_SUCCEEDED if every transaction completed and reported status 0. The batch stops at the first failure and
+ * the requests after it are not sent and are marked ZSA_RESULT_FAILED.
+ *
+ * \param requests
+ * The requests passed to \ref usb_cmd_submit, with their output fields written.
+ *
+ * \param context
+ * Context passed to \ref usb_cmd_submit
+ *
+ * \remarks
+ * Runs on the thread servicing libusb events, which may be the stream thread. It must not block or issue synchronous
+ * commands.
+ */
+typedef void(usb_cmd_complete_cb_t)(zsa_result_t result, usb_cmd_request_t *requests, uint32_t count, void *context);
+
 //************ Declarations (Statics and globals) ***************
 
 //******************* Function Prototypes ***********************
@@ -133,6 +169,42 @@ zsa_result_t usb_cmd_write_with_status(usbcmd_t usb_handle,
                                        size_t data_size,
                                        uint32_t *cmd_status);
 
+/** Queue a batch of command transactions without waiting for them.
+ *
+ * \param usbcmd_handle [IN]
+ *    Handle of the device to send the commands to
+ *
+ * \param requests [IN OUT]
+ *    Transactions to run in order. The array and the data buffers it points to must stay valid until complete_cb runs.
+ *
+ * \param count [IN]
+ *    Number of requests
+ *
+ * \param complete_cb [IN]
+ *    Called when the batch is done. May run before this function returns if the batch fails to start.
+ *
+ * \param context [IN]
+ *    Context for complete_cb
+ *
+ * \return ZSA_RESULT_SUCCEEDED if the batch was queued, in which case complete_cb is always called.
+ *
+ * \remarks
+ * Batches run one after the other in submission order, interleaved with the synchronous calls below. Each stage of a
+ * transaction is submitted from the completion of the previous one, so queued commands go out back to back without a
+ * thread handoff and no lock is held while waiting on the device.
+ */
+zsa_result_t usb_cmd_submit(usbcmd_t usbcmd_handle,
+                            usb_cmd_request_t *requests,
+                            uint32_t count,
+                            usb_cmd_complete_cb_t *complete_cb,
+                            void *context);
+
+/** Run a batch of command transactions and wait for it to complete.
+ *
+ * \return The result the completion callback of \ref usb_cmd_submit would receive.
+ */
+zsa_result_t usb_cmd_execute(usbcmd_t usbcmd_handle, usb_cmd_request_t *requests, uint32_t count);
+
 // stream data callback
 zsa_result_t usb_cmd_stream_register_cb(usbcmd_t usbcmd, usb_cmd_stream_cb_t *frame_ready_cb, void *context);
 
@@ -143,6 +215,12 @@ zsa_result_t usb_cmd_stream_stop(usbcmd_t usb_handle);
 // Get the number of connected devices
 zsa_result_t usb_cmd_get_device_count(uint32_t *p_device_count);
 
+// Get the index usb_cmd_create() opens a device at from its serial number, without opening any device. Only devices
+// this process opened before, and that did not enumerate again since, are known.
+zsa_result_t usb_cmd_find_device_index(usb_command_device_type_t device_type,
+                                       const char *serial_number,
+                                       uint32_t *p_device_index);
+
 const guid_t *usb_cmd_get_container_id(usbcmd_t usbcmd_handle);
 
 #ifdef __cplusplus
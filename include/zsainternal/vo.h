@@ -0,0 +1,141 @@
+/** \file vo.h
+ * Copyright (c) Microsoft Corporation. All rights reserved.
+ * Licensed under the MIT License.
+ * Kinect For Azure SDK.
+ */
+
+#ifndef VO_H
+#define VO_H
+
+#include <zsa/zsatypes.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Handle to the RGB-D visual odometry front-end.
+ *
+ * The front-end tracks corners of the color image from capture to capture, lifts them to 3D with the depth image and
+ * estimates the camera motion from the tracked points. Captures are processed on a worker thread owned by the handle.
+ *
+ * Only code inside the SDK uses the front-end, zsa.h does not expose it.
+ *
+ * Handles are created with \ref vo_create and closed
+ * with \ref vo_destroy.
+ * Invalid handles are set to 0.
+ */
+ZSA_DECLARE_HANDLE(vo_t);
+
+/** Visual odometry settings. */
+typedef struct _vo_config_t
+{
+    /** Color camera intrinsics in pixels. The depth image must be registered to the color camera; it may have a
+     * different resolution, in which case pixel coordinates are scaled. */
+    float fx;
+    float fy;
+    float cx;
+    float cy;
+
+    /** Levels of the image pyramid used for tracking, including full resolution. 1 to 5. */
+    int pyramid_levels;
+
+    /** Largest number of features tracked at once. */
+    int max_features;
+
+    /** FAST intensity threshold. */
+    int fast_threshold;
+
+    /** Edge length in pixels of the grid cells used to spread features; each cell holds at most one feature. */
+    int feature_cell_size;
+
+    /** Half width in pixels of the patch tracked by Lucas-Kanade, 2 to 15. The patch is 2 * track_window + 1 pixels
+     * wide, so it always has a center pixel. */
+    int track_window;
+
+    /** Largest reprojection error in pixels of a pose inlier. */
+    float max_reprojection_error;
+
+    /** Captures buffered for the worker; the oldest is dropped when the worker falls behind. */
+    uint32_t queue_depth;
+} vo_config_t;
+
+/** Camera pose estimated for one capture. */
+typedef struct _vo_pose_t
+{
+    bool valid;                     /**< The motion since the previous capture was estimated */
+    uint64_t device_timestamp_usec; /**< Device timestamp of the color image */
+    uint64_t system_timestamp_nsec; /**< System timestamp of the color image */
+    float rotation[3 * 3];          /**< Row major rotation of the camera in the frame of the first capture */
+    float translation[3];           /**< Position of the camera in the frame of the first capture, millimeters */
+    int tracked_features;           /**< Features tracked from the previous capture */
+    int inliers;                    /**< Tracked features consistent with the estimated motion */
+    float processing_ms;            /**< Time spent processing the capture */
+} vo_pose_t;
+
+/** Called on the worker thread with the pose of every processed capture.
+ *
+ * \param pose
+ *  Pose of the capture. Only valid for the duration of the call.
+ *
+ * \param context
+ *  The context passed to \ref vo_create.
+ */
+typedef void(vo_pose_ready_cb_t)(const vo_pose_t *pose, void *context);
+
+/** Create a visual odometry front-end and start its worker thread.
+ *
+ * \param config [IN]
+ *  Front-end settings.
+ *
+ * \param pose_ready_cb [IN]
+ *  Optional callback receiving the pose of every capture processed by the worker.
+ *
+ * \param pose_ready_cb_context [IN]
+ *  Context passed to pose_ready_cb.
+ *
+ * \param vo_handle [OUT]
+ *  A pointer to write the handle to.
+ *
+ * \return ZSA_RESULT_SUCCEEDED if the front-end was created, otherwise ZSA_RESULT_FAILED
+ */
+zsa_result_t vo_create(const vo_config_t *config,
+                       vo_pose_ready_cb_t *pose_ready_cb,
+                       void *pose_ready_cb_context,
+                       vo_t *vo_handle);
+
+/** Stop the worker thread and destroy the front-end.
+ */
+void vo_destroy(vo_t vo_handle);
+
+/** Hand a synchronized capture to the worker thread without blocking.
+ *
+ * \param vo_handle [IN]
+ *  Front-end handle.
+ *
+ * \param capture_handle [IN]
+ *  A capture holding a color image (BGRA32, NV12, YUY2 or CUSTOM8 gray) and a DEPTH16 image. The front-end takes its
+ *  own reference.
+ *
+ * \return ZSA_RESULT_SUCCEEDED if the capture was queued
+ */
+zsa_result_t vo_submit_capture(vo_t vo_handle, zsa_capture_t capture_handle);
+
+/** Process a capture on the calling thread.
+ *
+ * \remarks
+ * Intended for offline processing and benchmarks. Do not mix with \ref vo_submit_capture on the same handle.
+ *
+ * \return ZSA_RESULT_SUCCEEDED if the capture could be processed; pose->valid tells whether motion was estimated
+ */
+zsa_result_t vo_process_capture(vo_t vo_handle, zsa_capture_t capture_handle, vo_pose_t *pose);
+
+/** Forget the tracked features and restart the trajectory at the identity pose.
+ */
+void vo_reset(vo_t vo_handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VO_H */
@@ -0,0 +1,75 @@
+# Copyright (c) Microsoft Corporation. All rights reserved.
+# Licensed under the MIT License.
+
+"""Measures the cost of handing a frame to NumPy through the zsa bindings.
+
+Wrapping an image with numpy.asarray() only views the SDK memory, so its cost per frame stays the same from a
+thumbnail to a 4K frame, while the copying path grows with the image. Run with a device attached and --device to
+also measure get_capture() of a streaming camera.
+
+    python throughput.py [--frames N] [--device INDEX]
+"""
+
+import argparse
+import time
+
+import numpy
+
+import zsa
+
+SIZES = [(64, 64), (1280, 720), (1920, 1080), (3840, 2160)]
+
+
+def per_frame_usec(function, frames):
+    start = time.perf_counter()
+    for _ in range(frames):
+        function()
+    return (time.perf_counter() - start) * 1e6 / frames
+
+
+def bench_images(frames):
+    print("%-11s %14s %14s" % ("size", "view us/frame", "copy us/frame"))
+    for width, height in SIZES:
+        image = zsa.create_image(zsa.IMAGE_FORMAT_COLOR_BGRA32, width, height, width * 4)
+
+        def view():
+            pixels = numpy.asarray(image)
+            return pixels[0, 0, 0]
+
+        def copy():
+            pixels = numpy.array(image)
+            return pixels[0, 0, 0]
+
+        print("%5dx%-5d %14.2f %14.2f" % (width, height, per_frame_usec(view, frames), per_frame_usec(copy, frames)))
+
+
+def bench_device(index, frames):
+    with zsa.Device(index) as device:
+        device.start(color_format=zsa.IMAGE_FORMAT_COLOR_BGRA32, color_resolution=zsa.COLOR_RESOLUTION_720P)
+        overhead = 0.0
+        for _ in range(frames):
+            capture = device.get_capture(timeout_ms=1000)
+            if capture is None:
+                continue
+            start = time.perf_counter()
+            image = capture.color
+            if image is not None:
+                numpy.asarray(image)[0, 0, 0]
+            overhead += time.perf_counter() - start
+        device.stop()
+    print("device %d: %.2f us/frame from capture to array" % (index, overhead * 1e6 / frames))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--frames", type=int, default=1000, help="frames per measurement")
+    parser.add_argument("--device", type=int, help="index of a device to stream from")
+    args = parser.parse_args()
+
+    bench_images(args.frames)
+    if args.device is not None:
+        bench_device(args.device, args.frames)
+
+
+if __name__ == "__main__":
+    main()
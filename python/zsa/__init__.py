@@ -0,0 +1,26 @@
+# Copyright (c) Microsoft Corporation. All rights reserved.
+# Licensed under the MIT License.
+
+"""Python bindings of the zsa SDK.
+
+Images implement the buffer protocol, numpy.asarray(image) returns a view of the SDK memory that keeps the image
+alive for as long as the array exists. Captured images are read only since the same image may be delivered to other
+readers; copy the array to modify it.
+
+    import numpy
+    import zsa
+
+    with zsa.Device(0) as device:
+        device.start(color_format=zsa.IMAGE_FORMAT_COLOR_BGRA32, color_resolution=zsa.COLOR_RESOLUTION_720P)
+        capture = device.get_capture(timeout_ms=1000)
+        if capture is not None and capture.color is not None:
+            pixels = numpy.asarray(capture.color)  # (height, width, 4) uint8, no copy
+        device.stop()
+
+With color_decode_on_demand=True, capture.color is the MJPEG frame and capture.color_decoded decodes it to BGRA32 on
+first access.
+
+Calls that wait on the device release the GIL.
+"""
+
+from ._zsa import *  # noqa: F401,F403
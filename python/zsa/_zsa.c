@@ -0,0 +1,695 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+// Python bindings for devices, captures and images. Images export the SDK memory through the buffer protocol, so
+// numpy.asarray(image) is a view of the pixels and not a copy.
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <pythread.h>
+
+// This library
+#include <zsa/zsa.h>
+
+// System dependencies
+#include <stdbool.h>
+
+typedef struct
+{
+    PyObject_HEAD
+    zsa_device_t handle;
+    int calls;               // Calls using the handle with the GIL released, guarded by the GIL
+    PyThread_type_lock idle; // Held while calls is not 0, close waits on it
+} device_object_t;
+
+typedef struct
+{
+    PyObject_HEAD
+    zsa_capture_t handle;
+} capture_object_t;
+
+typedef struct
+{
+    PyObject_HEAD
+    zsa_image_t handle;
+    bool writable; // Created by the application, captured images may be shared with other readers
+
+    // Layout handed to the buffer protocol
+    Py_ssize_t shape[3];
+    Py_ssize_t strides[3];
+    int ndim;
+    char *item_format;
+} image_object_t;
+
+static PyTypeObject device_type;
+static PyTypeObject capture_type;
+static PyTypeObject image_type;
+
+static PyObject *zsa_error;
+
+// Takes ownership of the image reference
+static PyObject *image_wrap(zsa_image_t handle, bool writable)
+{
+    image_object_t *self = PyObject_New(image_object_t, &image_type);
+    if (self == NULL)
+    {
+        zsa_image_release(handle);
+        return NULL;
+    }
+
+    self->handle = handle;
+    self->writable = writable;
+
+    int width = zsa_image_get_width_pixels(handle);
+    int height = zsa_image_get_height_pixels(handle);
+    int stride = zsa_image_get_stride_bytes(handle);
+
+    // Pixel formats are exposed as rows and columns, the others as the raw bytes
+    self->item_format = "B";
+    self->ndim = 1;
+    self->shape[0] = (Py_ssize_t)zsa_image_get_size(handle);
+    self->strides[0] = 1;
+    switch (zsa_image_get_format(handle))
+    {
+    case ZSA_IMAGE_FORMAT_COLOR_BGRA32:
+        self->ndim = 3;
+        self->shape[0] = height;
+        self->shape[1] = width;
+        self->shape[2] = 4;
+        self->strides[0] = stride;
+        self->strides[1] = 4;
+        self->strides[2] = 1;
+        break;
+    case ZSA_IMAGE_FORMAT_COLOR_YUY2:
+        self->ndim = 3;
+        self->shape[0] = height;
+        self->shape[1] = width;
+        self->shape[2] = 2;
+        self->strides[0] = stride;
+        self->strides[1] = 2;
+        self->strides[2] = 1;
+        break;
+    case ZSA_IMAGE_FORMAT_DEPTH16:
+    case ZSA_IMAGE_FORMAT_IR16:
+    case ZSA_IMAGE_FORMAT_CUSTOM16:
+        self->item_format = "H";
+        self->ndim = 2;
+        self->shape[0] = height;
+        self->shape[1] = width;
+        self->strides[0] = stride;
+        self->strides[1] = 2;
+        break;
+    case ZSA_IMAGE_FORMAT_CUSTOM8:
+        self->ndim = 2;
+        self->shape[0] = height;
+        self->shape[1] = width;
+        self->strides[0] = stride;
+        self->strides[1] = 1;
+        break;
+    default:
+        break;
+    }
+
+    return (PyObject *)self;
+}
+
+static void image_dealloc(image_object_t *self)
+{
+    if (self->handle)
+    {
+        zsa_image_release(self->handle);
+    }
+    PyObject_Del(self);
+}
+
+static int image_getbuffer(image_object_t *self, Py_buffer *view, int flags)
+{
+    if ((flags & PyBUF_WRITABLE) && !self->writable)
+    {
+        PyErr_SetString(PyExc_BufferError, "Captured images are read only, copy the array to modify it");
+        return -1;
+    }
+
+    // The first access of an image decoded on demand runs the decoder
+    uint8_t *buffer;
+    Py_BEGIN_ALLOW_THREADS
+    buffer = zsa_image_get_buffer(self->handle);
+    Py_END_ALLOW_THREADS
+
+    if (buffer == NULL)
+    {
+        PyErr_SetString(zsa_error, "Failed to get the image buffer");
+        return -1;
+    }
+
+    // view->obj keeps this object, and with it the image reference, alive for as long as the buffer is used
+    view->obj = (PyObject *)self;
+    Py_INCREF(self);
+    view->buf = buffer;
+    view->len = (Py_ssize_t)zsa_image_get_size(self->handle);
+    view->readonly = !self->writable;
+    view->itemsize = self->item_format[0] == 'H' ? 2 : 1;
+    view->format = (flags & PyBUF_FORMAT) ? self->item_format : NULL;
+    view->ndim = self->ndim;
+    view->shape = (flags & PyBUF_ND) ? self->shape : NULL;
+    view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? self->strides : NULL;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+
+    if (view->strides == NULL && self->ndim > 1 && self->strides[0] != self->shape[1] * self->strides[1])
+    {
+        Py_DECREF(self);
+        view->obj = NULL;
+        PyErr_SetString(PyExc_BufferError, "Image rows are padded, a strided buffer is required");
+        return -1;
+    }
+    return 0;
+}
+
+static PyBufferProcs image_as_buffer = { (getbufferproc)image_getbuffer, NULL };
+
+static PyObject *image_get_format(image_object_t *self, void *closure)
+{
+    (void)closure;
+    return PyLong_FromLong(zsa_image_get_format(self->handle));
+}
+
+static PyObject *image_get_width(image_object_t *self, void *closure)
+{
+    (void)closure;
+    return PyLong_FromLong(zsa_image_get_width_pixels(self->handle));
+}
+
+static PyObject *image_get_height(image_object_t *self, void *closure)
+{
+    (void)closure;
+    return PyLong_FromLong(zsa_image_get_height_pixels(self->handle));
+}
+
+static PyObject *image_get_stride(image_object_t *self, void *closure)
+{
+    (void)closure;
+    return PyLong_FromLong(zsa_image_get_stride_bytes(self->handle));
+}
+
+static PyObject *image_get_size(image_object_t *self, void *closure)
+{
+    (void)closure;
+    return PyLong_FromSize_t(zsa_image_get_size(self->handle));
+}
+
+static PyObject *image_get_device_timestamp(image_object_t *self, void *closure)
+{
+    (void)closure;
+    return PyLong_FromUnsignedLongLong(zsa_image_get_device_timestamp_usec(self->handle));
+}
+
+static PyObject *image_get_system_timestamp(image_object_t *self, void *closure)
+{
+    (void)closure;
+    return PyLong_FromUnsignedLongLong(zsa_image_get_system_timestamp_nsec(self->handle));
+}
+
+static PyGetSetDef image_getset[] = {
+    { "format", (getter)image_get_format, NULL, "Image format, one of the IMAGE_FORMAT_* constants", NULL },
+    { "width", (getter)image_get_width, NULL, "Width in pixels", NULL },
+    { "height", (getter)image_get_height, NULL, "Height in pixels", NULL },
+    { "stride", (getter)image_get_stride, NULL, "Bytes per row", NULL },
+    { "size", (getter)image_get_size, NULL, "Bytes in the buffer", NULL },
+    { "device_timestamp_usec", (getter)image_get_device_timestamp, NULL, "Device timestamp in microseconds", NULL },
+    { "system_timestamp_nsec", (getter)image_get_system_timestamp, NULL, "Host timestamp in nanoseconds", NULL },
+    { NULL, NULL, NULL, NULL, NULL },
+};
+
+static PyTypeObject image_type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "zsa.Image",
+    .tp_basicsize = sizeof(image_object_t),
+    .tp_dealloc = (destructor)image_dealloc,
+    .tp_as_buffer = &image_as_buffer,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_doc = "An image. numpy.asarray(image) views the image memory without copying it.",
+    .tp_getset = image_getset,
+};
+
+static void capture_dealloc(capture_object_t *self)
+{
+    if (self->handle)
+    {
+        zsa_capture_release(self->handle);
+    }
+    PyObject_Del(self);
+}
+
+static PyObject *capture_get_color(capture_object_t *self, void *closure)
+{
+    (void)closure;
+    zsa_image_t image = zsa_capture_get_color_image(self->handle);
+    if (image == NULL)
+    {
+        Py_RETURN_NONE;
+    }
+    return image_wrap(image, false);
+}
+
+static PyObject *capture_get_color_decoded(capture_object_t *self, void *closure)
+{
+    (void)closure;
+    zsa_image_t image;
+
+    // The first access decodes the frame
+    Py_BEGIN_ALLOW_THREADS
+    image = zsa_capture_get_color_decoded_image(self->handle);
+    Py_END_ALLOW_THREADS
+
+    if (image == NULL)
+    {
+        Py_RETURN_NONE;
+    }
+    return image_wrap(image, false);
+}
+
+static PyGetSetDef capture_getset[] = {
+    { "color", (getter)capture_get_color, NULL, "The color Image, None if the capture has none", NULL },
+    { "color_decoded",
+      (getter)capture_get_color_decoded,
+      NULL,
+      "The color Image decoded to BGRA32, decoded on first access with color_decode_on_demand. None if the capture has "
+      "no color image or it could not be decoded",
+      NULL },
+    { NULL, NULL, NULL, NULL, NULL },
+};
+
+static PyTypeObject capture_type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "zsa.Capture",
+    .tp_basicsize = sizeof(capture_object_t),
+    .tp_dealloc = (destructor)capture_dealloc,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_doc = "Images captured together by a device",
+    .tp_getset = capture_getset,
+};
+
+static int device_init(device_object_t *self, PyObject *args, PyObject *kwds)
+{
+    static char *keywords[] = { "index", NULL };
+    unsigned int index = 0;
+    zsa_result_t result;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|I", keywords, &index))
+    {
+        return -1;
+    }
+
+    if (self->handle)
+    {
+        PyErr_SetString(zsa_error, "Device is already open");
+        return -1;
+    }
+
+    if (self->idle == NULL)
+    {
+        self->idle = PyThread_allocate_lock();
+        if (self->idle == NULL)
+        {
+            PyErr_NoMemory();
+            return -1;
+        }
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    result = zsa_device_open(index, &self->handle);
+    Py_END_ALLOW_THREADS
+
+    if (ZSA_FAILED(result))
+    {
+        self->handle = NULL;
+        PyErr_Format(zsa_error, "Failed to open device %u", index);
+        return -1;
+    }
+    return 0;
+}
+
+static bool device_check_open(device_object_t *self)
+{
+    if (self->handle == NULL)
+    {
+        PyErr_SetString(zsa_error, "Device is closed");
+        return false;
+    }
+    return true;
+}
+
+// Called with the GIL held before releasing it to use the handle, NULL with an exception set if the device is closed
+static zsa_device_t device_begin_call(device_object_t *self)
+{
+    if (!device_check_open(self))
+    {
+        return NULL;
+    }
+
+    // Closing clears the handle before waiting, so the lock is free when the first call takes it
+    if (self->calls++ == 0)
+    {
+        PyThread_acquire_lock(self->idle, WAIT_LOCK);
+    }
+    return self->handle;
+}
+
+// Called with the GIL held again once the call using the handle returned
+static void device_end_call(device_object_t *self)
+{
+    if (--self->calls == 0)
+    {
+        PyThread_release_lock(self->idle);
+    }
+}
+
+static void device_close_handle(device_object_t *self)
+{
+    zsa_device_t handle = self->handle;
+    bool busy = self->calls != 0;
+
+    self->handle = NULL;
+    if (handle)
+    {
+        Py_BEGIN_ALLOW_THREADS
+        if (busy)
+        {
+            // Wake a thread waiting for a capture, then let the calls in flight return before freeing the device
+            zsa_device_stop_cameras(handle);
+            PyThread_acquire_lock(self->idle, WAIT_LOCK);
+            PyThread_release_lock(self->idle);
+        }
+        zsa_device_close(handle);
+        Py_END_ALLOW_THREADS
+    }
+}
+
+static void device_dealloc(device_object_t *self)
+{
+    device_close_handle(self);
+    if (self->idle)
+    {
+        PyThread_free_lock(self->idle);
+    }
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *device_start(device_object_t *self, PyObject *args, PyObject *kwds)
+{
+    static char *keywords[] = {
+        "color_format", "color_resolution", "camera_fps", "synchronized_images_only", "color_decode_on_demand", NULL
+    };
+    zsa_device_configuration_t config = ZSA_DEVICE_CONFIG_INIT_DISABLE_ALL;
+    int color_format = ZSA_IMAGE_FORMAT_COLOR_BGRA32;
+    int color_resolution = ZSA_COLOR_RESOLUTION_720P;
+    int camera_fps = ZSA_FRAMES_PER_SECOND_30;
+    int synchronized_images_only = 0;
+    int color_decode_on_demand = 0;
+    zsa_device_t handle;
+    zsa_result_t result;
+
+    if (!PyArg_ParseTupleAndKeywords(args,
+                                     kwds,
+                                     "|iiipp",
+                                     keywords,
+                                     &color_format,
+                                     &color_resolution,
+                                     &camera_fps,
+                                     &synchronized_images_only,
+                                     &color_decode_on_demand))
+    {
+        return NULL;
+    }
+    handle = device_begin_call(self);
+    if (handle == NULL)
+    {
+        return NULL;
+    }
+
+    config.color_format = (zsa_image_format_t)color_format;
+    config.color_resolution = (zsa_color_resolution_t)color_resolution;
+    config.camera_fps = (zsa_fps_t)camera_fps;
+    config.synchronized_images_only = synchronized_images_only != 0;
+    config.color_decode_on_demand = color_decode_on_demand != 0;
+
+    Py_BEGIN_ALLOW_THREADS
+    result = zsa_device_start_cameras(handle, &config);
+    Py_END_ALLOW_THREADS
+    device_end_call(self);
+
+    if (ZSA_FAILED(result))
+    {
+        PyErr_SetString(zsa_error, "Failed to start the cameras");
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject *device_stop(device_object_t *self, PyObject *unused)
+{
+    (void)unused;
+    zsa_device_t handle = device_begin_call(self);
+    if (handle == NULL)
+    {
+        return NULL;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    zsa_device_stop_cameras(handle);
+    Py_END_ALLOW_THREADS
+    device_end_call(self);
+
+    Py_RETURN_NONE;
+}
+
+static PyObject *device_close(device_object_t *self, PyObject *unused)
+{
+    (void)unused;
+    device_close_handle(self);
+    Py_RETURN_NONE;
+}
+
+static PyObject *device_get_capture(device_object_t *self, PyObject *args, PyObject *kwds)
+{
+    static char *keywords[] = { "timeout_ms", NULL };
+    int timeout_ms = ZSA_WAIT_INFINITE;
+    zsa_capture_t capture = NULL;
+    zsa_device_t handle;
+    zsa_wait_result_t wresult;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|i", keywords, &timeout_ms))
+    {
+        return NULL;
+    }
+    handle = device_begin_call(self);
+    if (handle == NULL)
+    {
+        return NULL;
+    }
+
+    // Other Python threads run while this one waits for the camera, close() waits for it to return
+    Py_BEGIN_ALLOW_THREADS
+    wresult = zsa_device_get_capture(handle, &capture, timeout_ms);
+    Py_END_ALLOW_THREADS
+    device_end_call(self);
+
+    if (wresult == ZSA_WAIT_RESULT_TIMEOUT)
+    {
+        Py_RETURN_NONE;
+    }
+    if (wresult != ZSA_WAIT_RESULT_SUCCEEDED)
+    {
+        PyErr_SetString(zsa_error, "Failed to get a capture from the device");
+        return NULL;
+    }
+
+    capture_object_t *result = PyObject_New(capture_object_t, &capture_type);
+    if (result == NULL)
+    {
+        zsa_capture_release(capture);
+        return NULL;
+    }
+    result->handle = capture;
+    return (PyObject *)result;
+}
+
+static PyObject *device_get_serial_number(device_object_t *self, void *closure)
+{
+    (void)closure;
+    char serial_number[64];
+    size_t size = sizeof(serial_number);
+
+    if (!device_check_open(self))
+    {
+        return NULL;
+    }
+    if (zsa_device_get_serialnum(self->handle, serial_number, &size) != ZSA_BUFFER_RESULT_SUCCEEDED)
+    {
+        PyErr_SetString(zsa_error, "Failed to read the serial number");
+        return NULL;
+    }
+    return PyUnicode_FromString(serial_number);
+}
+
+static PyObject *device_enter(device_object_t *self, PyObject *unused)
+{
+    (void)unused;
+    Py_INCREF(self);
+    return (PyObject *)self;
+}
+
+static PyObject *device_exit(device_object_t *self, PyObject *args)
+{
+    (void)args;
+    device_close_handle(self);
+    Py_RETURN_FALSE;
+}
+
+static PyMethodDef device_methods[] = {
+    { "start",
+      (PyCFunction)(void (*)(void))device_start,
+      METH_VARARGS | METH_KEYWORDS,
+      "start(color_format=IMAGE_FORMAT_COLOR_BGRA32, color_resolution=COLOR_RESOLUTION_720P, camera_fps=FPS_30, "
+      "synchronized_images_only=False, color_decode_on_demand=False)\n\nStarts the cameras." },
+    { "stop", (PyCFunction)device_stop, METH_NOARGS, "Stops the cameras." },
+    { "close",
+      (PyCFunction)device_close,
+      METH_NOARGS,
+      "Closes the device. Calls in flight on other threads are woken by stopping the cameras and awaited." },
+    { "get_capture",
+      (PyCFunction)(void (*)(void))device_get_capture,
+      METH_VARARGS | METH_KEYWORDS,
+      "get_capture(timeout_ms=-1)\n\nReads the next Capture, None on timeout. The GIL is released while waiting." },
+    { "__enter__", (PyCFunction)device_enter, METH_NOARGS, NULL },
+    { "__exit__", (PyCFunction)device_exit, METH_VARARGS, NULL },
+    { NULL, NULL, 0, NULL },
+};
+
+static PyGetSetDef device_getset[] = {
+    { "serial_number", (getter)device_get_serial_number, NULL, "Serial number of the device", NULL },
+    { NULL, NULL, NULL, NULL, NULL },
+};
+
+static PyTypeObject device_type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "zsa.Device",
+    .tp_basicsize = sizeof(device_object_t),
+    .tp_dealloc = (destructor)device_dealloc,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_doc = "Device(index=0)\n\nAn open device.",
+    .tp_methods = device_methods,
+    .tp_getset = device_getset,
+    .tp_init = (initproc)device_init,
+    .tp_new = PyType_GenericNew,
+};
+
+static PyObject *module_create_image(PyObject *module, PyObject *args, PyObject *kwds)
+{
+    static char *keywords[] = { "format", "width", "height", "stride", NULL };
+    int format, width, height, stride;
+    zsa_image_t image = NULL;
+    (void)module;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "iiii", keywords, &format, &width, &height, &stride))
+    {
+        return NULL;
+    }
+    if (ZSA_FAILED(zsa_image_create((zsa_image_format_t)format, width, height, stride, &image)))
+    {
+        PyErr_SetString(zsa_error, "Failed to create the image");
+        return NULL;
+    }
+    return image_wrap(image, true);
+}
+
+static PyObject *module_get_device_count(PyObject *module, PyObject *unused)
+{
+    (void)module;
+    (void)unused;
+    uint32_t count;
+
+    Py_BEGIN_ALLOW_THREADS
+    count = zsa_device_get_installed_count();
+    Py_END_ALLOW_THREADS
+
+    return PyLong_FromUnsignedLong(count);
+}
+
+static PyMethodDef module_methods[] = {
+    { "create_image",
+      (PyCFunction)(void (*)(void))module_create_image,
+      METH_VARARGS | METH_KEYWORDS,
+      "create_image(format, width, height, stride)\n\nCreates a writable Image." },
+    { "get_device_count", module_get_device_count, METH_NOARGS, "Number of devices connected." },
+    { NULL, NULL, 0, NULL },
+};
+
+static struct PyModuleDef module_def = {
+    PyModuleDef_HEAD_INIT, "_zsa", "Bindings of the zsa SDK", -1, module_methods, NULL, NULL, NULL, NULL,
+};
+
+#define ADD_CONSTANT(name, value)                                                                                      \
+    if (PyModule_AddIntConstant(module, name, value) != 0)                                                             \
+    {                                                                                                                  \
+        goto error;                                                                                                    \
+    }
+
+PyMODINIT_FUNC PyInit__zsa(void)
+{
+    PyObject *module = NULL;
+
+    if (PyType_Ready(&device_type) < 0 || PyType_Ready(&capture_type) < 0 || PyType_Ready(&image_type) < 0)
+    {
+        return NULL;
+    }
+
+    module = PyModule_Create(&module_def);
+    if (module == NULL)
+    {
+        return NULL;
+    }
+
+    zsa_error = PyErr_NewException("zsa.Error", NULL, NULL);
+    if (zsa_error == NULL || PyModule_AddObject(module, "Error", zsa_error) != 0)
+    {
+        goto error;
+    }
+    Py_INCREF(zsa_error);
+
+    Py_INCREF(&device_type);
+    Py_INCREF(&capture_type);
+    Py_INCREF(&image_type);
+    if (PyModule_AddObject(module, "Device", (PyObject *)&device_type) != 0 ||
+        PyModule_AddObject(module, "Capture", (PyObject *)&capture_type) != 0 ||
+        PyModule_AddObject(module, "Image", (PyObject *)&image_type) != 0)
+    {
+        goto error;
+    }
+
+    ADD_CONSTANT("IMAGE_FORMAT_COLOR_MJPG", ZSA_IMAGE_FORMAT_COLOR_MJPG);
+    ADD_CONSTANT("IMAGE_FORMAT_COLOR_NV12", ZSA_IMAGE_FORMAT_COLOR_NV12);
+    ADD_CONSTANT("IMAGE_FORMAT_COLOR_YUY2", ZSA_IMAGE_FORMAT_COLOR_YUY2);
+    ADD_CONSTANT("IMAGE_FORMAT_COLOR_BGRA32", ZSA_IMAGE_FORMAT_COLOR_BGRA32);
+    ADD_CONSTANT("IMAGE_FORMAT_DEPTH16", ZSA_IMAGE_FORMAT_DEPTH16);
+    ADD_CONSTANT("IMAGE_FORMAT_IR16", ZSA_IMAGE_FORMAT_IR16);
+    ADD_CONSTANT("IMAGE_FORMAT_CUSTOM8", ZSA_IMAGE_FORMAT_CUSTOM8);
+    ADD_CONSTANT("IMAGE_FORMAT_CUSTOM16", ZSA_IMAGE_FORMAT_CUSTOM16);
+    ADD_CONSTANT("IMAGE_FORMAT_CUSTOM", ZSA_IMAGE_FORMAT_CUSTOM);
+    ADD_CONSTANT("COLOR_RESOLUTION_720P", ZSA_COLOR_RESOLUTION_720P);
+    ADD_CONSTANT("COLOR_RESOLUTION_1080P", ZSA_COLOR_RESOLUTION_1080P);
+    ADD_CONSTANT("COLOR_RESOLUTION_1440P", ZSA_COLOR_RESOLUTION_1440P);
+    ADD_CONSTANT("COLOR_RESOLUTION_1536P", ZSA_COLOR_RESOLUTION_1536P);
+    ADD_CONSTANT("COLOR_RESOLUTION_2160P", ZSA_COLOR_RESOLUTION_2160P);
+    ADD_CONSTANT("COLOR_RESOLUTION_3072P", ZSA_COLOR_RESOLUTION_3072P);
+    ADD_CONSTANT("FPS_5", ZSA_FRAMES_PER_SECOND_5);
+    ADD_CONSTANT("FPS_15", ZSA_FRAMES_PER_SECOND_15);
+    ADD_CONSTANT("FPS_30", ZSA_FRAMES_PER_SECOND_30);
+
+    return module;
+
+error:
+    Py_DECREF(module);
+    return NULL;
+}
@@ -9,6 +9,7 @@
 #include <zsainternal/global.h>
 #include <zsainternal/rwlock.h>
 #include <azure_c_shared_utility/refcount.h>
+#include <azure_c_shared_utility/threadapi.h>
 
 // System dependencies
 #include <stdlib.h>
@@ -17,23 +18,116 @@
 #include <assert.h>
 #include <math.h>
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 typedef enum
 {
     IMAGE_TYPE_COLOR = 0,
     IMAGE_TYPE_DEPTH,
     IMAGE_TYPE_IR,
+    IMAGE_TYPE_HEIGHT_MAP,
+    IMAGE_TYPE_COLOR_DECODED,
     IMAGE_TYPE_COUNT,
 } image_type_index_t;
 
-// Global properties of the allocator
+// Mappings of freed buffers each source keeps for reuse
+#define ALLOCATOR_MAPPING_CACHE_SIZE (4)
+
+// Allocations aligned to this or more keep their header out of band, see allocator_alloc_aligned()
+#define ALLOCATOR_OUT_OF_BAND_ALIGNMENT (2 * ALLOCATOR_PAGE_ALIGNMENT)
+
+// Allocations whose header is kept out of band at once, later ones keep it in front of the buffer
+#define ALLOCATOR_OUT_OF_BAND_SLOTS (128)
+
+// Policy of mbind() preferring a node, from <numaif.h> which is only installed with libnuma
+#define ALLOCATOR_MPOL_PREFERRED (1)
+
+// Memory mapped by the huge page backend
 typedef struct
 {
-    zsa_rwlock_t lock;
+    void *address;   // NULL if not mapped
+    size_t bytes;    // Multiple of ALLOCATOR_HUGE_PAGE_ALIGNMENT
+    bool huge_pages; // Backed by reserved huge pages, otherwise advised for transparent huge pages
+    int numa_node;   // Node requested for the mapping
+} allocator_mapping_t;
 
-    // Access to these function pointers may only occur
-    // while holding lock
-    zsa_memory_allocate_cb_t *alloc;
+// Huge page backend state of an allocation source
+typedef struct
+{
+    allocator_mapping_t cache[ALLOCATOR_MAPPING_CACHE_SIZE];
+    uint32_t cache_count;
+    allocator_backend_stats_t stats;
+} allocator_source_backend_t;
+
+// Allocations aligned beyond ALLOCATOR_DEFAULT_ALIGNMENT are moved up to the alignment within a larger allocation. How
+// that allocation is freed is kept in the padding in front of the buffer, followed by the allocation context, so the
+// buffer starts right at the alignment and a page aligned buffer only holds whole pages. Beyond a page that padding
+// would take a whole alignment, so the header is kept in an out of band slot instead.
+typedef struct _aligned_allocation_t
+{
+    void *full_buffer; // Returned by the allocate callback
     zsa_memory_destroy_cb_t *free;
+    void *free_context;
+    allocator_mapping_t mapping; // Set instead of free when served by the huge page backend
+} aligned_allocation_t;
+
+// Header of an allocation kept out of band, claimed and released with atomic operations on buffer
+typedef struct
+{
+    void *volatile buffer; // NULL if the slot is free
+    allocation_source_t source;
+    size_t size;
+    aligned_allocation_t allocation;
+} allocator_out_of_band_slot_t;
+
+// How a source allocates. Never modified once published, a change publishes a copy, so allocations read it without
+// taking a lock.
+typedef struct
+{
+    zsa_memory_allocate_cb_t *alloc;                 // NULL when alloc_aligned serves every allocation
+    zsa_memory_destroy_cb_t *free;                   // Frees what alloc returned
+    zsa_memory_allocate_aligned_cb_t *alloc_aligned; // NULL when aligned allocations are padded through alloc
+    zsa_memory_destroy_cb_t *free_aligned;           // Frees what alloc_aligned returned
+    void *context;                                   // Passed to alloc and alloc_aligned in *context
+    size_t alignment;                                // Alignment of allocator_alloc()
+    allocator_backend_t backend;
+    int numa_node;
+    size_t budget_bytes; // 0 if none
+    allocator_budget_policy_t budget_policy;
+} allocator_config_t;
+
+// Global properties of the allocator
+typedef struct
+{
+    zsa_rwlock_t lock; // Serializes changes of config
+
+    // Published with an atomic exchange. Readers hold a read section, see allocator_read_config(), while they use
+    // it and a replaced config is freed once the read sections that could have seen it ended.
+    allocator_config_t *volatile config[ALLOCATION_SOURCE_COUNT];
+    allocator_config_t initial_config[ALLOCATION_SOURCE_COUNT]; // Published first, never freed
+    volatile long reader_phase;                                  // Selects readers[] of new read sections
+    volatile long readers[2];                                    // Read sections in progress per phase
+
+    zsa_rwlock_t backend_lock; // Protects backend
+    allocator_source_backend_t backend[ALLOCATION_SOURCE_COUNT];
+
+    // Memory budget, updated with atomic operations
+    volatile int64_t bytes_in_flight[ALLOCATION_SOURCE_COUNT];
+    volatile int64_t peak_bytes_in_flight[ALLOCATION_SOURCE_COUNT];
+    volatile int64_t total_bytes_in_flight;
+    volatile size_t total_budget_bytes; // 0 if none
+    volatile long shed_count[ALLOCATION_SOURCE_COUNT];
+    volatile long failed_allocations[ALLOCATION_SOURCE_COUNT];
+
+    // Headers of allocations aligned to ALLOCATOR_OUT_OF_BAND_ALIGNMENT or more, looked up by buffer when freed
+    allocator_out_of_band_slot_t out_of_band[ALLOCATOR_OUT_OF_BAND_SLOTS];
+    volatile long out_of_band_count; // Slots reserved, a slot is reserved before it is claimed
 } allocator_global_t;
 
 // This allocator implementation is used by default
@@ -55,13 +149,61 @@ static void default_free(void *buffer, void *context)
     free(buffer);
 }
 
+// This aligned allocator implementation is used by default
+static uint8_t *default_alloc_aligned(int size, int alignment, void **context)
+{
+    *context = NULL;
+    if (size < 0)
+    {
+        return NULL;
+    }
+#ifdef _WIN32
+    return (uint8_t *)_aligned_malloc((size_t)size, (size_t)alignment);
+#else
+    void *buffer = NULL;
+    if (posix_memalign(&buffer, (size_t)alignment, (size_t)size) != 0)
+    {
+        return NULL;
+    }
+    return (uint8_t *)buffer;
+#endif
+}
+
+// This is the free function for the default aligned allocator
+static void default_free_aligned(void *buffer, void *context)
+{
+    (void)context;
+    assert(context == NULL);
+#ifdef _WIN32
+    _aligned_free(buffer);
+#else
+    free(buffer);
+#endif
+}
+
 // This is a one time initialization of the global state for the allocator
 static void allocator_global_init(allocator_global_t *g_allocator)
 {
     rwlock_init(&g_allocator->lock);
+    rwlock_init(&g_allocator->backend_lock);
 
-    g_allocator->alloc = default_alloc;
-    g_allocator->free = default_free;
+    for (int i = 0; i < ALLOCATION_SOURCE_COUNT; i++)
+    {
+        allocator_config_t *config = &g_allocator->initial_config[i];
+        config->alloc = default_alloc;
+        config->free = default_free;
+        config->alloc_aligned = default_alloc_aligned;
+        config->free_aligned = default_free_aligned;
+        config->context = NULL;
+        config->alignment = ALLOCATOR_DEFAULT_ALIGNMENT;
+        config->backend = ALLOCATOR_BACKEND_HEAP;
+        config->numa_node = ALLOCATOR_NUMA_NODE_ANY;
+        config->budget_bytes = 0;
+        config->budget_policy = ALLOCATOR_BUDGET_SHED;
+        g_allocator->config[i] = config;
+    }
+    // Color frames are read with vector loads
+    g_allocator->initial_config[ALLOCATION_SOURCE_COLOR].alignment = ALLOCATOR_CACHE_LINE_ALIGNMENT;
 }
 
 // The allocation context is pre-pended to memory returned by the allocator
@@ -73,6 +215,9 @@ typedef struct _allocation_context_t
         struct _context
         {
             allocation_source_t source;
+            size_t size; // Requested by the caller
+
+            // NULL for aligned allocations, free_context then points to their aligned_allocation_t
             zsa_memory_destroy_cb_t *free;
             void *free_context;
         } context;
@@ -113,89 +258,699 @@ typedef struct _capture_context_t
     zsa_image_t image[IMAGE_TYPE_COUNT];
 
     float temperature_c; /** Temperature in Celsius */
+
+    capture_color_decoder_t color_decoder; /** Decodes IMAGE_TYPE_COLOR into IMAGE_TYPE_COLOR_DECODED on demand */
+    zsa_rwlock_t decode_lock;              /** Held for write while decoding, so the decode runs once */
 } capture_context_t;
 
-ZSA_DECLARE_CONTEXT(zsa_capture_t, capture_context_t);
+ZSA_DECLARE_CONTEXT(zsa_capture_t, capture_context_t);
+
+// Starts a read section of the config of a source, which stays valid until allocator_end_read()
+static const allocator_config_t *allocator_begin_read(allocation_source_t source, long *phase)
+{
+    allocator_global_t *g_allocator = allocator_global_t_get();
+
+    *phase = g_allocator->reader_phase & 1;
+    // A full barrier, the config is read after the read section is visible to allocator_synchronize()
+    INC_REF_VAR(g_allocator->readers[*phase]);
+    return g_allocator->config[source];
+}
+
+static void allocator_end_read(long phase)
+{
+    allocator_global_t *g_allocator = allocator_global_t_get();
+    DEC_REF_VAR(g_allocator->readers[phase]);
+}
+
+// Waits for the read sections started before a config was replaced. Called with lock held for write.
+static void allocator_synchronize(void)
+{
+    allocator_global_t *g_allocator = allocator_global_t_get();
+
+    // Read sections starting meanwhile count in the other phase, so each wait ends
+    for (int i = 0; i < 2; i++)
+    {
+        long phase = g_allocator->reader_phase & 1;
+        INC_REF_VAR(g_allocator->reader_phase);
+        while (g_allocator->readers[phase] != 0)
+        {
+            ThreadAPI_Sleep(1);
+        }
+    }
+}
+
+static allocator_config_t *allocator_exchange_config(allocator_config_t *volatile *config, allocator_config_t *value)
+{
+#ifdef _WIN32
+    return (allocator_config_t *)InterlockedExchangePointer((PVOID volatile *)config, value);
+#else
+    return __atomic_exchange_n(config, value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+// Copies the configs of sources first to last to change them. Called with lock held for write.
+static zsa_result_t allocator_copy_configs(int first, int last, allocator_config_t **configs)
+{
+    allocator_global_t *g_allocator = allocator_global_t_get();
+
+    for (int i = first; i <= last; i++)
+    {
+        configs[i] = (allocator_config_t *)malloc(sizeof(allocator_config_t));
+        if (configs[i] == NULL)
+        {
+            LOG_ERROR("Failed to allocate an allocator config", 0);
+            for (int j = first; j < i; j++)
+            {
+                free(configs[j]);
+            }
+            return ZSA_RESULT_FAILED;
+        }
+        *configs[i] = *g_allocator->config[i];
+    }
+    return ZSA_RESULT_SUCCEEDED;
+}
+
+// Publishes the changed configs of sources first to last and frees the ones they replace. Called with lock held for
+// write.
+static void allocator_publish_configs(int first, int last, allocator_config_t **configs)
+{
+    allocator_global_t *g_allocator = allocator_global_t_get();
+    allocator_config_t *replaced[ALLOCATION_SOURCE_COUNT];
+
+    for (int i = first; i <= last; i++)
+    {
+        replaced[i] = allocator_exchange_config(&g_allocator->config[i], configs[i]);
+    }
+
+    allocator_synchronize();
+
+    for (int i = first; i <= last; i++)
+    {
+        if (replaced[i] != &g_allocator->initial_config[i])
+        {
+            free(replaced[i]);
+        }
+    }
+}
+
+#ifndef _WIN32
+// Prefers numa_node for the pages of a mapping, before any of them is touched
+static bool allocator_bind_mapping(const allocator_mapping_t *mapping)
+{
+#ifdef SYS_mbind
+    unsigned long node_mask = 1UL << mapping->numa_node;
+    // The kernel reads one bit less than maxnode
+    unsigned long max_node = sizeof(node_mask) * 8 + 1;
+    return syscall(SYS_mbind, mapping->address, mapping->bytes, ALLOCATOR_MPOL_PREFERRED, &node_mask, max_node, 0) ==
+           0;
+#else
+    (void)mapping;
+    return false;
+#endif
+}
+#endif
+
+// Maps bytes rounded up to whole huge pages, from reserved huge pages when there are enough and otherwise from regular
+// pages advised to be backed by transparent huge pages. bound is false if the mapping could not be bound to numa_node.
+static bool allocator_map(size_t bytes, int numa_node, allocator_mapping_t *mapping, bool *bound)
+{
+    mapping->address = NULL;
+    mapping->bytes = (bytes + ALLOCATOR_HUGE_PAGE_ALIGNMENT - 1) & ~(size_t)(ALLOCATOR_HUGE_PAGE_ALIGNMENT - 1);
+    mapping->huge_pages = false;
+    mapping->numa_node = numa_node;
+    *bound = true;
+
+#ifdef _WIN32
+    return false;
+#else
+#ifdef MAP_HUGETLB
+    void *address = mmap(NULL,
+                         mapping->bytes,
+                         PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+                         -1,
+                         0);
+    if (address != MAP_FAILED)
+    {
+        mapping->address = address;
+        mapping->huge_pages = true;
+    }
+#endif
+
+    if (mapping->address == NULL)
+    {
+        // Map a huge page more than needed and trim the mapping to start on a huge page
+        size_t span = mapping->bytes + ALLOCATOR_HUGE_PAGE_ALIGNMENT;
+        uint8_t *span_address = (uint8_t *)mmap(NULL, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (span_address == MAP_FAILED)
+        {
+            return false;
+        }
+
+        uintptr_t start = ((uintptr_t)span_address + ALLOCATOR_HUGE_PAGE_ALIGNMENT - 1) &
+                          ~(uintptr_t)(ALLOCATOR_HUGE_PAGE_ALIGNMENT - 1);
+        uint8_t *start_address = (uint8_t *)start;
+        uint8_t *end_address = start_address + mapping->bytes;
+        if (start_address != span_address)
+        {
+            munmap(span_address, (size_t)(start_address - span_address));
+        }
+        munmap(end_address, (size_t)(span_address + span - end_address));
+
+#ifdef MADV_HUGEPAGE
+        (void)madvise(start_address, mapping->bytes, MADV_HUGEPAGE);
+#endif
+        mapping->address = start_address;
+    }
+
+    if (numa_node != ALLOCATOR_NUMA_NODE_ANY)
+    {
+        *bound = allocator_bind_mapping(mapping);
+    }
+    return true;
+#endif
+}
+
+static void allocator_unmap(const allocator_mapping_t *mapping)
+{
+#ifndef _WIN32
+    munmap(mapping->address, mapping->bytes);
+#else
+    (void)mapping;
+#endif
+}
+
+// Unmaps the mappings of freed buffers kept for reuse by a source
+static void allocator_release_mapping_cache(allocation_source_t source)
+{
+    allocator_global_t *g_allocator = allocator_global_t_get();
+    allocator_mapping_t cache[ALLOCATOR_MAPPING_CACHE_SIZE];
+
+    rwlock_acquire_write(&g_allocator->backend_lock);
+    uint32_t cache_count = g_allocator->backend[source].cache_count;
+    memcpy(cache, g_allocator->backend[source].cache, sizeof(cache));
+    g_allocator->backend[source].cache_count = 0;
+    rwlock_release_write(&g_allocator->backend_lock);
+
+    for (uint32_t i = 0; i < cache_count; i++)
+    {
+        allocator_unmap(&cache[i]);
+    }
+}
+
+void allocator_initialize(void)
+{
+    INC_REF_VAR(g_allocator_sessions);
+}
+
+void allocator_deinitialize(void)
+{
+    if (DEC_REF_VAR(g_allocator_sessions) == 0)
+    {
+        // Nothing streams until the next session, give back the mappings kept for reuse
+        for (int i = 0; i < ALLOCATION_SOURCE_COUNT; i++)
+        {
+            allocator_release_mapping_cache((allocation_source_t)i);
+        }
+    }
+}
+
+// Sets the callbacks of sources first to last, the defaults if both allocate callbacks are NULL
+static zsa_result_t allocator_publish_callbacks(int first, int last, const allocator_callbacks_t *callbacks)
+{
+    allocator_global_t *g_allocator = allocator_global_t_get();
+    allocator_config_t *configs[ALLOCATION_SOURCE_COUNT];
+
+    rwlock_acquire_write(&g_allocator->lock);
+    zsa_result_t result = allocator_copy_configs(first, last, configs);
+    if (ZSA_SUCCEEDED(result))
+    {
+        for (int i = first; i <= last; i++)
+        {
+            configs[i]->alloc = callbacks->alloc;
+            configs[i]->free = callbacks->free;
+            configs[i]->alloc_aligned = callbacks->alloc_aligned;
+            configs[i]->free_aligned = callbacks->free_aligned;
+            configs[i]->context = callbacks->context;
+        }
+        allocator_publish_configs(first, last, configs);
+    }
+    rwlock_release_write(&g_allocator->lock);
+
+    return result;
+}
+
+static zsa_result_t allocator_set_callbacks(int first,
+                                            int last,
+                                            zsa_memory_allocate_cb_t *allocate,
+                                            zsa_memory_allocate_aligned_cb_t *allocate_aligned,
+                                            zsa_memory_destroy_cb_t *free,
+                                            void *context)
+{
+    bool reset = allocate == NULL && allocate_aligned == NULL;
+    allocator_callbacks_t callbacks;
+
+    callbacks.alloc = reset ? default_alloc : allocate;
+    callbacks.free = reset ? default_free : free;
+    callbacks.alloc_aligned = reset ? default_alloc_aligned : allocate_aligned;
+    callbacks.free_aligned = reset ? default_free_aligned : free;
+    callbacks.context = reset ? NULL : context;
+
+    return allocator_publish_callbacks(first, last, &callbacks);
+}
+
+zsa_result_t allocator_set_allocator(zsa_memory_allocate_cb_t allocate, zsa_memory_destroy_cb_t free)
+{
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, allocate == NULL && free != NULL);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, allocate != NULL && free == NULL);
+
+    return allocator_set_callbacks(ALLOCATION_SOURCE_USER, ALLOCATION_SOURCE_USB_IMU, allocate, NULL, free, NULL);
+}
+
+zsa_result_t allocator_set_allocator_aligned(zsa_memory_allocate_aligned_cb_t allocate, zsa_memory_destroy_cb_t free)
+{
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, allocate == NULL && free != NULL);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, allocate != NULL && free == NULL);
+
+    return allocator_set_callbacks(ALLOCATION_SOURCE_USER, ALLOCATION_SOURCE_USB_IMU, NULL, allocate, free, NULL);
+}
+
+zsa_result_t allocator_set_source_allocator(allocation_source_t source,
+                                            zsa_memory_allocate_cb_t allocate,
+                                            zsa_memory_destroy_cb_t free,
+                                            void *context)
+{
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, source < ALLOCATION_SOURCE_USER || source > ALLOCATION_SOURCE_USB_IMU);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, allocate == NULL && free != NULL);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, allocate != NULL && free == NULL);
+
+    return allocator_set_callbacks(source, source, allocate, NULL, free, context);
+}
+
+zsa_result_t allocator_set_source_allocator_aligned(allocation_source_t source,
+                                                    zsa_memory_allocate_aligned_cb_t allocate,
+                                                    zsa_memory_destroy_cb_t free,
+                                                    void *context)
+{
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, source < ALLOCATION_SOURCE_USER || source > ALLOCATION_SOURCE_USB_IMU);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, allocate == NULL && free != NULL);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, allocate != NULL && free == NULL);
+
+    return allocator_set_callbacks(source, source, NULL, allocate, free, context);
+}
+
+zsa_result_t allocator_get_source_callbacks(allocation_source_t source, allocator_callbacks_t *callbacks)
+{
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, source < ALLOCATION_SOURCE_USER || source > ALLOCATION_SOURCE_USB_IMU);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, callbacks == NULL);
+
+    long phase;
+    const allocator_config_t *config = allocator_begin_read(source, &phase);
+    callbacks->alloc = config->alloc;
+    callbacks->free = config->free;
+    callbacks->alloc_aligned = config->alloc_aligned;
+    callbacks->free_aligned = config->free_aligned;
+    callbacks->context = config->context;
+    allocator_end_read(phase);
+
+    return ZSA_RESULT_SUCCEEDED;
+}
+
+zsa_result_t allocator_set_source_callbacks(allocation_source_t source, const allocator_callbacks_t *callbacks)
+{
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, source < ALLOCATION_SOURCE_USER || source > ALLOCATION_SOURCE_USB_IMU);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, callbacks == NULL);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, callbacks->alloc == NULL && callbacks->alloc_aligned == NULL);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, callbacks->alloc != NULL && callbacks->free == NULL);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, callbacks->alloc_aligned != NULL && callbacks->free_aligned == NULL);
+
+    return allocator_publish_callbacks(source, source, callbacks);
+}
+
+static bool is_valid_alignment(size_t alignment)
+{
+    return alignment != 0 && (alignment & (alignment - 1)) == 0 && alignment <= ALLOCATOR_HUGE_PAGE_ALIGNMENT;
+}
+
+zsa_result_t allocator_set_alignment(allocation_source_t source, size_t alignment)
+{
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, source < ALLOCATION_SOURCE_USER || source > ALLOCATION_SOURCE_USB_IMU);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, !is_valid_alignment(alignment) || alignment < ALLOCATOR_DEFAULT_ALIGNMENT);
+
+    allocator_global_t *g_allocator = allocator_global_t_get();
+    allocator_config_t *configs[ALLOCATION_SOURCE_COUNT];
+
+    rwlock_acquire_write(&g_allocator->lock);
+    zsa_result_t result = allocator_copy_configs(source, source, configs);
+    if (ZSA_SUCCEEDED(result))
+    {
+        configs[source]->alignment = alignment;
+        allocator_publish_configs(source, source, configs);
+    }
+    rwlock_release_write(&g_allocator->lock);
+
+    return result;
+}
+
+zsa_result_t allocator_set_backend(allocation_source_t source, allocator_backend_t backend, int numa_node)
+{
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, source < ALLOCATION_SOURCE_USER || source > ALLOCATION_SOURCE_USB_IMU);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, backend > ALLOCATOR_BACKEND_HUGE_PAGES);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, numa_node < ALLOCATOR_NUMA_NODE_ANY);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, numa_node >= ALLOCATOR_MAX_NUMA_NODES);
+#ifdef _WIN32
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, backend == ALLOCATOR_BACKEND_HUGE_PAGES);
+#endif
+
+    allocator_global_t *g_allocator = allocator_global_t_get();
+    allocator_config_t *configs[ALLOCATION_SOURCE_COUNT];
+
+    rwlock_acquire_write(&g_allocator->lock);
+    zsa_result_t result = allocator_copy_configs(source, source, configs);
+    if (ZSA_SUCCEEDED(result))
+    {
+        configs[source]->backend = backend;
+        configs[source]->numa_node = numa_node;
+        allocator_publish_configs(source, source, configs);
+    }
+    rwlock_release_write(&g_allocator->lock);
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        // Mappings kept for reuse may be on another node
+        allocator_release_mapping_cache(source);
+    }
+
+    return result;
+}
+
+zsa_result_t allocator_set_budget(allocation_source_t source, size_t budget_bytes, allocator_budget_policy_t policy)
+{
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, source < ALLOCATION_SOURCE_USER || source > ALLOCATION_SOURCE_USB_IMU);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, policy != ALLOCATOR_BUDGET_SHED && policy != ALLOCATOR_BUDGET_FAIL);
+
+    allocator_global_t *g_allocator = allocator_global_t_get();
+    allocator_config_t *configs[ALLOCATION_SOURCE_COUNT];
+
+    rwlock_acquire_write(&g_allocator->lock);
+    zsa_result_t result = allocator_copy_configs(source, source, configs);
+    if (ZSA_SUCCEEDED(result))
+    {
+        configs[source]->budget_bytes = budget_bytes;
+        configs[source]->budget_policy = policy;
+        allocator_publish_configs(source, source, configs);
+    }
+    rwlock_release_write(&g_allocator->lock);
+
+    return result;
+}
+
+void allocator_set_total_budget(size_t budget_bytes)
+{
+    allocator_global_t *g_allocator = allocator_global_t_get();
+    g_allocator->total_budget_bytes = budget_bytes;
+}
+
+static int64_t allocator_add_bytes(volatile int64_t *bytes, int64_t delta)
+{
+#ifdef _WIN32
+    return InterlockedExchangeAdd64((volatile LONG64 *)bytes, delta) + delta;
+#else
+    return __atomic_add_fetch(bytes, delta, __ATOMIC_SEQ_CST);
+#endif
+}
+
+static bool allocator_fits_budget(const allocator_config_t *config, int64_t source_bytes, int64_t total_bytes)
+{
+    allocator_global_t *g_allocator = allocator_global_t_get();
+    size_t total_budget_bytes = g_allocator->total_budget_bytes;
+
+    return (config->budget_bytes == 0 || source_bytes <= (int64_t)config->budget_bytes) &&
+           (total_budget_bytes == 0 || total_bytes <= (int64_t)total_budget_bytes);
+}
+
+// Counts the bytes of an allocation in flight. Fails, counting nothing, when they go over budget and the policy of
+// the source is to fail allocations.
+static bool allocator_charge(allocation_source_t source, const allocator_config_t *config, size_t bytes)
+{
+    allocator_global_t *g_allocator = allocator_global_t_get();
+
+    int64_t source_bytes = allocator_add_bytes(&g_allocator->bytes_in_flight[source], (int64_t)bytes);
+    int64_t total_bytes = allocator_add_bytes(&g_allocator->total_bytes_in_flight, (int64_t)bytes);
+
+    if (config->budget_policy == ALLOCATOR_BUDGET_FAIL && !allocator_fits_budget(config, source_bytes, total_bytes))
+    {
+        allocator_add_bytes(&g_allocator->bytes_in_flight[source], -(int64_t)bytes);
+        allocator_add_bytes(&g_allocator->total_bytes_in_flight, -(int64_t)bytes);
+        INC_REF_VAR(g_allocator->failed_allocations[source]);
+        return false;
+    }
+
+    // Racing updates may lose a peak by the size of one allocation
+    if (source_bytes > g_allocator->peak_bytes_in_flight[source])
+    {
+        g_allocator->peak_bytes_in_flight[source] = source_bytes;
+    }
+    return true;
+}
+
+static void allocator_discharge(allocation_source_t source, size_t bytes)
+{
+    allocator_global_t *g_allocator = allocator_global_t_get();
+
+    allocator_add_bytes(&g_allocator->bytes_in_flight[source], -(int64_t)bytes);
+    allocator_add_bytes(&g_allocator->total_bytes_in_flight, -(int64_t)bytes);
+}
+
+bool allocator_within_budget(allocation_source_t source, size_t bytes)
+{
+    RETURN_VALUE_IF_ARG(false, source < ALLOCATION_SOURCE_USER || source > ALLOCATION_SOURCE_USB_IMU);
+
+    allocator_global_t *g_allocator = allocator_global_t_get();
+
+    long phase;
+    const allocator_config_t *config = allocator_begin_read(source, &phase);
+    bool within_budget = allocator_fits_budget(config,
+                                               g_allocator->bytes_in_flight[source] + (int64_t)bytes,
+                                               g_allocator->total_bytes_in_flight + (int64_t)bytes);
+    allocator_end_read(phase);
+
+    return within_budget;
+}
+
+void allocator_record_shed(allocation_source_t source)
+{
+    RETURN_VALUE_IF_ARG(VOID_VALUE, source < ALLOCATION_SOURCE_USER || source > ALLOCATION_SOURCE_USB_IMU);
+
+    allocator_global_t *g_allocator = allocator_global_t_get();
+    INC_REF_VAR(g_allocator->shed_count[source]);
+}
+
+void allocator_get_memory_usage(allocator_memory_usage_t *usage)
+{
+    RETURN_VALUE_IF_ARG(VOID_VALUE, usage == NULL);
+
+    allocator_global_t *g_allocator = allocator_global_t_get();
+
+    usage->bytes_in_flight = g_allocator->total_bytes_in_flight;
+    usage->budget_bytes = g_allocator->total_budget_bytes;
+    for (int i = 0; i < ALLOCATION_SOURCE_COUNT; i++)
+    {
+        allocator_source_usage_t *source_usage = &usage->sources[i];
+        long phase;
+        const allocator_config_t *config = allocator_begin_read((allocation_source_t)i, &phase);
+        source_usage->budget_bytes = config->budget_bytes;
+        source_usage->budget_policy = config->budget_policy;
+        allocator_end_read(phase);
+
+        source_usage->bytes_in_flight = g_allocator->bytes_in_flight[i];
+        source_usage->peak_bytes_in_flight = g_allocator->peak_bytes_in_flight[i];
+        source_usage->shed_count = (uint64_t)g_allocator->shed_count[i];
+        source_usage->failed_allocations = (uint64_t)g_allocator->failed_allocations[i];
+    }
+}
+
+zsa_result_t allocator_get_backend_stats(allocation_source_t source, allocator_backend_stats_t *stats)
+{
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, source < ALLOCATION_SOURCE_USER || source > ALLOCATION_SOURCE_USB_IMU);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, stats == NULL);
+
+    allocator_global_t *g_allocator = allocator_global_t_get();
+    rwlock_acquire_read(&g_allocator->backend_lock);
+    *stats = g_allocator->backend[source].stats;
+    rwlock_release_read(&g_allocator->backend_lock);
+
+    return ZSA_RESULT_SUCCEEDED;
+}
+
+int allocator_get_current_numa_node(void)
+{
+#if !defined(_WIN32) && defined(SYS_getcpu)
+    unsigned int cpu = 0;
+    unsigned int node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0 && node < ALLOCATOR_MAX_NUMA_NODES)
+    {
+        return (int)node;
+    }
+#endif
+    return ALLOCATOR_NUMA_NODE_ANY;
+}
+
+// The count of outstanding allocations of a source
+static volatile long *allocation_count(allocation_source_t source)
+{
+    switch (source)
+    {
+    case ALLOCATION_SOURCE_USER:
+        return &g_allocated_image_count_user;
+    case ALLOCATION_SOURCE_DEPTH:
+        return &g_allocated_image_count_depth;
+    case ALLOCATION_SOURCE_COLOR:
+        return &g_allocated_image_count_color;
+    case ALLOCATION_SOURCE_IMU:
+        return &g_allocated_image_count_imu;
+    case ALLOCATION_SOURCE_USB_DEPTH:
+        return &g_allocated_image_count_usb_depth;
+    case ALLOCATION_SOURCE_USB_IMU:
+        return &g_allocated_image_count_usb_imu;
+    default:
+        assert(0);
+        return NULL;
+    }
+}
+
+// Bytes in front of an aligned buffer describing its allocation
+#define ALIGNED_ALLOCATION_HEADER_SIZE (sizeof(aligned_allocation_t) + sizeof(allocation_context_t))
+
+// Writes the header in front of an aligned buffer, which free reads without looking the buffer up
+static void allocator_write_aligned_header(uint8_t *buffer,
+                                           allocation_source_t source,
+                                           size_t alloc_size,
+                                           const aligned_allocation_t *allocation)
+{
+    uint8_t *allocation_address = buffer - ALIGNED_ALLOCATION_HEADER_SIZE;
+    allocation_context_t allocation_context;
+
+    allocation_context.u.context.source = source;
+    allocation_context.u.context.size = alloc_size;
+    allocation_context.u.context.free = NULL;
+    allocation_context.u.context.free_context = allocation_address;
+
+    memcpy(allocation_address, allocation, sizeof(aligned_allocation_t));
+    memcpy(buffer - sizeof(allocation_context_t), &allocation_context, sizeof(allocation_context));
+}
+
+// Reserves an out of band slot for an allocation aligned to alignment, false to keep its header in front of it
+static bool allocator_reserve_out_of_band(size_t alignment)
+{
+    allocator_global_t *g_allocator = allocator_global_t_get();
+
+    if (alignment < ALLOCATOR_OUT_OF_BAND_ALIGNMENT)
+    {
+        return false;
+    }
+    if (INC_REF_VAR(g_allocator->out_of_band_count) > ALLOCATOR_OUT_OF_BAND_SLOTS)
+    {
+        DEC_REF_VAR(g_allocator->out_of_band_count);
+        return false;
+    }
+    return true;
+}
 
-void allocator_initialize(void)
+static void allocator_unreserve_out_of_band(void)
 {
-    INC_REF_VAR(g_allocator_sessions);
+    allocator_global_t *g_allocator = allocator_global_t_get();
+    DEC_REF_VAR(g_allocator->out_of_band_count);
 }
 
-void allocator_deinitialize(void)
+static size_t allocator_out_of_band_hash(const void *buffer)
 {
-    DEC_REF_VAR(g_allocator_sessions);
+    return (size_t)((uintptr_t)buffer / ALLOCATOR_OUT_OF_BAND_ALIGNMENT) % ALLOCATOR_OUT_OF_BAND_SLOTS;
 }
 
-zsa_result_t allocator_set_allocator(zsa_memory_allocate_cb_t allocate, zsa_memory_destroy_cb_t free)
+static bool allocator_claim_slot(void *volatile *slot_buffer, void *buffer)
 {
-    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, allocate == NULL && free != NULL);
-    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, allocate != NULL && free == NULL);
+#ifdef _WIN32
+    return InterlockedCompareExchangePointer((PVOID volatile *)slot_buffer, buffer, NULL) == NULL;
+#else
+    void *expected = NULL;
+    return __atomic_compare_exchange_n(slot_buffer, &expected, buffer, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+#endif
+}
 
+// Stores the header of a buffer in a slot reserved with allocator_reserve_out_of_band()
+static void allocator_write_out_of_band(uint8_t *buffer,
+                                        allocation_source_t source,
+                                        size_t alloc_size,
+                                        const aligned_allocation_t *allocation)
+{
     allocator_global_t *g_allocator = allocator_global_t_get();
-    rwlock_acquire_write(&g_allocator->lock);
-
-    g_allocator->alloc = allocate ? allocate : default_alloc;
-    g_allocator->free = free ? free : default_free;
-
-    rwlock_release_write(&g_allocator->lock);
 
-    return ZSA_RESULT_SUCCEEDED;
+    // The reservation leaves a free slot for this buffer, other buffers may claim the ones probed first meanwhile
+    for (size_t i = allocator_out_of_band_hash(buffer);; i = (i + 1) % ALLOCATOR_OUT_OF_BAND_SLOTS)
+    {
+        allocator_out_of_band_slot_t *slot = &g_allocator->out_of_band[i];
+        if (slot->buffer == NULL && allocator_claim_slot(&slot->buffer, buffer))
+        {
+            // Only the thread freeing the buffer reads the slot, after the buffer was handed to it
+            slot->source = source;
+            slot->size = alloc_size;
+            slot->allocation = *allocation;
+            return;
+        }
+    }
 }
 
-uint8_t *allocator_alloc(allocation_source_t source, size_t alloc_size)
+// Takes the header of a buffer out of its slot, false if the header is in front of the buffer
+static bool allocator_take_out_of_band(void *buffer, allocator_out_of_band_slot_t *header)
 {
     allocator_global_t *g_allocator = allocator_global_t_get();
 
-    RETURN_VALUE_IF_ARG(NULL, source < ALLOCATION_SOURCE_USER || source > ALLOCATION_SOURCE_USB_IMU);
-    RETURN_VALUE_IF_ARG(NULL, alloc_size == 0);
-
-    size_t required_bytes = alloc_size + sizeof(allocation_context_t);
-    RETURN_VALUE_IF_ARG(NULL, required_bytes > INT32_MAX);
-
-    volatile long *ref = NULL;
-    switch (source)
+    if (g_allocator->out_of_band_count == 0 || ((uintptr_t)buffer & (ALLOCATOR_OUT_OF_BAND_ALIGNMENT - 1)) != 0)
     {
-    case ALLOCATION_SOURCE_USER:
-        ref = &g_allocated_image_count_user;
-        break;
-    case ALLOCATION_SOURCE_DEPTH:
-        ref = &g_allocated_image_count_depth;
-        break;
-    case ALLOCATION_SOURCE_COLOR:
-        ref = &g_allocated_image_count_color;
-        break;
-    case ALLOCATION_SOURCE_IMU:
-        ref = &g_allocated_image_count_imu;
-        break;
-    case ALLOCATION_SOURCE_USB_DEPTH:
-        ref = &g_allocated_image_count_usb_depth;
-        break;
-    case ALLOCATION_SOURCE_USB_IMU:
-        ref = &g_allocated_image_count_usb_imu;
-        break;
-    default:
-        assert(0);
-        break;
+        return false;
     }
 
-    INC_REF_VAR(*ref);
+    size_t first = allocator_out_of_band_hash(buffer);
+    for (size_t n = 0; n < ALLOCATOR_OUT_OF_BAND_SLOTS; n++)
+    {
+        allocator_out_of_band_slot_t *slot = &g_allocator->out_of_band[(first + n) % ALLOCATOR_OUT_OF_BAND_SLOTS];
+        if (slot->buffer == buffer)
+        {
+            *header = *slot;
+#ifdef _WIN32
+            InterlockedExchangePointer((PVOID volatile *)&slot->buffer, NULL);
+#else
+            __atomic_store_n(&slot->buffer, NULL, __ATOMIC_SEQ_CST);
+#endif
+            allocator_unreserve_out_of_band();
+            return true;
+        }
+    }
+    return false;
+}
 
-    rwlock_acquire_read(&g_allocator->lock);
+static uint8_t *allocator_alloc_with_context(allocation_source_t source,
+                                             const allocator_config_t *config,
+                                             size_t alloc_size)
+{
+    size_t required_bytes = alloc_size + sizeof(allocation_context_t);
+    RETURN_VALUE_IF_ARG(NULL, required_bytes > INT32_MAX);
 
-    void *user_context;
+    void *user_context = config->context;
 
-    void *full_buffer = g_allocator->alloc((int)required_bytes, &user_context);
+    void *full_buffer = config->alloc ?
+                            config->alloc((int)required_bytes, &user_context) :
+                            config->alloc_aligned((int)required_bytes, ALLOCATOR_DEFAULT_ALIGNMENT, &user_context);
 
     // Store information about the allocation that we will need during free.
     allocation_context_t allocation_context;
 
     allocation_context.u.context.source = source;
-    allocation_context.u.context.free = g_allocator->free;
+    allocation_context.u.context.size = alloc_size;
+    allocation_context.u.context.free = config->alloc ? config->free : config->free_aligned;
     allocation_context.u.context.free_context = user_context;
 
-    rwlock_release_read(&g_allocator->lock);
-
     if (full_buffer == NULL)
     {
         LOG_ERROR("User allocation function for %d bytes failed", required_bytes);
@@ -212,8 +967,237 @@ uint8_t *allocator_alloc(allocation_source_t source, size_t alloc_size)
     return buffer;
 }
 
+static uint8_t *allocator_alloc_out_of_band(allocation_source_t source,
+                                            const allocator_config_t *config,
+                                            size_t alloc_size,
+                                            size_t alignment)
+{
+    // An aligned allocate callback returns a buffer on the alignment, the header takes whole alignments in front of
+    // the caller's buffer. Otherwise the buffer is padded so it can be moved up to the alignment past the header. A
+    // header kept out of band takes no room.
+    RETURN_VALUE_IF_ARG(NULL, alloc_size > INT32_MAX - ALIGNED_ALLOCATION_HEADER_SIZE - alignment);
+    bool out_of_band = allocator_reserve_out_of_band(alignment);
+    size_t header_bytes = out_of_band ? 0 : ALIGNED_ALLOCATION_HEADER_SIZE;
+    size_t prefix_bytes = (header_bytes + alignment - 1) & ~(alignment - 1);
+    size_t required_bytes = config->alloc_aligned ? alloc_size + prefix_bytes :
+                                                    alloc_size + header_bytes + alignment - 1;
+
+    aligned_allocation_t allocation;
+    uint8_t *buffer = NULL;
+    allocation.mapping.address = NULL;
+    allocation.free_context = config->context;
+
+    if (config->alloc_aligned)
+    {
+        allocation.full_buffer = config->alloc_aligned((int)required_bytes, (int)alignment, &allocation.free_context);
+        allocation.free = config->free_aligned;
+        buffer = (uint8_t *)allocation.full_buffer + prefix_bytes;
+    }
+    else
+    {
+        allocation.full_buffer = config->alloc((int)required_bytes, &allocation.free_context);
+        allocation.free = config->free;
+        uintptr_t address = (uintptr_t)allocation.full_buffer + header_bytes + alignment - 1;
+        buffer = (uint8_t *)(address & ~(uintptr_t)(alignment - 1));
+    }
+
+    if (allocation.full_buffer == NULL || ((uintptr_t)buffer & (alignment - 1)) != 0)
+    {
+        LOG_ERROR("User allocation function for %d bytes aligned to %d failed", alloc_size, alignment);
+        if (allocation.full_buffer)
+        {
+            allocation.free(allocation.full_buffer, allocation.free_context);
+        }
+        if (out_of_band)
+        {
+            allocator_unreserve_out_of_band();
+        }
+        return NULL;
+    }
+
+    if (out_of_band)
+    {
+        allocator_write_out_of_band(buffer, source, alloc_size, &allocation);
+    }
+    else
+    {
+        allocator_write_aligned_header(buffer, source, alloc_size, &allocation);
+    }
+    return buffer;
+}
+
+static uint8_t *allocator_alloc_mapped(allocation_source_t source,
+                                       const allocator_config_t *config,
+                                       size_t alloc_size,
+                                       size_t alignment)
+{
+    allocator_global_t *g_allocator = allocator_global_t_get();
+    allocator_source_backend_t *backend = &g_allocator->backend[source];
+
+    // Mappings start on a huge page, which is the start of the buffer when its header is kept out of band. Otherwise
+    // the header takes whole alignments at the start of the mapping.
+    alignment = alignment < ALLOCATOR_CACHE_LINE_ALIGNMENT ? ALLOCATOR_CACHE_LINE_ALIGNMENT : alignment;
+    RETURN_VALUE_IF_ARG(NULL, alloc_size > SIZE_MAX - 2 * ALLOCATOR_HUGE_PAGE_ALIGNMENT);
+    bool out_of_band = allocator_reserve_out_of_band(ALLOCATOR_HUGE_PAGE_ALIGNMENT);
+    size_t prefix_bytes = out_of_band ? 0 : (ALIGNED_ALLOCATION_HEADER_SIZE + alignment - 1) & ~(alignment - 1);
+    size_t mapped_bytes = (alloc_size + prefix_bytes + ALLOCATOR_HUGE_PAGE_ALIGNMENT - 1) &
+                          ~(size_t)(ALLOCATOR_HUGE_PAGE_ALIGNMENT - 1);
+
+    aligned_allocation_t allocation;
+    allocation.free = NULL;
+    allocation.free_context = NULL;
+
+    bool cached = false;
+    bool bound = true;
+
+    rwlock_acquire_write(&g_allocator->backend_lock);
+    for (uint32_t i = 0; i < backend->cache_count; i++)
+    {
+        if (backend->cache[i].bytes == mapped_bytes)
+        {
+            allocation.mapping = backend->cache[i];
+            backend->cache[i] = backend->cache[--backend->cache_count];
+            cached = true;
+            break;
+        }
+    }
+    rwlock_release_write(&g_allocator->backend_lock);
+
+    // Mapping zeroes the pages, which takes about as long as the first touch of a heap buffer
+    if (!cached && !allocator_map(mapped_bytes, config->numa_node, &allocation.mapping, &bound))
+    {
+        LOG_ERROR("Failed to map %d bytes of huge pages", mapped_bytes);
+        if (out_of_band)
+        {
+            allocator_unreserve_out_of_band();
+        }
+        return NULL;
+    }
+
+    rwlock_acquire_write(&g_allocator->backend_lock);
+    backend->stats.allocations++;
+    backend->stats.huge_page_allocations += allocation.mapping.huge_pages ? 1 : 0;
+    backend->stats.cached_allocations += cached ? 1 : 0;
+    backend->stats.numa_bind_failures += bound ? 0 : 1;
+    rwlock_release_write(&g_allocator->backend_lock);
+
+    allocation.full_buffer = allocation.mapping.address;
+    uint8_t *buffer = (uint8_t *)allocation.mapping.address + prefix_bytes;
+
+    if (out_of_band)
+    {
+        allocator_write_out_of_band(buffer, source, alloc_size, &allocation);
+    }
+    else
+    {
+        allocator_write_aligned_header(buffer, source, alloc_size, &allocation);
+    }
+    return buffer;
+}
+
+// Keeps the mapping of a freed buffer for reuse, or unmaps it
+static void allocator_free_mapped(allocation_source_t source, const allocator_mapping_t *mapping)
+{
+    allocator_global_t *g_allocator = allocator_global_t_get();
+    allocator_source_backend_t *backend = &g_allocator->backend[source];
+    bool cached = false;
+
+    long phase;
+    const allocator_config_t *config = allocator_begin_read(source, &phase);
+    bool reusable = config->backend == ALLOCATOR_BACKEND_HUGE_PAGES && config->numa_node == mapping->numa_node;
+    allocator_end_read(phase);
+
+    rwlock_acquire_write(&g_allocator->backend_lock);
+    if (reusable && backend->cache_count < ALLOCATOR_MAPPING_CACHE_SIZE && g_allocator_sessions != 0)
+    {
+        backend->cache[backend->cache_count++] = *mapping;
+        cached = true;
+    }
+    rwlock_release_write(&g_allocator->backend_lock);
+
+    if (!cached)
+    {
+        allocator_unmap(mapping);
+    }
+}
+
+uint8_t *allocator_alloc_aligned(allocation_source_t source, size_t alloc_size, size_t alignment)
+{
+    RETURN_VALUE_IF_ARG(NULL, source < ALLOCATION_SOURCE_USER || source > ALLOCATION_SOURCE_USB_IMU);
+    RETURN_VALUE_IF_ARG(NULL, alloc_size == 0);
+    RETURN_VALUE_IF_ARG(NULL, alignment != 0 && !is_valid_alignment(alignment));
+
+    // The read section keeps the callbacks from being replaced while they run
+    long phase;
+    const allocator_config_t *config = allocator_begin_read(source, &phase);
+    if (alignment == 0)
+    {
+        alignment = config->alignment;
+    }
+
+    if (!allocator_charge(source, config, alloc_size))
+    {
+        allocator_end_read(phase);
+        return NULL;
+    }
+
+    uint8_t *buffer;
+    if (config->backend == ALLOCATOR_BACKEND_HUGE_PAGES)
+    {
+        buffer = allocator_alloc_mapped(source, config, alloc_size, alignment);
+    }
+    else if (alignment <= ALLOCATOR_DEFAULT_ALIGNMENT)
+    {
+        buffer = allocator_alloc_with_context(source, config, alloc_size);
+    }
+    else
+    {
+        buffer = allocator_alloc_out_of_band(source, config, alloc_size, alignment);
+    }
+    allocator_end_read(phase);
+
+    if (buffer)
+    {
+        INC_REF_VAR(*allocation_count(source));
+    }
+    else
+    {
+        allocator_discharge(source, alloc_size);
+    }
+    return buffer;
+}
+
+uint8_t *allocator_alloc(allocation_source_t source, size_t alloc_size)
+{
+    return allocator_alloc_aligned(source, alloc_size, 0);
+}
+
+// Releases the allocation an aligned buffer was moved into
+static void allocator_free_aligned(allocation_source_t source, const aligned_allocation_t *allocation)
+{
+    if (allocation->mapping.address)
+    {
+        allocator_free_mapped(source, &allocation->mapping);
+    }
+    else
+    {
+        allocation->free(allocation->full_buffer, allocation->free_context);
+    }
+}
+
 void allocator_free(void *buffer)
 {
+    RETURN_VALUE_IF_ARG(VOID_VALUE, buffer == NULL);
+
+    allocator_out_of_band_slot_t header;
+    if (allocator_take_out_of_band(buffer, &header))
+    {
+        DEC_REF_VAR(*allocation_count(header.source));
+        allocator_discharge(header.source, header.size);
+        allocator_free_aligned(header.source, &header.allocation);
+        return;
+    }
+
     void *full_buffer = (uint8_t *)buffer - sizeof(allocation_context_t);
     allocation_context_t allocation_context;
     memcpy(&allocation_context, full_buffer, sizeof(allocation_context));
@@ -221,37 +1205,19 @@ void allocator_free(void *buffer)
     allocation_source_t source = allocation_context.u.context.source;
 
     RETURN_VALUE_IF_ARG(VOID_VALUE, source < ALLOCATION_SOURCE_USER || source > ALLOCATION_SOURCE_USB_IMU);
-    RETURN_VALUE_IF_ARG(VOID_VALUE, buffer == NULL);
 
-    volatile long *ref = NULL;
+    DEC_REF_VAR(*allocation_count(source));
+    allocator_discharge(source, allocation_context.u.context.size);
 
-    switch (source)
+    if (allocation_context.u.context.free == NULL)
     {
-    case ALLOCATION_SOURCE_USER:
-        ref = &g_allocated_image_count_user;
-        break;
-    case ALLOCATION_SOURCE_DEPTH:
-        ref = &g_allocated_image_count_depth;
-        break;
-    case ALLOCATION_SOURCE_COLOR:
-        ref = &g_allocated_image_count_color;
-        break;
-    case ALLOCATION_SOURCE_IMU:
-        ref = &g_allocated_image_count_imu;
-        break;
-    case ALLOCATION_SOURCE_USB_DEPTH:
-        ref = &g_allocated_image_count_usb_depth;
-        break;
-    case ALLOCATION_SOURCE_USB_IMU:
-        ref = &g_allocated_image_count_usb_imu;
-        break;
-    default:
-        assert(0);
-        break;
+        // An aligned allocation, read its header before the memory holding it is released
+        aligned_allocation_t allocation;
+        memcpy(&allocation, allocation_context.u.context.free_context, sizeof(allocation));
+        allocator_free_aligned(source, &allocation);
+        return;
     }
 
-    DEC_REF_VAR(*ref);
-
     allocation_context.u.context.free(full_buffer, allocation_context.u.context.free_context);
     full_buffer = NULL;
 }
@@ -310,6 +1276,7 @@ void capture_dec_ref(zsa_capture_t capture_handle)
         }
         rwlock_release_write(&capture->lock);
         rwlock_deinit(&capture->lock);
+        rwlock_deinit(&capture->decode_lock);
         zsa_capture_t_destroy(capture_handle);
     }
 }
@@ -334,6 +1301,7 @@ zsa_result_t capture_create(zsa_capture_t *capture_handle)
         capture->ref_count = 1;
         capture->temperature_c = NAN;
         rwlock_init(&capture->lock);
+        rwlock_init(&capture->decode_lock);
     }
 
     return result;
@@ -386,6 +1354,22 @@ zsa_image_t capture_get_ir_image(zsa_capture_t capture_handle)
     return *image;
 }
 
+zsa_image_t capture_get_height_map_image(zsa_capture_t capture_handle)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(NULL, zsa_capture_t, capture_handle);
+
+    capture_context_t *capture = zsa_capture_t_get_context(capture_handle);
+
+    rwlock_acquire_read(&capture->lock);
+    zsa_image_t *image = &capture->image[IMAGE_TYPE_HEIGHT_MAP];
+    if (*image)
+    {
+        image_inc_ref(*image);
+    }
+    rwlock_release_read(&capture->lock);
+    return *image;
+}
+
 zsa_image_t capture_get_imu_image(zsa_capture_t capture_handle)
 {
     // We just reuse the ir image location as this is never exposed to the user or combined with ir/color/depth.
@@ -409,6 +1393,14 @@ void capture_set_color_image(zsa_capture_t capture_handle, zsa_image_t image_han
     {
         image_inc_ref(*image);
     }
+
+    // Decoded from the image that was here
+    image = &capture->image[IMAGE_TYPE_COLOR_DECODED];
+    if (*image)
+    {
+        image_dec_ref(*image);
+        *image = NULL;
+    }
     rwlock_release_write(&capture->lock);
 }
 void capture_set_depth_image(zsa_capture_t capture_handle, zsa_image_t image_handle)
@@ -448,6 +1440,24 @@ void capture_set_ir_image(zsa_capture_t capture_handle, zsa_image_t image_handle
     }
     rwlock_release_write(&capture->lock);
 }
+void capture_set_height_map_image(zsa_capture_t capture_handle, zsa_image_t image_handle)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(VOID_VALUE, zsa_capture_t, capture_handle);
+
+    capture_context_t *capture = zsa_capture_t_get_context(capture_handle);
+    rwlock_acquire_write(&capture->lock);
+    zsa_image_t *image = &capture->image[IMAGE_TYPE_HEIGHT_MAP];
+    if (*image)
+    {
+        image_dec_ref(*image); // drop the image that was here
+    }
+    *image = image_handle;
+    if (image_handle != NULL)
+    {
+        image_inc_ref(*image);
+    }
+    rwlock_release_write(&capture->lock);
+}
 void capture_set_imu_image(zsa_capture_t capture_handle, zsa_image_t image_handle)
 {
     // We just reuse the ir image location as this is never exposed to the user.
@@ -470,3 +1480,121 @@ float capture_get_temperature_c(zsa_capture_t capture_handle)
     capture_context_t *capture = zsa_capture_t_get_context(capture_handle);
     return capture->temperature_c;
 }
+
+size_t capture_get_size_bytes(zsa_capture_t capture_handle)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(0, zsa_capture_t, capture_handle);
+    capture_context_t *capture = zsa_capture_t_get_context(capture_handle);
+    size_t size = 0;
+
+    rwlock_acquire_read(&capture->lock);
+    for (int x = 0; x < IMAGE_TYPE_COUNT; x++)
+    {
+        if (capture->image[x])
+        {
+            size += image_get_size(capture->image[x]);
+        }
+    }
+    rwlock_release_read(&capture->lock);
+    return size;
+}
+
+void capture_set_color_decoder(zsa_capture_t capture_handle, const capture_color_decoder_t *decoder)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(VOID_VALUE, zsa_capture_t, capture_handle);
+    capture_context_t *capture = zsa_capture_t_get_context(capture_handle);
+
+    rwlock_acquire_write(&capture->lock);
+    if (decoder)
+    {
+        capture->color_decoder = *decoder;
+    }
+    else
+    {
+        memset(&capture->color_decoder, 0, sizeof(capture->color_decoder));
+    }
+
+    // A decode of the previous color image is stale now
+    if (capture->image[IMAGE_TYPE_COLOR_DECODED])
+    {
+        image_dec_ref(capture->image[IMAGE_TYPE_COLOR_DECODED]);
+        capture->image[IMAGE_TYPE_COLOR_DECODED] = NULL;
+    }
+    rwlock_release_write(&capture->lock);
+}
+
+bool capture_get_color_decoder(zsa_capture_t capture_handle, capture_color_decoder_t *decoder)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(false, zsa_capture_t, capture_handle);
+    RETURN_VALUE_IF_ARG(false, decoder == NULL);
+    capture_context_t *capture = zsa_capture_t_get_context(capture_handle);
+
+    rwlock_acquire_read(&capture->lock);
+    bool has_decoder = capture->color_decoder.decode_cb != NULL;
+    *decoder = capture->color_decoder;
+    rwlock_release_read(&capture->lock);
+    return has_decoder;
+}
+
+// Gets the decoded image, or the image to decode with the decoder when it still needs to be decoded
+static zsa_image_t capture_get_color_decode_state(capture_context_t *capture, capture_color_decoder_t *decoder)
+{
+    rwlock_acquire_read(&capture->lock);
+    zsa_image_t image = capture->image[IMAGE_TYPE_COLOR_DECODED];
+    *decoder = capture->color_decoder;
+    if (image == NULL)
+    {
+        image = capture->image[IMAGE_TYPE_COLOR];
+    }
+    else
+    {
+        decoder->decode_cb = NULL;
+    }
+
+    if (image)
+    {
+        image_inc_ref(image);
+    }
+    rwlock_release_read(&capture->lock);
+    return image;
+}
+
+zsa_image_t capture_get_color_decoded_image(zsa_capture_t capture_handle)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(NULL, zsa_capture_t, capture_handle);
+    capture_context_t *capture = zsa_capture_t_get_context(capture_handle);
+    capture_color_decoder_t decoder;
+
+    zsa_image_t image = capture_get_color_decode_state(capture, &decoder);
+    if (image == NULL || decoder.decode_cb == NULL)
+    {
+        return image;
+    }
+    image_dec_ref(image);
+
+    // Only one caller decodes, the others find its result once they get the lock
+    rwlock_acquire_write(&capture->decode_lock);
+    zsa_image_t source = capture_get_color_decode_state(capture, &decoder);
+    if (source == NULL || decoder.decode_cb == NULL)
+    {
+        rwlock_release_write(&capture->decode_lock);
+        return source;
+    }
+
+    image = NULL;
+    zsa_result_t result = TRACE_CALL(decoder.decode_cb(source, &decoder, &image));
+    if (ZSA_SUCCEEDED(result))
+    {
+        rwlock_acquire_write(&capture->lock);
+        if (capture->image[IMAGE_TYPE_COLOR] == source && capture->image[IMAGE_TYPE_COLOR_DECODED] == NULL)
+        {
+            capture->image[IMAGE_TYPE_COLOR_DECODED] = image;
+            image_inc_ref(image);
+        }
+        rwlock_release_write(&capture->lock);
+    }
+    rwlock_release_write(&capture->decode_lock);
+
+    image_dec_ref(source);
+    return ZSA_SUCCEEDED(result) ? image : NULL;
+}
@@ -0,0 +1,1196 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+// This library
+#include <zsainternal/camserver.h>
+
+// Dependent libraries
+#include <zsainternal/allocator.h>
+#include <zsainternal/capture.h>
+#include <zsainternal/common.h>
+#include <zsainternal/handle.h>
+#include <zsainternal/image.h>
+#include <zsainternal/logging.h>
+#include <zsainternal/queue.h>
+#include <azure_c_shared_utility/refcount.h>
+#include <azure_c_shared_utility/threadapi.h>
+
+// System dependencies
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <math.h>
+#include <poll.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <linux/memfd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+
+#define CAMSERVER_MAGIC (0x5a534153) // "ZSAS"
+#define CAMSERVER_VERSION (1)
+
+// Holder bits of a slot. Clients use bits 0 to CAMSERVER_MAX_CLIENTS - 1.
+#define CAMSERVER_BUSY (1u << 30)           // Set while the server moves the slot to its next generation
+#define CAMSERVER_SERVER_HOLDER (1u << 31)  // Set while the server holds the slot
+
+#define CAMSERVER_SUBSCRIBER_DEPTH (8)
+#define CAMSERVER_POLL_INTERVAL_MS (100)    // Retry period of a stopped subscriber, and of clients checking the server
+#define CAMSERVER_CONNECT_TIMEOUT_MS (1000) // Time a client waits for the server to accept it
+
+// Images of a capture, in the order they are published
+typedef enum
+{
+    CAMSERVER_IMAGE_COLOR = 0,
+    CAMSERVER_IMAGE_DEPTH,
+    CAMSERVER_IMAGE_IR,
+    CAMSERVER_IMAGE_HEIGHT_MAP,
+} camserver_image_type_t;
+
+// Everything below is shared between processes, only fixed size fields
+
+typedef struct
+{
+    volatile uint32_t holders;    // Holder bits of the server and the clients
+    volatile uint32_t generation; // Incremented every time the server takes the slot
+} camserver_slot_t;
+
+typedef struct
+{
+    uint32_t type;       // camserver_image_type_t
+    uint32_t slot;       // Slot holding the buffer
+    uint32_t generation; // Of the slot when the image was published
+    int32_t format;
+    uint64_t offset; // Of the buffer in the slot
+    uint64_t size;
+    int32_t width_pixels;
+    int32_t height_pixels;
+    int32_t stride_bytes;
+    uint32_t white_balance;
+    uint64_t device_timestamp_usec;
+    uint64_t system_timestamp_nsec;
+    uint64_t exposure_usec;
+    uint32_t iso_speed;
+    uint32_t reserved;
+} camserver_image_t;
+
+typedef struct
+{
+    volatile uint64_t sequence; // Of the capture in the entry, 0 while the server rewrites it
+    uint32_t image_count;
+    float temperature_c;
+    camserver_image_t images[CAMSERVER_MAX_IMAGES];
+} camserver_entry_t;
+
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t ring_size;
+    uint64_t slot_size;         // A multiple of ALLOCATOR_PAGE_ALIGNMENT
+    uint64_t slots_offset;      // Of the first slot in the shared memory, page aligned
+    volatile uint64_t sequence; // Of the last capture published
+    volatile uint32_t futex;    // Incremented when a capture is published and when the server stops
+    volatile uint32_t stopped;
+    camserver_slot_t slots[CAMSERVER_MAX_SLOTS];
+    camserver_entry_t ring[CAMSERVER_MAX_RING_SIZE];
+} camserver_shared_t;
+
+// Sent with the descriptor of the shared memory to every client accepted
+typedef struct
+{
+    uint32_t magic;
+    uint32_t client_index;
+} camserver_hello_t;
+
+// A mapping of the shared memory, kept by the server or a client and every slot it holds
+
+typedef struct _camserver_memory_t camserver_memory_t;
+
+typedef struct
+{
+    camserver_memory_t *memory;
+    uint32_t slot;
+} camserver_slot_ref_t;
+
+struct _camserver_memory_t
+{
+    volatile long ref_count;     // One for the server or client, one per slot it holds
+    int fd;                      // memfd of the shared memory
+    int socket;                  // Connection of a client to its server, kept while the client holds slots
+    uint32_t holder;             // Holder bit set on the slots held
+    camserver_shared_t *shared;  // Header, mapped read write
+    size_t shared_bytes;         // Mapped at shared
+    uint8_t *slots;              // First slot, mapped read only for clients
+    size_t slot_size;
+    uint32_t slot_count;
+    uint32_t ring_size;
+    volatile uint32_t next_slot; // Where the server starts looking for a free slot
+    camserver_slot_ref_t refs[CAMSERVER_MAX_SLOTS]; // Destroy contexts of the images of a client
+};
+
+typedef struct _camserver_context_t
+{
+    camserver_memory_t *memory;
+    capturesync_t capturesync;
+    queue_t subscriber;
+    int listen_socket;
+    int wake_fd; // eventfd written to stop the thread
+    THREAD_HANDLE thread;
+    bool thread_started;
+    bool allocators_set;
+    allocator_callbacks_t previous_color; // Callbacks of the color source before the server, restored by destroy
+    allocator_callbacks_t previous_depth; // Callbacks of the depth source before the server, restored by destroy
+    bool active; // Holds g_camserver_active
+    int clients[CAMSERVER_MAX_CLIENTS]; // Socket of each client, -1 for none
+    uint32_t client_count;
+    uint64_t sequence;                                 // Of the last capture published
+    zsa_capture_t published[CAMSERVER_MAX_RING_SIZE];  // Capture of each ring entry, holding its slots
+    uint64_t copies[CAMSERVER_MAX_RING_SIZE];          // Slots holding the copies made for each ring entry
+} camserver_context_t;
+
+ZSA_DECLARE_CONTEXT(camserver_t, camserver_context_t);
+
+typedef struct _camclient_context_t
+{
+    camserver_memory_t *memory;
+    uint64_t next_sequence; // Of the next capture to read
+} camclient_context_t;
+
+ZSA_DECLARE_CONTEXT(camclient_t, camclient_context_t);
+
+// The color and depth allocators route to one server at a time
+static volatile long g_camserver_active = 0;
+
+static size_t camserver_page_round(size_t size)
+{
+    return (size + ALLOCATOR_PAGE_ALIGNMENT - 1) & ~(size_t)(ALLOCATOR_PAGE_ALIGNMENT - 1);
+}
+
+static uint64_t camserver_now_ms(void)
+{
+    struct timespec now;
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+}
+
+// Address of a server in the abstract namespace, which goes away with the listening socket
+static bool camserver_address(const char *name, struct sockaddr_un *address, socklen_t *length)
+{
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+
+    size_t capacity = sizeof(address->sun_path) - 1;
+    int written = snprintf(address->sun_path + 1, capacity, "zsa-camserver/%s", name);
+    if (written < 0 || (size_t)written >= capacity)
+    {
+        LOG_ERROR("Camera server name %s is too long", name);
+        return false;
+    }
+
+    *length = (socklen_t)(offsetof(struct sockaddr_un, sun_path) + 1 + (size_t)written);
+    return true;
+}
+
+static void camserver_memory_release(camserver_memory_t *memory)
+{
+    if (DEC_REF_VAR(memory->ref_count) != 0)
+    {
+        return;
+    }
+
+    if (memory->slots)
+    {
+        (void)munmap(memory->slots, memory->slot_size * memory->slot_count);
+    }
+    if (memory->shared)
+    {
+        (void)munmap(memory->shared, memory->shared_bytes);
+    }
+    if (memory->socket >= 0)
+    {
+        close(memory->socket);
+    }
+    if (memory->fd >= 0)
+    {
+        close(memory->fd);
+    }
+    free(memory);
+}
+
+static camserver_memory_t *camserver_memory_alloc(void)
+{
+    camserver_memory_t *memory = (camserver_memory_t *)calloc(1, sizeof(camserver_memory_t));
+    if (memory == NULL)
+    {
+        LOG_ERROR("Failed to allocate the camera server mapping", 0);
+        return NULL;
+    }
+
+    memory->ref_count = 1;
+    memory->fd = -1;
+    memory->socket = -1;
+    for (uint32_t i = 0; i < CAMSERVER_MAX_SLOTS; i++)
+    {
+        memory->refs[i].memory = memory;
+        memory->refs[i].slot = i;
+    }
+    return memory;
+}
+
+static camserver_memory_t *camserver_memory_create(const zsa_server_configuration_t *config)
+{
+    camserver_memory_t *memory = camserver_memory_alloc();
+    if (memory == NULL)
+    {
+        return NULL;
+    }
+
+    memory->holder = CAMSERVER_SERVER_HOLDER;
+    memory->slot_count = config->slot_count;
+    memory->slot_size = camserver_page_round(config->slot_size_bytes);
+    memory->ring_size = config->ring_size;
+    memory->shared_bytes = camserver_page_round(sizeof(camserver_shared_t));
+    size_t slots_bytes = memory->slot_size * memory->slot_count;
+
+    memory->fd = (int)syscall(SYS_memfd_create, "zsa-camserver", MFD_CLOEXEC);
+    bool ok = memory->fd >= 0 && ftruncate(memory->fd, (off_t)(memory->shared_bytes + slots_bytes)) == 0;
+
+    void *address = MAP_FAILED;
+    if (ok)
+    {
+        // Pages are only backed once an image is written to them
+        address = mmap(NULL, memory->shared_bytes + slots_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, memory->fd, 0);
+        ok = address != MAP_FAILED;
+    }
+
+    if (!ok)
+    {
+        LOG_ERROR("Failed to create %d bytes of shared memory, errno %d", memory->shared_bytes + slots_bytes, errno);
+        camserver_memory_release(memory);
+        return NULL;
+    }
+
+    memory->shared = (camserver_shared_t *)address;
+    memory->slots = (uint8_t *)address + memory->shared_bytes;
+
+    camserver_shared_t *shared = memory->shared;
+    shared->magic = CAMSERVER_MAGIC;
+    shared->version = CAMSERVER_VERSION;
+    shared->slot_count = memory->slot_count;
+    shared->ring_size = memory->ring_size;
+    shared->slot_size = memory->slot_size;
+    shared->slots_offset = memory->shared_bytes;
+    return memory;
+}
+
+// Takes a free slot for the server, false when every slot is held
+static bool camserver_take_slot(camserver_memory_t *memory, uint32_t *slot_index)
+{
+    camserver_shared_t *shared = memory->shared;
+
+    for (uint32_t i = 0; i < memory->slot_count; i++)
+    {
+        uint32_t slot = __atomic_fetch_add(&memory->next_slot, 1, __ATOMIC_RELAXED) % memory->slot_count;
+        uint32_t expected = 0;
+
+        // Busy until the generation changes, so a client can't take the slot for the image it held before
+        if (__atomic_compare_exchange_n(&shared->slots[slot].holders,
+                                        &expected,
+                                        CAMSERVER_SERVER_HOLDER | CAMSERVER_BUSY,
+                                        false,
+                                        __ATOMIC_SEQ_CST,
+                                        __ATOMIC_RELAXED))
+        {
+            __atomic_add_fetch(&shared->slots[slot].generation, 1, __ATOMIC_SEQ_CST);
+            __atomic_fetch_and(&shared->slots[slot].holders, ~CAMSERVER_BUSY, __ATOMIC_SEQ_CST);
+            INC_REF_VAR(memory->ref_count);
+            *slot_index = slot;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void camserver_give_slot(camserver_memory_t *memory, uint32_t slot)
+{
+    __atomic_fetch_and(&memory->shared->slots[slot].holders, ~CAMSERVER_SERVER_HOLDER, __ATOMIC_SEQ_CST);
+    camserver_memory_release(memory);
+}
+
+// Allocator of the color and depth sources while the server runs
+static uint8_t *camserver_allocate(int size, int alignment, void **context)
+{
+    camserver_memory_t *memory = (camserver_memory_t *)*context;
+    uint32_t slot;
+
+    if (size > 0 && (size_t)size <= memory->slot_size && alignment <= ALLOCATOR_PAGE_ALIGNMENT &&
+        camserver_take_slot(memory, &slot))
+    {
+        return memory->slots + (size_t)slot * memory->slot_size;
+    }
+
+    // No slot fits, the buffer is copied if it gets published
+    void *buffer = NULL;
+    *context = NULL;
+    if (size <= 0 || posix_memalign(&buffer, (size_t)MAX(alignment, (int)sizeof(void *)), (size_t)size) != 0)
+    {
+        return NULL;
+    }
+    return (uint8_t *)buffer;
+}
+
+static void camserver_free(void *buffer, void *context)
+{
+    camserver_memory_t *memory = (camserver_memory_t *)context;
+    if (memory == NULL)
+    {
+        free(buffer);
+        return;
+    }
+
+    camserver_give_slot(memory, (uint32_t)(((uint8_t *)buffer - memory->slots) / memory->slot_size));
+}
+
+// Finds the slot holding a buffer, false for buffers outside of the shared memory
+static bool camserver_find_slot(camserver_memory_t *memory,
+                                const uint8_t *buffer,
+                                size_t size,
+                                uint32_t *slot,
+                                size_t *offset)
+{
+    uintptr_t start = (uintptr_t)memory->slots;
+    uintptr_t end = start + memory->slot_size * memory->slot_count;
+    if ((uintptr_t)buffer < start || (uintptr_t)buffer >= end)
+    {
+        return false;
+    }
+
+    size_t position = (size_t)((uintptr_t)buffer - start);
+    *slot = (uint32_t)(position / memory->slot_size);
+    *offset = position % memory->slot_size;
+    return *offset + size <= memory->slot_size;
+}
+
+static void camserver_wake_clients(camserver_shared_t *shared)
+{
+    __atomic_add_fetch(&shared->futex, 1, __ATOMIC_SEQ_CST);
+    (void)syscall(SYS_futex, &shared->futex, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+// Releases the capture and copies a ring entry held. Clients holding its images keep their slots.
+static void camserver_release_entry(camserver_context_t *server, uint32_t index)
+{
+    if (server->published[index])
+    {
+        capture_dec_ref(server->published[index]);
+        server->published[index] = NULL;
+    }
+
+    while (server->copies[index])
+    {
+        uint32_t slot = (uint32_t)__builtin_ctzll(server->copies[index]);
+        server->copies[index] &= server->copies[index] - 1;
+        camserver_give_slot(server->memory, slot);
+    }
+}
+
+static bool camserver_describe_image(camserver_context_t *server,
+                                     uint32_t index,
+                                     zsa_image_t image,
+                                     camserver_image_t *description)
+{
+    camserver_memory_t *memory = server->memory;
+    uint8_t *buffer = image_get_buffer(image);
+    size_t size = image_get_size(image);
+    uint32_t slot;
+    size_t offset;
+
+    if (buffer == NULL || size == 0)
+    {
+        return false;
+    }
+
+    if (!camserver_find_slot(memory, buffer, size, &slot, &offset))
+    {
+        // Allocated elsewhere, copied once into a slot the ring entry holds
+        if (size > memory->slot_size || !camserver_take_slot(memory, &slot))
+        {
+            return false;
+        }
+        offset = 0;
+        memcpy(memory->slots + (size_t)slot * memory->slot_size, buffer, size);
+        server->copies[index] |= 1ull << slot;
+    }
+
+    description->slot = slot;
+    description->generation = __atomic_load_n(&memory->shared->slots[slot].generation, __ATOMIC_SEQ_CST);
+    description->format = (int32_t)image_get_format(image);
+    description->offset = offset;
+    description->size = size;
+    description->width_pixels = image_get_width_pixels(image);
+    description->height_pixels = image_get_height_pixels(image);
+    description->stride_bytes = image_get_stride_bytes(image);
+    description->white_balance = image_get_white_balance(image);
+    description->device_timestamp_usec = image_get_device_timestamp_usec(image);
+    description->system_timestamp_nsec = image_get_system_timestamp_nsec(image);
+    description->exposure_usec = image_get_exposure_usec(image);
+    description->iso_speed = image_get_iso_speed(image);
+    return true;
+}
+
+static void camserver_publish(camserver_context_t *server, zsa_capture_t capture)
+{
+    camserver_shared_t *shared = server->memory->shared;
+    uint64_t sequence = server->sequence + 1;
+    uint32_t index = (uint32_t)(sequence % server->memory->ring_size);
+    camserver_entry_t *entry = &shared->ring[index];
+
+    // Clients reading the entry find its sequence changed and retry
+    __atomic_store_n(&entry->sequence, 0, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    camserver_release_entry(server, index);
+
+    // Color is published as captured, clients decode an MJPEG image themselves rather than the server decoding every
+    // frame on its thread
+    zsa_image_t images[CAMSERVER_MAX_IMAGES] = { capture_get_color_image(capture),
+                                                 capture_get_depth_image(capture),
+                                                 capture_get_ir_image(capture),
+                                                 capture_get_height_map_image(capture) };
+    uint32_t image_count = 0;
+    bool complete = true;
+
+    for (uint32_t type = 0; type < CAMSERVER_MAX_IMAGES; type++)
+    {
+        if (images[type] == NULL)
+        {
+            continue;
+        }
+
+        if (complete && camserver_describe_image(server, index, images[type], &entry->images[image_count]))
+        {
+            entry->images[image_count].type = type;
+            image_count++;
+        }
+        else
+        {
+            complete = false;
+        }
+        image_dec_ref(images[type]);
+    }
+
+    if (!complete)
+    {
+        // No slot for an image, the clients miss this capture
+        camserver_release_entry(server, index);
+        return;
+    }
+
+    entry->image_count = image_count;
+    entry->temperature_c = capture_get_temperature_c(capture);
+
+    capture_inc_ref(capture);
+    server->published[index] = capture;
+    server->sequence = sequence;
+
+    __atomic_store_n(&entry->sequence, sequence, __ATOMIC_RELEASE);
+    __atomic_store_n(&shared->sequence, sequence, __ATOMIC_SEQ_CST);
+    camserver_wake_clients(shared);
+}
+
+static bool camserver_send_memory(int client_socket, uint32_t client_index, int fd)
+{
+    camserver_hello_t hello = { CAMSERVER_MAGIC, client_index };
+    struct iovec iov = { &hello, sizeof(hello) };
+    union
+    {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct msghdr message;
+
+    memset(&control, 0, sizeof(control));
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.buffer;
+    message.msg_controllen = sizeof(control.buffer);
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+    return sendmsg(client_socket, &message, MSG_NOSIGNAL) == (ssize_t)sizeof(hello);
+}
+
+static void camserver_accept(camserver_context_t *server)
+{
+    int client_socket = accept(server->listen_socket, NULL, NULL);
+    if (client_socket < 0)
+    {
+        return;
+    }
+    (void)fcntl(client_socket, F_SETFD, FD_CLOEXEC);
+
+    uint32_t index = 0;
+    while (index < CAMSERVER_MAX_CLIENTS && server->clients[index] >= 0)
+    {
+        index++;
+    }
+
+    if (index == CAMSERVER_MAX_CLIENTS)
+    {
+        LOG_WARNING("Camera server refused a client, %d are connected", CAMSERVER_MAX_CLIENTS);
+        close(client_socket);
+        return;
+    }
+
+    if (!camserver_send_memory(client_socket, index, server->memory->fd))
+    {
+        LOG_WARNING("Camera server failed to share its memory with a client, errno %d", errno);
+        close(client_socket);
+        return;
+    }
+
+    server->clients[index] = client_socket;
+    server->client_count++;
+}
+
+// Releases the slots a client held when it went away
+static void camserver_drop_client(camserver_context_t *server, uint32_t index)
+{
+    camserver_shared_t *shared = server->memory->shared;
+    uint32_t holder = 1u << index;
+
+    close(server->clients[index]);
+    server->clients[index] = -1;
+    server->client_count--;
+
+    for (uint32_t slot = 0; slot < server->memory->slot_count; slot++)
+    {
+        __atomic_fetch_and(&shared->slots[slot].holders, ~holder, __ATOMIC_SEQ_CST);
+    }
+}
+
+// Publishes the captures queued for the server, false once the subscriber is stopped or disabled
+static bool camserver_drain(camserver_context_t *server)
+{
+    zsa_capture_t captures[CAMSERVER_SUBSCRIBER_DEPTH];
+    uint32_t count = 0;
+
+    zsa_wait_result_t result = queue_pop_batch(server->subscriber, captures, CAMSERVER_SUBSCRIBER_DEPTH, &count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (server->client_count > 0)
+        {
+            camserver_publish(server, captures[i]);
+        }
+        capture_dec_ref(captures[i]);
+    }
+
+    return result != ZSA_WAIT_RESULT_FAILED;
+}
+
+static int camserver_thread(void *param)
+{
+    camserver_context_t *server = (camserver_context_t *)param;
+    int queue_fd = queue_get_event_fd(server->subscriber);
+    bool queue_open = true;
+    bool running = true;
+
+    while (running)
+    {
+        struct pollfd fds[3 + CAMSERVER_MAX_CLIENTS];
+        fds[0].fd = server->wake_fd;
+        fds[1].fd = server->listen_socket;
+        // The event fd stays readable while the cameras are stopped, so it is polled again after an interval
+        fds[2].fd = queue_open ? queue_fd : -1;
+        for (uint32_t i = 0; i < CAMSERVER_MAX_CLIENTS; i++)
+        {
+            fds[3 + i].fd = server->clients[i];
+        }
+        for (uint32_t i = 0; i < COUNTOF(fds); i++)
+        {
+            fds[i].events = POLLIN;
+            fds[i].revents = 0;
+        }
+
+        int ready = poll(fds, COUNTOF(fds), queue_open ? -1 : CAMSERVER_POLL_INTERVAL_MS);
+        if (ready < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            LOG_ERROR("Camera server failed to poll, errno %d", errno);
+            break;
+        }
+
+        running = fds[0].revents == 0;
+
+        if (fds[1].revents & POLLIN)
+        {
+            camserver_accept(server);
+        }
+
+        // Clients send nothing, anything readable is a hang up
+        for (uint32_t i = 0; i < CAMSERVER_MAX_CLIENTS; i++)
+        {
+            if (fds[3 + i].revents != 0)
+            {
+                camserver_drop_client(server, i);
+            }
+        }
+
+        queue_open = fds[2].fd < 0 || fds[2].revents == 0 || camserver_drain(server);
+    }
+
+    ThreadAPI_Exit(0);
+    return 0;
+}
+
+zsa_result_t camserver_create(capturesync_t capturesync_handle,
+                              const char *name,
+                              const zsa_server_configuration_t *config,
+                              camserver_t *camserver_handle)
+{
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, capturesync_handle == NULL);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, name == NULL);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, camserver_handle == NULL);
+
+    zsa_server_configuration_t default_config = ZSA_SERVER_CONFIG_INIT_DEFAULT;
+    if (config == NULL)
+    {
+        config = &default_config;
+    }
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, config->slot_count == 0 || config->slot_count > CAMSERVER_MAX_SLOTS);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, config->slot_size_bytes == 0 || config->slot_size_bytes > INT32_MAX);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, config->ring_size == 0 || config->ring_size > CAMSERVER_MAX_RING_SIZE);
+
+    struct sockaddr_un address;
+    socklen_t address_length;
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, !camserver_address(name, &address, &address_length));
+
+    camserver_context_t *server = camserver_t_create(camserver_handle);
+    zsa_result_t result = ZSA_RESULT_FROM_BOOL(server != NULL);
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        server->capturesync = capturesync_handle;
+        server->listen_socket = -1;
+        server->wake_fd = -1;
+        for (uint32_t i = 0; i < CAMSERVER_MAX_CLIENTS; i++)
+        {
+            server->clients[i] = -1;
+        }
+
+        server->active = __sync_bool_compare_and_swap(&g_camserver_active, 0, 1);
+        if (!server->active)
+        {
+            LOG_ERROR("A camera server already runs in this process", 0);
+            result = ZSA_RESULT_FAILED;
+        }
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        server->memory = camserver_memory_create(config);
+        result = ZSA_RESULT_FROM_BOOL(server->memory != NULL);
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        server->listen_socket = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        if (server->listen_socket < 0 ||
+            bind(server->listen_socket, (struct sockaddr *)&address, address_length) != 0 ||
+            listen(server->listen_socket, CAMSERVER_MAX_CLIENTS) != 0)
+        {
+            LOG_ERROR("Failed to listen as camera server %s, errno %d", name, errno);
+            result = ZSA_RESULT_FAILED;
+        }
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        server->wake_fd = eventfd(0, EFD_CLOEXEC);
+        result = ZSA_RESULT_FROM_BOOL(server->wake_fd >= 0);
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        result = TRACE_CALL(capturesync_subscribe(capturesync_handle,
+                                                  CAMSERVER_SUBSCRIBER_DEPTH,
+                                                  QUEUE_OVERFLOW_DROP_OLDEST,
+                                                  0,
+                                                  &server->subscriber));
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        result = ZSA_RESULT_FROM_BOOL(queue_get_event_fd(server->subscriber) >= 0);
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        result = TRACE_CALL(allocator_get_source_callbacks(ALLOCATION_SOURCE_COLOR, &server->previous_color));
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        result = TRACE_CALL(allocator_get_source_callbacks(ALLOCATION_SOURCE_DEPTH, &server->previous_depth));
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        server->allocators_set = true;
+        result = TRACE_CALL(allocator_set_source_allocator_aligned(ALLOCATION_SOURCE_COLOR,
+                                                                   camserver_allocate,
+                                                                   camserver_free,
+                                                                   server->memory));
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        result = TRACE_CALL(allocator_set_source_allocator_aligned(ALLOCATION_SOURCE_DEPTH,
+                                                                   camserver_allocate,
+                                                                   camserver_free,
+                                                                   server->memory));
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        result = ZSA_RESULT_FROM_BOOL(ThreadAPI_Create(&server->thread, camserver_thread, server) == THREADAPI_OK);
+        server->thread_started = ZSA_SUCCEEDED(result);
+    }
+
+    if (ZSA_FAILED(result) && server != NULL)
+    {
+        camserver_destroy(*camserver_handle);
+        *camserver_handle = NULL;
+    }
+
+    return result;
+}
+
+void camserver_destroy(camserver_t camserver_handle)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(VOID_VALUE, camserver_t, camserver_handle);
+    camserver_context_t *server = camserver_t_get_context(camserver_handle);
+
+    if (server->thread_started)
+    {
+        uint64_t stop = 1;
+        ssize_t written = write(server->wake_fd, &stop, sizeof(stop));
+        (void)written;
+
+        int thread_result;
+        (void)ThreadAPI_Join(server->thread, &thread_result);
+    }
+
+    if (server->allocators_set)
+    {
+        // Buffers already in slots keep the memory mapped until they are freed. The application's allocators, if it
+        // had set any, serve the sources again.
+        (void)allocator_set_source_callbacks(ALLOCATION_SOURCE_COLOR, &server->previous_color);
+        (void)allocator_set_source_callbacks(ALLOCATION_SOURCE_DEPTH, &server->previous_depth);
+    }
+
+    if (server->subscriber)
+    {
+        capturesync_unsubscribe(server->capturesync, server->subscriber);
+    }
+
+    for (uint32_t i = 0; i < CAMSERVER_MAX_CLIENTS; i++)
+    {
+        if (server->clients[i] >= 0)
+        {
+            close(server->clients[i]);
+        }
+    }
+
+    if (server->memory)
+    {
+        for (uint32_t i = 0; i < CAMSERVER_MAX_RING_SIZE; i++)
+        {
+            camserver_release_entry(server, i);
+        }
+
+        __atomic_store_n(&server->memory->shared->stopped, 1, __ATOMIC_SEQ_CST);
+        camserver_wake_clients(server->memory->shared);
+        camserver_memory_release(server->memory);
+    }
+
+    if (server->listen_socket >= 0)
+    {
+        close(server->listen_socket);
+    }
+    if (server->wake_fd >= 0)
+    {
+        close(server->wake_fd);
+    }
+    if (server->active)
+    {
+        __sync_lock_release(&g_camserver_active);
+    }
+
+    camserver_t_destroy(camserver_handle);
+}
+
+static zsa_result_t camclient_connect(camserver_memory_t *memory, const struct sockaddr_un *address, socklen_t length)
+{
+    memory->socket = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (memory->socket < 0 || connect(memory->socket, (const struct sockaddr *)address, length) != 0)
+    {
+        return ZSA_RESULT_FAILED;
+    }
+
+    struct pollfd ready = { memory->socket, POLLIN, 0 };
+    if (poll(&ready, 1, CAMSERVER_CONNECT_TIMEOUT_MS) != 1)
+    {
+        return ZSA_RESULT_FAILED;
+    }
+
+    camserver_hello_t hello;
+    struct iovec iov = { &hello, sizeof(hello) };
+    union
+    {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct msghdr message;
+
+    memset(&control, 0, sizeof(control));
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.buffer;
+    message.msg_controllen = sizeof(control.buffer);
+
+    // A server serving as many clients as it can closes the connection instead
+    if (recvmsg(memory->socket, &message, MSG_CMSG_CLOEXEC) != (ssize_t)sizeof(hello))
+    {
+        return ZSA_RESULT_FAILED;
+    }
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+    if (cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS ||
+        cmsg->cmsg_len != CMSG_LEN(sizeof(int)))
+    {
+        return ZSA_RESULT_FAILED;
+    }
+    memcpy(&memory->fd, CMSG_DATA(cmsg), sizeof(int));
+
+    if (hello.magic != CAMSERVER_MAGIC || hello.client_index >= CAMSERVER_MAX_CLIENTS)
+    {
+        return ZSA_RESULT_FAILED;
+    }
+    memory->holder = 1u << hello.client_index;
+    return ZSA_RESULT_SUCCEEDED;
+}
+
+static zsa_result_t camclient_map(camserver_memory_t *memory)
+{
+    memory->shared_bytes = camserver_page_round(sizeof(camserver_shared_t));
+    void *address = mmap(NULL, memory->shared_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, memory->fd, 0);
+    if (address == MAP_FAILED)
+    {
+        return ZSA_RESULT_FAILED;
+    }
+    memory->shared = (camserver_shared_t *)address;
+
+    camserver_shared_t *shared = memory->shared;
+    struct stat status;
+    if (shared->magic != CAMSERVER_MAGIC || shared->version != CAMSERVER_VERSION || shared->slot_count == 0 ||
+        shared->slot_count > CAMSERVER_MAX_SLOTS || shared->ring_size == 0 ||
+        shared->ring_size > CAMSERVER_MAX_RING_SIZE || shared->slot_size == 0 || shared->slot_size > INT32_MAX ||
+        shared->slot_size % ALLOCATOR_PAGE_ALIGNMENT != 0 || shared->slots_offset != memory->shared_bytes ||
+        fstat(memory->fd, &status) != 0 ||
+        (uint64_t)status.st_size < shared->slots_offset + shared->slot_size * shared->slot_count)
+    {
+        LOG_ERROR("Camera server memory has an unknown layout", 0);
+        return ZSA_RESULT_FAILED;
+    }
+
+    // The slot geometry is read once, the server never changes it
+    memory->slot_size = (size_t)shared->slot_size;
+    memory->slot_count = shared->slot_count;
+    memory->ring_size = shared->ring_size;
+
+    address = mmap(NULL,
+                   memory->slot_size * memory->slot_count,
+                   PROT_READ,
+                   MAP_SHARED,
+                   memory->fd,
+                   (off_t)shared->slots_offset);
+    if (address == MAP_FAILED)
+    {
+        return ZSA_RESULT_FAILED;
+    }
+    memory->slots = (uint8_t *)address;
+    return ZSA_RESULT_SUCCEEDED;
+}
+
+zsa_result_t camclient_open(const char *name, camclient_t *camclient_handle)
+{
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, name == NULL);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, camclient_handle == NULL);
+
+    struct sockaddr_un address;
+    socklen_t address_length;
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, !camserver_address(name, &address, &address_length));
+
+    camclient_context_t *client = camclient_t_create(camclient_handle);
+    zsa_result_t result = ZSA_RESULT_FROM_BOOL(client != NULL);
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        client->memory = camserver_memory_alloc();
+        result = ZSA_RESULT_FROM_BOOL(client->memory != NULL);
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        result = camclient_connect(client->memory, &address, address_length);
+        if (ZSA_FAILED(result))
+        {
+            LOG_ERROR("Failed to connect to camera server %s, errno %d", name, errno);
+        }
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        result = TRACE_CALL(camclient_map(client->memory));
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        // Captures published from now on
+        client->next_sequence = __atomic_load_n(&client->memory->shared->sequence, __ATOMIC_SEQ_CST) + 1;
+    }
+
+    if (ZSA_FAILED(result) && client != NULL)
+    {
+        camclient_close(*camclient_handle);
+        *camclient_handle = NULL;
+    }
+
+    return result;
+}
+
+void camclient_close(camclient_t camclient_handle)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(VOID_VALUE, camclient_t, camclient_handle);
+    camclient_context_t *client = camclient_t_get_context(camclient_handle);
+
+    // Images still held keep the mapping, and the connection their slots are held for
+    if (client->memory)
+    {
+        camserver_memory_release(client->memory);
+    }
+
+    camclient_t_destroy(camclient_handle);
+}
+
+// Sets the client's holder bit on a slot if it still holds the generation an image was published in
+static bool camclient_hold_slot(camserver_memory_t *memory, uint32_t slot, uint32_t generation)
+{
+    camserver_slot_t *shared_slot = &memory->shared->slots[slot];
+
+    // A slot held by anyone can't be taken for another generation, a free or busy one may already have been
+    uint32_t holders = __atomic_fetch_or(&shared_slot->holders, memory->holder, __ATOMIC_SEQ_CST);
+    if (holders == 0 || (holders & CAMSERVER_BUSY) != 0 ||
+        __atomic_load_n(&shared_slot->generation, __ATOMIC_SEQ_CST) != generation)
+    {
+        __atomic_fetch_and(&shared_slot->holders, ~memory->holder, __ATOMIC_SEQ_CST);
+        return false;
+    }
+
+    INC_REF_VAR(memory->ref_count);
+    return true;
+}
+
+static void camclient_release_slot(void *buffer, void *context)
+{
+    (void)buffer;
+    camserver_slot_ref_t *ref = (camserver_slot_ref_t *)context;
+    camserver_memory_t *memory = ref->memory;
+
+    __atomic_fetch_and(&memory->shared->slots[ref->slot].holders, ~memory->holder, __ATOMIC_SEQ_CST);
+    camserver_memory_release(memory);
+}
+
+static bool camclient_add_image(camserver_memory_t *memory,
+                                const camserver_image_t *description,
+                                zsa_capture_t capture_handle)
+{
+    if (description->type > CAMSERVER_IMAGE_HEIGHT_MAP || description->slot >= memory->slot_count ||
+        description->offset > memory->slot_size || description->size == 0 ||
+        description->size > memory->slot_size - description->offset)
+    {
+        return false;
+    }
+
+    if (!camclient_hold_slot(memory, description->slot, description->generation))
+    {
+        return false;
+    }
+
+    uint8_t *buffer = memory->slots + (size_t)description->slot * memory->slot_size + description->offset;
+    camserver_slot_ref_t *ref = &memory->refs[description->slot];
+    zsa_image_t image = NULL;
+
+    if (ZSA_FAILED(TRACE_CALL(image_create_from_buffer((zsa_image_format_t)description->format,
+                                                       description->width_pixels,
+                                                       description->height_pixels,
+                                                       description->stride_bytes,
+                                                       buffer,
+                                                       (size_t)description->size,
+                                                       camclient_release_slot,
+                                                       ref,
+                                                       &image))))
+    {
+        camclient_release_slot(buffer, ref);
+        return false;
+    }
+
+    image_set_device_timestamp_usec(image, description->device_timestamp_usec);
+    image_set_system_timestamp_nsec(image, description->system_timestamp_nsec);
+    image_set_exposure_usec(image, description->exposure_usec);
+    image_set_white_balance(image, description->white_balance);
+    image_set_iso_speed(image, description->iso_speed);
+
+    switch ((camserver_image_type_t)description->type)
+    {
+    case CAMSERVER_IMAGE_COLOR:
+        capture_set_color_image(capture_handle, image);
+        break;
+    case CAMSERVER_IMAGE_DEPTH:
+        capture_set_depth_image(capture_handle, image);
+        break;
+    case CAMSERVER_IMAGE_IR:
+        capture_set_ir_image(capture_handle, image);
+        break;
+    case CAMSERVER_IMAGE_HEIGHT_MAP:
+        capture_set_height_map_image(capture_handle, image);
+        break;
+    }
+
+    image_dec_ref(image);
+    return true;
+}
+
+// Reads a ring entry into a capture, false if the server moved on from it
+static bool camclient_read_entry(camserver_memory_t *memory, uint64_t sequence, zsa_capture_t *capture_handle)
+{
+    camserver_entry_t *shared_entry = &memory->shared->ring[sequence % memory->ring_size];
+    camserver_entry_t entry;
+
+    if (__atomic_load_n(&shared_entry->sequence, __ATOMIC_ACQUIRE) != sequence)
+    {
+        return false;
+    }
+    memcpy(&entry, (const void *)shared_entry, sizeof(entry));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&shared_entry->sequence, __ATOMIC_RELAXED) != sequence ||
+        entry.image_count > CAMSERVER_MAX_IMAGES)
+    {
+        return false;
+    }
+
+    zsa_capture_t capture = NULL;
+    bool ok = ZSA_SUCCEEDED(capture_create(&capture));
+    for (uint32_t i = 0; ok && i < entry.image_count; i++)
+    {
+        ok = camclient_add_image(memory, &entry.images[i], capture);
+    }
+
+    if (!ok)
+    {
+        if (capture)
+        {
+            capture_dec_ref(capture);
+        }
+        return false;
+    }
+
+    if (!isnan(entry.temperature_c))
+    {
+        capture_set_temperature_c(capture, entry.temperature_c);
+    }
+    *capture_handle = capture;
+    return true;
+}
+
+// True once the server closed the connection, which it does when its process exits
+static bool camclient_server_gone(camserver_memory_t *memory)
+{
+    struct pollfd hangup = { memory->socket, POLLIN, 0 };
+    return poll(&hangup, 1, 0) != 0;
+}
+
+zsa_wait_result_t camclient_get_capture(camclient_t camclient_handle,
+                                        zsa_capture_t *capture_handle,
+                                        int32_t timeout_in_ms)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_WAIT_RESULT_FAILED, camclient_t, camclient_handle);
+    RETURN_VALUE_IF_ARG(ZSA_WAIT_RESULT_FAILED, capture_handle == NULL);
+
+    camclient_context_t *client = camclient_t_get_context(camclient_handle);
+    camserver_memory_t *memory = client->memory;
+    camserver_shared_t *shared = memory->shared;
+    uint64_t start_ms = camserver_now_ms();
+
+    *capture_handle = NULL;
+
+    for (;;)
+    {
+        // Read before the sequence, so a capture published after it is checked wakes the wait below
+        uint32_t futex = __atomic_load_n(&shared->futex, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&shared->stopped, __ATOMIC_SEQ_CST) || camclient_server_gone(memory))
+        {
+            return ZSA_WAIT_RESULT_FAILED;
+        }
+
+        uint64_t sequence = __atomic_load_n(&shared->sequence, __ATOMIC_SEQ_CST);
+        while (client->next_sequence <= sequence)
+        {
+            // Fell behind, the oldest capture still published is next
+            if (sequence - client->next_sequence >= memory->ring_size)
+            {
+                client->next_sequence = sequence - memory->ring_size + 1;
+            }
+
+            if (camclient_read_entry(memory, client->next_sequence++, capture_handle))
+            {
+                return ZSA_WAIT_RESULT_SUCCEEDED;
+            }
+        }
+
+        // Wakes up periodically to notice a server that went away without stopping
+        int32_t wait_ms = CAMSERVER_POLL_INTERVAL_MS;
+        if (timeout_in_ms >= 0)
+        {
+            uint64_t elapsed_ms = camserver_now_ms() - start_ms;
+            if (elapsed_ms >= (uint64_t)timeout_in_ms)
+            {
+                return ZSA_WAIT_RESULT_TIMEOUT;
+            }
+            wait_ms = (int32_t)MIN((uint64_t)wait_ms, (uint64_t)timeout_in_ms - elapsed_ms);
+        }
+
+        struct timespec wait = { wait_ms / 1000, (long)(wait_ms % 1000) * 1000000 };
+        (void)syscall(SYS_futex, &shared->futex, FUTEX_WAIT, futex, &wait, NULL, 0);
+    }
+}
@@ -0,0 +1,51 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+// This library
+#include <zsainternal/camserver.h>
+
+// Dependent libraries
+#include <zsainternal/logging.h>
+
+// Sharing captures relies on memfd, descriptor passing and futexes; Windows has no camera server yet.
+
+zsa_result_t camserver_create(capturesync_t capturesync_handle,
+                              const char *name,
+                              const zsa_server_configuration_t *config,
+                              camserver_t *camserver_handle)
+{
+    (void)capturesync_handle;
+    (void)name;
+    (void)config;
+    (void)camserver_handle;
+    LOG_ERROR("Camera servers are not supported on Windows", 0);
+    return ZSA_RESULT_FAILED;
+}
+
+void camserver_destroy(camserver_t camserver_handle)
+{
+    (void)camserver_handle;
+}
+
+zsa_result_t camclient_open(const char *name, camclient_t *camclient_handle)
+{
+    (void)name;
+    (void)camclient_handle;
+    LOG_ERROR("Camera servers are not supported on Windows", 0);
+    return ZSA_RESULT_FAILED;
+}
+
+void camclient_close(camclient_t camclient_handle)
+{
+    (void)camclient_handle;
+}
+
+zsa_wait_result_t camclient_get_capture(camclient_t camclient_handle,
+                                        zsa_capture_t *capture_handle,
+                                        int32_t timeout_in_ms)
+{
+    (void)camclient_handle;
+    (void)capture_handle;
+    (void)timeout_in_ms;
+    return ZSA_WAIT_RESULT_FAILED;
+}
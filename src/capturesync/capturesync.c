@@ -32,6 +32,8 @@ typedef struct _image_t
 typedef struct _capturesync_context_t
 {
     queue_t sync_queue;    // Queue for storing synchronized captures in
+    // Queues of the subscribers receiving the same captures as sync_queue, NULL for unused entries
+    queue_t subscribers[CAPTURESYNC_MAX_SUBSCRIBERS];
     frame_info_t color;    // Oldest capture received from the color sensor
     frame_info_t depth_ir; // Timestamp in us of the oldest depth capture
 
@@ -49,6 +51,9 @@ typedef struct _capturesync_context_t
     volatile bool running;              // We have received start and should be processing data when true.
     LOCK_HANDLE lock;
 
+    zsa_capture_ready_cb_t *async_cb; // Pending capturesync_get_capture_async(), NULL if none
+    void *async_context;
+
 } capturesync_context_t;
 
 ZSA_DECLARE_CONTEXT(capturesync_t, capturesync_context_t);
@@ -61,6 +66,49 @@ ZSA_DECLARE_CONTEXT(capturesync_t, capturesync_context_t);
 
 #define MICRO_SECONDS(seconds) (seconds * 1000000)
 
+// Completes a pending capturesync_get_capture_async() once a capture is queued or the queue failed
+static void complete_async_capture(capturesync_context_t *sync)
+{
+    zsa_capture_ready_cb_t *callback = NULL;
+    void *context = NULL;
+    zsa_capture_t capture = NULL;
+    uint32_t count = 0;
+    zsa_wait_result_t wresult = ZSA_WAIT_RESULT_TIMEOUT;
+
+    Lock(sync->lock);
+    if (sync->async_cb)
+    {
+        wresult = queue_pop_batch(sync->sync_queue, &capture, 1, &count);
+        if (wresult != ZSA_WAIT_RESULT_TIMEOUT)
+        {
+            callback = sync->async_cb;
+            context = sync->async_context;
+            sync->async_cb = NULL;
+            sync->async_context = NULL;
+        }
+    }
+    Unlock(sync->lock);
+
+    // Called without the lock so the callback can ask for the next capture
+    if (callback)
+    {
+        callback(context, wresult, count ? capture : NULL);
+    }
+}
+
+// Hands a capture to the application queue and to every subscriber, each taking its own reference
+static void publish_capture(capturesync_context_t *sync, zsa_capture_t capture)
+{
+    queue_push(sync->sync_queue, capture);
+    for (int i = 0; i < CAPTURESYNC_MAX_SUBSCRIBERS; i++)
+    {
+        if (sync->subscribers[i])
+        {
+            queue_push(sync->subscribers[i], capture);
+        }
+    }
+}
+
 /**
  * This function is responsible for updating the information in either capturesync_context_t->depth_ir or in
  * capturesync_context_t->color. capturesync_context_t holds the capture, image, and ts for the sample we are currenly
@@ -91,7 +139,7 @@ drop_sample(capturesync_context_t *sync, zsa_wait_result_t *wresult, bool color_
         // drop_into_queue is provided, then it is dropped on the floor
         if (!sync->synchronized_images_only)
         {
-            queue_push(sync->sync_queue, frame_info->capture);
+            publish_capture(sync, frame_info->capture);
         }
     }
 
@@ -145,7 +193,7 @@ static void replace_sample(capturesync_context_t *sync, zsa_capture_t capture_ne
 
     if (!sync->synchronized_images_only)
     {
-        queue_push(sync->sync_queue, frame_info->capture);
+        publish_capture(sync, frame_info->capture);
     }
     capture_dec_ref(frame_info->capture);
     image_dec_ref(frame_info->image);
@@ -174,6 +222,12 @@ static zsa_capture_t merge_captures(zsa_capture_t depth, zsa_capture_t color)
     (void)ZSA_RESULT_FROM_BOOL(image != NULL);
     capture_set_color_image(depth, image);
     image_dec_ref(image);
+
+    capture_color_decoder_t decoder;
+    if (capture_get_color_decoder(color, &decoder))
+    {
+        capture_set_color_decoder(depth, &decoder);
+    }
     return depth;
 }
 
@@ -206,6 +260,16 @@ void capturesync_add_capture(capturesync_t capturesync_handle,
         queue_stop(sync->depth_ir.queue);
         queue_stop(sync->color.queue);
 
+        Lock(sync->lock);
+        for (int i = 0; i < CAPTURESYNC_MAX_SUBSCRIBERS; i++)
+        {
+            if (sync->subscribers[i])
+            {
+                queue_stop(sync->subscribers[i]);
+            }
+        }
+        Unlock(sync->lock);
+
         // Reflect the low level error in the current result
         result = capture_result;
     }
@@ -257,7 +321,7 @@ void capturesync_add_capture(capturesync_t capturesync_handle,
         if (sync->sync_captures == false || sync->disable_sync == true)
         {
             // we are not synchronizing samples, just copy to the queue
-            queue_push(sync->sync_queue, capture_raw);
+            publish_capture(sync, capture_raw);
             result = ZSA_RESULT_FAILED; // Not an error, just a graceful exit
         }
         else if (!color_capture && sync->waiting_for_clean_depth_ts)
@@ -371,7 +435,7 @@ void capturesync_add_capture(capturesync_t capturesync_handle,
                 }
 
                 zsa_capture_t merged = merge_captures(sync->depth_ir.capture, sync->color.capture);
-                queue_push(sync->sync_queue, merged);
+                publish_capture(sync, merged);
                 merged = NULL; // No need to call capture_dec_ref() here.
 
                 // Use drop symantic to get another sample from the queue if present. Synchronized sample is
@@ -394,6 +458,11 @@ void capturesync_add_capture(capturesync_t capturesync_handle,
         Unlock(sync->lock);
         locked = false;
     }
+
+    if (sync)
+    {
+        complete_async_capture(sync);
+    }
 }
 
 zsa_result_t capturesync_create(capturesync_t *capturesync_handle)
@@ -466,6 +535,14 @@ void capturesync_destroy(capturesync_t capturesync_handle)
 
     capturesync_stop(capturesync_handle);
 
+    for (int i = 0; i < CAPTURESYNC_MAX_SUBSCRIBERS; i++)
+    {
+        if (sync->subscribers[i])
+        {
+            queue_destroy(sync->subscribers[i]);
+        }
+    }
+
     if (sync->depth_ir.queue)
     {
         queue_destroy(sync->depth_ir.queue);
@@ -517,6 +594,16 @@ zsa_result_t capturesync_start(capturesync_t capturesync_handle, const zsa_devic
         queue_enable(sync->depth_ir.queue);
         queue_enable(sync->sync_queue);
 
+        Lock(sync->lock);
+        for (int i = 0; i < CAPTURESYNC_MAX_SUBSCRIBERS; i++)
+        {
+            if (sync->subscribers[i])
+            {
+                queue_enable(sync->subscribers[i]);
+            }
+        }
+        Unlock(sync->lock);
+
         // Not taking the lock as we don't need to syncronize this on start
         sync->running = true;
     }
@@ -545,6 +632,14 @@ void capturesync_stop(capturesync_t capturesync_handle)
         queue_disable(sync->sync_queue);
     }
 
+    for (int i = 0; i < CAPTURESYNC_MAX_SUBSCRIBERS; i++)
+    {
+        if (sync->subscribers[i])
+        {
+            queue_disable(sync->subscribers[i]);
+        }
+    }
+
     if (sync->color.capture)
     {
         capture_dec_ref(sync->color.capture);
@@ -571,6 +666,9 @@ void capturesync_stop(capturesync_t capturesync_handle)
         sync->depth_ir.image = NULL;
     }
     Unlock(sync->lock);
+
+    // Fails a pending capturesync_get_capture_async(), sync_queue is disabled
+    complete_async_capture(sync);
 }
 
 zsa_wait_result_t capturesync_get_capture(capturesync_t capturesync_handle,
@@ -590,3 +688,163 @@ zsa_wait_result_t capturesync_get_capture(capturesync_t capturesync_handle,
     }
     return wresult;
 }
+
+zsa_result_t capturesync_get_capture_async(capturesync_t capturesync_handle,
+                                           zsa_capture_ready_cb_t *capture_ready_cb,
+                                           void *capture_ready_cb_context)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_RESULT_FAILED, capturesync_t, capturesync_handle);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, capture_ready_cb == NULL);
+    capturesync_context_t *sync = capturesync_t_get_context(capturesync_handle);
+    zsa_capture_t capture = NULL;
+    uint32_t count = 0;
+    zsa_wait_result_t wresult = ZSA_WAIT_RESULT_TIMEOUT;
+    bool pending = false;
+
+    // Captures are published under the lock, so either one is found here or the callback is registered before the
+    // next one is published
+    Lock(sync->lock);
+    pending = sync->async_cb != NULL;
+    if (!pending)
+    {
+        wresult = queue_pop_batch(sync->sync_queue, &capture, 1, &count);
+        if (wresult == ZSA_WAIT_RESULT_TIMEOUT)
+        {
+            sync->async_cb = capture_ready_cb;
+            sync->async_context = capture_ready_cb_context;
+        }
+    }
+    Unlock(sync->lock);
+
+    if (pending)
+    {
+        LOG_ERROR("A capture is already being read asynchronously.", 0);
+        return ZSA_RESULT_FAILED;
+    }
+
+    if (wresult != ZSA_WAIT_RESULT_TIMEOUT)
+    {
+        capture_ready_cb(capture_ready_cb_context, wresult, count ? capture : NULL);
+    }
+    return ZSA_RESULT_SUCCEEDED;
+}
+
+zsa_wait_result_t capturesync_get_captures(capturesync_t capturesync_handle,
+                                           zsa_capture_t *capture_handles,
+                                           uint32_t capacity,
+                                           uint32_t *count)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_WAIT_RESULT_FAILED, capturesync_t, capturesync_handle);
+    capturesync_context_t *sync = capturesync_t_get_context(capturesync_handle);
+
+    return queue_pop_batch(sync->sync_queue, capture_handles, capacity, count);
+}
+
+int capturesync_get_event_fd(capturesync_t capturesync_handle)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(-1, capturesync_t, capturesync_handle);
+    capturesync_context_t *sync = capturesync_t_get_context(capturesync_handle);
+
+    return queue_get_event_fd(sync->sync_queue);
+}
+
+zsa_result_t capturesync_set_overflow_policy(capturesync_t capturesync_handle,
+                                             queue_overflow_policy_t policy,
+                                             size_t max_bytes)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_RESULT_FAILED, capturesync_t, capturesync_handle);
+    capturesync_context_t *sync = capturesync_t_get_context(capturesync_handle);
+
+    return TRACE_CALL(queue_set_overflow_policy(sync->sync_queue, policy, max_bytes));
+}
+
+void capturesync_get_queue_stats(capturesync_t capturesync_handle, queue_stats_t *stats)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(VOID_VALUE, capturesync_t, capturesync_handle);
+    RETURN_VALUE_IF_ARG(VOID_VALUE, stats == NULL);
+    capturesync_context_t *sync = capturesync_t_get_context(capturesync_handle);
+
+    queue_get_stats(sync->sync_queue, stats);
+}
+
+zsa_result_t capturesync_subscribe(capturesync_t capturesync_handle,
+                                   uint32_t queue_depth,
+                                   queue_overflow_policy_t policy,
+                                   size_t max_bytes,
+                                   queue_t *subscriber)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_RESULT_FAILED, capturesync_t, capturesync_handle);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, subscriber == NULL);
+    capturesync_context_t *sync = capturesync_t_get_context(capturesync_handle);
+    queue_t queue = NULL;
+
+    zsa_result_t result = TRACE_CALL(
+        queue_create(queue_depth == 0 ? QUEUE_DEFAULT_SIZE / 2 : queue_depth, "Queue_subscriber", &queue));
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        result = TRACE_CALL(queue_set_overflow_policy(queue, policy, max_bytes));
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        // Queues are created disabled, match the state of the ones already streaming
+        Lock(sync->lock);
+        if (sync->running)
+        {
+            queue_enable(queue);
+        }
+
+        result = ZSA_RESULT_FAILED;
+        for (int i = 0; i < CAPTURESYNC_MAX_SUBSCRIBERS; i++)
+        {
+            if (sync->subscribers[i] == NULL)
+            {
+                sync->subscribers[i] = queue;
+                result = ZSA_RESULT_SUCCEEDED;
+                break;
+            }
+        }
+        Unlock(sync->lock);
+
+        if (ZSA_FAILED(result))
+        {
+            LOG_ERROR("All %d capture subscriptions are in use.", CAPTURESYNC_MAX_SUBSCRIBERS);
+        }
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        *subscriber = queue;
+    }
+    else if (queue)
+    {
+        queue_destroy(queue);
+    }
+
+    return result;
+}
+
+void capturesync_unsubscribe(capturesync_t capturesync_handle, queue_t subscriber)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(VOID_VALUE, capturesync_t, capturesync_handle);
+    RETURN_VALUE_IF_ARG(VOID_VALUE, subscriber == NULL);
+    capturesync_context_t *sync = capturesync_t_get_context(capturesync_handle);
+    bool found = false;
+
+    // Once removed no new captures can be pushed, the ones still queued are released with the queue
+    Lock(sync->lock);
+    for (int i = 0; i < CAPTURESYNC_MAX_SUBSCRIBERS; i++)
+    {
+        if (sync->subscribers[i] == subscriber)
+        {
+            sync->subscribers[i] = NULL;
+            found = true;
+            break;
+        }
+    }
+    Unlock(sync->lock);
+
+    RETURN_VALUE_IF_ARG(VOID_VALUE, found == false);
+    queue_destroy(subscriber);
+}
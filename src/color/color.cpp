@@ -5,6 +5,7 @@
 #include <zsainternal/color.h>
 
 // Dependent libraries
+#include <zsainternal/capture.h>
 
 // System dependencies
 #include <stdlib.h>
@@ -12,6 +13,12 @@
 #include <assert.h>
 #include <new>
 #include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <system_error>
+#include <thread>
 
 #include "color_priv.h"
 
@@ -28,6 +35,39 @@ extern "C" {
 
 color_cb_stream_t color_capture_available;
 
+#define COLOR_CONTROL_COUNT (ZSA_COLOR_CONTROL_POWERLINE_FREQUENCY + 1)
+
+// Last known mode and value of a control. Published with a seqlock: the sequence is odd while a writer updates the
+// fields, readers retry until they copied them under one even sequence.
+typedef struct _color_control_state_t
+{
+    std::atomic<uint32_t> sequence;
+    std::atomic<int32_t> mode;
+    std::atomic<int32_t> value;
+    std::atomic<bool> valid;
+} color_control_state_t;
+
+// One entry of the frame metadata ring. Written like a seqlock: the sequence is 2 * frame_index + 1 while the entry is
+// being filled and 2 * frame_index + 2 once it holds that frame.
+typedef struct _color_metadata_slot_t
+{
+    std::atomic<uint64_t> sequence;
+    std::atomic<uint64_t> device_timestamp_usec;
+    std::atomic<uint64_t> system_timestamp_nsec;
+    std::atomic<uint64_t> exposure_usec;
+    std::atomic<uint32_t> iso_speed;
+    std::atomic<uint32_t> white_balance;
+    std::atomic<uint64_t> size_bytes;
+} color_metadata_slot_t;
+
+typedef struct _color_control_write_t
+{
+    zsa_color_control_command_t command;
+    zsa_color_control_mode_t mode;
+    int32_t value;
+    uint32_t generation; // control_generation of the command when the write was queued
+} color_control_write_t;
+
 typedef struct _color_context_t
 {
     TICK_COUNTER_HANDLE tick;
@@ -35,6 +75,27 @@ typedef struct _color_context_t
     void *capture_ready_cb_context;
     tickcounter_ms_t sensor_start_time_tick;
     std::array<color_control_cap_t, ZSA_COLOR_CONTROL_POWERLINE_FREQUENCY + 1> control_cap = {};
+
+    // Control snapshot read by color_get_control() without touching the camera. Writers are serialized by
+    // control_state_lock; the streaming callback only updates it when the lock is free. color_set_control() publishes
+    // a write as it queues it and counts the writes of each control in control_generation, under the same lock.
+    std::array<color_control_state_t, COLOR_CONTROL_COUNT> control_state;
+    std::array<uint32_t, COLOR_CONTROL_COUNT> control_generation;
+    std::mutex control_state_lock;
+
+    // color_set_control() requests, applied in order by control_thread
+    std::deque<color_control_write_t> control_writes;
+    std::mutex control_write_lock;
+    std::condition_variable control_write_condition;
+    std::thread control_thread;
+    bool control_thread_stop = false;
+
+    // Metadata of the last COLOR_METADATA_RING_SIZE frames. The streaming thread is the only writer.
+    std::array<color_metadata_slot_t, COLOR_METADATA_RING_SIZE> metadata_ring;
+    std::atomic<uint64_t> metadata_count; // Frames added so far
+
+    // Set by color_set_standby(), read by the streaming thread for every frame
+    std::atomic<bool> standby;
 #ifdef _WIN32
     Microsoft::WRL::ComPtr<CMFCameraReader> m_spCameraReader;
 #else
@@ -44,6 +105,198 @@ typedef struct _color_context_t
 
 ZSA_DECLARE_CONTEXT(color_t, color_context_t);
 
+// Must be called with control_state_lock held
+static void color_control_state_write(color_control_state_t *state, zsa_color_control_mode_t mode, int32_t value)
+{
+    uint32_t sequence = state->sequence.load(std::memory_order_relaxed);
+    state->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    state->mode.store((int32_t)mode, std::memory_order_relaxed);
+    state->value.store(value, std::memory_order_relaxed);
+    state->valid.store(true, std::memory_order_relaxed);
+    state->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+static bool color_control_state_read(const color_control_state_t *state, zsa_color_control_mode_t *mode, int32_t *value)
+{
+    uint32_t sequence;
+    bool valid;
+
+    do
+    {
+        sequence = state->sequence.load(std::memory_order_acquire);
+        valid = state->valid.load(std::memory_order_relaxed);
+        *mode = (zsa_color_control_mode_t)state->mode.load(std::memory_order_relaxed);
+        *value = state->value.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((sequence & 1) != 0 || sequence != state->sequence.load(std::memory_order_relaxed));
+
+    return valid;
+}
+
+// Auto exposure and auto white balance change every frame; the frame metadata carries the values the camera used
+static void color_control_state_update_from_image(color_context_t *color, zsa_image_t image)
+{
+    std::unique_lock<std::mutex> lock(color->control_state_lock, std::try_to_lock);
+    if (!lock.owns_lock())
+    {
+        // A control is being written, the next frame updates the snapshot
+        return;
+    }
+
+    const struct
+    {
+        zsa_color_control_command_t command;
+        int64_t value;
+    } observed[] = { { ZSA_COLOR_CONTROL_EXPOSURE_TIME_ABSOLUTE, (int64_t)image_get_exposure_usec(image) },
+                     { ZSA_COLOR_CONTROL_WHITEBALANCE, (int64_t)image_get_white_balance(image) } };
+
+    for (size_t i = 0; i < COUNTOF(observed); i++)
+    {
+        color_control_state_t *state = &color->control_state[observed[i].command];
+        zsa_color_control_mode_t mode;
+        int32_t value;
+        int32_t observed_value = (int32_t)observed[i].value;
+
+        // Frames without the statistic report 0. Manual values are the ones written.
+        if (observed[i].value <= 0 || observed[i].value > INT32_MAX ||
+            !color_control_state_read(state, &mode, &value) || mode != ZSA_COLOR_CONTROL_MODE_AUTO)
+        {
+            continue;
+        }
+
+        // Reported in the exposure steps color_get_control() reads from the camera
+        if (observed[i].command == ZSA_COLOR_CONTROL_EXPOSURE_TIME_ABSOLUTE)
+        {
+            observed_value = color->m_spCameraReader->MapExposureToK4a(observed_value);
+        }
+
+        if (value != observed_value)
+        {
+            color_control_state_write(state, mode, observed_value);
+        }
+    }
+}
+
+void color_frame_metadata_add(void *context, const zsa_color_frame_metadata_t *metadata)
+{
+    color_context_t *color = (color_context_t *)context;
+    uint64_t frame_index = color->metadata_count.load(std::memory_order_relaxed);
+    color_metadata_slot_t *slot = &color->metadata_ring[frame_index & (COLOR_METADATA_RING_SIZE - 1)];
+
+    slot->sequence.store(2 * frame_index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot->device_timestamp_usec.store(metadata->device_timestamp_usec, std::memory_order_relaxed);
+    slot->system_timestamp_nsec.store(metadata->system_timestamp_nsec, std::memory_order_relaxed);
+    slot->exposure_usec.store(metadata->exposure_usec, std::memory_order_relaxed);
+    slot->iso_speed.store(metadata->iso_speed, std::memory_order_relaxed);
+    slot->white_balance.store(metadata->white_balance, std::memory_order_relaxed);
+    slot->size_bytes.store(metadata->size_bytes, std::memory_order_relaxed);
+    slot->sequence.store(2 * frame_index + 2, std::memory_order_release);
+
+    color->metadata_count.store(frame_index + 1, std::memory_order_release);
+}
+
+bool color_in_standby(void *context)
+{
+    color_context_t *color = (color_context_t *)context;
+    return color->standby.load(std::memory_order_acquire);
+}
+
+uint32_t color_read_frame_metadata(const color_t color_handle,
+                                   uint64_t *frame_index,
+                                   zsa_color_frame_metadata_t *metadata,
+                                   uint32_t count)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(0, color_t, color_handle);
+    RETURN_VALUE_IF_ARG(0, frame_index == NULL);
+    RETURN_VALUE_IF_ARG(0, metadata == NULL && count > 0);
+    color_context_t *color = color_t_get_context(color_handle);
+    uint32_t read = 0;
+
+    while (read < count)
+    {
+        uint64_t added = color->metadata_count.load(std::memory_order_acquire);
+        uint64_t index = *frame_index;
+
+        if (index >= added)
+        {
+            break;
+        }
+
+        if (added - index > COLOR_METADATA_RING_SIZE)
+        {
+            // Overwritten already, continue with the oldest frame held
+            index = added - COLOR_METADATA_RING_SIZE;
+        }
+
+        const color_metadata_slot_t *slot = &color->metadata_ring[index & (COLOR_METADATA_RING_SIZE - 1)];
+        zsa_color_frame_metadata_t *entry = &metadata[read];
+        uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+
+        entry->frame_index = index;
+        entry->device_timestamp_usec = slot->device_timestamp_usec.load(std::memory_order_relaxed);
+        entry->system_timestamp_nsec = slot->system_timestamp_nsec.load(std::memory_order_relaxed);
+        entry->exposure_usec = slot->exposure_usec.load(std::memory_order_relaxed);
+        entry->iso_speed = slot->iso_speed.load(std::memory_order_relaxed);
+        entry->white_balance = slot->white_balance.load(std::memory_order_relaxed);
+        entry->size_bytes = slot->size_bytes.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        // The writer lapped this reader while the entry was copied; skip ahead and try again
+        if (sequence != 2 * index + 2 || slot->sequence.load(std::memory_order_relaxed) != sequence)
+        {
+            *frame_index = index + 1;
+            continue;
+        }
+
+        *frame_index = index + 1;
+        read++;
+    }
+
+    return read;
+}
+
+static void color_control_thread(color_context_t *color)
+{
+    std::unique_lock<std::mutex> lock(color->control_write_lock);
+
+    while (!color->control_writes.empty() || !color->control_thread_stop)
+    {
+        if (color->control_writes.empty())
+        {
+            color->control_write_condition.wait(lock);
+            continue;
+        }
+
+        color_control_write_t write = color->control_writes.front();
+        color->control_writes.pop_front();
+        lock.unlock();
+
+        zsa_result_t result = color->m_spCameraReader->SetCameraControl(write.command, write.mode, write.value);
+
+        if (ZSA_FAILED(result))
+        {
+            LOG_ERROR("Setting color control %d to mode %d value %d failed", write.command, write.mode, write.value);
+
+            // color_set_control() published the write when it was queued. Unless a later write of the same control
+            // replaced it since, what the camera kept is unknown and the next color_get_control() reads it back.
+            std::lock_guard<std::mutex> state_lock(color->control_state_lock);
+            if (color->control_generation[write.command] == write.generation)
+            {
+                color_control_state_t *state = &color->control_state[write.command];
+                uint32_t sequence = state->sequence.load(std::memory_order_relaxed);
+                state->sequence.store(sequence + 1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+                state->valid.store(false, std::memory_order_relaxed);
+                state->sequence.store(sequence + 2, std::memory_order_release);
+            }
+        }
+
+        lock.lock();
+    }
+}
+
 zsa_result_t color_create(TICK_COUNTER_HANDLE tick_handle,
                           const guid_t *container_id,
                           const char *serial_number,
@@ -93,6 +346,18 @@ zsa_result_t color_create(TICK_COUNTER_HANDLE tick_handle,
     return result;
 }
 
+zsa_result_t color_get_device_count(uint32_t *device_count)
+{
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, device_count == NULL);
+#ifdef _WIN32
+    // Media Foundation cameras are matched to their MCU by container ID; there is no separate count to compare
+    *device_count = 0;
+    return ZSA_RESULT_FAILED;
+#else
+    return TRACE_CALL(UVCCameraReader::GetDeviceCount(device_count));
+#endif
+}
+
 void color_destroy(color_t color_handle)
 {
     RETURN_VALUE_IF_HANDLE_INVALID(VOID_VALUE, color_t, color_handle);
@@ -100,6 +365,17 @@ void color_destroy(color_t color_handle)
     color_stop(color_handle);
 
     color_context_t *color = color_t_get_context(color_handle);
+    if (color->control_thread.joinable())
+    {
+        // Queued writes are still applied before the camera is closed
+        {
+            std::lock_guard<std::mutex> lock(color->control_write_lock);
+            color->control_thread_stop = true;
+        }
+        color->control_write_condition.notify_one();
+        color->control_thread.join();
+    }
+
     if (color->m_spCameraReader)
     {
         color->m_spCameraReader->Shutdown();
@@ -112,6 +388,16 @@ void color_capture_available(zsa_result_t result, zsa_capture_t capture_handle,
 {
     color_context_t *color = (color_context_t *)context;
 
+    if (ZSA_SUCCEEDED(result))
+    {
+        zsa_image_t image = capture_get_color_image(capture_handle);
+        if (image)
+        {
+            color_control_state_update_from_image(color, image);
+            image_dec_ref(image);
+        }
+    }
+
     if (color->capture_ready_cb)
     {
         color->capture_ready_cb(result, capture_handle, color->capture_ready_cb_context);
@@ -125,41 +411,37 @@ void color_capture_available(zsa_result_t result, zsa_capture_t capture_handle,
     }
 }
 
-zsa_result_t color_start(color_t color_handle, const zsa_device_configuration_t *config)
+// Resolution and frame rate the camera streams for a configuration
+static zsa_result_t color_get_stream_mode(const zsa_device_configuration_t *config,
+                                          uint32_t *width,
+                                          uint32_t *height,
+                                          float *fps)
 {
-    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_RESULT_FAILED, color_t, color_handle);
-    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, config == NULL);
-    zsa_result_t result = ZSA_RESULT_SUCCEEDED;
-    color_context_t *color = color_t_get_context(color_handle);
-    uint32_t width = 0;
-    uint32_t height = 0;
-    float fps = 1.0f;
-
     switch (config->color_resolution)
     {
     case ZSA_COLOR_RESOLUTION_720P:
-        width = 1280;
-        height = 720;
+        *width = 1280;
+        *height = 720;
         break;
     case ZSA_COLOR_RESOLUTION_2160P:
-        width = 3840;
-        height = 2160;
+        *width = 3840;
+        *height = 2160;
         break;
     case ZSA_COLOR_RESOLUTION_1440P:
-        width = 2560;
-        height = 1440;
+        *width = 2560;
+        *height = 1440;
         break;
     case ZSA_COLOR_RESOLUTION_1080P:
-        width = 1920;
-        height = 1080;
+        *width = 1920;
+        *height = 1080;
         break;
     case ZSA_COLOR_RESOLUTION_3072P:
-        width = 4096;
-        height = 3072;
+        *width = 4096;
+        *height = 3072;
         break;
     case ZSA_COLOR_RESOLUTION_1536P:
-        width = 2048;
-        height = 1536;
+        *width = 2048;
+        *height = 1536;
         break;
     default:
         LOG_ERROR("color_resolution %d is invalid", config->color_resolution);
@@ -169,21 +451,82 @@ zsa_result_t color_start(color_t color_handle, const zsa_device_configuration_t
     switch (config->camera_fps)
     {
     case ZSA_FRAMES_PER_SECOND_30:
-        fps = 30.0f;
+        *fps = 30.0f;
         break;
     case ZSA_FRAMES_PER_SECOND_15:
-        fps = 15.0f;
+        *fps = 15.0f;
         break;
     case ZSA_FRAMES_PER_SECOND_5:
-        fps = 5.0f;
+        *fps = 5.0f;
         break;
     default:
         LOG_ERROR("camera_fps %d is invalid", config->camera_fps);
         return ZSA_RESULT_FAILED;
     }
 
+    return ZSA_RESULT_SUCCEEDED;
+}
+
+zsa_result_t color_prepare(color_t color_handle, const zsa_device_configuration_t *config)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_RESULT_FAILED, color_t, color_handle);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, config == NULL);
+    color_context_t *color = color_t_get_context(color_handle);
+    uint32_t width = 0;
+    uint32_t height = 0;
+    float fps = 1.0f;
+
+    zsa_result_t result = TRACE_CALL(color_get_stream_mode(config, &width, &height, &fps));
+
+#ifdef _WIN32
+    // Media Foundation picks the media type as part of starting the source reader
+    (void)(color);
+#else
+    if (ZSA_SUCCEEDED(result))
+    {
+        result = TRACE_CALL(color->m_spCameraReader->Prepare(width, height, fps, config->color_format));
+    }
+#endif
+
+    return result;
+}
+
+zsa_result_t color_start(color_t color_handle, const zsa_device_configuration_t *config)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_RESULT_FAILED, color_t, color_handle);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, config == NULL);
+    zsa_result_t result = ZSA_RESULT_SUCCEEDED;
+    color_context_t *color = color_t_get_context(color_handle);
+    uint32_t width = 0;
+    uint32_t height = 0;
+    float fps = 1.0f;
+
+    if (ZSA_FAILED(color_get_stream_mode(config, &width, &height, &fps)))
+    {
+        return ZSA_RESULT_FAILED;
+    }
+
     result = ZSA_RESULT_FROM_BOOL(tickcounter_get_current_ms(color->tick, &color->sensor_start_time_tick) == 0);
 
+#ifdef _WIN32
+    // Media Foundation decodes MJPEG itself, always at full size
+    bool decode_region = config->color_scale != ZSA_COLOR_SCALE_FULL || config->color_crop.width != 0 ||
+                         config->color_crop.height != 0;
+    if (ZSA_SUCCEEDED(result) &&
+        (config->color_decode_on_demand || (config->color_format == ZSA_IMAGE_FORMAT_COLOR_BGRA32 && decode_region)))
+    {
+        LOG_ERROR("color_scale, color_crop and color_decode_on_demand are not supported on this platform", 0);
+        result = ZSA_RESULT_FAILED;
+    }
+#else
+    if (ZSA_SUCCEEDED(result))
+    {
+        result = TRACE_CALL(color->m_spCameraReader->SetDecodeOptions(config->color_scale,
+                                                                      &config->color_crop,
+                                                                      config->color_decode_on_demand));
+    }
+#endif
+
     if (ZSA_SUCCEEDED(result))
     {
         result = TRACE_CALL(color->m_spCameraReader->Start(width,
@@ -216,9 +559,17 @@ void color_stop(color_t color_handle)
         color->m_spCameraReader->Stop();
     }
 
+    color->standby.store(false, std::memory_order_release);
     return;
 }
 
+void color_set_standby(color_t color_handle, bool standby)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(VOID_VALUE, color_t, color_handle);
+    color_context_t *color = color_t_get_context(color_handle);
+    color->standby.store(standby, std::memory_order_release);
+}
+
 tickcounter_ms_t color_get_sensor_start_time_tick(const color_t handle)
 {
     RETURN_VALUE_IF_HANDLE_INVALID(0, color_t, handle);
@@ -278,8 +629,73 @@ zsa_result_t color_get_control(const color_t handle,
     RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, mode == NULL);
     RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, value == NULL);
     color_context_t *color = color_t_get_context(handle);
+    color_control_state_t *state = &color->control_state[command];
+
+    if (color_control_state_read(state, mode, value))
+    {
+        return ZSA_RESULT_SUCCEEDED;
+    }
+
+    // First read of this control, ask the camera once
+    uint32_t sequence = state->sequence.load(std::memory_order_acquire);
+    zsa_result_t result = color->m_spCameraReader->GetCameraControl(command, mode, value);
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        std::lock_guard<std::mutex> lock(color->control_state_lock);
+
+        // Unless a write completed in the meantime, which knows better
+        if (state->sequence.load(std::memory_order_relaxed) == sequence)
+        {
+            color_control_state_write(state, *mode, *value);
+        }
+    }
+
+    return result;
+}
+
+// Checks a write against the capabilities of the control, so values the camera would reject fail the call that made
+// them. Must be called with control_state_lock held.
+static zsa_result_t color_control_validate(color_context_t *color,
+                                           const zsa_color_control_command_t command,
+                                           const zsa_color_control_mode_t mode,
+                                           int32_t value)
+{
+    color_control_cap_t *cap = &color->control_cap[command];
+    zsa_result_t result = ZSA_RESULT_SUCCEEDED;
+
+    if (cap->valid == false)
+    {
+        result = TRACE_CALL(color->m_spCameraReader->GetCameraControlCapabilities(command, cap));
+    }
+
+    if (ZSA_SUCCEEDED(result) && mode == ZSA_COLOR_CONTROL_MODE_AUTO && !cap->supportAuto)
+    {
+        LOG_ERROR("Color control %d has no automatic mode", command);
+        result = ZSA_RESULT_FAILED;
+    }
+
+    if (ZSA_SUCCEEDED(result) && mode == ZSA_COLOR_CONTROL_MODE_MANUAL &&
+        (value < cap->minValue || value > cap->maxValue))
+    {
+        LOG_ERROR("Color control %d value %d is outside of [%d, %d]", command, value, cap->minValue, cap->maxValue);
+        result = ZSA_RESULT_FAILED;
+    }
+
+    // Exposure times are rounded up to the next exposure the camera supports, other values must be on a step
+    if (ZSA_SUCCEEDED(result) && mode == ZSA_COLOR_CONTROL_MODE_MANUAL &&
+        command != ZSA_COLOR_CONTROL_EXPOSURE_TIME_ABSOLUTE && cap->stepValue > 1 &&
+        (value - cap->minValue) % cap->stepValue != 0)
+    {
+        LOG_ERROR("Color control %d value %d is not a multiple of %d above %d",
+                  command,
+                  value,
+                  cap->stepValue,
+                  cap->minValue);
+        result = ZSA_RESULT_FAILED;
+    }
 
-    return color->m_spCameraReader->GetCameraControl(command, mode, value);
+    return result;
 }
 
 zsa_result_t color_set_control(const color_t handle,
@@ -294,8 +710,73 @@ zsa_result_t color_set_control(const color_t handle,
     RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED,
                         mode != ZSA_COLOR_CONTROL_MODE_AUTO && mode != ZSA_COLOR_CONTROL_MODE_MANUAL);
     color_context_t *color = color_t_get_context(handle);
+    std::lock_guard<std::mutex> state_lock(color->control_state_lock);
+
+    zsa_result_t result = TRACE_CALL(color_control_validate(color, command, mode, value));
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        std::lock_guard<std::mutex> lock(color->control_write_lock);
 
-    return color->m_spCameraReader->SetCameraControl(command, mode, value);
+        if (!color->control_thread.joinable())
+        {
+            try
+            {
+                color->control_thread = std::thread(color_control_thread, color);
+            }
+            catch (const std::system_error &)
+            {
+                LOG_ERROR("Could not start the color control thread", 0);
+                result = ZSA_RESULT_FAILED;
+            }
+        }
+
+        if (ZSA_SUCCEEDED(result))
+        {
+            uint32_t generation = ++color->control_generation[command];
+
+            // A write still queued for the same control is superseded, e.g. while a slider is dragged
+            bool queued = false;
+            for (color_control_write_t &write : color->control_writes)
+            {
+                if (write.command == command)
+                {
+                    write.mode = mode;
+                    write.value = value;
+                    write.generation = generation;
+                    queued = true;
+                }
+            }
+
+            if (!queued)
+            {
+                color->control_writes.push_back({ command, mode, value, generation });
+            }
+        }
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        // Published right away so that a read after this call sees it. Automatic values keep what was last known
+        // until frames report the ones the camera picked.
+        color_control_state_t *state = &color->control_state[command];
+        zsa_color_control_mode_t known_mode;
+        int32_t published = value;
+
+        if (mode == ZSA_COLOR_CONTROL_MODE_AUTO && !color_control_state_read(state, &known_mode, &published))
+        {
+            published = color->control_cap[command].defaultValue;
+        }
+        else if (mode == ZSA_COLOR_CONTROL_MODE_MANUAL && command == ZSA_COLOR_CONTROL_EXPOSURE_TIME_ABSOLUTE)
+        {
+            published = color->m_spCameraReader->MapExposureToK4a(value);
+        }
+
+        color_control_state_write(state, mode, published);
+        color->control_write_condition.notify_one();
+    }
+
+    return result;
 }
 
 #ifdef __cplusplus
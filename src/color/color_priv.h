@@ -77,6 +77,30 @@ KSELECTANY color_exposure_mapping_t device_exposure_mapping[] = {
  */
 typedef void(color_cb_stream_t)(zsa_result_t result, zsa_capture_t capture_handle, void *context);
 
+/** Records the metadata of a frame in the color module's metadata ring.
+ *
+ * \param context
+ * The context of the \ref color_cb_stream_t callback
+ *
+ * \param metadata
+ * Metadata of the frame, frame_index is assigned by the ring
+ *
+ * \remarks
+ * Called by the camera reader for every frame as soon as the metadata is parsed, before anything is allocated for the
+ * frame. Never blocks.
+ */
+void color_frame_metadata_add(void *context, const zsa_color_frame_metadata_t *metadata);
+
+/** Tells the camera reader whether frames are dropped, see \ref color_set_standby.
+ *
+ * \param context
+ * The context of the \ref color_cb_stream_t callback
+ *
+ * \remarks
+ * Called by the camera reader for every frame before anything is allocated for it. Never blocks.
+ */
+bool color_in_standby(void *context);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1045,6 +1045,13 @@ STDMETHODIMP CMFCameraReader::OnReadSample(HRESULT hrStatus,
                     LOG_INFO("Dropping color image due to ts:%lld", pFrameContext->GetPTSTime());
                 }
 
+                if (ZSA_SUCCEEDED(result) && color_in_standby(m_pCallbackContext))
+                {
+                    // Not copied while nobody reads the captures
+                    dropped = true;
+                    result = ZSA_RESULT_FAILED;
+                }
+
                 if (ZSA_SUCCEEDED(result))
                 {
                     if (m_use_mf_buffer)
@@ -1459,6 +1466,11 @@ CMFCameraReader::SetCameraControlValue(const GUID PropertySet, const ULONG Prope
                                      &retSize);
 }
 
+int32_t CMFCameraReader::MapExposureToK4a(int32_t exposureUsec)
+{
+    return (int32_t)MapMfExponentToK4a(MapK4aExposureToMf(exposureUsec));
+}
+
 LONG CMFCameraReader::MapK4aExposureToMf(int K4aExposure)
 {
     for (int x = 0; x < COUNTOF(device_exposure_mapping); x++)
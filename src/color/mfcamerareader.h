@@ -105,6 +105,9 @@ public:
                                   const zsa_color_control_mode_t mode,
                                   int32_t newValue);
 
+    // Exposure time in microseconds as GetCameraControl() reports it
+    int32_t MapExposureToK4a(int32_t exposureUsec);
+
     // IMFSourceReaderCallback
     STDMETHOD(OnReadSample)
     (HRESULT hrStatus, DWORD dwStreamIndex, DWORD dwStreamFlags, LONGLONG llTimestamp, IMFSample *pSample);
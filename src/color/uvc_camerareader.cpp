@@ -23,6 +23,328 @@ static void UVCFrameCallback(uvc_frame_t *frame, void *ptr)
     }
 }
 
+// libjpeg error handler, the default one exits the process
+static void UVCJpegErrorExit(j_common_ptr cinfo)
+{
+    char message[JMSG_LENGTH_MAX];
+    (*cinfo->err->format_message)(cinfo, message);
+    LOG_ERROR("MJPEG decode failed: %s", message);
+
+    uvc_jpeg_error_t *error = (uvc_jpeg_error_t *)cinfo->err;
+    longjmp(error->jump, 1);
+}
+
+// libjpeg warning handler, the default one prints to stderr
+static void UVCJpegOutputMessage(j_common_ptr cinfo)
+{
+    char message[JMSG_LENGTH_MAX];
+    (*cinfo->err->format_message)(cinfo, message);
+    LOG_WARNING("MJPEG decode: %s", message);
+}
+
+// Callback function for when image objects are destroyed
+static void uvc_camerareader_free_allocation(void *buffer, void *context)
+{
+    (void)context;
+    allocator_free(buffer);
+}
+
+// Returns 0 for an invalid scale
+static uint32_t GetScaleDenominator(const zsa_color_scale_t scale)
+{
+    switch (scale)
+    {
+    case ZSA_COLOR_SCALE_FULL:
+        return 1;
+    case ZSA_COLOR_SCALE_HALF:
+        return 2;
+    case ZSA_COLOR_SCALE_QUARTER:
+        return 4;
+    case ZSA_COLOR_SCALE_EIGHTH:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+// Size of the images decoded from MJPEG frames of width x height
+static zsa_result_t GetDecodedSize(const capture_color_decoder_t *decode,
+                                   const uint32_t width,
+                                   const uint32_t height,
+                                   uint32_t *decodedWidth,
+                                   uint32_t *decodedHeight,
+                                   bool *cropped)
+{
+    uint32_t denominator = GetScaleDenominator(decode->scale);
+    if (denominator == 0)
+    {
+        LOG_ERROR("color_scale %d is invalid", decode->scale);
+        return ZSA_RESULT_FAILED;
+    }
+
+    // Same rounding as the decoder
+    tjscalingfactor scale = { 1, (int)denominator };
+    uint32_t scaledWidth = (uint32_t)TJSCALED((int)width, scale);
+    uint32_t scaledHeight = (uint32_t)TJSCALED((int)height, scale);
+    const zsa_color_crop_t *crop = &decode->crop;
+
+    *decodedWidth = scaledWidth;
+    *decodedHeight = scaledHeight;
+    if (crop->width != 0 && crop->height != 0)
+    {
+        if (crop->width > scaledWidth || crop->x > scaledWidth - crop->width || crop->height > scaledHeight ||
+            crop->y > scaledHeight - crop->height)
+        {
+            LOG_ERROR("Color crop (%u, %u) %u x %u is outside of the %u x %u image",
+                      crop->x,
+                      crop->y,
+                      crop->width,
+                      crop->height,
+                      scaledWidth,
+                      scaledHeight);
+            return ZSA_RESULT_FAILED;
+        }
+
+        *decodedWidth = crop->width;
+        *decodedHeight = crop->height;
+    }
+
+    if (cropped)
+    {
+        *cropped = *decodedWidth != scaledWidth || *decodedHeight != scaledHeight;
+    }
+    return ZSA_RESULT_SUCCEEDED;
+}
+
+static void DestroyMJPEGDecoder(uvc_mjpeg_decoder_t *decoder)
+{
+    if (decoder->handle)
+    {
+        (void)tjDestroy(decoder->handle);
+        decoder->handle = nullptr;
+    }
+
+    if (decoder->region_valid)
+    {
+        jpeg_destroy_decompress(&decoder->region);
+        decoder->region_valid = false;
+    }
+}
+
+static zsa_result_t DecodeMJPEGRegionToBGRA32(uvc_mjpeg_decoder_t *decoder,
+                                              const uint32_t scaleDenominator,
+                                              const zsa_color_crop_t *crop,
+                                              uint8_t *in_buf,
+                                              const size_t in_size,
+                                              uint8_t *out_buf,
+                                              const size_t out_size)
+{
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, (size_t)crop->width * crop->height * 4 > out_size);
+    struct jpeg_decompress_struct *cinfo = &decoder->region;
+
+    if (!decoder->region_valid)
+    {
+        cinfo->err = jpeg_std_error(&decoder->region_error.pub);
+        decoder->region_error.pub.error_exit = UVCJpegErrorExit;
+        decoder->region_error.pub.output_message = UVCJpegOutputMessage;
+        jpeg_create_decompress(cinfo);
+        decoder->region_valid = true;
+    }
+
+    // Errors raised by libjpeg below land here, already logged
+    if (setjmp(decoder->region_error.jump) != 0)
+    {
+        jpeg_abort_decompress(cinfo);
+        return ZSA_RESULT_FAILED;
+    }
+
+    jpeg_mem_src(cinfo, in_buf, (unsigned long)in_size);
+    (void)jpeg_read_header(cinfo, TRUE);
+    cinfo->out_color_space = JCS_EXT_BGRA;
+    cinfo->scale_num = 1;
+    cinfo->scale_denom = scaleDenominator;
+    cinfo->dct_method = JDCT_IFAST;
+    // Fancy upsampling is kept on, skipping rows with the merged upsampler is not reliable in this libjpeg-turbo
+    (void)jpeg_start_decompress(cinfo);
+
+    if (cinfo->output_width < crop->x + crop->width || cinfo->output_height < crop->y + crop->height)
+    {
+        LOG_ERROR("MJPEG frame of %u x %u is smaller than the color crop", cinfo->output_width, cinfo->output_height);
+        jpeg_abort_decompress(cinfo);
+        return ZSA_RESULT_FAILED;
+    }
+
+    // Only the iMCU columns covering the region are decoded, the region is widened to their boundaries
+    JDIMENSION x = crop->x;
+    JDIMENSION width = crop->width;
+    jpeg_crop_scanline(cinfo, &x, &width);
+    size_t row_offset = (size_t)(crop->x - x) * 4;
+    size_t row_size = (size_t)crop->width * 4;
+    bool direct = x == crop->x && width == crop->width;
+
+    if (!direct)
+    {
+        decoder->region_row.resize((size_t)cinfo->output_width * 4);
+    }
+
+    if (crop->y != 0 && jpeg_skip_scanlines(cinfo, crop->y) != crop->y)
+    {
+        LOG_ERROR("MJPEG frame ended before row %u", crop->y);
+        jpeg_abort_decompress(cinfo);
+        return ZSA_RESULT_FAILED;
+    }
+
+    for (uint32_t y = 0; y < crop->height; y++)
+    {
+        JSAMPROW row = direct ? out_buf + y * row_size : decoder->region_row.data();
+        if (jpeg_read_scanlines(cinfo, &row, 1) != 1)
+        {
+            LOG_ERROR("MJPEG frame ended before row %u", crop->y + y);
+            jpeg_abort_decompress(cinfo);
+            return ZSA_RESULT_FAILED;
+        }
+
+        if (!direct)
+        {
+            memcpy(out_buf + y * row_size, row + row_offset, row_size);
+        }
+    }
+
+    // The rows below the region are never decoded
+    jpeg_abort_decompress(cinfo);
+    return ZSA_RESULT_SUCCEEDED;
+}
+
+// Decodes a width x height MJPEG frame as set by decode
+static zsa_result_t DecodeMJPEGtoBGRA32(uvc_mjpeg_decoder_t *decoder,
+                                        const capture_color_decoder_t *decode,
+                                        const uint32_t width,
+                                        const uint32_t height,
+                                        uint8_t *in_buf,
+                                        const size_t in_size,
+                                        uint8_t *out_buf,
+                                        const size_t out_size)
+{
+    uint32_t decodedWidth = 0;
+    uint32_t decodedHeight = 0;
+    bool cropped = false;
+
+    if (ZSA_FAILED(GetDecodedSize(decode, width, height, &decodedWidth, &decodedHeight, &cropped)))
+    {
+        return ZSA_RESULT_FAILED;
+    }
+
+    if (cropped)
+    {
+        return DecodeMJPEGRegionToBGRA32(
+            decoder, GetScaleDenominator(decode->scale), &decode->crop, in_buf, in_size, out_buf, out_size);
+    }
+
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, (size_t)decodedWidth * decodedHeight * 4 > out_size);
+
+    if (decoder->handle == nullptr)
+    {
+        decoder->handle = tjInitDecompress();
+        if (decoder->handle == nullptr)
+        {
+            LOG_ERROR("MJPEG decoder initialization failed\n", 0);
+            return ZSA_RESULT_FAILED;
+        }
+    }
+
+    int decompressStatus = tjDecompress2(decoder->handle,
+                                         in_buf,
+                                         (unsigned long)in_size,
+                                         out_buf,
+                                         (int)decodedWidth, // Scaled down by the decoder when smaller
+                                         0,                 // pitch
+                                         (int)decodedHeight,
+                                         TJPF_BGRA,
+                                         TJFLAG_FASTDCT | TJFLAG_FASTUPSAMPLE);
+
+    if (decompressStatus != 0)
+    {
+        LOG_ERROR("MJPEG decode failed: %d", decompressStatus);
+        return ZSA_RESULT_FAILED;
+    }
+
+    return ZSA_RESULT_SUCCEEDED;
+}
+
+// Decoder kept by a thread for as long as it runs
+typedef struct _uvc_mjpeg_thread_decoder_t
+{
+    uvc_mjpeg_decoder_t decoder;
+
+    ~_uvc_mjpeg_thread_decoder_t()
+    {
+        DestroyMJPEGDecoder(&decoder);
+    }
+} uvc_mjpeg_thread_decoder_t;
+
+// capture_decode_cb_t decoding the MJPEG color image of a capture on the thread requesting it
+static zsa_result_t DecodeColorImage(zsa_image_t source, const capture_color_decoder_t *decode, zsa_image_t *decoded)
+{
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, image_get_format(source) != ZSA_IMAGE_FORMAT_COLOR_MJPG);
+    uint32_t width = (uint32_t)image_get_width_pixels(source);
+    uint32_t height = (uint32_t)image_get_height_pixels(source);
+    uint32_t decodedWidth = 0;
+    uint32_t decodedHeight = 0;
+    uint8_t *buffer = nullptr;
+    size_t bufferSize = 0;
+
+    // Captures are decoded on any thread and may outlive the reader, so each thread keeps a decoder of its own
+    static thread_local uvc_mjpeg_thread_decoder_t threadDecoder;
+
+    zsa_result_t result = GetDecodedSize(decode, width, height, &decodedWidth, &decodedHeight, nullptr);
+    if (ZSA_SUCCEEDED(result))
+    {
+        bufferSize = (size_t)decodedWidth * decodedHeight * 4;
+        buffer = allocator_alloc(ALLOCATION_SOURCE_COLOR, bufferSize);
+        result = ZSA_RESULT_FROM_BOOL(buffer != NULL);
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        result = DecodeMJPEGtoBGRA32(&threadDecoder.decoder,
+                                     decode,
+                                     width,
+                                     height,
+                                     image_get_buffer(source),
+                                     image_get_size(source),
+                                     buffer,
+                                     bufferSize);
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        result = TRACE_CALL(image_create_from_buffer(ZSA_IMAGE_FORMAT_COLOR_BGRA32,
+                                                     (int)decodedWidth,
+                                                     (int)decodedHeight,
+                                                     (int)decodedWidth * 4,
+                                                     buffer,
+                                                     bufferSize,
+                                                     uvc_camerareader_free_allocation,
+                                                     nullptr,
+                                                     decoded));
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        image_set_system_timestamp_nsec(*decoded, image_get_system_timestamp_nsec(source));
+        image_set_device_timestamp_usec(*decoded, image_get_device_timestamp_usec(source));
+        image_set_exposure_usec(*decoded, image_get_exposure_usec(source));
+        image_set_iso_speed(*decoded, image_get_iso_speed(source));
+        image_set_white_balance(*decoded, image_get_white_balance(source));
+    }
+    else if (buffer)
+    {
+        allocator_free(buffer);
+    }
+
+    return result;
+}
+
 UVCCameraReader::UVCCameraReader() {}
 
 UVCCameraReader::~UVCCameraReader()
@@ -71,6 +393,120 @@ zsa_result_t UVCCameraReader::Init(const char *serialNumber)
     return ZSA_RESULT_SUCCEEDED;
 }
 
+zsa_result_t UVCCameraReader::GetDeviceCount(uint32_t *pDeviceCount)
+{
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, pDeviceCount == NULL);
+    *pDeviceCount = 0;
+
+    uvc_context_t *pContext = nullptr;
+    uvc_error_t res = uvc_init(&pContext, NULL);
+    if (res < 0)
+    {
+        LOG_ERROR("Failed to initialize libuvc: %s", uvc_strerror(res));
+        return ZSA_RESULT_FAILED;
+    }
+
+    uvc_device_t **ppList = nullptr;
+    res = uvc_get_device_list(pContext, &ppList);
+    if (res < 0)
+    {
+        LOG_ERROR("Failed to list UVC devices: %s", uvc_strerror(res));
+        uvc_exit(pContext);
+        return ZSA_RESULT_FAILED;
+    }
+
+    for (int i = 0; ppList[i] != nullptr; i++)
+    {
+        uvc_device_descriptor_t *pDescriptor = nullptr;
+        if (uvc_get_device_descriptor(ppList[i], &pDescriptor) == UVC_SUCCESS)
+        {
+            if (pDescriptor->idVendor == COLOR_CAMERA_VID && pDescriptor->idProduct == COLOR_CAMERA_PID)
+            {
+                (*pDeviceCount)++;
+            }
+            uvc_free_device_descriptor(pDescriptor);
+        }
+    }
+
+    uvc_free_device_list(ppList, 1);
+    uvc_exit(pContext);
+    return ZSA_RESULT_SUCCEEDED;
+}
+
+// Native format streamed by the camera for a ZSA image format
+static uvc_frame_format GetUVCFrameFormat(const zsa_image_format_t imageFormat)
+{
+    switch (imageFormat)
+    {
+    case ZSA_IMAGE_FORMAT_COLOR_MJPG:
+    case ZSA_IMAGE_FORMAT_COLOR_BGRA32: // Decoded from MJPEG on the host
+        return UVC_COLOR_FORMAT_MJPEG;
+    case ZSA_IMAGE_FORMAT_COLOR_NV12:
+        return UVC_COLOR_FORMAT_NV12;
+    case ZSA_IMAGE_FORMAT_COLOR_YUY2:
+        return UVC_COLOR_FORMAT_YUYV;
+    default:
+        return UVC_FRAME_FORMAT_UNKNOWN;
+    }
+}
+
+zsa_result_t UVCCameraReader::NegotiateStreamControl(const uvc_frame_format frameFormat,
+                                                     const uint32_t width,
+                                                     const uint32_t height,
+                                                     const float fps)
+{
+    if (m_ctrl_valid && m_ctrl_format == frameFormat && m_ctrl_width == width && m_ctrl_height == height &&
+        m_ctrl_fps == (int)fps)
+    {
+        return ZSA_RESULT_SUCCEEDED;
+    }
+
+    m_ctrl_valid = false;
+    uvc_error_t res =
+        uvc_get_stream_ctrl_format_size(m_pDeviceHandle, &m_ctrl, frameFormat, (int)width, (int)height, (int)fps);
+
+    if (res < 0)
+    {
+        LOG_ERROR("Failed to get stream control for resolution (%d, %d) - %d fps - format (%d): %s",
+                  width,
+                  height,
+                  (int)fps,
+                  frameFormat,
+                  uvc_strerror(res));
+        return ZSA_RESULT_FAILED;
+    }
+
+    m_ctrl_valid = true;
+    m_ctrl_format = frameFormat;
+    m_ctrl_width = width;
+    m_ctrl_height = height;
+    m_ctrl_fps = (int)fps;
+    return ZSA_RESULT_SUCCEEDED;
+}
+
+zsa_result_t UVCCameraReader::Prepare(const uint32_t width,
+                                      const uint32_t height,
+                                      const float fps,
+                                      const zsa_image_format_t imageFormat)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!IsInitialized())
+    {
+        LOG_ERROR("Camera reader is not initialized", 0);
+        return ZSA_RESULT_FAILED;
+    }
+
+    uvc_frame_format frameFormat = GetUVCFrameFormat(imageFormat);
+    if (frameFormat == UVC_FRAME_FORMAT_UNKNOWN)
+    {
+        LOG_ERROR("Unsupported format %d", imageFormat);
+        return ZSA_RESULT_FAILED;
+    }
+
+    return NegotiateStreamControl(frameFormat, width, height, fps);
+}
+
 zsa_result_t UVCCameraReader::Start(const uint32_t width,
                                     const uint32_t height,
                                     const float fps,
@@ -94,54 +530,51 @@ zsa_result_t UVCCameraReader::Start(const uint32_t width,
         return ZSA_RESULT_FAILED;
     }
 
-    uvc_stream_ctrl_t ctrl;
-    uvc_frame_format frameFormat = UVC_FRAME_FORMAT_UNKNOWN;
-    switch (imageFormat)
+    uvc_frame_format frameFormat = GetUVCFrameFormat(imageFormat);
+    if (frameFormat == UVC_FRAME_FORMAT_UNKNOWN)
     {
-    case ZSA_IMAGE_FORMAT_COLOR_MJPG:
-        m_output_image_format = imageFormat;
-        m_input_image_format = imageFormat;
-
-        frameFormat = UVC_COLOR_FORMAT_MJPEG;
-        break;
-    case ZSA_IMAGE_FORMAT_COLOR_NV12:
-        m_output_image_format = imageFormat;
-        m_input_image_format = imageFormat;
-
-        frameFormat = UVC_COLOR_FORMAT_NV12;
-        break;
-    case ZSA_IMAGE_FORMAT_COLOR_YUY2:
-        m_output_image_format = imageFormat;
-        m_input_image_format = imageFormat;
-
-        frameFormat = UVC_COLOR_FORMAT_YUYV;
-        break;
-    case ZSA_IMAGE_FORMAT_COLOR_BGRA32:
-        m_output_image_format = imageFormat;
-        m_input_image_format = ZSA_IMAGE_FORMAT_COLOR_MJPG;
-
-        frameFormat = UVC_COLOR_FORMAT_MJPEG;
-        break;
-    default:
         LOG_ERROR("Unsupported format %d", imageFormat);
         return ZSA_RESULT_FAILED;
     }
 
+    m_output_image_format = imageFormat;
+    m_input_image_format = frameFormat == UVC_COLOR_FORMAT_MJPEG ? ZSA_IMAGE_FORMAT_COLOR_MJPG : imageFormat;
     m_width_pixels = width;
     m_height_pixels = height;
+    m_output_width_pixels = width;
+    m_output_height_pixels = height;
 
-    // Set frame format
-    uvc_error_t res =
-        uvc_get_stream_ctrl_format_size(m_pDeviceHandle, &ctrl, frameFormat, (int)width, (int)height, (int)fps);
+    if (m_decode_on_demand && m_input_image_format != ZSA_IMAGE_FORMAT_COLOR_MJPG)
+    {
+        LOG_ERROR("Decoding on demand requires the MJPEG format, not %d", imageFormat);
+        m_width_pixels = 0;
+        m_height_pixels = 0;
+        return ZSA_RESULT_FAILED;
+    }
 
-    if (res < 0)
+    bool decodeMJPEG = m_input_image_format == ZSA_IMAGE_FORMAT_COLOR_MJPG &&
+                       m_output_image_format == ZSA_IMAGE_FORMAT_COLOR_BGRA32;
+    if (decodeMJPEG || m_decode_on_demand)
+    {
+        uint32_t decodedWidth = 0;
+        uint32_t decodedHeight = 0;
+        if (ZSA_FAILED(GetDecodedSize(&m_decode, width, height, &decodedWidth, &decodedHeight, nullptr)))
+        {
+            m_width_pixels = 0;
+            m_height_pixels = 0;
+            return ZSA_RESULT_FAILED;
+        }
+
+        if (decodeMJPEG)
+        {
+            m_output_width_pixels = decodedWidth;
+            m_output_height_pixels = decodedHeight;
+        }
+    }
+
+    // Set frame format, already done when the stream was prepared or run in this mode before
+    if (ZSA_FAILED(NegotiateStreamControl(frameFormat, width, height, fps)))
     {
-        LOG_ERROR("Failed to get stream control for resolution (%d, %d) - %d fps - format (%d): %s",
-                  width,
-                  height,
-                  (int)fps,
-                  imageFormat,
-                  uvc_strerror(res));
         return ZSA_RESULT_FAILED;
     }
 
@@ -149,7 +582,7 @@ zsa_result_t UVCCameraReader::Start(const uint32_t width,
     m_pCallback = pCallback;
     m_pCallbackContext = pCallbackContext;
 
-    res = uvc_start_streaming(m_pDeviceHandle, &ctrl, UVCFrameCallback, this, 0);
+    uvc_error_t res = uvc_start_streaming(m_pDeviceHandle, &m_ctrl, UVCFrameCallback, this, 0);
     if (res < 0)
     {
         LOG_ERROR("Failed to start streaming: %s", uvc_strerror(res));
@@ -159,6 +592,7 @@ zsa_result_t UVCCameraReader::Start(const uint32_t width,
         m_height_pixels = 0;
         m_pCallback = nullptr;
         m_pCallbackContext = nullptr;
+        m_ctrl_valid = false;
 
         return ZSA_RESULT_FAILED;
     }
@@ -167,6 +601,31 @@ zsa_result_t UVCCameraReader::Start(const uint32_t width,
     return ZSA_RESULT_SUCCEEDED;
 }
 
+zsa_result_t
+UVCCameraReader::SetDecodeOptions(const zsa_color_scale_t scale, const zsa_color_crop_t *pCrop, bool decodeOnDemand)
+{
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, pCrop == NULL);
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_streaming)
+    {
+        LOG_ERROR("Decode options can not change while streaming", 0);
+        return ZSA_RESULT_FAILED;
+    }
+
+    if (GetScaleDenominator(scale) == 0)
+    {
+        LOG_ERROR("color_scale %d is invalid", scale);
+        return ZSA_RESULT_FAILED;
+    }
+
+    m_decode.decode_cb = DecodeColorImage;
+    m_decode.scale = scale;
+    m_decode.crop = *pCrop;
+    m_decode_on_demand = decodeOnDemand;
+    return ZSA_RESULT_SUCCEEDED;
+}
+
 void UVCCameraReader::Stop()
 {
     std::unique_lock<std::mutex> lock(m_mutex);
@@ -195,6 +654,8 @@ void UVCCameraReader::Shutdown()
     // Make sure stream is stopped
     Stop();
 
+    m_ctrl_valid = false;
+
     if (m_pDeviceHandle)
     {
         // Close UVC device handle
@@ -216,12 +677,8 @@ void UVCCameraReader::Shutdown()
         m_pContext = nullptr;
     }
 
-    if (m_decoder)
-    {
-        // Destroy MJPEG decoder
-        (void)tjDestroy(m_decoder);
-        m_decoder = nullptr;
-    }
+    // Destroy MJPEG decoder
+    DestroyMJPEGDecoder(&m_decoder);
 }
 
 zsa_result_t UVCCameraReader::GetCameraControlCapabilities(const zsa_color_control_command_t command,
@@ -1098,13 +1555,6 @@ zsa_result_t UVCCameraReader::SetCameraControl(const zsa_color_control_command_t
     return ZSA_RESULT_SUCCEEDED;
 }
 
-// Callback function for when image objects are destroyed
-static void uvc_camerareader_free_allocation(void *buffer, void *context)
-{
-    (void)context;
-    allocator_free(buffer);
-}
-
 void UVCCameraReader::Callback(uvc_frame_t *frame)
 {
     std::lock_guard<std::mutex> lock(m_mutex);
@@ -1181,11 +1631,30 @@ void UVCCameraReader::Callback(uvc_frame_t *frame)
             return;
         }
 
+        uint64_t ts = (uint64_t)frame->capture_time_finished.tv_sec * 1000000000;
+        ts += (uint64_t)frame->capture_time_finished.tv_nsec;
+
+        // Recorded before anything is allocated, so the metadata of frames dropped later on is still seen
+        zsa_color_frame_metadata_t frameMetadata = {};
+        frameMetadata.device_timestamp_usec = ZSA_90K_HZ_TICK_TO_USEC(framePTS);
+        frameMetadata.system_timestamp_nsec = ts;
+        frameMetadata.exposure_usec = exposure_time;
+        frameMetadata.iso_speed = iso_speed;
+        frameMetadata.white_balance = white_balance;
+        frameMetadata.size_bytes = frame->data_bytes;
+        color_frame_metadata_add(m_pCallbackContext, &frameMetadata);
+
+        if (color_in_standby(m_pCallbackContext))
+        {
+            // Neither copied nor decoded while nobody reads the captures
+            return;
+        }
+
         if (m_input_image_format == ZSA_IMAGE_FORMAT_COLOR_MJPG &&
             m_output_image_format == ZSA_IMAGE_FORMAT_COLOR_BGRA32)
         {
-            stride = (int)frame->width * 4;
-            buffer_size = (size_t)stride * frame->height;
+            stride = (int)m_output_width_pixels * 4;
+            buffer_size = (size_t)stride * m_output_height_pixels;
             decodeMJPEG = true;
         }
         else
@@ -1194,6 +1663,13 @@ void UVCCameraReader::Callback(uvc_frame_t *frame)
             buffer_size = frame->data_bytes;
         }
 
+        if (!allocator_within_budget(ALLOCATION_SOURCE_COLOR, buffer_size))
+        {
+            // Over the memory budget, dropped before it is copied or decoded
+            allocator_record_shed(ALLOCATION_SOURCE_COLOR);
+            return;
+        }
+
         // Allocate ZSA Color buffer
         buffer = allocator_alloc(ALLOCATION_SOURCE_COLOR, buffer_size);
         zsa_result_t result = ZSA_RESULT_FROM_BOOL(buffer != NULL);
@@ -1202,8 +1678,16 @@ void UVCCameraReader::Callback(uvc_frame_t *frame)
         {
             if (decodeMJPEG)
             {
-                // Decode MJPG into BRGA32
-                result = DecodeMJPEGtoBGRA32((uint8_t *)frame->data, frame->data_bytes, buffer, buffer_size);
+                // Decode MJPG into BRGA32. Corrupt frames are dropped here; decoding later, on first access, is left
+                // to color_decode_on_demand where a failed decode is reported to the caller.
+                result = DecodeMJPEGtoBGRA32(&m_decoder,
+                                             &m_decode,
+                                             m_width_pixels,
+                                             m_height_pixels,
+                                             (uint8_t *)frame->data,
+                                             frame->data_bytes,
+                                             buffer,
+                                             buffer_size);
             }
             else
             {
@@ -1217,8 +1701,8 @@ void UVCCameraReader::Callback(uvc_frame_t *frame)
             // The buffer size may be larger than the height * stride for some formats
             // so we must use image_create_from_buffer rather than image_create
             result = TRACE_CALL(image_create_from_buffer(m_output_image_format,
-                                                         (int)m_width_pixels,
-                                                         (int)m_height_pixels,
+                                                         (int)m_output_width_pixels,
+                                                         (int)m_output_height_pixels,
                                                          stride,
                                                          buffer,
                                                          buffer_size,
@@ -1226,7 +1710,7 @@ void UVCCameraReader::Callback(uvc_frame_t *frame)
                                                          context,
                                                          &image));
         }
-        else
+        else if (buffer)
         {
             // cleanup if there was an error
             allocator_free(buffer);
@@ -1241,16 +1725,18 @@ void UVCCameraReader::Callback(uvc_frame_t *frame)
         if (ZSA_SUCCEEDED(result))
         {
             // Set metadata
-            uint64_t ts = (uint64_t)frame->capture_time_finished.tv_sec * 1000000000;
-            ts += (uint64_t)frame->capture_time_finished.tv_nsec;
             image_set_system_timestamp_nsec(image, ts);
-            image_set_device_timestamp_usec(image, ZSA_90K_HZ_TICK_TO_USEC(framePTS));
+            image_set_device_timestamp_usec(image, frameMetadata.device_timestamp_usec);
             image_set_exposure_usec(image, exposure_time);
             image_set_iso_speed(image, iso_speed);
             image_set_white_balance(image, white_balance);
 
             // Set image
             capture_set_color_image(capture, image);
+            if (m_decode_on_demand)
+            {
+                capture_set_color_decoder(capture, &m_decode);
+            }
         }
 
         // Calback to color
@@ -1270,40 +1756,6 @@ void UVCCameraReader::Callback(uvc_frame_t *frame)
     }
 }
 
-zsa_result_t
-UVCCameraReader::DecodeMJPEGtoBGRA32(uint8_t *in_buf, const size_t in_size, uint8_t *out_buf, const size_t out_size)
-{
-    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, m_width_pixels * m_height_pixels * 4 > out_size);
-
-    if (m_decoder == nullptr)
-    {
-        m_decoder = tjInitDecompress();
-        if (m_decoder == nullptr)
-        {
-            LOG_ERROR("MJPEG decoder initialization failed\n", 0);
-            return ZSA_RESULT_FAILED;
-        }
-    }
-
-    int decompressStatus = tjDecompress2(m_decoder,
-                                         in_buf,
-                                         (unsigned long)in_size,
-                                         out_buf,
-                                         (int)m_width_pixels,
-                                         0, // pitch
-                                         (int)m_height_pixels,
-                                         TJPF_BGRA,
-                                         TJFLAG_FASTDCT | TJFLAG_FASTUPSAMPLE);
-
-    if (decompressStatus != 0)
-    {
-        LOG_ERROR("MJPEG decode failed: %d", decompressStatus);
-        return ZSA_RESULT_FAILED;
-    }
-
-    return ZSA_RESULT_SUCCEEDED;
-}
-
 // Returns exposure in 100us time base
 int32_t UVCCameraReader::MapK4aExposureToLinux(int32_t K4aExposure_usec)
 {
@@ -1327,6 +1779,11 @@ int32_t UVCCameraReader::MapK4aExposureToLinux(int32_t K4aExposure_usec)
     return MAX_EXPOSURE(m_using_60hz_power) / CONV_100USEC_TO_USEC;
 }
 
+int32_t UVCCameraReader::MapExposureToK4a(int32_t exposureUsec)
+{
+    return MapLinuxExposureToK4a(exposureUsec / CONV_100USEC_TO_USEC);
+}
+
 int32_t UVCCameraReader::MapLinuxExposureToK4a(int32_t LinuxExposure)
 {
     LinuxExposure *= CONV_100USEC_TO_USEC; // Convert Linux 100us units to us.
@@ -3,15 +3,39 @@
 // zsa
 #include <zsa/zsatypes.h>
 #include <zsainternal/color.h>
+#include <zsainternal/capture.h>
 
 #include "color_priv.h"
 
 // STL
 #include <mutex>
+#include <vector>
 
 // external
+#include <stdio.h>
+#include <setjmp.h>
 #include <libuvc/libuvc.h>
 #include "turbojpeg.h"
+#include "jpeglib.h"
+
+// libjpeg error manager reporting errors by jumping back into the decode call
+typedef struct _uvc_jpeg_error_t
+{
+    struct jpeg_error_mgr pub;
+    jmp_buf jump;
+} uvc_jpeg_error_t;
+
+// MJPEG decoder state, kept from frame to frame by its owner
+typedef struct _uvc_mjpeg_decoder_t
+{
+    tjhandle handle = nullptr;
+
+    // TurboJPEG can not skip rows or columns, cropped regions are decoded with the libjpeg API
+    struct jpeg_decompress_struct region;
+    uvc_jpeg_error_t region_error;
+    bool region_valid = false;
+    std::vector<uint8_t> region_row;
+} uvc_mjpeg_decoder_t;
 
 class UVCCameraReader
 {
@@ -21,6 +45,13 @@ public:
 
     zsa_result_t Init(const char *serialNumber);
 
+    static zsa_result_t GetDeviceCount(uint32_t *pDeviceCount);
+
+    zsa_result_t Prepare(const uint32_t width,
+                         const uint32_t height,
+                         const float fps,
+                         const zsa_image_format_t imageFormat);
+
     zsa_result_t Start(const uint32_t width,
                        const uint32_t height,
                        const float fps,
@@ -28,6 +59,8 @@ public:
                        color_cb_stream_t *pCallback,
                        void *pCallbackContext);
 
+    zsa_result_t SetDecodeOptions(const zsa_color_scale_t scale, const zsa_color_crop_t *pCrop, bool decodeOnDemand);
+
     void Stop();
 
     void Shutdown();
@@ -43,6 +76,9 @@ public:
                                   const zsa_color_control_mode_t mode,
                                   int32_t newValue);
 
+    // Exposure time in microseconds as GetCameraControl() reports it
+    int32_t MapExposureToK4a(int32_t exposureUsec);
+
     void Callback(uvc_frame_t *frame);
 
 private:
@@ -51,7 +87,10 @@ private:
         return m_pContext && m_pDevice && m_pDeviceHandle;
     }
 
-    zsa_result_t DecodeMJPEGtoBGRA32(uint8_t *in_buf, const size_t in_size, uint8_t *out_buf, const size_t out_size);
+    zsa_result_t NegotiateStreamControl(const uvc_frame_format frameFormat,
+                                        const uint32_t width,
+                                        const uint32_t height,
+                                        const float fps);
 
     int32_t MapK4aExposureToLinux(int32_t K4aExposure);
     int32_t MapLinuxExposureToK4a(int32_t LinuxExposure);
@@ -67,18 +106,34 @@ private:
     bool m_streaming = false;
     bool m_using_60hz_power = true;
 
+    // Stream control negotiated last, committed again as is while the requested mode does not change
+    uvc_stream_ctrl_t m_ctrl;
+    bool m_ctrl_valid = false;
+    uvc_frame_format m_ctrl_format = UVC_FRAME_FORMAT_UNKNOWN;
+    uint32_t m_ctrl_width = 0;
+    uint32_t m_ctrl_height = 0;
+    int m_ctrl_fps = 0;
+
     // Image format cache
     uint32_t m_width_pixels;
     uint32_t m_height_pixels;
     zsa_image_format_t m_input_image_format;
     zsa_image_format_t m_output_image_format;
 
+    // Size of the images produced, smaller than the stream when MJPEG is decoded scaled or cropped
+    uint32_t m_output_width_pixels = 0;
+    uint32_t m_output_height_pixels = 0;
+
+    // How MJPEG is decoded, by this reader or by captures on demand
+    capture_color_decoder_t m_decode = {};
+    bool m_decode_on_demand = false;
+
     // ZSA stream callback
     color_cb_stream_t *m_pCallback = nullptr;
     void *m_pCallbackContext = nullptr;
 
-    // MJPEG decoder
-    tjhandle m_decoder = nullptr;
+    // MJPEG decoder of the streaming thread
+    uvc_mjpeg_decoder_t m_decoder;
 };
 
 #endif // UVC_CAMERAREADER_H
@@ -108,6 +108,14 @@ zsa_buffer_result_t colormcu_get_usb_serialnum(colormcu_t colormcu_handle,
     return usb_cmd_get_serial_number(colormcu->usb_cmd, serial_number, serial_number_size);
 }
 
+const guid_t *colormcu_get_container_id(colormcu_t colormcu_handle)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(NULL, colormcu_t, colormcu_handle);
+    colormcu_context_t *colormcu = colormcu_t_get_context(colormcu_handle);
+
+    return usb_cmd_get_container_id(colormcu->usb_cmd);
+}
+
 /**
  *  Function to start the IMU stream.
  *
@@ -0,0 +1,599 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+// This library
+#include <zsainternal/flightrec.h>
+
+// Dependent libraries
+#include <zsainternal/capture.h>
+#include <zsainternal/common.h>
+#include <zsainternal/handle.h>
+#include <zsainternal/image.h>
+#include <zsainternal/logging.h>
+#include <zsainternal/queue.h>
+#include <azure_c_shared_utility/lock.h>
+#include <azure_c_shared_utility/threadapi.h>
+
+// System dependencies
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Captures a second the record index is sized for, IMU captures included
+#define FLIGHTREC_MAX_CAPTURES_PER_SECOND (120)
+
+#define FLIGHTREC_SUBSCRIBER_DEPTH (8)
+#define FLIGHTREC_POLL_INTERVAL_MS (100) // Retry period of a stopped subscriber, and of checking for a dump signal
+
+#define FLIGHTREC_PAD(size) (((size) + 7) & ~(size_t)7)
+
+// A capture in the ring, its bytes are contiguous
+typedef struct
+{
+    size_t offset;
+    size_t size;
+    uint64_t recorded_nsec;
+} flightrec_record_t;
+
+typedef struct _flightrec_context_t
+{
+    capturesync_t capturesync;
+    queue_t subscriber;
+    uint64_t duration_nsec;
+
+    uint8_t *ring;   // Capture records, each contiguous
+    size_t capacity; // Bytes of ring
+    size_t head;     // End of the newest record
+
+    LOCK_HANDLE lock; // Protects the index below, held by the dump while it copies a record out
+    flightrec_record_t *records;
+    uint32_t max_records;
+    uint32_t first;          // Index of the oldest record
+    uint32_t count;          // Records kept
+    uint64_t first_sequence; // Sequence of the oldest record
+    size_t largest_record;   // Bytes of the largest record kept
+
+    LOCK_HANDLE dump_lock; // Serializes dumps
+
+    volatile bool stop;
+    THREAD_HANDLE record_thread;
+    bool record_thread_started;
+
+    int dump_signal;
+    char *dump_path;
+    sig_atomic_t dump_requests_handled; // Of g_flightrec_dump_requests[dump_signal] when the last dump started
+#ifdef _WIN32
+    void (*previous_handler)(int);
+#else
+    struct sigaction previous_action;
+#endif
+    THREAD_HANDLE signal_thread;
+    bool signal_thread_started;
+} flightrec_context_t;
+
+ZSA_DECLARE_CONTEXT(flightrec_t, flightrec_context_t);
+
+// Counted by the signal handler per signal, the only thing it may safely do. A recorder only dumps on the signal it
+// handles, so recorders of different devices can be dumped one at a time.
+static volatile sig_atomic_t g_flightrec_dump_requests[NSIG];
+
+static void flightrec_signal_handler(int signal_number)
+{
+    if (signal_number > 0 && signal_number < NSIG)
+    {
+        g_flightrec_dump_requests[signal_number]++;
+    }
+}
+
+// Installs the dump handler, false if the signal can't be handled or another recorder handles it already
+static bool flightrec_install_handler(flightrec_context_t *recorder, int signal_number)
+{
+    recorder->dump_requests_handled = g_flightrec_dump_requests[signal_number];
+
+#ifdef _WIN32
+    void (*previous_handler)(int) = signal(signal_number, flightrec_signal_handler);
+    if (previous_handler == SIG_ERR || previous_handler == flightrec_signal_handler)
+    {
+        return false;
+    }
+    recorder->previous_handler = previous_handler;
+#else
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = flightrec_signal_handler;
+    // Streaming threads interrupted by the signal resume their system calls
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+
+    if (sigaction(signal_number, &action, &recorder->previous_action) != 0)
+    {
+        return false;
+    }
+    if (!(recorder->previous_action.sa_flags & SA_SIGINFO) &&
+        recorder->previous_action.sa_handler == flightrec_signal_handler)
+    {
+        // The handler installed by another recorder is left in place
+        return false;
+    }
+#endif
+
+    recorder->dump_signal = signal_number;
+    return true;
+}
+
+static void flightrec_restore_handler(flightrec_context_t *recorder)
+{
+#ifdef _WIN32
+    (void)signal(recorder->dump_signal, recorder->previous_handler);
+#else
+    (void)sigaction(recorder->dump_signal, &recorder->previous_action, NULL);
+#endif
+}
+
+// Drops the oldest record. Called with recorder->lock held.
+static void flightrec_evict_locked(flightrec_context_t *recorder)
+{
+    recorder->first = (recorder->first + 1) % recorder->max_records;
+    recorder->first_sequence++;
+    recorder->count--;
+    if (recorder->count == 0)
+    {
+        recorder->head = 0;
+        recorder->largest_record = 0;
+    }
+}
+
+// Finds free bytes for a record after the newest one, wrapping to the start of the ring. Called with recorder->lock
+// held.
+static bool flightrec_fits_locked(const flightrec_context_t *recorder, size_t size, size_t *offset)
+{
+    if (recorder->count == 0)
+    {
+        *offset = 0;
+        return size <= recorder->capacity;
+    }
+
+    size_t tail = recorder->records[recorder->first].offset;
+    size_t head = recorder->head;
+
+    if (head > tail)
+    {
+        // Records are in [tail, head)
+        if (size <= recorder->capacity - head)
+        {
+            *offset = head;
+            return true;
+        }
+        *offset = 0;
+        return size <= tail;
+    }
+
+    // Wrapped, records are in [tail, end) and [0, head)
+    *offset = head;
+    return size <= tail - head;
+}
+
+// Copies the images of a capture into the ring
+static void flightrec_record(flightrec_context_t *recorder, zsa_capture_t capture_handle)
+{
+    // IMU samples are held in the IR image of captures of their own, see capture_get_imu_image(), which capturesync
+    // never publishes. Reading both would write the IR image twice.
+    zsa_image_t images[FLIGHTREC_IMAGE_COUNT] = { capture_get_color_image(capture_handle),
+                                                  capture_get_depth_image(capture_handle),
+                                                  capture_get_ir_image(capture_handle),
+                                                  NULL };
+    uint8_t *buffers[FLIGHTREC_IMAGE_COUNT];
+    uint32_t image_count = 0;
+    size_t size = sizeof(flightrec_capture_header_t);
+
+    for (uint32_t type = 0; type < FLIGHTREC_IMAGE_COUNT; type++)
+    {
+        buffers[type] = images[type] ? image_get_buffer(images[type]) : NULL;
+        if (buffers[type])
+        {
+            image_count++;
+            size += sizeof(flightrec_image_header_t) + FLIGHTREC_PAD(image_get_size(images[type]));
+        }
+    }
+
+    uint64_t now_nsec = 0;
+    (void)image_get_system_time_nsec(&now_nsec);
+
+    size_t offset = 0;
+    bool fits = false;
+    uint64_t sequence = 0;
+
+    // A capture larger than the ring is dropped on its own rather than evicting every record for nothing
+    bool recordable = image_count > 0 && size <= recorder->capacity && size <= UINT32_MAX;
+
+    Lock(recorder->lock);
+    while (recorder->count > 0 &&
+           now_nsec - recorder->records[recorder->first].recorded_nsec > recorder->duration_nsec)
+    {
+        flightrec_evict_locked(recorder);
+    }
+    if (recordable)
+    {
+        if (recorder->count == recorder->max_records)
+        {
+            flightrec_evict_locked(recorder);
+        }
+        while (!(fits = flightrec_fits_locked(recorder, size, &offset)) && recorder->count > 0)
+        {
+            flightrec_evict_locked(recorder);
+        }
+    }
+    sequence = recorder->first_sequence + recorder->count;
+    Unlock(recorder->lock);
+
+    if (fits)
+    {
+        // The bytes are free, a dump only reads records added to the index
+        uint8_t *record = recorder->ring + offset;
+        flightrec_capture_header_t *header = (flightrec_capture_header_t *)record;
+        header->magic = FLIGHTREC_CAPTURE_MAGIC;
+        header->size_bytes = (uint32_t)size;
+        header->sequence = sequence;
+        header->recorded_nsec = now_nsec;
+        header->temperature_c = capture_get_temperature_c(capture_handle);
+        header->image_count = image_count;
+
+        flightrec_image_header_t *image_header = (flightrec_image_header_t *)(header + 1);
+        uint8_t *data = (uint8_t *)(image_header + image_count);
+        for (uint32_t type = 0; type < FLIGHTREC_IMAGE_COUNT; type++)
+        {
+            if (buffers[type] == NULL)
+            {
+                continue;
+            }
+
+            zsa_image_t image = images[type];
+            image_header->type = type;
+            image_header->format = (int32_t)image_get_format(image);
+            image_header->width_pixels = image_get_width_pixels(image);
+            image_header->height_pixels = image_get_height_pixels(image);
+            image_header->stride_bytes = image_get_stride_bytes(image);
+            image_header->white_balance = image_get_white_balance(image);
+            image_header->size_bytes = image_get_size(image);
+            image_header->device_timestamp_usec = image_get_device_timestamp_usec(image);
+            image_header->system_timestamp_nsec = image_get_system_timestamp_nsec(image);
+            image_header->exposure_usec = image_get_exposure_usec(image);
+            image_header->iso_speed = image_get_iso_speed(image);
+            image_header->reserved = 0;
+
+            // The padding is cleared so that no bytes of older records end up in a dump
+            size_t image_size = (size_t)image_header->size_bytes;
+            memcpy(data, buffers[type], image_size);
+            memset(data + image_size, 0, FLIGHTREC_PAD(image_size) - image_size);
+            data += FLIGHTREC_PAD(image_size);
+            image_header++;
+        }
+
+        Lock(recorder->lock);
+        flightrec_record_t *entry = &recorder->records[(recorder->first + recorder->count) % recorder->max_records];
+        entry->offset = offset;
+        entry->size = size;
+        entry->recorded_nsec = now_nsec;
+        recorder->count++;
+        recorder->head = offset + size;
+        recorder->largest_record = MAX(recorder->largest_record, size);
+        Unlock(recorder->lock);
+    }
+
+    for (uint32_t type = 0; type < FLIGHTREC_IMAGE_COUNT; type++)
+    {
+        if (images[type])
+        {
+            image_dec_ref(images[type]);
+        }
+    }
+}
+
+static int flightrec_record_thread(void *param)
+{
+    flightrec_context_t *recorder = (flightrec_context_t *)param;
+
+    while (!recorder->stop)
+    {
+        zsa_capture_t captures[FLIGHTREC_SUBSCRIBER_DEPTH];
+        uint32_t count = 0;
+
+        // Checked without waiting first, a disabled queue fails queue_pop with an error logged
+        zsa_wait_result_t result = queue_pop_batch(recorder->subscriber, captures, COUNTOF(captures), &count);
+        if (result == ZSA_WAIT_RESULT_TIMEOUT)
+        {
+            result = queue_pop(recorder->subscriber, FLIGHTREC_POLL_INTERVAL_MS, &captures[0]);
+            count = result == ZSA_WAIT_RESULT_SUCCEEDED ? 1 : 0;
+        }
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            flightrec_record(recorder, captures[i]);
+            capture_dec_ref(captures[i]);
+        }
+
+        if (result == ZSA_WAIT_RESULT_FAILED)
+        {
+            // The cameras are stopped
+            ThreadAPI_Sleep(FLIGHTREC_POLL_INTERVAL_MS);
+        }
+    }
+
+    ThreadAPI_Exit(0);
+    return 0;
+}
+
+static zsa_result_t flightrec_dump_context(flightrec_context_t *recorder, const char *path)
+{
+    flightrec_file_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, FLIGHTREC_FILE_MAGIC, sizeof(FLIGHTREC_FILE_MAGIC));
+    header.version = FLIGHTREC_FILE_VERSION;
+    header.header_size = sizeof(flightrec_file_header_t);
+    header.capture_header_size = sizeof(flightrec_capture_header_t);
+    header.image_header_size = sizeof(flightrec_image_header_t);
+    header.duration_ms = recorder->duration_nsec / 1000000;
+
+    Lock(recorder->dump_lock);
+
+    // Records added after this point are left out
+    Lock(recorder->lock);
+    uint64_t next_sequence = recorder->first_sequence;
+    uint64_t end_sequence = recorder->first_sequence + recorder->count;
+    size_t scratch_size = recorder->largest_record;
+    Unlock(recorder->lock);
+
+    uint8_t *scratch = scratch_size ? (uint8_t *)malloc(scratch_size) : NULL;
+    FILE *file = fopen(path, "wb");
+    zsa_result_t result = ZSA_RESULT_FROM_BOOL(file != NULL && (scratch != NULL || scratch_size == 0));
+    if (ZSA_FAILED(result))
+    {
+        LOG_ERROR("Failed to create flight recorder file %s", path);
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        // Written again once the records are counted
+        result = ZSA_RESULT_FROM_BOOL(fwrite(&header, sizeof(header), 1, file) == 1);
+    }
+
+    for (; ZSA_SUCCEEDED(result) && next_sequence < end_sequence; next_sequence++)
+    {
+        // Only copied while the lock is held, so recording waits for memcpy and never for the file
+        flightrec_record_t record = { 0, 0, 0 };
+        Lock(recorder->lock);
+        if (next_sequence >= recorder->first_sequence)
+        {
+            uint32_t index = (uint32_t)((recorder->first + (next_sequence - recorder->first_sequence)) %
+                                        recorder->max_records);
+            record = recorder->records[index];
+            memcpy(scratch, recorder->ring + record.offset, record.size);
+        }
+        Unlock(recorder->lock);
+
+        if (record.size == 0)
+        {
+            header.lost_count++;
+            continue;
+        }
+
+        result = ZSA_RESULT_FROM_BOOL(fwrite(scratch, record.size, 1, file) == 1);
+        if (header.capture_count == 0)
+        {
+            header.first_recorded_nsec = record.recorded_nsec;
+        }
+        header.last_recorded_nsec = record.recorded_nsec;
+        header.capture_count++;
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        result = ZSA_RESULT_FROM_BOOL(fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1);
+    }
+
+    if (file != NULL)
+    {
+        if (fclose(file) != 0)
+        {
+            result = ZSA_RESULT_FAILED;
+        }
+        if (ZSA_FAILED(result))
+        {
+            LOG_ERROR("Failed to write flight recorder file %s", path);
+        }
+    }
+    free(scratch);
+
+    Unlock(recorder->dump_lock);
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        LOG_INFO("Flight recorder wrote %d captures to %s", header.capture_count, path);
+    }
+    return result;
+}
+
+static int flightrec_signal_thread(void *param)
+{
+    flightrec_context_t *recorder = (flightrec_context_t *)param;
+    uint32_t dump_count = 0;
+
+    while (!recorder->stop)
+    {
+        ThreadAPI_Sleep(FLIGHTREC_POLL_INTERVAL_MS);
+
+        sig_atomic_t requested = g_flightrec_dump_requests[recorder->dump_signal];
+        if (requested == recorder->dump_requests_handled)
+        {
+            continue;
+        }
+        recorder->dump_requests_handled = requested;
+
+        // The time tells dumps of different runs apart, the counter dumps within a second
+        char path[1024];
+        int written = snprintf(path,
+                               sizeof(path),
+                               "%s-%lld-%u",
+                               recorder->dump_path,
+                               (long long)time(NULL),
+                               ++dump_count);
+        if (written < 0 || (size_t)written >= sizeof(path))
+        {
+            LOG_ERROR("Flight recorder dump path %s is too long", recorder->dump_path);
+            continue;
+        }
+        (void)flightrec_dump_context(recorder, path);
+    }
+
+    ThreadAPI_Exit(0);
+    return 0;
+}
+
+zsa_result_t flightrec_create(capturesync_t capturesync_handle,
+                              const zsa_flight_recorder_configuration_t *config,
+                              flightrec_t *flightrec_handle)
+{
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, capturesync_handle == NULL);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, flightrec_handle == NULL);
+
+    zsa_flight_recorder_configuration_t default_config = ZSA_FLIGHT_RECORDER_CONFIG_INIT_DEFAULT;
+    if (config == NULL)
+    {
+        config = &default_config;
+    }
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, config->duration_ms == 0);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, config->memory_bytes < sizeof(flightrec_capture_header_t));
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, config->dump_signal < 0 || config->dump_signal >= NSIG);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, config->dump_signal != 0 && config->dump_path == NULL);
+
+    flightrec_context_t *recorder = flightrec_t_create(flightrec_handle);
+    zsa_result_t result = ZSA_RESULT_FROM_BOOL(recorder != NULL);
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        recorder->capturesync = capturesync_handle;
+        recorder->duration_nsec = (uint64_t)config->duration_ms * 1000000;
+        recorder->capacity = config->memory_bytes;
+        recorder->max_records = (uint32_t)((uint64_t)config->duration_ms * FLIGHTREC_MAX_CAPTURES_PER_SECOND / 1000 +
+                                           1);
+        recorder->lock = Lock_Init();
+        recorder->dump_lock = Lock_Init();
+        result = ZSA_RESULT_FROM_BOOL(recorder->lock != NULL && recorder->dump_lock != NULL);
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        recorder->ring = (uint8_t *)malloc(recorder->capacity);
+        recorder->records = (flightrec_record_t *)calloc(recorder->max_records, sizeof(flightrec_record_t));
+        if (recorder->ring == NULL || recorder->records == NULL)
+        {
+            LOG_ERROR("Failed to allocate %zu bytes for the flight recorder", recorder->capacity);
+            result = ZSA_RESULT_FAILED;
+        }
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        // Committed now rather than on the first lap of the ring
+        memset(recorder->ring, 0, recorder->capacity);
+
+        result = TRACE_CALL(capturesync_subscribe(capturesync_handle,
+                                                  FLIGHTREC_SUBSCRIBER_DEPTH,
+                                                  QUEUE_OVERFLOW_DROP_OLDEST,
+                                                  0,
+                                                  &recorder->subscriber));
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        result = ZSA_RESULT_FROM_BOOL(ThreadAPI_Create(&recorder->record_thread, flightrec_record_thread, recorder) ==
+                                      THREADAPI_OK);
+        recorder->record_thread_started = ZSA_SUCCEEDED(result);
+    }
+
+    if (ZSA_SUCCEEDED(result) && config->dump_signal != 0)
+    {
+        size_t length = strlen(config->dump_path) + 1;
+        recorder->dump_path = (char *)malloc(length);
+        result = ZSA_RESULT_FROM_BOOL(recorder->dump_path != NULL);
+        if (ZSA_SUCCEEDED(result))
+        {
+            memcpy(recorder->dump_path, config->dump_path, length);
+        }
+    }
+
+    if (ZSA_SUCCEEDED(result) && config->dump_signal != 0 && !flightrec_install_handler(recorder, config->dump_signal))
+    {
+        LOG_ERROR("Flight recorder can't handle signal %d", config->dump_signal);
+        result = ZSA_RESULT_FAILED;
+    }
+
+    if (ZSA_SUCCEEDED(result) && recorder->dump_signal != 0)
+    {
+        result = ZSA_RESULT_FROM_BOOL(ThreadAPI_Create(&recorder->signal_thread, flightrec_signal_thread, recorder) ==
+                                      THREADAPI_OK);
+        recorder->signal_thread_started = ZSA_SUCCEEDED(result);
+    }
+
+    if (ZSA_FAILED(result) && recorder != NULL)
+    {
+        flightrec_destroy(*flightrec_handle);
+        *flightrec_handle = NULL;
+    }
+
+    return result;
+}
+
+void flightrec_destroy(flightrec_t flightrec_handle)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(VOID_VALUE, flightrec_t, flightrec_handle);
+    flightrec_context_t *recorder = flightrec_t_get_context(flightrec_handle);
+
+    if (recorder->dump_signal != 0)
+    {
+        flightrec_restore_handler(recorder);
+    }
+
+    recorder->stop = true;
+    int thread_result;
+    if (recorder->signal_thread_started)
+    {
+        (void)ThreadAPI_Join(recorder->signal_thread, &thread_result);
+    }
+    if (recorder->record_thread_started)
+    {
+        (void)ThreadAPI_Join(recorder->record_thread, &thread_result);
+    }
+
+    if (recorder->subscriber)
+    {
+        capturesync_unsubscribe(recorder->capturesync, recorder->subscriber);
+    }
+
+    free(recorder->dump_path);
+    free(recorder->records);
+    free(recorder->ring);
+
+    if (recorder->dump_lock)
+    {
+        Lock_Deinit(recorder->dump_lock);
+    }
+    if (recorder->lock)
+    {
+        Lock_Deinit(recorder->lock);
+    }
+
+    flightrec_t_destroy(flightrec_handle);
+}
+
+zsa_result_t flightrec_dump(flightrec_t flightrec_handle, const char *path)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_RESULT_FAILED, flightrec_t, flightrec_handle);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, path == NULL);
+    flightrec_context_t *recorder = flightrec_t_get_context(flightrec_handle);
+
+    return flightrec_dump_context(recorder, path);
+}
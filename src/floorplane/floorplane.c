@@ -0,0 +1,524 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+// This library
+#include <zsainternal/floorplane.h>
+
+// Dependent libraries
+#include <zsainternal/common.h>
+#include <zsainternal/handle.h>
+#include <zsainternal/image.h>
+#include <zsainternal/logging.h>
+#include <zsainternal/math.h>
+#include <zsainternal/threadpool.h>
+
+// System dependencies
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Fewer sampled points than this cannot support a floor
+#define FLOORPLANE_MIN_SAMPLES (16)
+
+// Inverse iterations used to refine the normal of a plane hypothesis
+#define FLOORPLANE_REFINE_ITERATIONS (4)
+
+// Height map rows merged per task
+#define FLOORPLANE_MERGE_ROWS_PER_TASK (32)
+
+#define FLOORPLANE_PI (3.14159265358979f)
+
+typedef struct _floorplane_context_t
+{
+    threadpool_t pool;
+
+    float *samples; // xyz of the points used to search for the floor
+    size_t samples_capacity;
+
+    float *partial_maps; // One height map per task, merged into the output image
+    size_t partial_maps_capacity;
+
+    bool have_previous; // previous_normal and previous_offset hold the floor of the last frame
+    float previous_normal[3];
+    float previous_offset;
+
+    uint32_t random_state; // xorshift32 state used to pick hypotheses
+} floorplane_context_t;
+
+ZSA_DECLARE_CONTEXT(floorplane_t, floorplane_context_t);
+
+typedef struct _floorplane_job_t
+{
+    floorplane_context_t *context;
+    const pointcloud_input_t *input;
+    const floorplane_config_t *config;
+    float normal[3];
+    float offset;
+    float right[3];   // Height map column direction, on the floor
+    float forward[3]; // Height map row direction, on the floor
+    uint32_t task_count;
+    float *output;
+} floorplane_job_t;
+
+static inline bool floorplane_read_point(const pointcloud_input_t *input, int row, int col, float point[3])
+{
+    const uint8_t *src = input->data + (size_t)row * (size_t)input->stride_bytes;
+    if (input->point_type == POINTCLOUD_POINT_INT16_MM)
+    {
+        const int16_t *xyz = (const int16_t *)src + col * 3;
+        point[0] = xyz[0];
+        point[1] = xyz[1];
+        point[2] = xyz[2];
+    }
+    else
+    {
+        const float *xyz = (const float *)src + col * 3;
+        point[0] = xyz[0];
+        point[1] = xyz[1];
+        point[2] = xyz[2];
+    }
+    return point[2] != 0;
+}
+
+static uint32_t floorplane_random(floorplane_context_t *context)
+{
+    uint32_t x = context->random_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    context->random_state = x;
+    return x;
+}
+
+static size_t floorplane_count_inliers(const float *samples,
+                                       size_t sample_count,
+                                       const float normal[3],
+                                       float offset,
+                                       float threshold)
+{
+    size_t inliers = 0;
+    for (size_t i = 0; i < sample_count; i++)
+    {
+        inliers += fabsf(math_dot_3(normal, samples + i * 3) + offset) <= threshold;
+    }
+    return inliers;
+}
+
+// Least squares plane through the inliers of normal/offset, found by inverse iteration on their covariance starting
+// from the current normal. Returns false if there were too few inliers.
+static bool floorplane_refine(const float *samples,
+                              size_t sample_count,
+                              float threshold,
+                              float normal[3],
+                              float *offset)
+{
+    double sum[3] = { 0, 0, 0 };
+    double products[6] = { 0, 0, 0, 0, 0, 0 };
+    size_t count = 0;
+
+    for (size_t i = 0; i < sample_count; i++)
+    {
+        const float *p = samples + i * 3;
+        if (fabsf(math_dot_3(normal, p) + *offset) > threshold)
+        {
+            continue;
+        }
+
+        sum[0] += p[0];
+        sum[1] += p[1];
+        sum[2] += p[2];
+        products[0] += (double)p[0] * p[0];
+        products[1] += (double)p[0] * p[1];
+        products[2] += (double)p[0] * p[2];
+        products[3] += (double)p[1] * p[1];
+        products[4] += (double)p[1] * p[2];
+        products[5] += (double)p[2] * p[2];
+        count++;
+    }
+
+    if (count < 3)
+    {
+        return false;
+    }
+
+    const float centroid[3] = { (float)(sum[0] / count), (float)(sum[1] / count), (float)(sum[2] / count) };
+    float covariance[3 * 3];
+    covariance[0] = (float)(products[0] / count - centroid[0] * (double)centroid[0]);
+    covariance[1] = (float)(products[1] / count - centroid[0] * (double)centroid[1]);
+    covariance[2] = (float)(products[2] / count - centroid[0] * (double)centroid[2]);
+    covariance[4] = (float)(products[3] / count - centroid[1] * (double)centroid[1]);
+    covariance[5] = (float)(products[4] / count - centroid[1] * (double)centroid[2]);
+    covariance[8] = (float)(products[5] / count - centroid[2] * (double)centroid[2]);
+    covariance[3] = covariance[1];
+    covariance[6] = covariance[2];
+    covariance[7] = covariance[5];
+
+    // A small shift keeps the covariance of a perfectly flat floor invertible
+    const float shift = 1e-6f * (covariance[0] + covariance[4] + covariance[8]) + 1e-6f;
+    covariance[0] += shift;
+    covariance[4] += shift;
+    covariance[8] += shift;
+
+    float inverse[3 * 3];
+    if (math_invert_3x3(covariance, inverse))
+    {
+        for (int i = 0; i < FLOORPLANE_REFINE_ITERATIONS; i++)
+        {
+            float next[3];
+            math_mult_Ax_3x3(inverse, normal, next);
+            if (math_normalize_3(next, next) == 0)
+            {
+                break;
+            }
+            if (math_dot_3(next, normal) < 0)
+            {
+                math_negate_3(next, next);
+            }
+            memcpy(normal, next, sizeof(next));
+        }
+    }
+
+    *offset = -math_dot_3(normal, centroid);
+    return true;
+}
+
+// Plane through three samples, oriented along up. Returns false if the samples are collinear or the plane is tilted
+// further than the configuration allows.
+static bool floorplane_hypothesis(const float *a,
+                                  const float *b,
+                                  const float *c,
+                                  const float up[3],
+                                  float min_cos_tilt,
+                                  float normal[3],
+                                  float *offset)
+{
+    float ab[3], ac[3];
+    math_scale_3(a, -1, ab);
+    math_add_3(b, ab, ab);
+    math_scale_3(a, -1, ac);
+    math_add_3(c, ac, ac);
+
+    math_cross_3(ab, ac, normal);
+    if (math_normalize_3(normal, normal) == 0)
+    {
+        return false;
+    }
+
+    float cos_tilt = math_dot_3(normal, up);
+    if (cos_tilt < 0)
+    {
+        math_negate_3(normal, normal);
+        cos_tilt = -cos_tilt;
+    }
+    if (cos_tilt < min_cos_tilt)
+    {
+        return false;
+    }
+
+    *offset = -math_dot_3(normal, a);
+    return true;
+}
+
+// Projects one band of input rows into this task's partial height map
+static void floorplane_height_map_task(void *context, uint32_t task_index)
+{
+    floorplane_job_t *job = (floorplane_job_t *)context;
+    const pointcloud_input_t *input = job->input;
+    const floorplane_config_t *config = job->config;
+    const int cells = config->grid_width_cells * config->grid_depth_cells;
+    const float inverse_cell_size = 1 / config->cell_size_mm;
+    float *map = job->context->partial_maps + (size_t)task_index * (size_t)cells;
+    const int first_row = (int)(((int64_t)input->height_pixels * task_index) / job->task_count);
+    const int last_row = (int)(((int64_t)input->height_pixels * (task_index + 1)) / job->task_count);
+
+    for (int i = 0; i < cells; i++)
+    {
+        map[i] = -INFINITY;
+    }
+
+    for (int row = first_row; row < last_row; row++)
+    {
+        for (int col = 0; col < input->width_pixels; col++)
+        {
+            float point[3];
+            if (!floorplane_read_point(input, row, col, point))
+            {
+                continue;
+            }
+
+            const float height = math_dot_3(job->normal, point) + job->offset;
+            if (height > config->max_height_mm)
+            {
+                continue;
+            }
+
+            const int x = (int)floorf(math_dot_3(job->right, point) * inverse_cell_size) + config->grid_width_cells / 2;
+            const int y = (int)floorf(math_dot_3(job->forward, point) * inverse_cell_size);
+            if (x < 0 || x >= config->grid_width_cells || y < 0 || y >= config->grid_depth_cells)
+            {
+                continue;
+            }
+
+            float *cell = &map[y * config->grid_width_cells + x];
+            *cell = MAX(*cell, height);
+        }
+    }
+}
+
+// Merges one band of height map rows from all partial maps into the output image
+static void floorplane_merge_task(void *context, uint32_t task_index)
+{
+    floorplane_job_t *job = (floorplane_job_t *)context;
+    const int width = job->config->grid_width_cells;
+    const size_t cells = (size_t)width * (size_t)job->config->grid_depth_cells;
+    const int first_row = (int)task_index * FLOORPLANE_MERGE_ROWS_PER_TASK;
+    const int last_row = MIN(first_row + FLOORPLANE_MERGE_ROWS_PER_TASK, job->config->grid_depth_cells);
+
+    for (size_t i = (size_t)first_row * (size_t)width; i < (size_t)last_row * (size_t)width; i++)
+    {
+        float height = -INFINITY;
+        for (uint32_t map = 0; map < job->task_count; map++)
+        {
+            height = MAX(height, job->context->partial_maps[map * cells + i]);
+        }
+        job->output[i] = height == -INFINITY ? NAN : height;
+    }
+}
+
+// Unit vector along axis with its component along normal removed
+static void floorplane_project_axis(const float normal[3], const float axis[3], float out[3])
+{
+    memcpy(out, axis, 3 * sizeof(float));
+    math_add_scaled_3(normal, -math_dot_3(normal, axis), out);
+    (void)math_normalize_3(out, out);
+}
+
+zsa_result_t floorplane_create(uint32_t worker_count, floorplane_t *floorplane_handle)
+{
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, floorplane_handle == NULL);
+
+    floorplane_context_t *floorplane = floorplane_t_create(floorplane_handle);
+    zsa_result_t result = ZSA_RESULT_FROM_BOOL(floorplane != NULL);
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        floorplane->random_state = 0x2545F491;
+        result = TRACE_CALL(threadpool_create(worker_count, &floorplane->pool));
+    }
+
+    if (ZSA_FAILED(result) && floorplane != NULL)
+    {
+        floorplane_destroy(*floorplane_handle);
+        *floorplane_handle = NULL;
+    }
+
+    return result;
+}
+
+void floorplane_destroy(floorplane_t floorplane_handle)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(VOID_VALUE, floorplane_t, floorplane_handle);
+    floorplane_context_t *floorplane = floorplane_t_get_context(floorplane_handle);
+
+    if (floorplane->pool)
+    {
+        threadpool_destroy(floorplane->pool);
+    }
+
+    free(floorplane->samples);
+    free(floorplane->partial_maps);
+
+    floorplane_t_destroy(floorplane_handle);
+}
+
+void floorplane_reset(floorplane_t floorplane_handle)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(VOID_VALUE, floorplane_t, floorplane_handle);
+    floorplane_context_t *floorplane = floorplane_t_get_context(floorplane_handle);
+
+    floorplane->have_previous = false;
+}
+
+zsa_result_t floorplane_process(floorplane_t floorplane_handle,
+                                const pointcloud_input_t *input,
+                                const floorplane_config_t *config,
+                                floorplane_result_t *plane,
+                                zsa_image_t *height_map)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_RESULT_FAILED, floorplane_t, floorplane_handle);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, input == NULL || input->data == NULL);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, input->width_pixels <= 0 || input->height_pixels <= 0);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED,
+                        input->point_type != POINTCLOUD_POINT_INT16_MM &&
+                            input->point_type != POINTCLOUD_POINT_FLOAT32_MM);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED,
+                        (size_t)input->stride_bytes <
+                            (size_t)input->width_pixels * 3 *
+                                (input->point_type == POINTCLOUD_POINT_INT16_MM ? sizeof(int16_t) : sizeof(float)));
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, config == NULL);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, config->inlier_threshold_mm <= 0 || config->sample_stride <= 0);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, config->ransac_iterations < 0);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED,
+                        height_map != NULL && (config->cell_size_mm <= 0 || config->grid_width_cells <= 0 ||
+                                               config->grid_depth_cells <= 0));
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, plane == NULL);
+
+    floorplane_context_t *floorplane = floorplane_t_get_context(floorplane_handle);
+    memset(plane, 0, sizeof(*plane));
+    if (height_map)
+    {
+        *height_map = NULL;
+    }
+
+    float up[3];
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, math_normalize_3(config->up_hint.v, up) == 0);
+    const float min_cos_tilt = cosf(config->max_tilt_degrees * FLOORPLANE_PI / 180);
+
+    // Gather the sampled points
+    const int stride = config->sample_stride;
+    const size_t max_samples = (size_t)((input->height_pixels + stride - 1) / stride) *
+                               (size_t)((input->width_pixels + stride - 1) / stride);
+    if (max_samples > floorplane->samples_capacity)
+    {
+        float *grown = (float *)realloc(floorplane->samples, max_samples * 3 * sizeof(float));
+        if (grown == NULL)
+        {
+            LOG_ERROR("Failed to allocate %zu floor samples", max_samples);
+            return ZSA_RESULT_FAILED;
+        }
+        floorplane->samples = grown;
+        floorplane->samples_capacity = max_samples;
+    }
+
+    size_t sample_count = 0;
+    for (int row = stride / 2; row < input->height_pixels; row += stride)
+    {
+        for (int col = stride / 2; col < input->width_pixels; col += stride)
+        {
+            sample_count += floorplane_read_point(input, row, col, floorplane->samples + sample_count * 3);
+        }
+    }
+
+    if (sample_count < FLOORPLANE_MIN_SAMPLES)
+    {
+        floorplane->have_previous = false;
+        return ZSA_RESULT_SUCCEEDED;
+    }
+
+    const float *samples = floorplane->samples;
+    const float threshold = config->inlier_threshold_mm;
+    float normal[3] = { 0, 0, 0 };
+    float offset = 0;
+    size_t inliers = 0;
+
+    // Reuse the previous floor while it still explains enough of the scene
+    if (floorplane->have_previous)
+    {
+        memcpy(normal, floorplane->previous_normal, sizeof(normal));
+        offset = floorplane->previous_offset;
+        inliers = floorplane_count_inliers(samples, sample_count, normal, offset, threshold);
+        plane->seeded = inliers >= config->min_inlier_ratio * sample_count;
+    }
+
+    if (!plane->seeded)
+    {
+        for (int i = 0; i < config->ransac_iterations; i++)
+        {
+            const float *a = samples + (floorplane_random(floorplane) % sample_count) * 3;
+            const float *b = samples + (floorplane_random(floorplane) % sample_count) * 3;
+            const float *c = samples + (floorplane_random(floorplane) % sample_count) * 3;
+
+            float candidate_normal[3];
+            float candidate_offset;
+            if (!floorplane_hypothesis(a, b, c, up, min_cos_tilt, candidate_normal, &candidate_offset))
+            {
+                continue;
+            }
+
+            size_t candidate_inliers = floorplane_count_inliers(samples,
+                                                                sample_count,
+                                                                candidate_normal,
+                                                                candidate_offset,
+                                                                threshold);
+            if (candidate_inliers > inliers)
+            {
+                memcpy(normal, candidate_normal, sizeof(normal));
+                offset = candidate_offset;
+                inliers = candidate_inliers;
+            }
+        }
+    }
+
+    if (inliers < 3 || !floorplane_refine(samples, sample_count, threshold, normal, &offset) ||
+        math_dot_3(normal, up) < min_cos_tilt)
+    {
+        floorplane->have_previous = false;
+        return ZSA_RESULT_SUCCEEDED;
+    }
+
+    floorplane->have_previous = true;
+    memcpy(floorplane->previous_normal, normal, sizeof(normal));
+    floorplane->previous_offset = offset;
+
+    plane->valid = true;
+    memcpy(plane->normal.v, normal, sizeof(normal));
+    plane->offset_mm = offset;
+    plane->inlier_ratio = (float)floorplane_count_inliers(samples, sample_count, normal, offset, threshold) /
+                          (float)sample_count;
+
+    if (height_map == NULL)
+    {
+        return ZSA_RESULT_SUCCEEDED;
+    }
+
+    // Project every point onto the floor. Rows follow the optical axis and columns the sensor's x axis.
+    floorplane_job_t job = { 0 };
+    job.context = floorplane;
+    job.input = input;
+    job.config = config;
+    memcpy(job.normal, normal, sizeof(normal));
+    job.offset = offset;
+    job.task_count = threadpool_get_thread_count(floorplane->pool);
+
+    const float optical_axis[3] = { 0, 0, 1 };
+    const float x_axis[3] = { 1, 0, 0 };
+    floorplane_project_axis(normal, optical_axis, job.forward);
+    floorplane_project_axis(normal, x_axis, job.right);
+    math_add_scaled_3(job.forward, -math_dot_3(job.forward, job.right), job.right);
+    (void)math_normalize_3(job.right, job.right);
+
+    const size_t cells = (size_t)config->grid_width_cells * (size_t)config->grid_depth_cells;
+    if (cells * job.task_count > floorplane->partial_maps_capacity)
+    {
+        float *grown = (float *)realloc(floorplane->partial_maps, cells * job.task_count * sizeof(float));
+        if (grown == NULL)
+        {
+            LOG_ERROR("Failed to allocate %zu height map cells", cells * job.task_count);
+            return ZSA_RESULT_FAILED;
+        }
+        floorplane->partial_maps = grown;
+        floorplane->partial_maps_capacity = cells * job.task_count;
+    }
+
+    zsa_image_t image = NULL;
+    zsa_result_t result = TRACE_CALL(image_create(ZSA_IMAGE_FORMAT_CUSTOM,
+                                                  config->grid_width_cells,
+                                                  config->grid_depth_cells,
+                                                  config->grid_width_cells * (int)sizeof(float),
+                                                  ALLOCATION_SOURCE_DEPTH,
+                                                  &image));
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        job.output = (float *)image_get_buffer(image);
+        threadpool_run(floorplane->pool, job.task_count, floorplane_height_map_task, &job);
+        threadpool_run(floorplane->pool,
+                       (uint32_t)((config->grid_depth_cells + FLOORPLANE_MERGE_ROWS_PER_TASK - 1) /
+                                  FLOORPLANE_MERGE_ROWS_PER_TASK),
+                       floorplane_merge_task,
+                       &job);
+        *height_map = image;
+    }
+
+    return result;
+}
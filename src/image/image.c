@@ -455,10 +455,9 @@ void image_set_system_timestamp_nsec(zsa_image_t image_handle, uint64_t timestam
     image->sys_timestamp_nsec = timestamp_nsec;
 }
 
-zsa_result_t image_apply_system_timestamp(zsa_image_t image_handle)
+zsa_result_t image_get_system_time_nsec(uint64_t *timestamp_nsec)
 {
-    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_RESULT_FAILED, zsa_image_t, image_handle);
-    image_context_t *image = zsa_image_t_get_context(image_handle);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, timestamp_nsec == NULL);
     zsa_result_t result;
 
 #ifdef _WIN32
@@ -473,8 +472,8 @@ zsa_result_t image_apply_system_timestamp(zsa_image_t image_handle)
     {
         // Calculate seconds in such a way we minimize overflow.
         // Rollover happens, for a 1MHz Freq, when qpc.QuadPart > 0x003F FFFF FFFF FFFF; ~571 Years after boot.
-        image->sys_timestamp_nsec = qpc.QuadPart / freq.QuadPart * 1000000000;
-        image->sys_timestamp_nsec += qpc.QuadPart % freq.QuadPart * 1000000000 / freq.QuadPart;
+        *timestamp_nsec = qpc.QuadPart / freq.QuadPart * 1000000000;
+        *timestamp_nsec += qpc.QuadPart % freq.QuadPart * 1000000000 / freq.QuadPart;
     }
 #else
     struct timespec ts_time;
@@ -482,13 +481,21 @@ zsa_result_t image_apply_system_timestamp(zsa_image_t image_handle)
     if (ZSA_SUCCEEDED(result))
     {
         // Rollover happens about ~136 years after boot.
-        image->sys_timestamp_nsec = (uint64_t)ts_time.tv_sec * 1000000000 + (uint64_t)ts_time.tv_nsec;
+        *timestamp_nsec = (uint64_t)ts_time.tv_sec * 1000000000 + (uint64_t)ts_time.tv_nsec;
     }
 #endif
 
     return result;
 }
 
+zsa_result_t image_apply_system_timestamp(zsa_image_t image_handle)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_RESULT_FAILED, zsa_image_t, image_handle);
+    image_context_t *image = zsa_image_t_get_context(image_handle);
+
+    return image_get_system_time_nsec(&image->sys_timestamp_nsec);
+}
+
 void image_set_exposure_usec(zsa_image_t image_handle, uint64_t exposure_usec)
 {
     RETURN_VALUE_IF_HANDLE_INVALID(VOID_VALUE, zsa_image_t, image_handle);
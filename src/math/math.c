@@ -5,6 +5,9 @@
 // This library
 #include <zsainternal/math.h>
 
+// System dependencies
+#include <math.h>
+
 void math_transpose_3x3(const float in[3 * 3], float out[3 * 3])
 {
     for (int i = 0; i < 3; ++i)
@@ -54,6 +57,26 @@ float math_dot_3(const float a[3], const float b[3])
     return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
 }
 
+void math_cross_3(const float a[3], const float b[3], float out[3])
+{
+    const float x = a[1] * b[2] - a[2] * b[1];
+    const float y = a[2] * b[0] - a[0] * b[2];
+    const float z = a[0] * b[1] - a[1] * b[0];
+    out[0] = x;
+    out[1] = y;
+    out[2] = z;
+}
+
+float math_normalize_3(const float in[3], float out[3])
+{
+    const float length = sqrtf(math_dot_3(in, in));
+    if (length > 0)
+    {
+        math_scale_3(in, 1 / length, out);
+    }
+    return length;
+}
+
 void math_mult_Ax_3x3(const float A[3 * 3], const float x[3], float out[3])
 {
     const float y0 = math_dot_3(A, x);
@@ -79,6 +102,32 @@ void math_mult_AB_3x3x3(const float A[3 * 3], const float B[3 * 3], float out[3
     math_mult_Atx_3x3(B, A + 6, out + 6);
 }
 
+int math_invert_3x3(const float A[3 * 3], float out[3 * 3])
+{
+    float adjugate[3 * 3];
+    adjugate[0] = A[4] * A[8] - A[5] * A[7];
+    adjugate[1] = A[2] * A[7] - A[1] * A[8];
+    adjugate[2] = A[1] * A[5] - A[2] * A[4];
+    adjugate[3] = A[5] * A[6] - A[3] * A[8];
+    adjugate[4] = A[0] * A[8] - A[2] * A[6];
+    adjugate[5] = A[2] * A[3] - A[0] * A[5];
+    adjugate[6] = A[3] * A[7] - A[4] * A[6];
+    adjugate[7] = A[1] * A[6] - A[0] * A[7];
+    adjugate[8] = A[0] * A[4] - A[1] * A[3];
+
+    const float determinant = A[0] * adjugate[0] + A[1] * adjugate[3] + A[2] * adjugate[6];
+    if (determinant == 0)
+    {
+        return 0;
+    }
+
+    for (int i = 0; i < 3 * 3; ++i)
+    {
+        out[i] = adjugate[i] / determinant;
+    }
+    return 1;
+}
+
 float math_eval_poly_3(float x, const float coef[4])
 {
     return coef[0] + x * (coef[1] + x * (coef[2] + x * coef[3]));
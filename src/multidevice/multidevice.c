@@ -0,0 +1,388 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+// This library
+#include <zsainternal/multidevice.h>
+
+// Dependent libraries
+#include <zsainternal/capture.h>
+#include <zsainternal/image.h>
+#include <zsainternal/logging.h>
+#include <zsainternal/common.h>
+#include <azure_c_shared_utility/lock.h>
+#include <azure_c_shared_utility/condition.h>
+#include <azure_c_shared_utility/threadapi.h>
+
+// System dependencies
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+// Captures held per device while waiting for the rest of the chain. A few frame periods cover the USB latency
+// differences between devices; anything older can no longer be matched.
+#define MULTIDEVICE_PENDING_CAPTURES (8)
+
+typedef struct _pending_capture_t
+{
+    zsa_capture_t capture;
+    uint64_t ts; // Device timestamp in us, moved onto the master's timeline
+} pending_capture_t;
+
+typedef struct _pending_t
+{
+    pending_capture_t entries[MULTIDEVICE_PENDING_CAPTURES];
+    uint32_t read_location;
+    uint32_t count;
+} pending_t;
+
+typedef struct _capture_set_t
+{
+    zsa_capture_t captures[MULTIDEVICE_MAX_DEVICES];
+} capture_set_t;
+
+typedef struct _multidevice_context_t
+{
+    multidevice_config_t config;
+    pending_t pending[MULTIDEVICE_MAX_DEVICES];
+
+    capture_set_t *sets;    // Ring of sets ready for the reader
+    uint32_t sets_depth;    // config.queue_depth
+    uint32_t sets_read;     // Oldest ready set
+    uint32_t sets_count;    // Ready sets
+    uint32_t dropped_count; // Captures and sets dropped since the last read, for the log
+
+    bool running;
+    uint32_t waiters; // Threads blocked in multidevice_get_capture_set()
+    LOCK_HANDLE lock;
+    COND_HANDLE condition;
+} multidevice_context_t;
+
+ZSA_DECLARE_CONTEXT(multidevice_t, multidevice_context_t);
+
+static void release_set(const multidevice_context_t *multidevice, capture_set_t *set)
+{
+    for (uint32_t i = 0; i < multidevice->config.device_count; i++)
+    {
+        if (set->captures[i])
+        {
+            capture_dec_ref(set->captures[i]);
+            set->captures[i] = NULL;
+        }
+    }
+}
+
+static pending_capture_t *pending_at(pending_t *pending, uint32_t offset)
+{
+    return &pending->entries[(pending->read_location + offset) % MULTIDEVICE_PENDING_CAPTURES];
+}
+
+static zsa_capture_t pending_pop(pending_t *pending)
+{
+    zsa_capture_t capture = pending_at(pending, 0)->capture;
+    pending->read_location = (pending->read_location + 1) % MULTIDEVICE_PENDING_CAPTURES;
+    pending->count--;
+    return capture;
+}
+
+static void pending_drop(multidevice_context_t *multidevice, pending_t *pending)
+{
+    capture_dec_ref(pending_pop(pending));
+    multidevice->dropped_count++;
+}
+
+static void publish_set_locked(multidevice_context_t *multidevice, const capture_set_t *set)
+{
+    if (multidevice->sets_count == multidevice->sets_depth)
+    {
+        // The reader has fallen behind, drop the oldest set
+        release_set(multidevice, &multidevice->sets[multidevice->sets_read]);
+        multidevice->sets_read = (multidevice->sets_read + 1) % multidevice->sets_depth;
+        multidevice->sets_count--;
+        multidevice->dropped_count++;
+    }
+
+    uint32_t write_location = (multidevice->sets_read + multidevice->sets_count) % multidevice->sets_depth;
+    multidevice->sets[write_location] = *set;
+    multidevice->sets_count++;
+    Condition_Post(multidevice->condition);
+}
+
+// Builds capture sets around the oldest master capture for as long as the captures held allow a decision. A master
+// capture is settled once every subordinate either holds a capture at or past its timestamp, or has fallen two frame
+// periods behind the master, which means the subordinate missed that pulse.
+static void match_captures_locked(multidevice_context_t *multidevice)
+{
+    const multidevice_config_t *config = &multidevice->config;
+    pending_t *master = &multidevice->pending[config->master_index];
+    uint64_t tolerance = config->frame_period_usec / 4;
+
+    while (master->count > 0)
+    {
+        uint64_t ts = pending_at(master, 0)->ts;
+        uint64_t newest_ts = pending_at(master, master->count - 1)->ts;
+        capture_set_t set = { { 0 } };
+        bool complete = true;
+        bool waiting = false;
+
+        for (uint32_t i = 0; i < config->device_count; i++)
+        {
+            pending_t *pending = &multidevice->pending[i];
+            if (i == config->master_index)
+            {
+                continue;
+            }
+
+            // Captures older than the oldest master capture can not be matched by it or any later one
+            while (pending->count > 0 && pending_at(pending, 0)->ts + tolerance < ts)
+            {
+                pending_drop(multidevice, pending);
+            }
+
+            if (pending->count == 0)
+            {
+                waiting = true;
+                complete = false;
+            }
+            else if (pending_at(pending, 0)->ts > ts + tolerance)
+            {
+                // This subordinate's next capture belongs to a later pulse
+                complete = false;
+            }
+        }
+
+        if (waiting && newest_ts < ts + 2 * (uint64_t)config->frame_period_usec)
+        {
+            return;
+        }
+
+        if (!complete && config->synchronized_sets_only)
+        {
+            pending_drop(multidevice, master);
+            continue;
+        }
+
+        for (uint32_t i = 0; i < config->device_count; i++)
+        {
+            pending_t *pending = &multidevice->pending[i];
+            if (i == config->master_index || (pending->count > 0 && pending_at(pending, 0)->ts <= ts + tolerance))
+            {
+                set.captures[i] = pending_pop(pending);
+            }
+        }
+        publish_set_locked(multidevice, &set);
+    }
+}
+
+zsa_result_t multidevice_create(const multidevice_config_t *config, multidevice_t *multidevice_handle)
+{
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, config == NULL);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, multidevice_handle == NULL);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, config->device_count == 0);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, config->device_count > MULTIDEVICE_MAX_DEVICES);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, config->master_index >= config->device_count);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, config->frame_period_usec == 0);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, config->queue_depth == 0);
+
+    multidevice_context_t *multidevice = multidevice_t_create(multidevice_handle);
+    zsa_result_t result = ZSA_RESULT_FROM_BOOL(multidevice != NULL);
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        multidevice->config = *config;
+        multidevice->config.subordinate_delay_off_master_usec[config->master_index] = 0;
+        multidevice->sets_depth = config->queue_depth;
+        multidevice->sets = (capture_set_t *)calloc(config->queue_depth, sizeof(capture_set_t));
+        result = ZSA_RESULT_FROM_BOOL(multidevice->sets != NULL);
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        result = ZSA_RESULT_FROM_BOOL((multidevice->lock = Lock_Init()) != NULL);
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        result = ZSA_RESULT_FROM_BOOL((multidevice->condition = Condition_Init()) != NULL);
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        multidevice->running = true;
+    }
+    else if (multidevice)
+    {
+        multidevice_destroy(*multidevice_handle);
+        *multidevice_handle = NULL;
+    }
+
+    return result;
+}
+
+void multidevice_stop(multidevice_t multidevice_handle)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(VOID_VALUE, multidevice_t, multidevice_handle);
+    multidevice_context_t *multidevice = multidevice_t_get_context(multidevice_handle);
+
+    if (multidevice->lock == NULL)
+    {
+        return;
+    }
+
+    Lock(multidevice->lock);
+    multidevice->running = false;
+
+    while (multidevice->waiters != 0)
+    {
+        Condition_Post(multidevice->condition);
+        Unlock(multidevice->lock);
+        ThreadAPI_Sleep(25);
+        Lock(multidevice->lock);
+    }
+
+    for (uint32_t i = 0; i < multidevice->config.device_count; i++)
+    {
+        while (multidevice->pending[i].count > 0)
+        {
+            capture_dec_ref(pending_pop(&multidevice->pending[i]));
+        }
+    }
+
+    while (multidevice->sets_count > 0)
+    {
+        release_set(multidevice, &multidevice->sets[multidevice->sets_read]);
+        multidevice->sets_read = (multidevice->sets_read + 1) % multidevice->sets_depth;
+        multidevice->sets_count--;
+    }
+    Unlock(multidevice->lock);
+}
+
+void multidevice_destroy(multidevice_t multidevice_handle)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(VOID_VALUE, multidevice_t, multidevice_handle);
+    multidevice_context_t *multidevice = multidevice_t_get_context(multidevice_handle);
+
+    multidevice_stop(multidevice_handle);
+
+    if (multidevice->condition)
+    {
+        Condition_Deinit(multidevice->condition);
+    }
+
+    if (multidevice->lock)
+    {
+        Lock_Deinit(multidevice->lock);
+    }
+
+    free(multidevice->sets);
+    multidevice_t_destroy(multidevice_handle);
+}
+
+void multidevice_add_capture(multidevice_t multidevice_handle,
+                             uint32_t device_index,
+                             zsa_result_t result,
+                             zsa_capture_t capture_handle)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(VOID_VALUE, multidevice_t, multidevice_handle);
+    multidevice_context_t *multidevice = multidevice_t_get_context(multidevice_handle);
+    RETURN_VALUE_IF_ARG(VOID_VALUE, device_index >= multidevice->config.device_count);
+
+    if (ZSA_FAILED(result) || capture_handle == NULL)
+    {
+        LOG_WARNING("Device %d delivered a failed capture to the multi device aggregator", device_index);
+        return;
+    }
+
+    zsa_image_t image = capture_get_color_image(capture_handle);
+    if (image == NULL)
+    {
+        image = capture_get_depth_image(capture_handle);
+    }
+
+    if (image == NULL)
+    {
+        LOG_WARNING("Device %d delivered a capture without a color or depth image", device_index);
+        return;
+    }
+
+    uint64_t ts = image_get_device_timestamp_usec(image);
+    image_dec_ref(image);
+
+    // A subordinate is triggered its configured delay after the master's pulse, so its timestamps run that far ahead
+    uint32_t delay = multidevice->config.subordinate_delay_off_master_usec[device_index];
+    ts = ts <= delay ? 0 : ts - delay;
+
+    Lock(multidevice->lock);
+    if (multidevice->running)
+    {
+        pending_t *pending = &multidevice->pending[device_index];
+        if (pending->count == MULTIDEVICE_PENDING_CAPTURES)
+        {
+            pending_drop(multidevice, pending);
+        }
+
+        capture_inc_ref(capture_handle);
+        pending_capture_t *entry = pending_at(pending, pending->count);
+        entry->capture = capture_handle;
+        entry->ts = ts;
+        pending->count++;
+
+        match_captures_locked(multidevice);
+    }
+    Unlock(multidevice->lock);
+}
+
+zsa_wait_result_t multidevice_get_capture_set(multidevice_t multidevice_handle,
+                                              zsa_capture_t *capture_handles,
+                                              int32_t timeout_in_ms)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_WAIT_RESULT_FAILED, multidevice_t, multidevice_handle);
+    RETURN_VALUE_IF_ARG(ZSA_WAIT_RESULT_FAILED, capture_handles == NULL);
+    multidevice_context_t *multidevice = multidevice_t_get_context(multidevice_handle);
+    zsa_wait_result_t wresult = ZSA_WAIT_RESULT_SUCCEEDED;
+
+    Lock(multidevice->lock);
+
+    if (multidevice->running && multidevice->sets_count == 0 && timeout_in_ms != 0)
+    {
+        multidevice->waiters++;
+
+        // Anything less than 0 waits forever, which Condition_Wait spells as 0
+        COND_RESULT cond_result = Condition_Wait(multidevice->condition,
+                                                 multidevice->lock,
+                                                 timeout_in_ms < 0 ? 0 : timeout_in_ms);
+        if (cond_result == COND_ERROR)
+        {
+            wresult = ZSA_WAIT_RESULT_FAILED;
+        }
+
+        multidevice->waiters--;
+    }
+
+    if (!multidevice->running)
+    {
+        wresult = ZSA_WAIT_RESULT_FAILED;
+    }
+    else if (wresult == ZSA_WAIT_RESULT_SUCCEEDED && multidevice->sets_count == 0)
+    {
+        wresult = ZSA_WAIT_RESULT_TIMEOUT;
+    }
+
+    if (wresult == ZSA_WAIT_RESULT_SUCCEEDED)
+    {
+        capture_set_t *set = &multidevice->sets[multidevice->sets_read];
+        memcpy(capture_handles, set->captures, multidevice->config.device_count * sizeof(zsa_capture_t));
+        memset(set, 0, sizeof(*set));
+        multidevice->sets_read = (multidevice->sets_read + 1) % multidevice->sets_depth;
+        multidevice->sets_count--;
+    }
+
+    if (multidevice->dropped_count != 0)
+    {
+        LOG_INFO("Multi device aggregator dropped %d unmatched captures and sets.", multidevice->dropped_count);
+        multidevice->dropped_count = 0;
+    }
+
+    Unlock(multidevice->lock);
+
+    return wresult;
+}
@@ -0,0 +1,381 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+// This library
+#include <zsainternal/normals.h>
+
+// Dependent libraries
+#include <zsainternal/common.h>
+#include <zsainternal/handle.h>
+#include <zsainternal/image.h>
+#include <zsainternal/logging.h>
+#include <zsainternal/threadpool.h>
+
+// System dependencies
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NORMALS_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define NORMALS_NEON
+#endif
+
+// Rows handed to a worker per task
+#define NORMALS_ROWS_PER_TASK (16)
+
+// Integral image columns handed to a worker per task in the vertical pass
+#define NORMALS_COLUMNS_PER_TASK (128)
+
+// Largest supported smoothing window half width, in pixels
+#define NORMALS_MAX_WINDOW_RADIUS (32)
+
+// One integral image cell: running sums of x, y, z and the number of valid points. Doubles keep the sums of a whole
+// frame of millimeter values exact enough for the box differences.
+typedef struct _integral_cell_t
+{
+    double x;
+    double y;
+    double z;
+    double count;
+} integral_cell_t;
+
+typedef struct _normals_context_t
+{
+    threadpool_t pool;
+
+    integral_cell_t *integral; // (height + 1) x (width + 1), first row and column are zero
+    size_t integral_capacity;
+} normals_context_t;
+
+ZSA_DECLARE_CONTEXT(normals_t, normals_context_t);
+
+typedef struct _normals_job_t
+{
+    normals_context_t *context;
+    const pointcloud_input_t *input;
+    const normals_config_t *config;
+    uint8_t *output;
+    int output_stride_bytes;
+} normals_job_t;
+
+// Sum of the cells in the inclusive pixel box [top, bottom] x [left, right]. A cell is two pairs of doubles, (x, y)
+// and (z, count), so the SIMD paths do the four corner lookups two lanes at a time.
+static inline void normals_box_sum(const integral_cell_t *integral,
+                                   size_t integral_width,
+                                   int top,
+                                   int left,
+                                   int bottom,
+                                   int right,
+                                   integral_cell_t *sum)
+{
+    const integral_cell_t *a = &integral[(size_t)top * integral_width + (size_t)left];
+    const integral_cell_t *b = &integral[(size_t)top * integral_width + (size_t)right + 1];
+    const integral_cell_t *c = &integral[((size_t)bottom + 1) * integral_width + (size_t)left];
+    const integral_cell_t *d = &integral[((size_t)bottom + 1) * integral_width + (size_t)right + 1];
+
+#if defined(NORMALS_SSE2)
+    _mm_storeu_pd(&sum->x,
+                  _mm_add_pd(_mm_sub_pd(_mm_sub_pd(_mm_loadu_pd(&d->x), _mm_loadu_pd(&b->x)), _mm_loadu_pd(&c->x)),
+                             _mm_loadu_pd(&a->x)));
+    _mm_storeu_pd(&sum->z,
+                  _mm_add_pd(_mm_sub_pd(_mm_sub_pd(_mm_loadu_pd(&d->z), _mm_loadu_pd(&b->z)), _mm_loadu_pd(&c->z)),
+                             _mm_loadu_pd(&a->z)));
+#elif defined(NORMALS_NEON)
+    vst1q_f64(&sum->x, vaddq_f64(vsubq_f64(vsubq_f64(vld1q_f64(&d->x), vld1q_f64(&b->x)), vld1q_f64(&c->x)),
+                                 vld1q_f64(&a->x)));
+    vst1q_f64(&sum->z, vaddq_f64(vsubq_f64(vsubq_f64(vld1q_f64(&d->z), vld1q_f64(&b->z)), vld1q_f64(&c->z)),
+                                 vld1q_f64(&a->z)));
+#else
+    sum->x = d->x - b->x - c->x + a->x;
+    sum->y = d->y - b->y - c->y + a->y;
+    sum->z = d->z - b->z - c->z + a->z;
+    sum->count = d->count - b->count - c->count + a->count;
+#endif
+}
+
+// Difference of the mean points of two boxes, second minus first. The count of the result is not meaningful.
+static inline void normals_mean_difference(const integral_cell_t *first,
+                                           const integral_cell_t *second,
+                                           integral_cell_t *difference)
+{
+    const double first_scale = 1 / first->count;
+    const double second_scale = 1 / second->count;
+
+#if defined(NORMALS_SSE2)
+    const __m128d f = _mm_set1_pd(first_scale);
+    const __m128d s = _mm_set1_pd(second_scale);
+    _mm_storeu_pd(&difference->x,
+                  _mm_sub_pd(_mm_mul_pd(_mm_loadu_pd(&second->x), s), _mm_mul_pd(_mm_loadu_pd(&first->x), f)));
+    _mm_storeu_pd(&difference->z,
+                  _mm_sub_pd(_mm_mul_pd(_mm_loadu_pd(&second->z), s), _mm_mul_pd(_mm_loadu_pd(&first->z), f)));
+#elif defined(NORMALS_NEON)
+    vst1q_f64(&difference->x,
+              vsubq_f64(vmulq_n_f64(vld1q_f64(&second->x), second_scale),
+                        vmulq_n_f64(vld1q_f64(&first->x), first_scale)));
+    vst1q_f64(&difference->z,
+              vsubq_f64(vmulq_n_f64(vld1q_f64(&second->z), second_scale),
+                        vmulq_n_f64(vld1q_f64(&first->z), first_scale)));
+#else
+    difference->x = second->x * second_scale - first->x * first_scale;
+    difference->y = second->y * second_scale - first->y * first_scale;
+    difference->z = second->z * second_scale - first->z * first_scale;
+    difference->count = 0;
+#endif
+}
+
+// Horizontal pass: each integral row holds the running sum of its input row
+static void normals_integral_rows_task(void *context, uint32_t task_index)
+{
+    normals_job_t *job = (normals_job_t *)context;
+    const pointcloud_input_t *input = job->input;
+    const size_t integral_width = (size_t)input->width_pixels + 1;
+    const int first_row = (int)task_index * NORMALS_ROWS_PER_TASK;
+    const int last_row = MIN(first_row + NORMALS_ROWS_PER_TASK, input->height_pixels);
+
+    for (int row = first_row; row < last_row; row++)
+    {
+        const uint8_t *src = input->data + (size_t)row * (size_t)input->stride_bytes;
+        integral_cell_t *cell = &job->context->integral[((size_t)row + 1) * integral_width];
+        integral_cell_t sum = { 0, 0, 0, 0 };
+
+        *cell++ = sum;
+        for (int col = 0; col < input->width_pixels; col++, cell++)
+        {
+            float x, y, z;
+            if (input->point_type == POINTCLOUD_POINT_INT16_MM)
+            {
+                const int16_t *xyz = (const int16_t *)src + col * 3;
+                x = xyz[0];
+                y = xyz[1];
+                z = xyz[2];
+            }
+            else
+            {
+                const float *xyz = (const float *)src + col * 3;
+                x = xyz[0];
+                y = xyz[1];
+                z = xyz[2];
+            }
+
+            if (z != 0)
+            {
+                sum.x += x;
+                sum.y += y;
+                sum.z += z;
+                sum.count += 1;
+            }
+            *cell = sum;
+        }
+    }
+}
+
+// Vertical pass: accumulate rows downwards for one band of columns
+static void normals_integral_columns_task(void *context, uint32_t task_index)
+{
+    normals_job_t *job = (normals_job_t *)context;
+    const size_t integral_width = (size_t)job->input->width_pixels + 1;
+    const size_t first_col = (size_t)task_index * NORMALS_COLUMNS_PER_TASK;
+    const size_t last_col = MIN(first_col + NORMALS_COLUMNS_PER_TASK, integral_width);
+
+    for (int row = 2; row <= job->input->height_pixels; row++)
+    {
+        integral_cell_t *cell = &job->context->integral[(size_t)row * integral_width];
+        const integral_cell_t *above = cell - integral_width;
+        for (size_t col = first_col; col < last_col; col++)
+        {
+#if defined(NORMALS_SSE2)
+            _mm_storeu_pd(&cell[col].x, _mm_add_pd(_mm_loadu_pd(&cell[col].x), _mm_loadu_pd(&above[col].x)));
+            _mm_storeu_pd(&cell[col].z, _mm_add_pd(_mm_loadu_pd(&cell[col].z), _mm_loadu_pd(&above[col].z)));
+#elif defined(NORMALS_NEON)
+            vst1q_f64(&cell[col].x, vaddq_f64(vld1q_f64(&cell[col].x), vld1q_f64(&above[col].x)));
+            vst1q_f64(&cell[col].z, vaddq_f64(vld1q_f64(&cell[col].z), vld1q_f64(&above[col].z)));
+#else
+            cell[col].x += above[col].x;
+            cell[col].y += above[col].y;
+            cell[col].z += above[col].z;
+            cell[col].count += above[col].count;
+#endif
+        }
+    }
+}
+
+static void normals_estimate_task(void *context, uint32_t task_index)
+{
+    normals_job_t *job = (normals_job_t *)context;
+    const pointcloud_input_t *input = job->input;
+    const integral_cell_t *integral = job->context->integral;
+    const size_t integral_width = (size_t)input->width_pixels + 1;
+    const int r = job->config->window_radius;
+    const double min_count = (double)(r * (2 * r + 1)) / 2;
+    const double max_depth_change = job->config->max_depth_change_mm;
+    const int first_row = (int)task_index * NORMALS_ROWS_PER_TASK;
+    const int last_row = MIN(first_row + NORMALS_ROWS_PER_TASK, input->height_pixels);
+
+    for (int row = first_row; row < last_row; row++)
+    {
+        zsa_float3_t *normal = (zsa_float3_t *)(job->output + (size_t)row * (size_t)job->output_stride_bytes);
+        memset(normal, 0, (size_t)input->width_pixels * sizeof(zsa_float3_t));
+
+        if (row < r || row >= input->height_pixels - r)
+        {
+            continue;
+        }
+
+        const uint8_t *src = input->data + (size_t)row * (size_t)input->stride_bytes;
+        for (int col = r; col < input->width_pixels - r; col++)
+        {
+            const float center_z = input->point_type == POINTCLOUD_POINT_INT16_MM ?
+                                       ((const int16_t *)src)[col * 3 + 2] :
+                                       ((const float *)src)[col * 3 + 2];
+            if (center_z == 0)
+            {
+                continue;
+            }
+
+            integral_cell_t left, right, top, bottom;
+            normals_box_sum(integral, integral_width, row - r, col - r, row + r, col - 1, &left);
+            normals_box_sum(integral, integral_width, row - r, col + 1, row + r, col + r, &right);
+            normals_box_sum(integral, integral_width, row - r, col - r, row - 1, col + r, &top);
+            normals_box_sum(integral, integral_width, row + 1, col - r, row + r, col + r, &bottom);
+
+            if (left.count < min_count || right.count < min_count || top.count < min_count ||
+                bottom.count < min_count)
+            {
+                continue;
+            }
+
+            // Differences of the mean points on either side of the center pixel
+            integral_cell_t horizontal, vertical;
+            normals_mean_difference(&left, &right, &horizontal);
+            normals_mean_difference(&top, &bottom, &vertical);
+            const double hx = horizontal.x, hy = horizontal.y, hz = horizontal.z;
+            const double vx = vertical.x, vy = vertical.y, vz = vertical.z;
+
+            if (max_depth_change > 0 && (fabs(hz) > max_depth_change || fabs(vz) > max_depth_change))
+            {
+                continue;
+            }
+
+            double nx = hy * vz - hz * vy;
+            double ny = hz * vx - hx * vz;
+            double nz = hx * vy - hy * vx;
+            const double length = sqrt(nx * nx + ny * ny + nz * nz);
+            if (length == 0)
+            {
+                continue;
+            }
+
+            // Orient towards the sensor, which sits at the origin
+            const double mean_x = (left.x + right.x) / (left.count + right.count);
+            const double mean_y = (left.y + right.y) / (left.count + right.count);
+            const double mean_z = (left.z + right.z) / (left.count + right.count);
+            const double scale = (nx * mean_x + ny * mean_y + nz * mean_z) > 0 ? -1 / length : 1 / length;
+
+            normal[col].xyz.x = (float)(nx * scale);
+            normal[col].xyz.y = (float)(ny * scale);
+            normal[col].xyz.z = (float)(nz * scale);
+        }
+    }
+}
+
+zsa_result_t normals_create(uint32_t worker_count, normals_t *normals_handle)
+{
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, normals_handle == NULL);
+
+    normals_context_t *normals = normals_t_create(normals_handle);
+    zsa_result_t result = ZSA_RESULT_FROM_BOOL(normals != NULL);
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        result = TRACE_CALL(threadpool_create(worker_count, &normals->pool));
+    }
+
+    if (ZSA_FAILED(result) && normals != NULL)
+    {
+        normals_destroy(*normals_handle);
+        *normals_handle = NULL;
+    }
+
+    return result;
+}
+
+void normals_destroy(normals_t normals_handle)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(VOID_VALUE, normals_t, normals_handle);
+    normals_context_t *normals = normals_t_get_context(normals_handle);
+
+    if (normals->pool)
+    {
+        threadpool_destroy(normals->pool);
+    }
+
+    free(normals->integral);
+
+    normals_t_destroy(normals_handle);
+}
+
+zsa_result_t normals_compute(normals_t normals_handle,
+                             const pointcloud_input_t *input,
+                             const normals_config_t *config,
+                             zsa_image_t normal_image)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_RESULT_FAILED, normals_t, normals_handle);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, input == NULL || input->data == NULL);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, input->width_pixels <= 0 || input->height_pixels <= 0);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED,
+                        input->point_type != POINTCLOUD_POINT_INT16_MM &&
+                            input->point_type != POINTCLOUD_POINT_FLOAT32_MM);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED,
+                        (size_t)input->stride_bytes <
+                            (size_t)input->width_pixels * 3 *
+                                (input->point_type == POINTCLOUD_POINT_INT16_MM ? sizeof(int16_t) : sizeof(float)));
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, config == NULL);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED,
+                        config->window_radius < 1 || config->window_radius > NORMALS_MAX_WINDOW_RADIUS);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, normal_image == NULL);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, image_get_format(normal_image) != ZSA_IMAGE_FORMAT_CUSTOM);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED,
+                        image_get_width_pixels(normal_image) != input->width_pixels ||
+                            image_get_height_pixels(normal_image) != input->height_pixels);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED,
+                        (size_t)image_get_stride_bytes(normal_image) <
+                            (size_t)input->width_pixels * sizeof(zsa_float3_t));
+
+    normals_context_t *normals = normals_t_get_context(normals_handle);
+    const size_t integral_width = (size_t)input->width_pixels + 1;
+    const size_t integral_size = integral_width * ((size_t)input->height_pixels + 1);
+
+    if (integral_size > normals->integral_capacity)
+    {
+        integral_cell_t *grown = (integral_cell_t *)realloc(normals->integral, integral_size * sizeof(integral_cell_t));
+        if (grown == NULL)
+        {
+            LOG_ERROR("Failed to allocate a %zu cell integral image", integral_size);
+            return ZSA_RESULT_FAILED;
+        }
+        normals->integral = grown;
+        normals->integral_capacity = integral_size;
+    }
+
+    normals_job_t job = { 0 };
+    job.context = normals;
+    job.input = input;
+    job.config = config;
+    job.output = image_get_buffer(normal_image);
+    job.output_stride_bytes = image_get_stride_bytes(normal_image);
+
+    const uint32_t row_tasks = (uint32_t)((input->height_pixels + NORMALS_ROWS_PER_TASK - 1) / NORMALS_ROWS_PER_TASK);
+    const uint32_t column_tasks = (uint32_t)((integral_width + NORMALS_COLUMNS_PER_TASK - 1) /
+                                             NORMALS_COLUMNS_PER_TASK);
+
+    memset(normals->integral, 0, integral_width * sizeof(integral_cell_t));
+    threadpool_run(normals->pool, row_tasks, normals_integral_rows_task, &job);
+    threadpool_run(normals->pool, column_tasks, normals_integral_columns_task, &job);
+    threadpool_run(normals->pool, row_tasks, normals_estimate_task, &job);
+
+    return ZSA_RESULT_SUCCEEDED;
+}
@@ -0,0 +1,512 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+// This library
+#include <zsainternal/pointcloud.h>
+
+// Dependent libraries
+#include <zsainternal/common.h>
+#include <zsainternal/handle.h>
+#include <zsainternal/image.h>
+#include <zsainternal/logging.h>
+#include <zsainternal/threadpool.h>
+
+// System dependencies
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Rows handed to a worker per task. Small enough to balance across workers, large enough to amortize the hand off.
+#define POINTCLOUD_ROWS_PER_TASK (16)
+
+// Largest supported outlier neighborhood half width, in pixels
+#define POINTCLOUD_MAX_OUTLIER_WINDOW (15)
+
+// Voxel indices are biased to be positive and packed into 21 bits per axis of a 64 bit key
+#define VOXEL_INDEX_BITS (21)
+#define VOXEL_INDEX_BIAS (1 << (VOXEL_INDEX_BITS - 1))
+#define VOXEL_INDEX_MAX ((1 << VOXEL_INDEX_BITS) - 1)
+#define VOXEL_KEY_REJECTED (UINT64_MAX)
+#define VOXEL_KEY_KEPT (0)
+
+// Smallest hash table partition; keeps tiny clouds from overflowing a partition on an unlucky hash
+#define VOXEL_MIN_PARTITION_SIZE (64)
+
+typedef struct _voxel_entry_t
+{
+    uint64_t key;
+    float sum[3];
+    uint32_t count; // 0 marks an empty slot
+} voxel_entry_t;
+
+typedef struct _pointcloud_filter_context_t
+{
+    threadpool_t pool;
+
+    float *points; // ROI sized organized cloud, z == 0 marks points rejected by the crop stage
+    size_t points_capacity;
+
+    uint64_t *keys; // Voxel key per ROI pixel, or VOXEL_KEY_REJECTED
+    size_t keys_capacity;
+
+    voxel_entry_t *voxels; // Open addressing hash table, one partition per task
+    size_t voxels_capacity;
+
+    size_t *task_counts; // Points produced by each task, turned into output offsets once all tasks complete
+    size_t task_counts_capacity;
+} pointcloud_filter_context_t;
+
+ZSA_DECLARE_CONTEXT(pointcloud_filter_t, pointcloud_filter_context_t);
+
+typedef struct _pointcloud_job_t
+{
+    pointcloud_filter_context_t *filter;
+    const pointcloud_input_t *input;
+    const pointcloud_filter_config_t *config;
+    int roi_x;
+    int roi_y;
+    int roi_width;
+    int roi_height;
+
+    uint32_t partition_count;
+    size_t partition_size;
+
+    zsa_float3_t *output;
+} pointcloud_job_t;
+
+static bool pointcloud_reserve(void **buffer, size_t *capacity, size_t count, size_t element_size)
+{
+    if (count <= *capacity)
+    {
+        return true;
+    }
+
+    void *grown = realloc(*buffer, count * element_size);
+    if (grown == NULL)
+    {
+        LOG_ERROR("Failed to grow point cloud scratch buffer to %zu elements", count);
+        return false;
+    }
+
+    *buffer = grown;
+    *capacity = count;
+    return true;
+}
+
+static inline uint64_t voxel_hash(uint64_t key)
+{
+    return (key * 0x9E3779B97F4A7C15ull) >> 16;
+}
+
+static inline uint64_t voxel_key(const float *point, float inverse_voxel_size)
+{
+    uint64_t key = 0;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        int index = (int)floorf(point[axis] * inverse_voxel_size) + VOXEL_INDEX_BIAS;
+        index = MAX(0, MIN(index, VOXEL_INDEX_MAX));
+        key |= (uint64_t)index << (axis * VOXEL_INDEX_BITS);
+    }
+    return key;
+}
+
+// Converts one band of rows to float and applies the crop box and range limits
+static void pointcloud_load_task(void *context, uint32_t task_index)
+{
+    pointcloud_job_t *job = (pointcloud_job_t *)context;
+    const pointcloud_input_t *input = job->input;
+    const pointcloud_filter_config_t *config = job->config;
+
+    const float min_range2 = config->min_range_mm * config->min_range_mm;
+    const float max_range2 = config->max_range_mm > 0 ? config->max_range_mm * config->max_range_mm : INFINITY;
+    const int first_row = (int)task_index * POINTCLOUD_ROWS_PER_TASK;
+    const int last_row = MIN(first_row + POINTCLOUD_ROWS_PER_TASK, job->roi_height);
+
+    for (int row = first_row; row < last_row; row++)
+    {
+        const uint8_t *src = input->data + (size_t)(job->roi_y + row) * (size_t)input->stride_bytes;
+        float *dst = job->filter->points + (size_t)row * (size_t)job->roi_width * 3;
+
+        if (input->point_type == POINTCLOUD_POINT_INT16_MM)
+        {
+            const int16_t *xyz = (const int16_t *)src + job->roi_x * 3;
+            for (int i = 0; i < job->roi_width * 3; i++)
+            {
+                dst[i] = (float)xyz[i];
+            }
+        }
+        else
+        {
+            memcpy(dst, (const float *)src + job->roi_x * 3, (size_t)job->roi_width * 3 * sizeof(float));
+        }
+
+        for (int col = 0; col < job->roi_width; col++, dst += 3)
+        {
+            const float range2 = dst[0] * dst[0] + dst[1] * dst[1] + dst[2] * dst[2];
+            bool keep = dst[2] != 0 && range2 >= min_range2 && range2 <= max_range2;
+
+            if (keep && config->crop_box_enabled)
+            {
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    keep = keep && dst[axis] >= config->crop_box_min_mm.v[axis] &&
+                           dst[axis] <= config->crop_box_max_mm.v[axis];
+                }
+            }
+
+            if (!keep)
+            {
+                dst[0] = dst[1] = dst[2] = 0;
+            }
+        }
+    }
+}
+
+// Applies the radius outlier test to one band of rows and records the voxel key of every surviving point
+static void pointcloud_select_task(void *context, uint32_t task_index)
+{
+    pointcloud_job_t *job = (pointcloud_job_t *)context;
+    const pointcloud_filter_config_t *config = job->config;
+    const float *points = job->filter->points;
+    uint64_t *keys = job->filter->keys;
+
+    const bool outlier_enabled = config->outlier_radius_mm > 0;
+    const float radius2 = config->outlier_radius_mm * config->outlier_radius_mm;
+    const int window = config->outlier_window;
+    const bool voxel_enabled = config->voxel_size_mm > 0;
+    const float inverse_voxel_size = voxel_enabled ? 1.0f / config->voxel_size_mm : 0;
+    const int first_row = (int)task_index * POINTCLOUD_ROWS_PER_TASK;
+    const int last_row = MIN(first_row + POINTCLOUD_ROWS_PER_TASK, job->roi_height);
+    size_t kept = 0;
+
+    for (int row = first_row; row < last_row; row++)
+    {
+        for (int col = 0; col < job->roi_width; col++)
+        {
+            const size_t index = (size_t)row * (size_t)job->roi_width + (size_t)col;
+            const float *point = points + index * 3;
+            bool keep = point[2] != 0;
+
+            if (keep && outlier_enabled)
+            {
+                int neighbors = 0;
+                const int top = MAX(row - window, 0);
+                const int bottom = MIN(row + window, job->roi_height - 1);
+                const int left = MAX(col - window, 0);
+                const int right = MIN(col + window, job->roi_width - 1);
+
+                for (int y = top; y <= bottom && neighbors < config->outlier_min_neighbors; y++)
+                {
+                    const float *neighbor = points + ((size_t)y * (size_t)job->roi_width + (size_t)left) * 3;
+                    for (int x = left; x <= right; x++, neighbor += 3)
+                    {
+                        const float dx = neighbor[0] - point[0];
+                        const float dy = neighbor[1] - point[1];
+                        const float dz = neighbor[2] - point[2];
+                        if (neighbor[2] != 0 && neighbor != point && dx * dx + dy * dy + dz * dz <= radius2)
+                        {
+                            neighbors++;
+                        }
+                    }
+                }
+
+                keep = neighbors >= config->outlier_min_neighbors;
+            }
+
+            if (!keep)
+            {
+                keys[index] = VOXEL_KEY_REJECTED;
+                continue;
+            }
+
+            keys[index] = voxel_enabled ? voxel_key(point, inverse_voxel_size) : VOXEL_KEY_KEPT;
+            kept++;
+        }
+    }
+
+    job->filter->task_counts[task_index] = kept;
+}
+
+// Writes the surviving points of one band of rows to the output array
+static void pointcloud_compact_task(void *context, uint32_t task_index)
+{
+    pointcloud_job_t *job = (pointcloud_job_t *)context;
+    const float *points = job->filter->points;
+    const uint64_t *keys = job->filter->keys;
+    zsa_float3_t *output = job->output + job->filter->task_counts[task_index];
+
+    const size_t first = (size_t)task_index * POINTCLOUD_ROWS_PER_TASK * (size_t)job->roi_width;
+    const size_t last = MIN(first + POINTCLOUD_ROWS_PER_TASK * (size_t)job->roi_width,
+                            (size_t)job->roi_height * (size_t)job->roi_width);
+
+    for (size_t index = first; index < last; index++)
+    {
+        if (keys[index] != VOXEL_KEY_REJECTED)
+        {
+            memcpy(output->v, points + index * 3, sizeof(output->v));
+            output++;
+        }
+    }
+}
+
+// Accumulates every point whose key hashes to this task's partition. Each task owns its partition of the table, so
+// no locking is needed; the price is that each task scans all keys.
+static void pointcloud_voxel_accumulate_task(void *context, uint32_t task_index)
+{
+    pointcloud_job_t *job = (pointcloud_job_t *)context;
+    const float *points = job->filter->points;
+    const uint64_t *keys = job->filter->keys;
+    const size_t pixel_count = (size_t)job->roi_width * (size_t)job->roi_height;
+    const size_t partition_size = job->partition_size;
+    voxel_entry_t *partition = job->filter->voxels + task_index * partition_size;
+    size_t occupied = 0;
+
+    memset(partition, 0, partition_size * sizeof(voxel_entry_t));
+
+    for (size_t index = 0; index < pixel_count; index++)
+    {
+        const uint64_t key = keys[index];
+        if (key == VOXEL_KEY_REJECTED)
+        {
+            continue;
+        }
+
+        const uint64_t hash = voxel_hash(key);
+        if (hash % job->partition_count != task_index)
+        {
+            continue;
+        }
+
+        size_t slot = (size_t)((hash / job->partition_count) % partition_size);
+        while (partition[slot].count != 0 && partition[slot].key != key)
+        {
+            slot = slot + 1 == partition_size ? 0 : slot + 1;
+        }
+
+        voxel_entry_t *entry = &partition[slot];
+        if (entry->count == 0)
+        {
+            if (++occupied == partition_size)
+            {
+                // Table is full and the next new key would probe forever; let the caller retry with one partition
+                job->filter->task_counts[task_index] = SIZE_MAX;
+                return;
+            }
+            entry->key = key;
+        }
+
+        const float *point = points + index * 3;
+        entry->sum[0] += point[0];
+        entry->sum[1] += point[1];
+        entry->sum[2] += point[2];
+        entry->count++;
+    }
+
+    job->filter->task_counts[task_index] = occupied;
+}
+
+// Writes the centroid of every occupied voxel in this task's partition to the output array
+static void pointcloud_voxel_emit_task(void *context, uint32_t task_index)
+{
+    pointcloud_job_t *job = (pointcloud_job_t *)context;
+    const voxel_entry_t *partition = job->filter->voxels + task_index * job->partition_size;
+    zsa_float3_t *output = job->output + job->filter->task_counts[task_index];
+
+    for (size_t slot = 0; slot < job->partition_size; slot++)
+    {
+        const voxel_entry_t *entry = &partition[slot];
+        if (entry->count != 0)
+        {
+            const float scale = 1.0f / (float)entry->count;
+            output->xyz.x = entry->sum[0] * scale;
+            output->xyz.y = entry->sum[1] * scale;
+            output->xyz.z = entry->sum[2] * scale;
+            output++;
+        }
+    }
+}
+
+// Sums task_counts and turns them into exclusive offsets. Returns SIZE_MAX if any task reported an overflow.
+static size_t pointcloud_offsets_from_counts(size_t *task_counts, uint32_t task_count)
+{
+    size_t total = 0;
+    for (uint32_t i = 0; i < task_count; i++)
+    {
+        if (task_counts[i] == SIZE_MAX)
+        {
+            return SIZE_MAX;
+        }
+
+        size_t count = task_counts[i];
+        task_counts[i] = total;
+        total += count;
+    }
+    return total;
+}
+
+zsa_result_t pointcloud_filter_create(uint32_t worker_count, pointcloud_filter_t *filter_handle)
+{
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, filter_handle == NULL);
+
+    pointcloud_filter_context_t *filter = pointcloud_filter_t_create(filter_handle);
+    zsa_result_t result = ZSA_RESULT_FROM_BOOL(filter != NULL);
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        result = TRACE_CALL(threadpool_create(worker_count, &filter->pool));
+    }
+
+    if (ZSA_FAILED(result) && filter != NULL)
+    {
+        pointcloud_filter_destroy(*filter_handle);
+        *filter_handle = NULL;
+    }
+
+    return result;
+}
+
+void pointcloud_filter_destroy(pointcloud_filter_t filter_handle)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(VOID_VALUE, pointcloud_filter_t, filter_handle);
+    pointcloud_filter_context_t *filter = pointcloud_filter_t_get_context(filter_handle);
+
+    if (filter->pool)
+    {
+        threadpool_destroy(filter->pool);
+    }
+
+    free(filter->points);
+    free(filter->keys);
+    free(filter->voxels);
+    free(filter->task_counts);
+
+    pointcloud_filter_t_destroy(filter_handle);
+}
+
+zsa_result_t pointcloud_input_from_image(zsa_image_t xyz_image, pointcloud_input_t *input)
+{
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, xyz_image == NULL);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, input == NULL);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, image_get_format(xyz_image) != ZSA_IMAGE_FORMAT_CUSTOM);
+
+    input->data = image_get_buffer(xyz_image);
+    input->point_type = POINTCLOUD_POINT_INT16_MM;
+    input->width_pixels = image_get_width_pixels(xyz_image);
+    input->height_pixels = image_get_height_pixels(xyz_image);
+    input->stride_bytes = image_get_stride_bytes(xyz_image);
+
+    return ZSA_RESULT_FROM_BOOL(input->data != NULL &&
+                                (size_t)input->stride_bytes >= (size_t)input->width_pixels * 3 * sizeof(int16_t));
+}
+
+zsa_buffer_result_t pointcloud_filter_process(pointcloud_filter_t filter_handle,
+                                              const pointcloud_input_t *input,
+                                              const pointcloud_filter_config_t *config,
+                                              zsa_float3_t *points,
+                                              size_t points_capacity,
+                                              size_t *points_count)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_BUFFER_RESULT_FAILED, pointcloud_filter_t, filter_handle);
+    RETURN_VALUE_IF_ARG(ZSA_BUFFER_RESULT_FAILED, input == NULL || input->data == NULL);
+    RETURN_VALUE_IF_ARG(ZSA_BUFFER_RESULT_FAILED, config == NULL);
+    RETURN_VALUE_IF_ARG(ZSA_BUFFER_RESULT_FAILED, points_count == NULL);
+    RETURN_VALUE_IF_ARG(ZSA_BUFFER_RESULT_FAILED, input->width_pixels <= 0 || input->height_pixels <= 0);
+    RETURN_VALUE_IF_ARG(ZSA_BUFFER_RESULT_FAILED,
+                        input->point_type != POINTCLOUD_POINT_INT16_MM &&
+                            input->point_type != POINTCLOUD_POINT_FLOAT32_MM);
+    RETURN_VALUE_IF_ARG(ZSA_BUFFER_RESULT_FAILED,
+                        (size_t)input->stride_bytes <
+                            (size_t)input->width_pixels * 3 *
+                                (input->point_type == POINTCLOUD_POINT_INT16_MM ? sizeof(int16_t) : sizeof(float)));
+    RETURN_VALUE_IF_ARG(ZSA_BUFFER_RESULT_FAILED, config->voxel_size_mm < 0);
+    RETURN_VALUE_IF_ARG(ZSA_BUFFER_RESULT_FAILED,
+                        config->outlier_radius_mm > 0 &&
+                            (config->outlier_window < 1 || config->outlier_window > POINTCLOUD_MAX_OUTLIER_WINDOW));
+
+    pointcloud_filter_context_t *filter = pointcloud_filter_t_get_context(filter_handle);
+    pointcloud_job_t job = { 0 };
+    job.filter = filter;
+    job.input = input;
+    job.config = config;
+    job.roi_x = config->roi_x;
+    job.roi_y = config->roi_y;
+    job.roi_width = config->roi_width;
+    job.roi_height = config->roi_height;
+    if (job.roi_width == 0 || job.roi_height == 0)
+    {
+        job.roi_x = 0;
+        job.roi_y = 0;
+        job.roi_width = input->width_pixels;
+        job.roi_height = input->height_pixels;
+    }
+
+    RETURN_VALUE_IF_ARG(ZSA_BUFFER_RESULT_FAILED,
+                        job.roi_x < 0 || job.roi_y < 0 || job.roi_width < 0 || job.roi_height < 0 ||
+                            job.roi_x + job.roi_width > input->width_pixels ||
+                            job.roi_y + job.roi_height > input->height_pixels);
+
+    const size_t pixel_count = (size_t)job.roi_width * (size_t)job.roi_height;
+    const uint32_t band_count = (uint32_t)((job.roi_height + POINTCLOUD_ROWS_PER_TASK - 1) / POINTCLOUD_ROWS_PER_TASK);
+    const uint32_t thread_count = threadpool_get_thread_count(filter->pool);
+
+    zsa_result_t result = ZSA_RESULT_FROM_BOOL(
+        pointcloud_reserve((void **)&filter->points, &filter->points_capacity, pixel_count * 3, sizeof(float)) &&
+        pointcloud_reserve((void **)&filter->keys, &filter->keys_capacity, pixel_count, sizeof(uint64_t)) &&
+        pointcloud_reserve((void **)&filter->task_counts,
+                           &filter->task_counts_capacity,
+                           MAX(band_count, thread_count),
+                           sizeof(size_t)));
+    if (ZSA_FAILED(result))
+    {
+        return ZSA_BUFFER_RESULT_FAILED;
+    }
+
+    threadpool_run(filter->pool, band_count, pointcloud_load_task, &job);
+    threadpool_run(filter->pool, band_count, pointcloud_select_task, &job);
+    size_t count = pointcloud_offsets_from_counts(filter->task_counts, band_count);
+
+    if (config->voxel_size_mm > 0)
+    {
+        job.partition_count = thread_count;
+        job.partition_size = MAX(VOXEL_MIN_PARTITION_SIZE, 2 * ((count + thread_count - 1) / thread_count));
+
+        result = ZSA_RESULT_FROM_BOOL(pointcloud_reserve((void **)&filter->voxels,
+                                                         &filter->voxels_capacity,
+                                                         job.partition_count * job.partition_size,
+                                                         sizeof(voxel_entry_t)));
+        if (ZSA_FAILED(result))
+        {
+            return ZSA_BUFFER_RESULT_FAILED;
+        }
+
+        threadpool_run(filter->pool, job.partition_count, pointcloud_voxel_accumulate_task, &job);
+        count = pointcloud_offsets_from_counts(filter->task_counts, job.partition_count);
+
+        if (count == SIZE_MAX)
+        {
+            // A skewed hash filled one partition; the whole table as a single partition always has room
+            job.partition_size *= job.partition_count;
+            job.partition_count = 1;
+            threadpool_run(filter->pool, 1, pointcloud_voxel_accumulate_task, &job);
+            count = pointcloud_offsets_from_counts(filter->task_counts, 1);
+        }
+    }
+
+    *points_count = count;
+    if (points == NULL || points_capacity < count)
+    {
+        return ZSA_BUFFER_RESULT_TOO_SMALL;
+    }
+
+    job.output = points;
+    if (config->voxel_size_mm > 0)
+    {
+        threadpool_run(filter->pool, job.partition_count, pointcloud_voxel_emit_task, &job);
+    }
+    else
+    {
+        threadpool_run(filter->pool, band_count, pointcloud_compact_task, &job);
+    }
+
+    return ZSA_BUFFER_RESULT_SUCCEEDED;
+}
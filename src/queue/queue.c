@@ -14,10 +14,16 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#ifndef _WIN32
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
 
 typedef struct _queue_entry_t
 {
     zsa_capture_t capture;
+    size_t bytes;          // Bytes of the images of the capture
+    uint64_t pushed_nsec;  // When the capture was queued
 } queue_entry_t;
 
 typedef struct _queue_context_t
@@ -32,8 +38,14 @@ typedef struct _queue_context_t
     const char *name;           // Queue name in logger
     uint32_t dropped_count;     // Count of the dropped captures
 
+    queue_overflow_policy_t policy; // What a push does when full
+    size_t max_bytes;               // QUEUE_OVERFLOW_BOUNDED_BYTES limit
+    queue_stats_t stats;            // Counters, count and lag_usec are filled in when read
+    int event_fd;                   // -1 until queue_get_event_fd() is called
+    bool event_signaled;            // event_fd is readable
+
     LOCK_HANDLE lock;
-    COND_HANDLE condition;
+    COND_HANDLE condition; // Signaled when a capture is queued
 } queue_context_t;
 
 ZSA_DECLARE_CONTEXT(queue_t, queue_context_t);
@@ -47,20 +59,25 @@ ZSA_DECLARE_CONTEXT(queue_t, queue_context_t);
 
 zsa_result_t queue_create(uint32_t queue_depth, const char *queue_name, queue_t *queue_handle)
 {
-    zsa_result_t result;
-    queue_context_t *queue = queue_t_create(queue_handle);
-
     RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, queue_depth == 0);
     RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, queue_depth > 10000); // Sanity Check
-    queue->depth = queue_depth + 1;                              // Adding one; see comment on inc_read_write_location()
-    queue->name = queue_name;
-    if (queue->name == NULL)
+
+    queue_context_t *queue = queue_t_create(queue_handle);
+    zsa_result_t result = ZSA_RESULT_FROM_BOOL(queue != NULL);
+
+    if (ZSA_SUCCEEDED(result))
     {
-        queue->name = "Unknown queue";
-    }
+        queue->event_fd = -1;
+        queue->depth = queue_depth + 1; // Adding one; see comment on inc_read_write_location()
+        queue->name = queue_name;
+        if (queue->name == NULL)
+        {
+            queue->name = "Unknown queue";
+        }
 
-    queue->queue = malloc(sizeof(queue_entry_t) * queue->depth);
-    result = ZSA_RESULT_FROM_BOOL(queue->queue != NULL);
+        queue->queue = malloc(sizeof(queue_entry_t) * queue->depth);
+        result = ZSA_RESULT_FROM_BOOL(queue->queue != NULL);
+    }
 
     if (ZSA_SUCCEEDED(result))
     {
@@ -71,8 +88,10 @@ zsa_result_t queue_create(uint32_t queue_depth, const char *queue_name, queue_t
     if (ZSA_SUCCEEDED(result))
     {
         queue->condition = Condition_Init();
+        result = ZSA_RESULT_FROM_BOOL(queue->condition != NULL);
     }
-    else
+
+    if (ZSA_FAILED(result))
     {
         if (queue)
         {
@@ -83,6 +102,39 @@ zsa_result_t queue_create(uint32_t queue_depth, const char *queue_name, queue_t
     return result;
 }
 
+static uint64_t queue_now_nsec(void)
+{
+    uint64_t now = 0;
+    (void)image_get_system_time_nsec(&now);
+    return now;
+}
+
+// Keeps event_fd readable while captures are queued or the queue was stopped
+static void queue_update_event_locked(queue_context_t *queue)
+{
+#ifndef _WIN32
+    if (queue->event_fd < 0)
+    {
+        return;
+    }
+
+    bool ready = !is_queue_empty(queue) || queue->stopped;
+    if (ready != queue->event_signaled)
+    {
+        uint64_t value = 1;
+        ssize_t size = ready ? write(queue->event_fd, &value, sizeof(value))
+                             : read(queue->event_fd, &value, sizeof(value));
+        if (size != sizeof(value))
+        {
+            LOG_ERROR("Queue \"%s\" failed to update its event.", queue->name);
+        }
+        queue->event_signaled = ready;
+    }
+#else
+    (void)queue;
+#endif
+}
+
 static zsa_capture_t queue_pop_internal_locked(queue_context_t *queue)
 {
     if (is_queue_empty(queue) == false)
@@ -90,12 +142,35 @@ static zsa_capture_t queue_pop_internal_locked(queue_context_t *queue)
         queue_entry_t *entry = &queue->queue[queue->read_location];
 
         queue->read_location = inc_read_write_location(queue, queue->read_location);
+        queue->stats.bytes -= entry->bytes;
+        queue_update_event_locked(queue);
 
         return entry->capture;
     }
     return NULL;
 }
 
+// Removes the capture at the head of the queue for the consumer, accounting how long it waited
+static zsa_capture_t queue_pop_for_consumer_locked(queue_context_t *queue)
+{
+    uint64_t pushed_nsec = queue->queue[queue->read_location].pushed_nsec;
+    zsa_capture_t capture = queue_pop_internal_locked(queue);
+
+    if (capture)
+    {
+        uint64_t now = queue_now_nsec();
+        uint64_t lag_usec = now > pushed_nsec ? (now - pushed_nsec) / 1000 : 0;
+
+        queue->stats.popped++;
+        queue->stats.last_pop_lag_usec = lag_usec;
+        if (lag_usec > queue->stats.max_pop_lag_usec)
+        {
+            queue->stats.max_pop_lag_usec = lag_usec;
+        }
+    }
+    return capture;
+}
+
 zsa_wait_result_t queue_pop(queue_t queue_handle, int32_t wait_in_ms, zsa_capture_t *out_capture)
 {
     RETURN_VALUE_IF_HANDLE_INVALID(ZSA_WAIT_RESULT_FAILED, queue_t, queue_handle);
@@ -118,7 +193,7 @@ zsa_wait_result_t queue_pop(queue_t queue_handle, int32_t wait_in_ms, zsa_captur
         wresult = ZSA_WAIT_RESULT_TIMEOUT;
         queue->queue_pop_blocked++;
 
-        capture = queue_pop_internal_locked(queue);
+        capture = queue_pop_for_consumer_locked(queue);
         if (capture != NULL)
         {
             wresult = ZSA_WAIT_RESULT_SUCCEEDED;
@@ -138,7 +213,7 @@ zsa_wait_result_t queue_pop(queue_t queue_handle, int32_t wait_in_ms, zsa_captur
             COND_RESULT cond_result = Condition_Wait(queue->condition, queue->lock, wait_in_ms);
             if (cond_result == COND_OK)
             {
-                capture = queue_pop_internal_locked(queue);
+                capture = queue_pop_for_consumer_locked(queue);
                 wresult = ZSA_WAIT_RESULT_SUCCEEDED;
 
                 // Condition_Wait should only return COND_OK if there is data or if we are shutting down.
@@ -180,12 +255,38 @@ zsa_wait_result_t queue_pop(queue_t queue_handle, int32_t wait_in_ms, zsa_captur
     return wresult;
 }
 
-static void queue_push_internal_locked(queue_context_t *queue, zsa_capture_t capture)
+static void queue_push_internal_locked(queue_context_t *queue, zsa_capture_t capture, size_t bytes)
 {
     queue_entry_t *entry = &queue->queue[queue->write_location];
     entry->capture = capture;
+    entry->bytes = bytes;
+    entry->pushed_nsec = queue_now_nsec();
 
     queue->write_location = inc_read_write_location(queue, queue->write_location);
+    queue->stats.bytes += bytes;
+    queue_update_event_locked(queue);
+}
+
+static uint32_t queue_count_locked(queue_context_t *queue)
+{
+    return (queue->write_location + queue->depth - queue->read_location) % queue->depth;
+}
+
+// Drops the oldest capture, handing the first one dropped by a push to the caller when it asked for it
+static void queue_drop_oldest_locked(queue_context_t *queue, zsa_capture_t *dropped)
+{
+    zsa_capture_t capture = queue_pop_internal_locked(queue);
+
+    queue->stats.dropped_oldest++;
+    if (dropped != NULL && *dropped == NULL)
+    {
+        *dropped = capture;
+    }
+    else
+    {
+        queue->dropped_count++;
+        capture_dec_ref(capture);
+    }
 }
 
 void queue_push_w_dropped(queue_t queue_handle, zsa_capture_t capture, zsa_capture_t *dropped)
@@ -194,6 +295,13 @@ void queue_push_w_dropped(queue_t queue_handle, zsa_capture_t capture, zsa_captu
     RETURN_VALUE_IF_ARG(VOID_VALUE, capture == NULL);
 
     queue_context_t *queue = queue_t_get_context(queue_handle);
+    size_t bytes = capture_get_size_bytes(capture);
+    bool accept = true;
+
+    if (dropped != NULL)
+    {
+        *dropped = NULL;
+    }
 
     Lock(queue->lock);
 
@@ -203,26 +311,97 @@ void queue_push_w_dropped(queue_t queue_handle, zsa_capture_t capture, zsa_captu
     }
     else
     {
-        if (is_queue_full(queue))
+        switch (queue->policy)
         {
-            if (dropped == NULL)
+        case QUEUE_OVERFLOW_KEEP_LATEST:
+            while (!is_queue_empty(queue))
             {
-                queue->dropped_count++;
-                capture_dec_ref(queue_pop_internal_locked(queue));
+                queue_drop_oldest_locked(queue, dropped);
+            }
+            break;
+        case QUEUE_OVERFLOW_BOUNDED_BYTES:
+            while (!is_queue_empty(queue) && (is_queue_full(queue) || queue->stats.bytes + bytes > queue->max_bytes))
+            {
+                queue_drop_oldest_locked(queue, dropped);
+            }
+            break;
+        case QUEUE_OVERFLOW_DROP_NEWEST:
+            accept = !is_queue_full(queue);
+            break;
+        case QUEUE_OVERFLOW_DROP_OLDEST:
+        default:
+            if (is_queue_full(queue))
+            {
+                queue_drop_oldest_locked(queue, dropped);
+            }
+            break;
+        }
+
+        if (accept)
+        {
+            // We are accepting this into our queue, so add a ref to prevent it
+            // from being freed
+            capture_inc_ref(capture);
+
+            queue_push_internal_locked(queue, capture, bytes);
+            queue->stats.pushed++;
+
+            uint32_t count = queue_count_locked(queue);
+            if (count > queue->stats.max_count)
+            {
+                queue->stats.max_count = count;
+            }
+
+            Condition_Post(queue->condition);
+        }
+        else
+        {
+            queue->stats.dropped_newest++;
+            if (dropped != NULL)
+            {
+                // The caller gets a reference of its own, as for a dropped queued capture
+                capture_inc_ref(capture);
+                *dropped = capture;
             }
             else
             {
-                *dropped = queue_pop_internal_locked(queue);
+                queue->dropped_count++;
             }
         }
+    }
+    Unlock(queue->lock);
+}
 
-        // We are accepting this into our queue, so add a ref to prevent it
-        // from being freed
-        capture_inc_ref(capture);
+zsa_result_t queue_set_overflow_policy(queue_t queue_handle, queue_overflow_policy_t policy, size_t max_bytes)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_RESULT_FAILED, queue_t, queue_handle);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, policy > QUEUE_OVERFLOW_BOUNDED_BYTES);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, policy == QUEUE_OVERFLOW_BOUNDED_BYTES && max_bytes == 0);
+    queue_context_t *queue = queue_t_get_context(queue_handle);
 
-        queue_push_internal_locked(queue, capture);
+    Lock(queue->lock);
+    queue->policy = policy;
+    queue->max_bytes = max_bytes;
+    Unlock(queue->lock);
 
-        Condition_Post(queue->condition);
+    return ZSA_RESULT_SUCCEEDED;
+}
+
+void queue_get_stats(queue_t queue_handle, queue_stats_t *stats)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(VOID_VALUE, queue_t, queue_handle);
+    RETURN_VALUE_IF_ARG(VOID_VALUE, stats == NULL);
+    queue_context_t *queue = queue_t_get_context(queue_handle);
+
+    Lock(queue->lock);
+    *stats = queue->stats;
+    stats->count = queue_count_locked(queue);
+    stats->lag_usec = 0;
+    if (!is_queue_empty(queue))
+    {
+        uint64_t now = queue_now_nsec();
+        uint64_t pushed_nsec = queue->queue[queue->read_location].pushed_nsec;
+        stats->lag_usec = now > pushed_nsec ? (now - pushed_nsec) / 1000 : 0;
     }
     Unlock(queue->lock);
 }
@@ -232,6 +411,79 @@ void queue_push(queue_t queue_handle, zsa_capture_t capture)
     queue_push_w_dropped(queue_handle, capture, NULL);
 }
 
+zsa_wait_result_t queue_pop_batch(queue_t queue_handle, zsa_capture_t *captures, uint32_t capacity, uint32_t *count)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_WAIT_RESULT_FAILED, queue_t, queue_handle);
+    RETURN_VALUE_IF_ARG(ZSA_WAIT_RESULT_FAILED, captures == NULL);
+    RETURN_VALUE_IF_ARG(ZSA_WAIT_RESULT_FAILED, capacity == 0);
+    RETURN_VALUE_IF_ARG(ZSA_WAIT_RESULT_FAILED, count == NULL);
+
+    queue_context_t *queue = queue_t_get_context(queue_handle);
+    zsa_wait_result_t wresult = ZSA_WAIT_RESULT_TIMEOUT;
+    uint32_t popped = 0;
+
+    Lock(queue->lock);
+
+    if (queue->enabled == false)
+    {
+        wresult = ZSA_WAIT_RESULT_FAILED;
+    }
+    else
+    {
+        while (popped < capacity && !is_queue_empty(queue))
+        {
+            // The ref held by the queue is transfered to the caller
+            captures[popped++] = queue_pop_for_consumer_locked(queue);
+        }
+
+        if (popped != 0)
+        {
+            wresult = ZSA_WAIT_RESULT_SUCCEEDED;
+        }
+        else if (queue->stopped)
+        {
+            wresult = ZSA_WAIT_RESULT_FAILED;
+        }
+    }
+
+    if (queue->dropped_count != 0)
+    {
+        LOG_INFO("Queue \"%s\" dropped oldest %d captures from queue.", queue->name, queue->dropped_count);
+        queue->dropped_count = 0;
+    }
+
+    Unlock(queue->lock);
+
+    *count = popped;
+    return wresult;
+}
+
+int queue_get_event_fd(queue_t queue_handle)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(-1, queue_t, queue_handle);
+    queue_context_t *queue = queue_t_get_context(queue_handle);
+
+#ifndef _WIN32
+    Lock(queue->lock);
+    if (queue->event_fd < 0)
+    {
+        queue->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (queue->event_fd < 0)
+        {
+            LOG_ERROR("Queue \"%s\" failed to create an eventfd.", queue->name);
+        }
+        queue->event_signaled = false;
+        queue_update_event_locked(queue);
+    }
+    Unlock(queue->lock);
+
+    return queue->event_fd;
+#else
+    LOG_ERROR("Queue \"%s\" has no pollable event on this platform.", queue->name);
+    return -1;
+#endif
+}
+
 void queue_destroy(queue_t queue_handle)
 {
     RETURN_VALUE_IF_HANDLE_INVALID(VOID_VALUE, queue_t, queue_handle);
@@ -239,6 +491,13 @@ void queue_destroy(queue_t queue_handle)
 
     queue_disable(queue_handle);
 
+#ifndef _WIN32
+    if (queue->event_fd >= 0)
+    {
+        close(queue->event_fd);
+    }
+#endif
+
     if (queue->condition)
     {
         Condition_Deinit(queue->condition);
@@ -261,6 +520,7 @@ void queue_enable(queue_t queue_handle)
     Lock(queue->lock);
     queue->enabled = true;
     queue->stopped = false;
+    queue_update_event_locked(queue);
     Unlock(queue->lock);
 }
 
@@ -295,6 +555,7 @@ void queue_stop(queue_t queue_handle)
 
     Lock(queue->lock);
     queue->stopped = true;
+    queue_update_event_locked(queue);
     Unlock(queue->lock);
 
     LOG_INFO("Queue \"%s\" stopped, shutting down and notifying consumers.", queue->name);
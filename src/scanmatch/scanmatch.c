@@ -0,0 +1,744 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+// This library
+#include <zsainternal/scanmatch.h>
+
+// Dependent libraries
+#include <zsainternal/common.h>
+#include <zsainternal/handle.h>
+#include <zsainternal/image.h>
+#include <zsainternal/logging.h>
+#include <zsainternal/math.h>
+
+// System dependencies
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Lookup grids kept for branch and bound; level k holds the maximum of the likelihood map over 2^k x 2^k blocks
+#define SCANMATCH_MAX_LEVELS (8)
+
+// Fewer usable returns than this cannot be matched
+#define SCANMATCH_MIN_POINTS (20)
+
+// Consecutive unmatched scans after which the local map is restarted from the latest scan
+#define SCANMATCH_MAX_LOST_SCANS (10)
+
+// Levenberg-Marquardt iterations refining the branch and bound result
+#define SCANMATCH_REFINE_ITERATIONS (10)
+
+#define SCANMATCH_PI (3.14159265358979f)
+
+typedef struct _scanmatch_pose2d_t
+{
+    float x;
+    float y;
+    float theta;
+} scanmatch_pose2d_t;
+
+// Returns of a matched scan in map coordinates
+typedef struct _scanmatch_stored_scan_t
+{
+    float *points; // x, y pairs
+    uint32_t count;
+    uint32_t capacity;
+} scanmatch_stored_scan_t;
+
+typedef struct _scanmatch_candidate_t
+{
+    int angle; // Index into the searched headings
+    int x;     // Offset from the predicted position in cells
+    int y;
+    int score; // Sum of the lookup grid values under the scan returns
+} scanmatch_candidate_t;
+
+typedef struct _scanmatch_context_t
+{
+    scanmatch_config_t config;
+
+    // Likelihood map and its lookup grids, allocated once and rebuilt in place
+    int levels;
+    uint8_t *grids[SCANMATCH_MAX_LEVELS];
+    float origin[2]; // Map coordinates of the outer corner of cell (0, 0)
+    bool map_valid;
+
+    uint8_t *kernel; // Likelihood stamped around each return, (2 * kernel_radius + 1)^2 cells
+    int kernel_radius;
+
+    // Matched scans the map is built from, oldest overwritten first
+    scanmatch_stored_scan_t *stored;
+    int stored_next;
+    int stored_count;
+    int scans_since_update;
+
+    // Per scan scratch, grown as needed and reused
+    float *points; // Returns of the current scan in the sensor frame, x, y pairs
+    uint32_t points_capacity;
+    int32_t *cells; // Cells under the returns for every searched heading, x, y pairs
+    size_t cells_capacity;
+    scanmatch_candidate_t *candidates;
+    size_t candidates_capacity;
+
+    bool have_pose;
+    scanmatch_pose2d_t pose;     // Pose of the last scan
+    scanmatch_pose2d_t velocity; // Motion between the last two matched scans, the prediction for the next
+    int lost_scans;
+} scanmatch_context_t;
+
+ZSA_DECLARE_CONTEXT(scanmatch_t, scanmatch_context_t);
+
+static float scanmatch_wrap_angle(float angle)
+{
+    while (angle > SCANMATCH_PI)
+    {
+        angle -= 2 * SCANMATCH_PI;
+    }
+    while (angle <= -SCANMATCH_PI)
+    {
+        angle += 2 * SCANMATCH_PI;
+    }
+    return angle;
+}
+
+static bool scanmatch_reserve(void **buffer, size_t *capacity, size_t count, size_t element_size)
+{
+    if (count <= *capacity)
+    {
+        return true;
+    }
+
+    void *grown = realloc(*buffer, count * element_size);
+    if (grown == NULL)
+    {
+        LOG_ERROR("Failed to allocate %zu scan matcher elements", count);
+        return false;
+    }
+    *buffer = grown;
+    *capacity = count;
+    return true;
+}
+
+static void scanmatch_stamp(scanmatch_context_t *context, float x, float y)
+{
+    int size = context->config.map_size_cells;
+    int radius = context->kernel_radius;
+    int cx = (int)floorf((x - context->origin[0]) / context->config.resolution_mm);
+    int cy = (int)floorf((y - context->origin[1]) / context->config.resolution_mm);
+    if (cx < radius || cy < radius || cx >= size - radius || cy >= size - radius)
+    {
+        return;
+    }
+
+    int kernel_size = 2 * radius + 1;
+    for (int ky = 0; ky < kernel_size; ky++)
+    {
+        uint8_t *row = context->grids[0] + (size_t)(cy - radius + ky) * (size_t)size + (cx - radius);
+        const uint8_t *kernel = context->kernel + ky * kernel_size;
+        for (int kx = 0; kx < kernel_size; kx++)
+        {
+            row[kx] = MAX(row[kx], kernel[kx]);
+        }
+    }
+}
+
+// Rebuilds the likelihood map centered on center from the stored scans, then the lookup grids
+static void scanmatch_rebuild_map(scanmatch_context_t *context, const scanmatch_pose2d_t *center)
+{
+    int size = context->config.map_size_cells;
+    float half_extent = 0.5f * (float)size * context->config.resolution_mm;
+    context->origin[0] = center->x - half_extent;
+    context->origin[1] = center->y - half_extent;
+
+    memset(context->grids[0], 0, (size_t)size * (size_t)size);
+    for (int s = 0; s < context->stored_count; s++)
+    {
+        const scanmatch_stored_scan_t *stored = &context->stored[s];
+        for (uint32_t i = 0; i < stored->count; i++)
+        {
+            scanmatch_stamp(context, stored->points[2 * i], stored->points[2 * i + 1]);
+        }
+    }
+
+    // Each level doubles the block size: the maximum of four overlapping blocks of the level below
+    for (int level = 1; level < context->levels; level++)
+    {
+        const uint8_t *below = context->grids[level - 1];
+        uint8_t *grid = context->grids[level];
+        int half = 1 << (level - 1);
+        for (int y = 0; y < size; y++)
+        {
+            const uint8_t *row0 = below + (size_t)y * (size_t)size;
+            const uint8_t *row1 = y + half < size ? row0 + (size_t)half * (size_t)size : NULL;
+            uint8_t *out = grid + (size_t)y * (size_t)size;
+            for (int x = 0; x < size; x++)
+            {
+                uint8_t value = row0[x];
+                if (x + half < size)
+                {
+                    value = MAX(value, row0[x + half]);
+                }
+                if (row1)
+                {
+                    value = MAX(value, row1[x]);
+                    if (x + half < size)
+                    {
+                        value = MAX(value, row1[x + half]);
+                    }
+                }
+                out[x] = value;
+            }
+        }
+    }
+
+    context->map_valid = true;
+    context->scans_since_update = 0;
+}
+
+static bool scanmatch_store_scan(scanmatch_context_t *context, uint32_t count, const scanmatch_pose2d_t *pose)
+{
+    scanmatch_stored_scan_t *stored = &context->stored[context->stored_next];
+    size_t capacity = stored->capacity;
+    if (!scanmatch_reserve((void **)&stored->points, &capacity, (size_t)count, 2 * sizeof(float)))
+    {
+        return false;
+    }
+    stored->capacity = (uint32_t)capacity;
+
+    float c = cosf(pose->theta);
+    float s = sinf(pose->theta);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        float px = context->points[2 * i];
+        float py = context->points[2 * i + 1];
+        stored->points[2 * i] = c * px - s * py + pose->x;
+        stored->points[2 * i + 1] = s * px + c * py + pose->y;
+    }
+    stored->count = count;
+
+    context->stored_next = (context->stored_next + 1) % context->config.map_scans;
+    context->stored_count = MIN(context->stored_count + 1, context->config.map_scans);
+    context->scans_since_update++;
+    return true;
+}
+
+static int scanmatch_score(const uint8_t *grid, int size, const int32_t *cells, uint32_t count, int dx, int dy)
+{
+    int score = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        int x = cells[2 * i] + dx;
+        int y = cells[2 * i + 1] + dy;
+        if ((unsigned)x < (unsigned)size && (unsigned)y < (unsigned)size)
+        {
+            score += grid[(size_t)y * (size_t)size + (size_t)x];
+        }
+    }
+    return score;
+}
+
+static int scanmatch_compare_candidates(const void *a, const void *b)
+{
+    const scanmatch_candidate_t *ca = (const scanmatch_candidate_t *)a;
+    const scanmatch_candidate_t *cb = (const scanmatch_candidate_t *)b;
+    return (cb->score > ca->score) - (cb->score < ca->score);
+}
+
+// Depth first search below candidate, which sits on level. Subtrees whose bound cannot beat best are skipped.
+static void scanmatch_branch(const scanmatch_context_t *context,
+                             const scanmatch_candidate_t *candidate,
+                             int level,
+                             int window,
+                             uint32_t count,
+                             scanmatch_candidate_t *best)
+{
+    if (candidate->score <= best->score)
+    {
+        return;
+    }
+
+    if (level == 0)
+    {
+        *best = *candidate;
+        return;
+    }
+
+    int size = context->config.map_size_cells;
+    int half = 1 << (level - 1);
+    const int32_t *cells = context->cells + (size_t)candidate->angle * count * 2;
+
+    scanmatch_candidate_t children[4];
+    int child_count = 0;
+    for (int dy = 0; dy <= half; dy += half)
+    {
+        for (int dx = 0; dx <= half; dx += half)
+        {
+            scanmatch_candidate_t *child = &children[child_count];
+            child->angle = candidate->angle;
+            child->x = candidate->x + dx;
+            child->y = candidate->y + dy;
+            if (child->x > window || child->y > window)
+            {
+                continue;
+            }
+            child->score = scanmatch_score(context->grids[level - 1], size, cells, count, child->x, child->y);
+            child_count++;
+        }
+    }
+
+    qsort(children, (size_t)child_count, sizeof(children[0]), scanmatch_compare_candidates);
+    for (int i = 0; i < child_count; i++)
+    {
+        scanmatch_branch(context, &children[i], level - 1, window, count, best);
+    }
+}
+
+// Branch and bound over the search window around prediction. Returns false if no pose reaches min_score.
+static bool scanmatch_search(scanmatch_context_t *context,
+                             uint32_t count,
+                             float max_range,
+                             const scanmatch_pose2d_t *prediction,
+                             scanmatch_pose2d_t *result)
+{
+    const scanmatch_config_t *config = &context->config;
+    int size = config->map_size_cells;
+
+    // Heading step that moves the farthest return by about one cell
+    float step = acosf(1.0f - (config->resolution_mm * config->resolution_mm) / (2.0f * max_range * max_range));
+    int half_angles = (int)ceilf(config->search_angular_degrees * SCANMATCH_PI / 180.0f / step);
+    int angle_count = 2 * half_angles + 1;
+    int window = (int)ceilf(config->search_linear_mm / config->resolution_mm);
+
+    if (!scanmatch_reserve((void **)&context->cells,
+                           &context->cells_capacity,
+                           (size_t)angle_count * count * 2,
+                           sizeof(int32_t)))
+    {
+        return false;
+    }
+
+    for (int a = 0; a < angle_count; a++)
+    {
+        float theta = prediction->theta + (float)(a - half_angles) * step;
+        float c = cosf(theta);
+        float s = sinf(theta);
+        int32_t *cells = context->cells + (size_t)a * count * 2;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            float px = context->points[2 * i];
+            float py = context->points[2 * i + 1];
+            float x = c * px - s * py + prediction->x;
+            float y = s * px + c * py + prediction->y;
+            cells[2 * i] = (int32_t)floorf((x - context->origin[0]) / config->resolution_mm);
+            cells[2 * i + 1] = (int32_t)floorf((y - context->origin[1]) / config->resolution_mm);
+        }
+    }
+
+    // Candidates on the coarsest level tile the window with blocks of 2^top cells
+    int top = context->levels - 1;
+    int block = 1 << top;
+    int per_axis = (2 * window) / block + 1;
+    size_t top_count = (size_t)angle_count * (size_t)per_axis * (size_t)per_axis;
+    if (!scanmatch_reserve((void **)&context->candidates,
+                           &context->candidates_capacity,
+                           top_count,
+                           sizeof(scanmatch_candidate_t)))
+    {
+        return false;
+    }
+
+    size_t n = 0;
+    for (int a = 0; a < angle_count; a++)
+    {
+        const int32_t *cells = context->cells + (size_t)a * count * 2;
+        for (int y = -window; y <= window; y += block)
+        {
+            for (int x = -window; x <= window; x += block)
+            {
+                scanmatch_candidate_t *candidate = &context->candidates[n++];
+                candidate->angle = a;
+                candidate->x = x;
+                candidate->y = y;
+                candidate->score = scanmatch_score(context->grids[top], size, cells, count, x, y);
+            }
+        }
+    }
+    qsort(context->candidates, n, sizeof(scanmatch_candidate_t), scanmatch_compare_candidates);
+
+    scanmatch_candidate_t best;
+    memset(&best, 0, sizeof(best));
+    best.score = (int)(config->min_score * 255.0f * (float)count) - 1;
+    best.angle = -1;
+    for (size_t i = 0; i < n; i++)
+    {
+        scanmatch_branch(context, &context->candidates[i], top, window, count, &best);
+    }
+
+    if (best.angle < 0)
+    {
+        return false;
+    }
+
+    result->x = prediction->x + (float)best.x * config->resolution_mm;
+    result->y = prediction->y + (float)best.y * config->resolution_mm;
+    result->theta = prediction->theta + (float)(best.angle - half_angles) * step;
+    return true;
+}
+
+// Bilinear likelihood of the map at (x, y) in [0, 1] and its gradient per millimeter
+static float scanmatch_interpolate(const scanmatch_context_t *context, float x, float y, float gradient[2])
+{
+    int size = context->config.map_size_cells;
+    float gx = (x - context->origin[0]) / context->config.resolution_mm - 0.5f;
+    float gy = (y - context->origin[1]) / context->config.resolution_mm - 0.5f;
+    float fx = floorf(gx);
+    float fy = floorf(gy);
+    int ix = (int)fx;
+    int iy = (int)fy;
+
+    gradient[0] = 0;
+    gradient[1] = 0;
+    if (ix < 0 || iy < 0 || ix + 1 >= size || iy + 1 >= size)
+    {
+        return 0;
+    }
+
+    const uint8_t *row0 = context->grids[0] + (size_t)iy * (size_t)size + (size_t)ix;
+    const uint8_t *row1 = row0 + size;
+    float ax = gx - fx;
+    float ay = gy - fy;
+    float top = row0[0] + ax * (float)(row0[1] - row0[0]);
+    float bottom = row1[0] + ax * (float)(row1[1] - row1[0]);
+
+    float scale = 1.0f / (255.0f * context->config.resolution_mm);
+    gradient[0] = ((1 - ay) * (float)(row0[1] - row0[0]) + ay * (float)(row1[1] - row1[0])) * scale;
+    gradient[1] = (bottom - top) * scale;
+    return (top + ay * (bottom - top)) / 255.0f;
+}
+
+// Sum of the squared likelihood deficits of the returns; also the mean likelihood if requested
+static float scanmatch_cost(const scanmatch_context_t *context,
+                            uint32_t count,
+                            const scanmatch_pose2d_t *pose,
+                            float *mean_likelihood)
+{
+    float c = cosf(pose->theta);
+    float s = sinf(pose->theta);
+    float cost = 0;
+    float likelihood = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        float px = context->points[2 * i];
+        float py = context->points[2 * i + 1];
+        float gradient[2];
+        float residual = 1.0f - scanmatch_interpolate(context,
+                                                      c * px - s * py + pose->x,
+                                                      s * px + c * py + pose->y,
+                                                      gradient);
+        cost += residual * residual;
+        likelihood += 1.0f - residual;
+    }
+
+    if (mean_likelihood)
+    {
+        *mean_likelihood = likelihood / (float)count;
+    }
+    return cost;
+}
+
+// Levenberg-Marquardt on the interpolated likelihood, starting from the branch and bound result
+static void scanmatch_refine(const scanmatch_context_t *context, uint32_t count, scanmatch_pose2d_t *pose)
+{
+    float cost = scanmatch_cost(context, count, pose, NULL);
+    float lambda = 1e-3f;
+
+    for (int iteration = 0; iteration < SCANMATCH_REFINE_ITERATIONS; iteration++)
+    {
+        float c = cosf(pose->theta);
+        float s = sinf(pose->theta);
+        float h[3 * 3] = { 0 };
+        float g[3] = { 0 };
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            float px = context->points[2 * i];
+            float py = context->points[2 * i + 1];
+            float rx = c * px - s * py; // Return relative to the sensor, in map axes
+            float ry = s * px + c * py;
+            float gradient[2];
+            float residual = 1.0f - scanmatch_interpolate(context, rx + pose->x, ry + pose->y, gradient);
+
+            float j[3] = { -gradient[0], -gradient[1], -(gradient[0] * -ry + gradient[1] * rx) };
+            for (int r = 0; r < 3; r++)
+            {
+                for (int k = 0; k < 3; k++)
+                {
+                    h[r * 3 + k] += j[r] * j[k];
+                }
+                g[r] += j[r] * residual;
+            }
+        }
+
+        for (int r = 0; r < 3; r++)
+        {
+            h[r * 3 + r] *= 1.0f + lambda;
+        }
+
+        float inverse[3 * 3];
+        float step[3];
+        if (!math_invert_3x3(h, inverse))
+        {
+            return;
+        }
+        math_mult_Ax_3x3(inverse, g, step);
+
+        scanmatch_pose2d_t next = { pose->x - step[0], pose->y - step[1], pose->theta - step[2] };
+        float next_cost = scanmatch_cost(context, count, &next, NULL);
+        if (next_cost < cost)
+        {
+            *pose = next;
+            lambda *= 0.1f;
+            if (cost - next_cost < 1e-4f * cost)
+            {
+                return;
+            }
+            cost = next_cost;
+        }
+        else
+        {
+            lambda *= 10.0f;
+        }
+    }
+}
+
+void scanmatch_reset(scanmatch_t scanmatch_handle)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(VOID_VALUE, scanmatch_t, scanmatch_handle);
+    scanmatch_context_t *context = scanmatch_t_get_context(scanmatch_handle);
+
+    context->map_valid = false;
+    context->stored_next = 0;
+    context->stored_count = 0;
+    context->scans_since_update = 0;
+    context->have_pose = false;
+    context->lost_scans = 0;
+    memset(&context->pose, 0, sizeof(context->pose));
+    memset(&context->velocity, 0, sizeof(context->velocity));
+}
+
+zsa_result_t scanmatch_create(const scanmatch_config_t *config, scanmatch_t *scanmatch_handle)
+{
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, config == NULL);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, scanmatch_handle == NULL);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, config->resolution_mm <= 0);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, config->map_size_cells < 16);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, config->max_range_mm <= config->min_range_mm);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, config->hit_sigma_mm <= 0);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, config->search_linear_mm < 0 || config->search_angular_degrees < 0);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, config->map_scans <= 0 || config->map_update_interval <= 0);
+
+    scanmatch_context_t *context = scanmatch_t_create(scanmatch_handle);
+    zsa_result_t result = ZSA_RESULT_FROM_BOOL(context != NULL);
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        context->config = *config;
+
+        // Enough levels for the coarsest block to span the whole linear window
+        int window_cells = 2 * (int)ceilf(config->search_linear_mm / config->resolution_mm) + 1;
+        context->levels = 1;
+        while (context->levels < SCANMATCH_MAX_LEVELS && (1 << (context->levels - 1)) < window_cells)
+        {
+            context->levels++;
+        }
+
+        size_t grid_size = (size_t)config->map_size_cells * (size_t)config->map_size_cells;
+        for (int level = 0; ZSA_SUCCEEDED(result) && level < context->levels; level++)
+        {
+            context->grids[level] = (uint8_t *)malloc(grid_size);
+            result = ZSA_RESULT_FROM_BOOL(context->grids[level] != NULL);
+        }
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        context->stored = (scanmatch_stored_scan_t *)calloc((size_t)config->map_scans, sizeof(scanmatch_stored_scan_t));
+        result = ZSA_RESULT_FROM_BOOL(context->stored != NULL);
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        context->kernel_radius = (int)ceilf(3.0f * config->hit_sigma_mm / config->resolution_mm);
+        int kernel_size = 2 * context->kernel_radius + 1;
+        context->kernel = (uint8_t *)malloc((size_t)kernel_size * (size_t)kernel_size);
+        result = ZSA_RESULT_FROM_BOOL(context->kernel != NULL);
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        int kernel_size = 2 * context->kernel_radius + 1;
+        float sigma_cells = config->hit_sigma_mm / config->resolution_mm;
+        float scale = 1.0f / (2.0f * sigma_cells * sigma_cells);
+        for (int ky = 0; ky < kernel_size; ky++)
+        {
+            for (int kx = 0; kx < kernel_size; kx++)
+            {
+                int dx = kx - context->kernel_radius;
+                int dy = ky - context->kernel_radius;
+                float likelihood = expf(-(float)(dx * dx + dy * dy) * scale);
+                context->kernel[ky * kernel_size + kx] = (uint8_t)(255.0f * likelihood + 0.5f);
+            }
+        }
+    }
+
+    if (ZSA_FAILED(result) && context != NULL)
+    {
+        scanmatch_destroy(*scanmatch_handle);
+        *scanmatch_handle = NULL;
+    }
+
+    return result;
+}
+
+void scanmatch_destroy(scanmatch_t scanmatch_handle)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(VOID_VALUE, scanmatch_t, scanmatch_handle);
+    scanmatch_context_t *context = scanmatch_t_get_context(scanmatch_handle);
+
+    for (int level = 0; level < SCANMATCH_MAX_LEVELS; level++)
+    {
+        free(context->grids[level]);
+    }
+
+    if (context->stored)
+    {
+        for (int s = 0; s < context->config.map_scans; s++)
+        {
+            free(context->stored[s].points);
+        }
+        free(context->stored);
+    }
+
+    free(context->kernel);
+    free(context->points);
+    free(context->cells);
+    free(context->candidates);
+
+    scanmatch_t_destroy(scanmatch_handle);
+}
+
+zsa_result_t scanmatch_process(scanmatch_t scanmatch_handle, const scanmatch_scan_t *scan, scanmatch_pose_t *pose)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_RESULT_FAILED, scanmatch_t, scanmatch_handle);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, scan == NULL);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, scan->points == NULL && scan->point_count > 0);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, pose == NULL);
+    scanmatch_context_t *context = scanmatch_t_get_context(scanmatch_handle);
+    const scanmatch_config_t *config = &context->config;
+
+    memset(pose, 0, sizeof(*pose));
+    pose->device_timestamp_usec = scan->device_timestamp_usec;
+    pose->system_timestamp_nsec = scan->system_timestamp_nsec;
+
+    zsa_result_t result = ZSA_RESULT_SUCCEEDED;
+    if (pose->system_timestamp_nsec == 0)
+    {
+        result = TRACE_CALL(image_get_system_time_nsec(&pose->system_timestamp_nsec));
+    }
+
+    size_t capacity = context->points_capacity;
+    if (ZSA_SUCCEEDED(result))
+    {
+        result = ZSA_RESULT_FROM_BOOL(
+            scanmatch_reserve((void **)&context->points, &capacity, scan->point_count, 2 * sizeof(float)));
+        context->points_capacity = (uint32_t)capacity;
+    }
+
+    if (ZSA_FAILED(result))
+    {
+        return result;
+    }
+
+    uint32_t count = 0;
+    float max_range = 0;
+    for (uint32_t i = 0; i < scan->point_count; i++)
+    {
+        float range = scan->points[i].range_mm;
+        if (range >= config->min_range_mm && range <= config->max_range_mm)
+        {
+            context->points[2 * count] = range * cosf(scan->points[i].angle_rad);
+            context->points[2 * count + 1] = range * sinf(scan->points[i].angle_rad);
+            max_range = MAX(max_range, range);
+            count++;
+        }
+    }
+
+    scanmatch_pose2d_t prediction = context->pose;
+    if (context->have_pose)
+    {
+        prediction.x += context->velocity.x;
+        prediction.y += context->velocity.y;
+        prediction.theta = scanmatch_wrap_angle(prediction.theta + context->velocity.theta);
+    }
+
+    scanmatch_pose2d_t estimate = prediction;
+    bool matched = false;
+    if (count >= SCANMATCH_MIN_POINTS && context->map_valid)
+    {
+        matched = scanmatch_search(context, count, max_range, &prediction, &estimate);
+        if (matched)
+        {
+            scanmatch_refine(context, count, &estimate);
+            estimate.theta = scanmatch_wrap_angle(estimate.theta);
+            (void)scanmatch_cost(context, count, &estimate, &pose->score);
+        }
+    }
+
+    if (matched)
+    {
+        context->velocity.x = estimate.x - context->pose.x;
+        context->velocity.y = estimate.y - context->pose.y;
+        context->velocity.theta = scanmatch_wrap_angle(estimate.theta - context->pose.theta);
+        context->pose = estimate;
+        context->lost_scans = 0;
+        (void)scanmatch_store_scan(context, count, &estimate);
+
+        float dx = estimate.x - (context->origin[0] + 0.5f * (float)config->map_size_cells * config->resolution_mm);
+        float dy = estimate.y - (context->origin[1] + 0.5f * (float)config->map_size_cells * config->resolution_mm);
+        float drift_limit = 0.25f * (float)config->map_size_cells * config->resolution_mm;
+        if (context->scans_since_update >= config->map_update_interval || dx * dx + dy * dy > drift_limit * drift_limit)
+        {
+            scanmatch_rebuild_map(context, &estimate);
+        }
+    }
+    else if (count >= SCANMATCH_MIN_POINTS &&
+             (!context->map_valid || ++context->lost_scans >= SCANMATCH_MAX_LOST_SCANS))
+    {
+        // First scan, or lost for too long: start a new map from this scan where it was expected to be
+        if (context->map_valid)
+        {
+            LOG_WARNING("Scan matching lost for %d scans, restarting the local map", context->lost_scans);
+        }
+        context->stored_next = 0;
+        context->stored_count = 0;
+        context->pose = prediction;
+        memset(&context->velocity, 0, sizeof(context->velocity));
+        context->lost_scans = 0;
+        if (scanmatch_store_scan(context, count, &prediction))
+        {
+            scanmatch_rebuild_map(context, &prediction);
+        }
+    }
+    else
+    {
+        memset(&context->velocity, 0, sizeof(context->velocity));
+        context->pose = prediction;
+    }
+    context->have_pose = true;
+
+    pose->valid = matched;
+    pose->x_mm = context->pose.x;
+    pose->y_mm = context->pose.y;
+    pose->theta_rad = context->pose.theta;
+    return result;
+}
@@ -6,14 +6,21 @@
 
 // Dependent libraries
 #include <zsainternal/common.h>
+#include <zsainternal/allocator.h>
+#include <zsainternal/camserver.h>
 #include <zsainternal/capture.h>
 #include <zsainternal/color.h>
 #include <zsainternal/color_mcu.h>
+#include <zsainternal/flightrec.h>
 // #include <zsainternal/depth_mcu.h>
 // #include <zsainternal/calibration.h>
 #include <zsainternal/capturesync.h>
+#include <zsainternal/multidevice.h>
+#include <zsainternal/queue.h>
+#include <zsainternal/threadpool.h>
 // #include <zsainternal/transformation.h>
 #include <zsainternal/logging.h>
+#include <azure_c_shared_utility/threadapi.h>
 #include <azure_c_shared_utility/tickcounter.h>
 #include <astra/capi/astra.h>
 
@@ -23,6 +30,10 @@
 #include <stdbool.h>
 #include <assert.h>
 
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -44,10 +55,56 @@ typedef struct _zsa_context_t
     color_t color;
 
     bool color_started;
+
+    // Configuration the cameras were last started with. The MCU keeps its sync settings while the device is open.
+    zsa_device_configuration_t config;
+    bool config_valid;
+
+    // Set by zsa_device_standby_cameras(), the sensors keep streaming but their frames are dropped by the color module
+    // before they are decoded. Read by the streaming thread, so only accessed through device_set_standby() and
+    // device_in_standby().
+    volatile long standby;
+
+    // Set while the device streams as part of a zsa_device_group_t, captures are then routed to the group
+    multidevice_t multidevice;
+    uint32_t multidevice_index;
+
+    // Set by zsa_device_start_server(), publishes the captures of capturesync to other processes
+    camserver_t camserver;
+
+    // Set by zsa_device_start_flight_recorder(), keeps the last captures of capturesync in memory
+    flightrec_t flightrec;
 } zsa_context_t;
 
 ZSA_DECLARE_CONTEXT(zsa_device_t, zsa_context_t);
 
+typedef struct _zsa_client_context_t
+{
+    camclient_t camclient;
+} zsa_client_context_t;
+
+ZSA_DECLARE_CONTEXT(zsa_client_t, zsa_client_context_t);
+
+typedef struct _zsa_subscriber_context_t
+{
+    capturesync_t capturesync; // Of the device subscribed to
+    queue_t queue;
+} zsa_subscriber_context_t;
+
+ZSA_DECLARE_CONTEXT(zsa_subscriber_t, zsa_subscriber_context_t);
+
+typedef struct _zsa_device_group_context_t
+{
+    zsa_device_t devices[MULTIDEVICE_MAX_DEVICES];
+    uint32_t device_count;
+
+    multidevice_t multidevice; // Only exists while the group's cameras run
+
+    threadpool_t pool; // Starts the subordinates side by side
+} zsa_device_group_context_t;
+
+ZSA_DECLARE_CONTEXT(zsa_device_group_t, zsa_device_group_context_t);
+
 #define DEPTH_CAPTURE (false)
 #define COLOR_CAPTURE (true)
 #define TRANSFORM_ENABLE_GPU_OPTIMIZATION (true)
@@ -66,12 +123,43 @@ ZSA_DECLARE_CONTEXT(zsa_device_t, zsa_context_t);
 
 uint32_t zsa_device_get_installed_count(void)
 {
-    uint32_t device_count = 9;
-    // usb_cmd_get_device_count(&device_count);
-    LOG_ERROR("zs: zsa_device_get_installed_count not implemented", 0);
+    uint32_t device_count = 0;
+    uint32_t camera_count = 0;
+
+    if (ZSA_FAILED(usb_cmd_get_device_count(&device_count)))
+    {
+        return 0;
+    }
+
+    // A device can only be opened when its color camera enumerated too. Platforms that can not count the cameras on
+    // their own report the MCU count.
+    if (ZSA_SUCCEEDED(color_get_device_count(&camera_count)) && camera_count < device_count)
+    {
+        LOG_WARNING("Found %d devices but only %d color cameras", device_count, camera_count);
+        device_count = camera_count;
+    }
+
     return device_count;
 }
 
+static void device_set_standby(zsa_context_t *device, bool standby)
+{
+#ifdef _WIN32
+    (void)InterlockedExchange(&device->standby, standby ? 1 : 0);
+#else
+    __atomic_store_n(&device->standby, standby ? 1 : 0, __ATOMIC_SEQ_CST);
+#endif
+}
+
+static bool device_in_standby(zsa_context_t *device)
+{
+#ifdef _WIN32
+    return InterlockedCompareExchange(&device->standby, 0, 0) != 0;
+#else
+    return __atomic_load_n(&device->standby, __ATOMIC_SEQ_CST) != 0;
+#endif
+}
+
 color_cb_streaming_capture_t color_capture_ready;
 
 void color_capture_ready(zsa_result_t result, zsa_capture_t capture_handle, void *callback_context)
@@ -79,15 +167,25 @@ void color_capture_ready(zsa_result_t result, zsa_capture_t capture_handle, void
     zsa_device_t device_handle = (zsa_device_t)callback_context;
     RETURN_VALUE_IF_HANDLE_INVALID(VOID_VALUE, zsa_device_t, device_handle);
     zsa_context_t *device = zsa_device_t_get_context(device_handle);
-    capturesync_add_capture(device->capturesync, result, capture_handle, COLOR_CAPTURE);
+
+    if (device_in_standby(device))
+    {
+        return;
+    }
+
+    if (device->multidevice)
+    {
+        multidevice_add_capture(device->multidevice, device->multidevice_index, result, capture_handle);
+    }
+    else
+    {
+        capturesync_add_capture(device->capturesync, result, capture_handle, COLOR_CAPTURE);
+    }
 }
 
-zsa_result_t zsa_device_open(uint32_t index, zsa_device_t *device_handle)
+// Builds the device around an opened color MCU, which the device takes ownership of
+static zsa_result_t device_open_colormcu(colormcu_t colormcu, zsa_device_t *device_handle)
 {
-    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, device_handle == NULL);
-
-    // device是一台机器人所有视觉传感器的集合,支持同一相机的不同实例?
-    // 此结构体包含视觉传感器的所有配置信息，定义在本文件
     zsa_context_t *device = NULL;
     zsa_result_t result = ZSA_RESULT_SUCCEEDED;
     zsa_device_t handle = NULL;
@@ -97,18 +195,34 @@ zsa_result_t zsa_device_open(uint32_t index, zsa_device_t *device_handle)
 
     allocator_initialize();
 
-    // 此定义还没有找到
     device = zsa_device_t_create(&handle);
     result = ZSA_RESULT_FROM_BOOL(device != NULL);
 
+    if (ZSA_SUCCEEDED(result))
+    {
+        device->colormcu = colormcu;
+    }
+    else
+    {
+        colormcu_destroy(colormcu);
+        allocator_deinitialize();
+    }
+
     if (ZSA_SUCCEEDED(result))
     {
         result = ZSA_RESULT_FROM_BOOL((device->tick_handle = tickcounter_create()) != NULL);
     }
 
+    // The serial number finds the UVC color camera and the container ID the Media Foundation one of this device
+    if (ZSA_SUCCEEDED(result))
+    {
+        result = ZSA_RESULT_FROM_BOOL(colormcu_get_usb_serialnum(colormcu, serial_number, &serial_number_size) ==
+                                      ZSA_BUFFER_RESULT_SUCCEEDED);
+    }
+
     if (ZSA_SUCCEEDED(result))
     {
-        result = TRACE_CALL(colormcu_create(container_id, &device->colormcu));
+        result = ZSA_RESULT_FROM_BOOL((container_id = colormcu_get_container_id(colormcu)) != NULL);
     }
 
     if (ZSA_SUCCEEDED(result))
@@ -136,6 +250,81 @@ zsa_result_t zsa_device_open(uint32_t index, zsa_device_t *device_handle)
     return result;
 }
 
+zsa_result_t zsa_device_open(uint32_t index, zsa_device_t *device_handle)
+{
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, device_handle == NULL);
+
+    colormcu_t colormcu = NULL;
+    zsa_result_t result = TRACE_CALL(colormcu_create_by_index(index, &colormcu));
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        result = TRACE_CALL(device_open_colormcu(colormcu, device_handle));
+    }
+
+    return result;
+}
+
+zsa_result_t zsa_device_open_by_serialnum(const char *serial_number, zsa_device_t *device_handle)
+{
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, serial_number == NULL);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, device_handle == NULL);
+
+    colormcu_t colormcu = NULL;
+    uint32_t device_count = 0;
+    uint32_t cached_index = 0;
+    zsa_result_t result = ZSA_RESULT_SUCCEEDED;
+
+    // A device opened before is found without opening every candidate, as long as it did not enumerate again
+    if (ZSA_SUCCEEDED(usb_cmd_find_device_index(USB_DEVICE_COLOR_IMU_PROCESSOR, serial_number, &cached_index)))
+    {
+        char candidate[MAX_SERIAL_NUMBER_LENGTH];
+        size_t candidate_size = sizeof(candidate);
+
+        if (ZSA_SUCCEEDED(colormcu_create_by_index(cached_index, &colormcu)) &&
+            (colormcu_get_usb_serialnum(colormcu, candidate, &candidate_size) != ZSA_BUFFER_RESULT_SUCCEEDED ||
+             strcmp(candidate, serial_number) != 0))
+        {
+            colormcu_destroy(colormcu);
+            colormcu = NULL;
+        }
+    }
+
+    if (colormcu == NULL)
+    {
+        result = TRACE_CALL(usb_cmd_get_device_count(&device_count));
+    }
+
+    // Indices shift as devices come and go, so every candidate is identified by the serial number it reports
+    for (uint32_t index = 0; ZSA_SUCCEEDED(result) && index < device_count && colormcu == NULL; index++)
+    {
+        char candidate[MAX_SERIAL_NUMBER_LENGTH];
+        size_t candidate_size = sizeof(candidate);
+
+        // Devices opened elsewhere fail to open and are skipped
+        if (ZSA_SUCCEEDED(colormcu_create_by_index(index, &colormcu)) &&
+            (colormcu_get_usb_serialnum(colormcu, candidate, &candidate_size) != ZSA_BUFFER_RESULT_SUCCEEDED ||
+             strcmp(candidate, serial_number) != 0))
+        {
+            colormcu_destroy(colormcu);
+            colormcu = NULL;
+        }
+    }
+
+    if (ZSA_SUCCEEDED(result) && colormcu == NULL)
+    {
+        LOG_ERROR("No available device has serial number %s", serial_number);
+        result = ZSA_RESULT_FAILED;
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        result = TRACE_CALL(device_open_colormcu(colormcu, device_handle));
+    }
+
+    return result;
+}
+
 void zsa_device_close(zsa_device_t device_handle)
 {
     RETURN_VALUE_IF_HANDLE_INVALID(VOID_VALUE, zsa_device_t, device_handle);
@@ -147,6 +336,19 @@ void zsa_device_close(zsa_device_t device_handle)
         capturesync_stop(device->capturesync);
     }
 
+    // The server and the recorder subscribe to capturesync
+    if (device->camserver)
+    {
+        camserver_destroy(device->camserver);
+        device->camserver = NULL;
+    }
+
+    if (device->flightrec)
+    {
+        flightrec_destroy(device->flightrec);
+        device->flightrec = NULL;
+    }
+
     if (device->color)
     {
         color_destroy(device->color);
@@ -176,29 +378,210 @@ void zsa_device_close(zsa_device_t device_handle)
     allocator_deinitialize();
 }
 
-// zsa_wait_result_t zsa_device_get_capture(zsa_device_t device_handle,
-//                                          zsa_capture_t *capture_handle,
-//                                          int32_t timeout_in_ms)
-// {
-//     RETURN_VALUE_IF_HANDLE_INVALID(ZSA_WAIT_RESULT_FAILED, zsa_device_t, device_handle);
-//     RETURN_VALUE_IF_ARG(ZSA_WAIT_RESULT_FAILED, capture_handle == NULL);
-//     zsa_context_t *device = zsa_device_t_get_context(device_handle);
-//     return TRACE_WAIT_CALL(capturesync_get_capture(device->capturesync, capture_handle, timeout_in_ms));
-// }
+zsa_wait_result_t zsa_device_get_capture(zsa_device_t device_handle,
+                                         zsa_capture_t *capture_handle,
+                                         int32_t timeout_in_ms)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_WAIT_RESULT_FAILED, zsa_device_t, device_handle);
+    RETURN_VALUE_IF_ARG(ZSA_WAIT_RESULT_FAILED, capture_handle == NULL);
+    zsa_context_t *device = zsa_device_t_get_context(device_handle);
+    return TRACE_WAIT_CALL(capturesync_get_capture(device->capturesync, capture_handle, timeout_in_ms));
+}
 
-// zsa_image_t zsa_capture_get_color_image(zsa_capture_t capture_handle)
-// {
-//     return capture_get_color_image(capture_handle);
-// }
+void zsa_capture_reference(zsa_capture_t capture_handle)
+{
+    capture_inc_ref(capture_handle);
+}
 
-// zsa_result_t zsa_image_create(zsa_image_format_t format,
-//                               int width_pixels,
-//                               int height_pixels,
-//                               int stride_bytes,
-//                               zsa_image_t *image_handle)
-// {
-//     return image_create(format, width_pixels, height_pixels, stride_bytes, ALLOCATION_SOURCE_USER, image_handle);
-// }
+void zsa_capture_release(zsa_capture_t capture_handle)
+{
+    capture_dec_ref(capture_handle);
+}
+
+zsa_image_t zsa_capture_get_color_image(zsa_capture_t capture_handle)
+{
+    return capture_get_color_image(capture_handle);
+}
+
+zsa_image_t zsa_capture_get_color_decoded_image(zsa_capture_t capture_handle)
+{
+    return capture_get_color_decoded_image(capture_handle);
+}
+
+zsa_result_t zsa_image_create(zsa_image_format_t format,
+                              int width_pixels,
+                              int height_pixels,
+                              int stride_bytes,
+                              zsa_image_t *image_handle)
+{
+    return image_create(format, width_pixels, height_pixels, stride_bytes, ALLOCATION_SOURCE_USER, image_handle);
+}
+
+uint8_t *zsa_image_get_buffer(zsa_image_t image_handle)
+{
+    return image_get_buffer(image_handle);
+}
+
+size_t zsa_image_get_size(zsa_image_t image_handle)
+{
+    return image_get_size(image_handle);
+}
+
+zsa_image_format_t zsa_image_get_format(zsa_image_t image_handle)
+{
+    return image_get_format(image_handle);
+}
+
+int zsa_image_get_width_pixels(zsa_image_t image_handle)
+{
+    return image_get_width_pixels(image_handle);
+}
+
+int zsa_image_get_height_pixels(zsa_image_t image_handle)
+{
+    return image_get_height_pixels(image_handle);
+}
+
+int zsa_image_get_stride_bytes(zsa_image_t image_handle)
+{
+    return image_get_stride_bytes(image_handle);
+}
+
+uint64_t zsa_image_get_device_timestamp_usec(zsa_image_t image_handle)
+{
+    return image_get_device_timestamp_usec(image_handle);
+}
+
+uint64_t zsa_image_get_system_timestamp_nsec(zsa_image_t image_handle)
+{
+    return image_get_system_timestamp_nsec(image_handle);
+}
+
+void zsa_image_reference(zsa_image_t image_handle)
+{
+    image_inc_ref(image_handle);
+}
+
+void zsa_image_release(zsa_image_t image_handle)
+{
+    image_dec_ref(image_handle);
+}
+
+static zsa_result_t memory_source_from_public(zsa_memory_source_t source, allocation_source_t *allocation_source)
+{
+    switch (source)
+    {
+    case ZSA_MEMORY_SOURCE_USER:
+        *allocation_source = ALLOCATION_SOURCE_USER;
+        return ZSA_RESULT_SUCCEEDED;
+    case ZSA_MEMORY_SOURCE_DEPTH:
+        *allocation_source = ALLOCATION_SOURCE_DEPTH;
+        return ZSA_RESULT_SUCCEEDED;
+    case ZSA_MEMORY_SOURCE_COLOR:
+        *allocation_source = ALLOCATION_SOURCE_COLOR;
+        return ZSA_RESULT_SUCCEEDED;
+    case ZSA_MEMORY_SOURCE_IMU:
+        *allocation_source = ALLOCATION_SOURCE_IMU;
+        return ZSA_RESULT_SUCCEEDED;
+    case ZSA_MEMORY_SOURCE_USB_DEPTH:
+        *allocation_source = ALLOCATION_SOURCE_USB_DEPTH;
+        return ZSA_RESULT_SUCCEEDED;
+    case ZSA_MEMORY_SOURCE_USB_IMU:
+        *allocation_source = ALLOCATION_SOURCE_USB_IMU;
+        return ZSA_RESULT_SUCCEEDED;
+    default:
+        LOG_ERROR("Invalid memory source %d", source);
+        return ZSA_RESULT_FAILED;
+    }
+}
+
+zsa_result_t zsa_set_memory_backend(zsa_memory_source_t source, zsa_memory_backend_t backend, int numa_node)
+{
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED,
+                        backend != ZSA_MEMORY_BACKEND_HEAP && backend != ZSA_MEMORY_BACKEND_HUGE_PAGES);
+    allocation_source_t allocation_source;
+
+    zsa_result_t result = TRACE_CALL(memory_source_from_public(source, &allocation_source));
+    if (ZSA_SUCCEEDED(result))
+    {
+        allocator_backend_t allocator_backend = backend == ZSA_MEMORY_BACKEND_HUGE_PAGES ?
+                                                    ALLOCATOR_BACKEND_HUGE_PAGES :
+                                                    ALLOCATOR_BACKEND_HEAP;
+        result = TRACE_CALL(allocator_set_backend(allocation_source, allocator_backend, numa_node));
+    }
+    return result;
+}
+
+zsa_result_t zsa_get_memory_backend_stats(zsa_memory_source_t source, zsa_memory_backend_stats_t *stats)
+{
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, stats == NULL);
+    allocation_source_t allocation_source;
+    allocator_backend_stats_t backend_stats;
+
+    zsa_result_t result = TRACE_CALL(memory_source_from_public(source, &allocation_source));
+    if (ZSA_SUCCEEDED(result))
+    {
+        result = TRACE_CALL(allocator_get_backend_stats(allocation_source, &backend_stats));
+    }
+    if (ZSA_SUCCEEDED(result))
+    {
+        stats->allocations = backend_stats.allocations;
+        stats->huge_page_allocations = backend_stats.huge_page_allocations;
+        stats->cached_allocations = backend_stats.cached_allocations;
+        stats->numa_bind_failures = backend_stats.numa_bind_failures;
+    }
+    return result;
+}
+
+zsa_result_t zsa_set_memory_budget(zsa_memory_source_t source, size_t budget_bytes, zsa_memory_budget_policy_t policy)
+{
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, policy != ZSA_MEMORY_BUDGET_SHED && policy != ZSA_MEMORY_BUDGET_FAIL);
+    allocation_source_t allocation_source;
+
+    zsa_result_t result = TRACE_CALL(memory_source_from_public(source, &allocation_source));
+    if (ZSA_SUCCEEDED(result))
+    {
+        allocator_budget_policy_t budget_policy = policy == ZSA_MEMORY_BUDGET_FAIL ? ALLOCATOR_BUDGET_FAIL :
+                                                                                     ALLOCATOR_BUDGET_SHED;
+        result = TRACE_CALL(allocator_set_budget(allocation_source, budget_bytes, budget_policy));
+    }
+    return result;
+}
+
+void zsa_set_total_memory_budget(size_t budget_bytes)
+{
+    allocator_set_total_budget(budget_bytes);
+}
+
+zsa_result_t zsa_get_memory_usage(zsa_memory_usage_t *usage)
+{
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, usage == NULL);
+    allocator_memory_usage_t allocator_usage;
+
+    allocator_get_memory_usage(&allocator_usage);
+    usage->bytes_in_flight = allocator_usage.bytes_in_flight;
+    usage->budget_bytes = allocator_usage.budget_bytes;
+    for (int i = 0; i < ZSA_MEMORY_SOURCE_COUNT; i++)
+    {
+        allocation_source_t allocation_source;
+        zsa_result_t result = TRACE_CALL(memory_source_from_public((zsa_memory_source_t)i, &allocation_source));
+        if (ZSA_FAILED(result))
+        {
+            return result;
+        }
+
+        const allocator_source_usage_t *source_usage = &allocator_usage.sources[allocation_source];
+        usage->sources[i].bytes_in_flight = source_usage->bytes_in_flight;
+        usage->sources[i].peak_bytes_in_flight = source_usage->peak_bytes_in_flight;
+        usage->sources[i].budget_bytes = source_usage->budget_bytes;
+        usage->sources[i].budget_policy = source_usage->budget_policy == ALLOCATOR_BUDGET_FAIL ?
+                                              ZSA_MEMORY_BUDGET_FAIL :
+                                              ZSA_MEMORY_BUDGET_SHED;
+        usage->sources[i].shed_count = source_usage->shed_count;
+        usage->sources[i].failed_allocations = source_usage->failed_allocations;
+    }
+    return ZSA_RESULT_SUCCEEDED;
+}
 
 static zsa_result_t validate_configuration(zsa_context_t *device, const zsa_device_configuration_t *config)
 {
@@ -208,6 +591,69 @@ static zsa_result_t validate_configuration(zsa_context_t *device, const zsa_devi
     return result;
 }
 
+// Settings the color MCU is configured with by colormcu_set_multi_device_mode()
+static bool sync_configuration_equal(const zsa_device_configuration_t *a, const zsa_device_configuration_t *b)
+{
+    return a->wired_sync_mode == b->wired_sync_mode &&
+           a->subordinate_delay_off_master_usec == b->subordinate_delay_off_master_usec &&
+           a->depth_delay_off_color_usec == b->depth_delay_off_color_usec &&
+           a->disable_streaming_indicator == b->disable_streaming_indicator;
+}
+
+static bool configuration_equal(const zsa_device_configuration_t *a, const zsa_device_configuration_t *b)
+{
+    return a->color_format == b->color_format && a->color_resolution == b->color_resolution &&
+           a->depth_mode == b->depth_mode && a->camera_fps == b->camera_fps &&
+           a->synchronized_images_only == b->synchronized_images_only && a->color_scale == b->color_scale &&
+           memcmp(&a->color_crop, &b->color_crop, sizeof(a->color_crop)) == 0 &&
+           a->color_decode_on_demand == b->color_decode_on_demand && sync_configuration_equal(a, b);
+}
+
+typedef struct _device_bringup_t
+{
+    zsa_context_t *device;
+    const zsa_device_configuration_t *config;
+    zsa_result_t mcu_result;
+    zsa_result_t color_result;
+} device_bringup_t;
+
+static int device_bringup_mcu_thread(void *context)
+{
+    device_bringup_t *bringup = (device_bringup_t *)context;
+    zsa_context_t *device = bringup->device;
+
+    // The MCU keeps its sync settings until it is told otherwise
+    if (!device->config_valid || !sync_configuration_equal(&device->config, bringup->config))
+    {
+        device->config_valid = false;
+        bringup->mcu_result = TRACE_CALL(colormcu_set_multi_device_mode(device->colormcu, bringup->config));
+    }
+
+    return 0;
+}
+
+// The color MCU and the color camera are separate USB functions, so neither has to wait for the other's round trips.
+// The MCU is set up on a thread that only lives for the bring-up while the caller prepares the color camera.
+static void device_bringup(device_bringup_t *bringup)
+{
+    THREAD_HANDLE mcu_thread = NULL;
+    if (ThreadAPI_Create(&mcu_thread, device_bringup_mcu_thread, bringup) != THREADAPI_OK)
+    {
+        mcu_thread = NULL;
+        (void)device_bringup_mcu_thread(bringup);
+    }
+
+    if (bringup->config->color_resolution != ZSA_COLOR_RESOLUTION_OFF)
+    {
+        bringup->color_result = TRACE_CALL(color_prepare(bringup->device->color, bringup->config));
+    }
+
+    if (mcu_thread)
+    {
+        ThreadAPI_Join(mcu_thread, NULL);
+    }
+}
+
 zsa_result_t zsa_device_start_cameras(zsa_device_t device_handle, const zsa_device_configuration_t *config)
 {
     RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, config == NULL);
@@ -216,6 +662,21 @@ zsa_result_t zsa_device_start_cameras(zsa_device_t device_handle, const zsa_devi
     zsa_context_t *device = zsa_device_t_get_context(device_handle);
 
     LOG_TRACE("zsa_device_start_cameras starting", 0);
+    if (device_in_standby(device))
+    {
+        // The sensors never stopped, so only the delivery of captures has to resume
+        if (configuration_equal(&device->config, config) &&
+            ZSA_SUCCEEDED(TRACE_CALL(capturesync_start(device->capturesync, config))))
+        {
+            color_set_standby(device->color, false);
+            device_set_standby(device, false);
+            LOG_INFO("zsa_device_start_cameras resumed from standby", 0);
+            return ZSA_RESULT_SUCCEEDED;
+        }
+
+        zsa_device_stop_cameras(device_handle);
+    }
+
     if (device->color_started == true)
     {
         LOG_ERROR("zsa_device_start_cameras called while one of the sensors are running, color:%d",
@@ -233,12 +694,27 @@ zsa_result_t zsa_device_start_cameras(zsa_device_t device_handle, const zsa_devi
         LOG_INFO("    wired_sync_mode:%d", config->wired_sync_mode);
         LOG_INFO("    subordinate_delay_off_master_usec:%d", config->subordinate_delay_off_master_usec);
         LOG_INFO("    disable_streaming_indicator:%d", config->disable_streaming_indicator);
+        LOG_INFO("    color_scale:%d", config->color_scale);
+        LOG_INFO("    color_crop:(%u, %u) %u x %u",
+                 config->color_crop.x,
+                 config->color_crop.y,
+                 config->color_crop.width,
+                 config->color_crop.height);
+        LOG_INFO("    color_decode_on_demand:%d", config->color_decode_on_demand);
         result = TRACE_CALL(validate_configuration(device, config));
     }
 
     if (ZSA_SUCCEEDED(result))
     {
-        result = TRACE_CALL(colormcu_set_multi_device_mode(device->colormcu, config));
+        device_bringup_t bringup = { device, config, ZSA_RESULT_SUCCEEDED, ZSA_RESULT_SUCCEEDED };
+        device_bringup(&bringup);
+
+        result = ZSA_SUCCEEDED(bringup.mcu_result) ? bringup.color_result : bringup.mcu_result;
+        if (ZSA_SUCCEEDED(result))
+        {
+            device->config = *config;
+            device->config_valid = true;
+        }
     }
 
     if (ZSA_SUCCEEDED(result))
@@ -290,26 +766,603 @@ void zsa_device_stop_cameras(zsa_device_t device_handle)
         device->color_started = false;
     }
 
+    device_set_standby(device, false);
     LOG_INFO("zsa_device_stop_cameras stopped", 0);
 }
 
-// zsa_buffer_result_t zsa_device_get_serialnum(zsa_device_t device_handle,
-//                                              char *serial_number,
-//                                              size_t *serial_number_size)
-// {
-//     RETURN_VALUE_IF_HANDLE_INVALID(ZSA_BUFFER_RESULT_FAILED, zsa_device_t, device_handle);
-//     zsa_context_t *device = zsa_device_t_get_context(device_handle);
+zsa_result_t zsa_device_standby_cameras(zsa_device_t device_handle)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_RESULT_FAILED, zsa_device_t, device_handle);
+    zsa_context_t *device = zsa_device_t_get_context(device_handle);
 
-//     return TRACE_BUFFER_CALL(depth_get_device_serialnum(device->depth, serial_number, serial_number_size));
-// }
+    if (!device->color_started || device_in_standby(device))
+    {
+        LOG_ERROR("zsa_device_standby_cameras called while the cameras are not streaming", 0);
+        return ZSA_RESULT_FAILED;
+    }
 
-// zsa_result_t zsa_device_get_version(zsa_device_t device_handle, zsa_hardware_version_t *version)
-// {
-//     RETURN_VALUE_IF_HANDLE_INVALID(ZSA_RESULT_FAILED, zsa_device_t, device_handle);
-//     zsa_context_t *device = zsa_device_t_get_context(device_handle);
+    if (device->multidevice)
+    {
+        LOG_ERROR("zsa_device_standby_cameras called on a device streaming as part of a device group", 0);
+        return ZSA_RESULT_FAILED;
+    }
 
-//     return TRACE_CALL(depth_get_device_version(device->depth, version));
-// }
+    // Drop captures before stopping capturesync, so none is queued once blocked readers have been released. The color
+    // module drops frames before decoding or allocating them.
+    device_set_standby(device, true);
+    color_set_standby(device->color, true);
+    capturesync_stop(device->capturesync);
+    LOG_INFO("zsa_device_standby_cameras in standby", 0);
+
+    return ZSA_RESULT_SUCCEEDED;
+}
+
+zsa_result_t zsa_device_get_capture_async(zsa_device_t device_handle,
+                                          zsa_capture_ready_cb_t *capture_ready_cb,
+                                          void *capture_ready_cb_context)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_RESULT_FAILED, zsa_device_t, device_handle);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, capture_ready_cb == NULL);
+    zsa_context_t *device = zsa_device_t_get_context(device_handle);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, device->multidevice != NULL);
+
+    return TRACE_CALL(capturesync_get_capture_async(device->capturesync, capture_ready_cb, capture_ready_cb_context));
+}
+
+// Maps the public overflow policies to the queue's, which also has a blocking policy the SDK does not offer
+static zsa_result_t queue_overflow_policy_from_public(zsa_queue_overflow_policy_t policy,
+                                                     queue_overflow_policy_t *queue_policy)
+{
+    switch (policy)
+    {
+    case ZSA_QUEUE_OVERFLOW_DROP_OLDEST:
+        *queue_policy = QUEUE_OVERFLOW_DROP_OLDEST;
+        return ZSA_RESULT_SUCCEEDED;
+    case ZSA_QUEUE_OVERFLOW_DROP_NEWEST:
+        *queue_policy = QUEUE_OVERFLOW_DROP_NEWEST;
+        return ZSA_RESULT_SUCCEEDED;
+    case ZSA_QUEUE_OVERFLOW_KEEP_LATEST:
+        *queue_policy = QUEUE_OVERFLOW_KEEP_LATEST;
+        return ZSA_RESULT_SUCCEEDED;
+    case ZSA_QUEUE_OVERFLOW_BOUNDED_BYTES:
+        *queue_policy = QUEUE_OVERFLOW_BOUNDED_BYTES;
+        return ZSA_RESULT_SUCCEEDED;
+    default:
+        LOG_ERROR("Invalid queue overflow policy %d", policy);
+        return ZSA_RESULT_FAILED;
+    }
+}
+
+static void queue_stats_to_public(const queue_stats_t *queue_stats, zsa_queue_stats_t *stats)
+{
+    stats->count = queue_stats->count;
+    stats->max_count = queue_stats->max_count;
+    stats->bytes = queue_stats->bytes;
+    stats->pushed = queue_stats->pushed;
+    stats->popped = queue_stats->popped;
+    stats->dropped_oldest = queue_stats->dropped_oldest;
+    stats->dropped_newest = queue_stats->dropped_newest;
+    stats->lag_usec = queue_stats->lag_usec;
+    stats->last_pop_lag_usec = queue_stats->last_pop_lag_usec;
+    stats->max_pop_lag_usec = queue_stats->max_pop_lag_usec;
+}
+
+zsa_result_t zsa_device_set_capture_overflow_policy(zsa_device_t device_handle,
+                                                    zsa_queue_overflow_policy_t policy,
+                                                    size_t max_bytes)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_RESULT_FAILED, zsa_device_t, device_handle);
+    zsa_context_t *device = zsa_device_t_get_context(device_handle);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, device->multidevice != NULL);
+    queue_overflow_policy_t queue_policy;
+
+    zsa_result_t result = TRACE_CALL(queue_overflow_policy_from_public(policy, &queue_policy));
+    if (ZSA_SUCCEEDED(result))
+    {
+        result = TRACE_CALL(capturesync_set_overflow_policy(device->capturesync, queue_policy, max_bytes));
+    }
+    return result;
+}
+
+zsa_result_t zsa_device_get_capture_queue_stats(zsa_device_t device_handle, zsa_queue_stats_t *stats)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_RESULT_FAILED, zsa_device_t, device_handle);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, stats == NULL);
+    zsa_context_t *device = zsa_device_t_get_context(device_handle);
+    queue_stats_t queue_stats;
+
+    capturesync_get_queue_stats(device->capturesync, &queue_stats);
+    queue_stats_to_public(&queue_stats, stats);
+    return ZSA_RESULT_SUCCEEDED;
+}
+
+zsa_result_t zsa_device_subscribe(zsa_device_t device_handle,
+                                  uint32_t queue_depth,
+                                  zsa_queue_overflow_policy_t policy,
+                                  size_t max_bytes,
+                                  zsa_subscriber_t *subscriber_handle)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_RESULT_FAILED, zsa_device_t, device_handle);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, subscriber_handle == NULL);
+    zsa_context_t *device = zsa_device_t_get_context(device_handle);
+    queue_overflow_policy_t queue_policy;
+
+    zsa_result_t result = TRACE_CALL(queue_overflow_policy_from_public(policy, &queue_policy));
+    if (ZSA_FAILED(result))
+    {
+        return result;
+    }
+
+    zsa_subscriber_context_t *subscriber = zsa_subscriber_t_create(subscriber_handle);
+    result = ZSA_RESULT_FROM_BOOL(subscriber != NULL);
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        subscriber->capturesync = device->capturesync;
+        result = TRACE_CALL(
+            capturesync_subscribe(device->capturesync, queue_depth, queue_policy, max_bytes, &subscriber->queue));
+    }
+
+    if (ZSA_FAILED(result) && subscriber != NULL)
+    {
+        zsa_subscriber_close(*subscriber_handle);
+        *subscriber_handle = NULL;
+    }
+
+    return result;
+}
+
+zsa_wait_result_t zsa_subscriber_get_capture(zsa_subscriber_t subscriber_handle,
+                                             zsa_capture_t *capture_handle,
+                                             int32_t timeout_in_ms)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_WAIT_RESULT_FAILED, zsa_subscriber_t, subscriber_handle);
+    RETURN_VALUE_IF_ARG(ZSA_WAIT_RESULT_FAILED, capture_handle == NULL);
+    zsa_subscriber_context_t *subscriber = zsa_subscriber_t_get_context(subscriber_handle);
+
+    return TRACE_WAIT_CALL(queue_pop(subscriber->queue, timeout_in_ms, capture_handle));
+}
+
+zsa_wait_result_t zsa_subscriber_get_captures(zsa_subscriber_t subscriber_handle,
+                                              zsa_capture_t *capture_handles,
+                                              uint32_t capacity,
+                                              uint32_t *count)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_WAIT_RESULT_FAILED, zsa_subscriber_t, subscriber_handle);
+    RETURN_VALUE_IF_ARG(ZSA_WAIT_RESULT_FAILED, capture_handles == NULL);
+    RETURN_VALUE_IF_ARG(ZSA_WAIT_RESULT_FAILED, count == NULL);
+    zsa_subscriber_context_t *subscriber = zsa_subscriber_t_get_context(subscriber_handle);
+
+    // An empty subscriber is the usual case for an event loop, so it is not traced
+    return queue_pop_batch(subscriber->queue, capture_handles, capacity, count);
+}
+
+int zsa_subscriber_get_event_fd(zsa_subscriber_t subscriber_handle)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(-1, zsa_subscriber_t, subscriber_handle);
+    zsa_subscriber_context_t *subscriber = zsa_subscriber_t_get_context(subscriber_handle);
+
+    return queue_get_event_fd(subscriber->queue);
+}
+
+zsa_result_t zsa_subscriber_get_stats(zsa_subscriber_t subscriber_handle, zsa_queue_stats_t *stats)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_RESULT_FAILED, zsa_subscriber_t, subscriber_handle);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, stats == NULL);
+    zsa_subscriber_context_t *subscriber = zsa_subscriber_t_get_context(subscriber_handle);
+    queue_stats_t queue_stats;
+
+    queue_get_stats(subscriber->queue, &queue_stats);
+    queue_stats_to_public(&queue_stats, stats);
+    return ZSA_RESULT_SUCCEEDED;
+}
+
+void zsa_subscriber_close(zsa_subscriber_t subscriber_handle)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(VOID_VALUE, zsa_subscriber_t, subscriber_handle);
+    zsa_subscriber_context_t *subscriber = zsa_subscriber_t_get_context(subscriber_handle);
+
+    if (subscriber->queue)
+    {
+        capturesync_unsubscribe(subscriber->capturesync, subscriber->queue);
+        subscriber->queue = NULL;
+    }
+
+    zsa_subscriber_t_destroy(subscriber_handle);
+}
+
+zsa_result_t zsa_device_start_server(zsa_device_t device_handle,
+                                     const char *name,
+                                     const zsa_server_configuration_t *config)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_RESULT_FAILED, zsa_device_t, device_handle);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, name == NULL);
+    zsa_context_t *device = zsa_device_t_get_context(device_handle);
+
+    if (device->camserver != NULL)
+    {
+        LOG_ERROR("zsa_device_start_server called while a server runs for the device", 0);
+        return ZSA_RESULT_FAILED;
+    }
+
+    return TRACE_CALL(camserver_create(device->capturesync, name, config, &device->camserver));
+}
+
+void zsa_device_stop_server(zsa_device_t device_handle)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(VOID_VALUE, zsa_device_t, device_handle);
+    zsa_context_t *device = zsa_device_t_get_context(device_handle);
+
+    if (device->camserver)
+    {
+        camserver_destroy(device->camserver);
+        device->camserver = NULL;
+    }
+}
+
+zsa_result_t zsa_device_start_flight_recorder(zsa_device_t device_handle,
+                                              const zsa_flight_recorder_configuration_t *config)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_RESULT_FAILED, zsa_device_t, device_handle);
+    zsa_context_t *device = zsa_device_t_get_context(device_handle);
+
+    if (device->flightrec != NULL)
+    {
+        LOG_ERROR("zsa_device_start_flight_recorder called while a recorder runs for the device", 0);
+        return ZSA_RESULT_FAILED;
+    }
+
+    return TRACE_CALL(flightrec_create(device->capturesync, config, &device->flightrec));
+}
+
+zsa_result_t zsa_device_dump_flight_recorder(zsa_device_t device_handle, const char *path)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_RESULT_FAILED, zsa_device_t, device_handle);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, path == NULL);
+    zsa_context_t *device = zsa_device_t_get_context(device_handle);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, device->flightrec == NULL);
+
+    return TRACE_CALL(flightrec_dump(device->flightrec, path));
+}
+
+void zsa_device_stop_flight_recorder(zsa_device_t device_handle)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(VOID_VALUE, zsa_device_t, device_handle);
+    zsa_context_t *device = zsa_device_t_get_context(device_handle);
+
+    if (device->flightrec)
+    {
+        flightrec_destroy(device->flightrec);
+        device->flightrec = NULL;
+    }
+}
+
+zsa_result_t zsa_client_open(const char *name, zsa_client_t *client_handle)
+{
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, name == NULL);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, client_handle == NULL);
+
+    zsa_client_context_t *client = zsa_client_t_create(client_handle);
+    zsa_result_t result = ZSA_RESULT_FROM_BOOL(client != NULL);
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        // Captures are built with the SDK's allocator, as they are for a device
+        allocator_initialize();
+        result = TRACE_CALL(camclient_open(name, &client->camclient));
+    }
+
+    if (ZSA_FAILED(result) && client != NULL)
+    {
+        zsa_client_close(*client_handle);
+        *client_handle = NULL;
+    }
+
+    return result;
+}
+
+zsa_wait_result_t zsa_client_get_capture(zsa_client_t client_handle,
+                                         zsa_capture_t *capture_handle,
+                                         int32_t timeout_in_ms)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_WAIT_RESULT_FAILED, zsa_client_t, client_handle);
+    RETURN_VALUE_IF_ARG(ZSA_WAIT_RESULT_FAILED, capture_handle == NULL);
+    zsa_client_context_t *client = zsa_client_t_get_context(client_handle);
+
+    return TRACE_WAIT_CALL(camclient_get_capture(client->camclient, capture_handle, timeout_in_ms));
+}
+
+void zsa_client_close(zsa_client_t client_handle)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(VOID_VALUE, zsa_client_t, client_handle);
+    zsa_client_context_t *client = zsa_client_t_get_context(client_handle);
+
+    if (client->camclient)
+    {
+        camclient_close(client->camclient);
+        client->camclient = NULL;
+    }
+
+    zsa_client_t_destroy(client_handle);
+    allocator_deinitialize();
+}
+
+zsa_buffer_result_t zsa_device_get_serialnum(zsa_device_t device_handle,
+                                             char *serial_number,
+                                             size_t *serial_number_size)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_BUFFER_RESULT_FAILED, zsa_device_t, device_handle);
+    zsa_context_t *device = zsa_device_t_get_context(device_handle);
+
+    return TRACE_BUFFER_CALL(colormcu_get_usb_serialnum(device->colormcu, serial_number, serial_number_size));
+}
+
+zsa_result_t zsa_device_get_color_control(zsa_device_t device_handle,
+                                          zsa_color_control_command_t command,
+                                          zsa_color_control_mode_t *mode,
+                                          int32_t *value)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_RESULT_FAILED, zsa_device_t, device_handle);
+    zsa_context_t *device = zsa_device_t_get_context(device_handle);
+
+    return TRACE_CALL(color_get_control(device->color, command, mode, value));
+}
+
+uint32_t zsa_device_read_color_metadata(zsa_device_t device_handle,
+                                        uint64_t *frame_index,
+                                        zsa_color_frame_metadata_t *metadata,
+                                        uint32_t count)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(0, zsa_device_t, device_handle);
+    zsa_context_t *device = zsa_device_t_get_context(device_handle);
+
+    return color_read_frame_metadata(device->color, frame_index, metadata, count);
+}
+
+zsa_result_t zsa_device_set_color_control(zsa_device_t device_handle,
+                                          zsa_color_control_command_t command,
+                                          zsa_color_control_mode_t mode,
+                                          int32_t value)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_RESULT_FAILED, zsa_device_t, device_handle);
+    zsa_context_t *device = zsa_device_t_get_context(device_handle);
+
+    return TRACE_CALL(color_set_control(device->color, command, mode, value));
+}
+
+// zsa_result_t zsa_device_get_version(zsa_device_t device_handle, zsa_hardware_version_t *version)
+// {
+//     RETURN_VALUE_IF_HANDLE_INVALID(ZSA_RESULT_FAILED, zsa_device_t, device_handle);
+//     zsa_context_t *device = zsa_device_t_get_context(device_handle);
+
+//     return TRACE_CALL(depth_get_device_version(device->depth, version));
+// }
+
+zsa_result_t zsa_device_group_create(const zsa_device_t *device_handles,
+                                     uint32_t device_count,
+                                     zsa_device_group_t *group_handle)
+{
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, device_handles == NULL);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, device_count == 0);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, device_count > MULTIDEVICE_MAX_DEVICES);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, group_handle == NULL);
+    for (uint32_t i = 0; i < device_count; i++)
+    {
+        RETURN_VALUE_IF_HANDLE_INVALID(ZSA_RESULT_FAILED, zsa_device_t, device_handles[i]);
+    }
+
+    zsa_device_group_context_t *group = zsa_device_group_t_create(group_handle);
+    zsa_result_t result = ZSA_RESULT_FROM_BOOL(group != NULL);
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        memcpy(group->devices, device_handles, device_count * sizeof(zsa_device_t));
+        group->device_count = device_count;
+        result = TRACE_CALL(threadpool_create(device_count - 1, &group->pool));
+    }
+
+    if (ZSA_FAILED(result))
+    {
+        zsa_device_group_destroy(*group_handle);
+        *group_handle = NULL;
+    }
+
+    return result;
+}
+
+void zsa_device_group_destroy(zsa_device_group_t group_handle)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(VOID_VALUE, zsa_device_group_t, group_handle);
+
+    zsa_device_group_context_t *group = zsa_device_group_t_get_context(group_handle);
+
+    zsa_device_group_stop_cameras(group_handle);
+
+    if (group->pool)
+    {
+        threadpool_destroy(group->pool);
+        group->pool = NULL;
+    }
+
+    zsa_device_group_t_destroy(group_handle);
+}
+
+static zsa_result_t validate_group_configuration(const zsa_device_group_context_t *group,
+                                                 const zsa_device_configuration_t *configs,
+                                                 multidevice_config_t *multidevice_config)
+{
+    uint32_t master_count = 0;
+    uint32_t camera_fps = zsa_convert_fps_to_uint(configs[0].camera_fps);
+
+    multidevice_config->device_count = group->device_count;
+    for (uint32_t i = 0; i < group->device_count; i++)
+    {
+        if (zsa_convert_fps_to_uint(configs[i].camera_fps) != camera_fps)
+        {
+            LOG_ERROR("Device %d of the group runs at a different camera_fps", i);
+            return ZSA_RESULT_FAILED;
+        }
+
+        if (configs[i].wired_sync_mode == ZSA_WIRED_SYNC_MODE_MASTER ||
+            (group->device_count == 1 && configs[i].wired_sync_mode == ZSA_WIRED_SYNC_MODE_STANDALONE))
+        {
+            master_count++;
+            multidevice_config->master_index = i;
+        }
+        else if (configs[i].wired_sync_mode != ZSA_WIRED_SYNC_MODE_SUBORDINATE)
+        {
+            LOG_ERROR("Device %d of the group is neither master nor subordinate", i);
+            return ZSA_RESULT_FAILED;
+        }
+        multidevice_config->subordinate_delay_off_master_usec[i] = configs[i].subordinate_delay_off_master_usec;
+    }
+
+    if (master_count != 1 || camera_fps == 0)
+    {
+        LOG_ERROR("A device group needs exactly one master, found %d", master_count);
+        return ZSA_RESULT_FAILED;
+    }
+
+    multidevice_config->frame_period_usec = 1000000 / camera_fps;
+    multidevice_config->synchronized_sets_only = configs[multidevice_config->master_index].synchronized_images_only;
+    multidevice_config->queue_depth = QUEUE_CALC_DEPTH(camera_fps, QUEUE_DEFAULT_DEPTH_USEC);
+
+    for (uint32_t i = 0; i < group->device_count; i++)
+    {
+        if (i != multidevice_config->master_index &&
+            configs[i].subordinate_delay_off_master_usec >= multidevice_config->frame_period_usec)
+        {
+            LOG_ERROR("Device %d of the group is delayed by more than one capture period", i);
+            return ZSA_RESULT_FAILED;
+        }
+    }
+
+    return ZSA_RESULT_SUCCEEDED;
+}
+
+typedef struct _group_bringup_t
+{
+    zsa_device_group_context_t *group;
+    const zsa_device_configuration_t *configs;
+    uint32_t master_index;
+    zsa_result_t results[MULTIDEVICE_MAX_DEVICES];
+} group_bringup_t;
+
+static void group_start_subordinate_task(void *context, uint32_t task_index)
+{
+    group_bringup_t *bringup = (group_bringup_t *)context;
+
+    if (task_index != bringup->master_index)
+    {
+        bringup->results[task_index] = TRACE_CALL(
+            zsa_device_start_cameras(bringup->group->devices[task_index], &bringup->configs[task_index]));
+    }
+}
+
+zsa_result_t zsa_device_group_start_cameras(zsa_device_group_t group_handle, const zsa_device_configuration_t *configs)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_RESULT_FAILED, zsa_device_group_t, group_handle);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, configs == NULL);
+    zsa_device_group_context_t *group = zsa_device_group_t_get_context(group_handle);
+    multidevice_config_t multidevice_config = { 0 };
+    zsa_result_t result = ZSA_RESULT_SUCCEEDED;
+
+    if (group->multidevice != NULL)
+    {
+        LOG_ERROR("zsa_device_group_start_cameras called while the group is running", 0);
+        result = ZSA_RESULT_FAILED;
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        result = TRACE_CALL(validate_group_configuration(group, configs, &multidevice_config));
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        result = TRACE_CALL(multidevice_create(&multidevice_config, &group->multidevice));
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        for (uint32_t i = 0; i < group->device_count; i++)
+        {
+            zsa_context_t *device = zsa_device_t_get_context(group->devices[i]);
+            device->multidevice = group->multidevice;
+            device->multidevice_index = i;
+        }
+    }
+
+    // Subordinates only trigger on the master's sync pulses, so they have to be streaming before the master starts or
+    // they miss its first captures. They do not depend on each other and start side by side.
+    if (ZSA_SUCCEEDED(result))
+    {
+        group_bringup_t bringup = { group, configs, multidevice_config.master_index, { ZSA_RESULT_SUCCEEDED } };
+        threadpool_run(group->pool, group->device_count, group_start_subordinate_task, &bringup);
+
+        for (uint32_t i = 0; ZSA_SUCCEEDED(result) && i < group->device_count; i++)
+        {
+            result = bringup.results[i];
+        }
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        uint32_t master = multidevice_config.master_index;
+        result = TRACE_CALL(zsa_device_start_cameras(group->devices[master], &configs[master]));
+    }
+
+    if (ZSA_FAILED(result))
+    {
+        zsa_device_group_stop_cameras(group_handle);
+    }
+
+    return result;
+}
+
+void zsa_device_group_stop_cameras(zsa_device_group_t group_handle)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(VOID_VALUE, zsa_device_group_t, group_handle);
+    zsa_device_group_context_t *group = zsa_device_group_t_get_context(group_handle);
+
+    if (group->multidevice == NULL)
+    {
+        return;
+    }
+
+    // Release blocked readers first, the same way capturesync is stopped ahead of the sensors
+    multidevice_stop(group->multidevice);
+
+    for (uint32_t i = 0; i < group->device_count; i++)
+    {
+        zsa_context_t *device = zsa_device_t_get_context(group->devices[i]);
+        if (device->multidevice == group->multidevice)
+        {
+            zsa_device_stop_cameras(group->devices[i]);
+            device->multidevice = NULL;
+        }
+    }
+
+    multidevice_destroy(group->multidevice);
+    group->multidevice = NULL;
+}
+
+zsa_wait_result_t zsa_device_group_get_capture_set(zsa_device_group_t group_handle,
+                                                  zsa_capture_t *capture_handles,
+                                                  int32_t timeout_in_ms)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_WAIT_RESULT_FAILED, zsa_device_group_t, group_handle);
+    RETURN_VALUE_IF_ARG(ZSA_WAIT_RESULT_FAILED, capture_handles == NULL);
+    zsa_device_group_context_t *group = zsa_device_group_t_get_context(group_handle);
+
+    if (group->multidevice == NULL)
+    {
+        LOG_ERROR("zsa_device_group_get_capture_set called while the group is stopped", 0);
+        return ZSA_WAIT_RESULT_FAILED;
+    }
+
+    return TRACE_WAIT_CALL(multidevice_get_capture_set(group->multidevice, capture_handles, timeout_in_ms));
+}
 
 
 #ifdef __cplusplus
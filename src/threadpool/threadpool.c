@@ -0,0 +1,245 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+// This library
+#include <zsainternal/threadpool.h>
+
+// Dependent libraries
+#include <zsainternal/common.h>
+#include <zsainternal/handle.h>
+#include <zsainternal/logging.h>
+#include <azure_c_shared_utility/lock.h>
+#include <azure_c_shared_utility/condition.h>
+#include <azure_c_shared_utility/threadapi.h>
+
+// System dependencies
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+#include <stdlib.h>
+#include <stdbool.h>
+
+// Upper bound on workers; more than this only adds contention for the frame sized batches we run.
+#define THREADPOOL_MAX_WORKERS (64)
+
+typedef struct _threadpool_context_t
+{
+    LOCK_HANDLE run_lock;        // Serializes callers of threadpool_run
+    LOCK_HANDLE lock;            // Protects everything below
+    COND_HANDLE work_condition;  // Posted when a batch is published or the pool shuts down
+    COND_HANDLE done_condition;  // Posted when the last task of a batch completes
+    THREAD_HANDLE *workers;      // Worker threads
+    uint32_t worker_count;       // Number of entries in workers
+    bool shutdown;               // Set by threadpool_destroy
+    uint32_t generation;         // Incremented for every batch published
+    threadpool_task_cb_t *task_cb;
+    void *task_context;
+    uint32_t task_count;         // Tasks in the current batch
+    uint32_t next_task;          // Next task index to hand out
+    uint32_t completed_tasks;    // Tasks of the current batch that have returned
+} threadpool_context_t;
+
+ZSA_DECLARE_CONTEXT(threadpool_t, threadpool_context_t);
+
+static uint32_t threadpool_online_processors(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (uint32_t)info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (uint32_t)count : 1;
+#endif
+}
+
+// Runs tasks of the current batch until none are left. Called and returns with pool->lock held.
+static void threadpool_drain_locked(threadpool_context_t *pool)
+{
+    while (pool->next_task < pool->task_count)
+    {
+        uint32_t task_index = pool->next_task++;
+        threadpool_task_cb_t *task_cb = pool->task_cb;
+        void *task_context = pool->task_context;
+
+        Unlock(pool->lock);
+        task_cb(task_context, task_index);
+        Lock(pool->lock);
+
+        pool->completed_tasks++;
+        if (pool->completed_tasks == pool->task_count)
+        {
+            Condition_Post(pool->done_condition);
+        }
+    }
+}
+
+static int threadpool_worker_thread(void *param)
+{
+    threadpool_context_t *pool = (threadpool_context_t *)param;
+
+    Lock(pool->lock);
+    uint32_t generation = pool->generation;
+    while (!pool->shutdown)
+    {
+        if (generation == pool->generation)
+        {
+            // Infinite wait; spurious wake ups are handled by re-checking the generation
+            (void)Condition_Wait(pool->work_condition, pool->lock, 0);
+            continue;
+        }
+
+        generation = pool->generation;
+        threadpool_drain_locked(pool);
+    }
+    Unlock(pool->lock);
+
+    ThreadAPI_Exit(0);
+    return 0;
+}
+
+zsa_result_t threadpool_create(uint32_t worker_count, threadpool_t *pool_handle)
+{
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, pool_handle == NULL);
+
+    threadpool_context_t *pool = threadpool_t_create(pool_handle);
+    zsa_result_t result = ZSA_RESULT_FROM_BOOL(pool != NULL);
+
+    if (worker_count == THREADPOOL_DEFAULT_WORKERS)
+    {
+        worker_count = threadpool_online_processors() - 1;
+    }
+    worker_count = MIN(worker_count, THREADPOOL_MAX_WORKERS);
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        pool->run_lock = Lock_Init();
+        pool->lock = Lock_Init();
+        pool->work_condition = Condition_Init();
+        pool->done_condition = Condition_Init();
+        result = ZSA_RESULT_FROM_BOOL(pool->run_lock != NULL && pool->lock != NULL && pool->work_condition != NULL &&
+                                      pool->done_condition != NULL);
+    }
+
+    if (ZSA_SUCCEEDED(result) && worker_count > 0)
+    {
+        pool->workers = (THREAD_HANDLE *)calloc(worker_count, sizeof(THREAD_HANDLE));
+        result = ZSA_RESULT_FROM_BOOL(pool->workers != NULL);
+    }
+
+    for (uint32_t i = 0; ZSA_SUCCEEDED(result) && i < worker_count; i++)
+    {
+        result = ZSA_RESULT_FROM_BOOL(ThreadAPI_Create(&pool->workers[i], threadpool_worker_thread, pool) ==
+                                      THREADAPI_OK);
+        if (ZSA_SUCCEEDED(result))
+        {
+            pool->worker_count++;
+        }
+    }
+
+    if (ZSA_FAILED(result) && pool != NULL)
+    {
+        threadpool_destroy(*pool_handle);
+        *pool_handle = NULL;
+    }
+
+    return result;
+}
+
+void threadpool_destroy(threadpool_t pool_handle)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(VOID_VALUE, threadpool_t, pool_handle);
+    threadpool_context_t *pool = threadpool_t_get_context(pool_handle);
+
+    if (pool->worker_count > 0)
+    {
+        Lock(pool->lock);
+        pool->shutdown = true;
+        for (uint32_t i = 0; i < pool->worker_count; i++)
+        {
+            Condition_Post(pool->work_condition);
+        }
+        Unlock(pool->lock);
+
+        for (uint32_t i = 0; i < pool->worker_count; i++)
+        {
+            int thread_result;
+            (void)ThreadAPI_Join(pool->workers[i], &thread_result);
+        }
+    }
+
+    free(pool->workers);
+
+    if (pool->done_condition)
+    {
+        Condition_Deinit(pool->done_condition);
+    }
+    if (pool->work_condition)
+    {
+        Condition_Deinit(pool->work_condition);
+    }
+    if (pool->lock)
+    {
+        Lock_Deinit(pool->lock);
+    }
+    if (pool->run_lock)
+    {
+        Lock_Deinit(pool->run_lock);
+    }
+
+    threadpool_t_destroy(pool_handle);
+}
+
+uint32_t threadpool_get_thread_count(threadpool_t pool_handle)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(1, threadpool_t, pool_handle);
+    threadpool_context_t *pool = threadpool_t_get_context(pool_handle);
+
+    return pool->worker_count + 1;
+}
+
+void threadpool_run(threadpool_t pool_handle, uint32_t task_count, threadpool_task_cb_t *task_cb, void *context)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(VOID_VALUE, threadpool_t, pool_handle);
+    RETURN_VALUE_IF_ARG(VOID_VALUE, task_cb == NULL);
+    threadpool_context_t *pool = threadpool_t_get_context(pool_handle);
+
+    if (pool->worker_count == 0 || task_count <= 1)
+    {
+        for (uint32_t i = 0; i < task_count; i++)
+        {
+            task_cb(context, i);
+        }
+        return;
+    }
+
+    Lock(pool->run_lock);
+    Lock(pool->lock);
+
+    pool->task_cb = task_cb;
+    pool->task_context = context;
+    pool->task_count = task_count;
+    pool->next_task = 0;
+    pool->completed_tasks = 0;
+    pool->generation++;
+
+    for (uint32_t i = 0; i < MIN(pool->worker_count, task_count - 1); i++)
+    {
+        Condition_Post(pool->work_condition);
+    }
+
+    // The caller works on the batch too, then waits for tasks still running on workers
+    threadpool_drain_locked(pool);
+    while (pool->completed_tasks < pool->task_count)
+    {
+        (void)Condition_Wait(pool->done_condition, pool->lock, 0);
+    }
+
+    pool->task_cb = NULL;
+    pool->task_context = NULL;
+
+    Unlock(pool->lock);
+    Unlock(pool->run_lock);
+}
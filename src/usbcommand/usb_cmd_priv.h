@@ -17,6 +17,7 @@
 // Dependent libraries
 #include <zsainternal/allocator.h>
 #include <azure_c_shared_utility/lock.h>
+#include <azure_c_shared_utility/condition.h>
 #include <azure_c_shared_utility/threadapi.h>
 
 // Exteranl dependencis
@@ -61,6 +62,54 @@ extern "C" {
 #define USB_CMD_IMU_STREAM_ENDPOINT 0x82
 
 //************************ Typedefs *****************************
+typedef struct _usb_command_header_t
+{
+    uint32_t packet_type;
+    uint32_t packet_transaction_id;
+    uint32_t payload_size;
+    uint32_t command;
+    uint32_t reserved; // Must be zero
+} usb_command_header_t;
+
+typedef struct _usb_command_packet_t
+{
+    usb_command_header_t header;
+    uint8_t data[USB_MAX_TX_DATA];
+} usb_command_packet_t;
+
+/////////////////////////////////////////////////////
+// This is the response structure going to the host.
+/////////////////////////////////////////////////////
+
+typedef struct _usb_command_response_t
+{
+    uint32_t packet_type;
+    uint32_t packet_transaction_id;
+    uint32_t status;
+    uint32_t reserved; // Will be zero
+} usb_command_response_t;
+
+// A batch queued with usb_cmd_submit()
+typedef struct _usb_cmd_batch_t
+{
+    struct _usb_cmd_batch_t *next;
+    usb_cmd_request_t *requests;
+    uint32_t count;
+    uint32_t current; // Request on the wire
+    zsa_result_t result;
+    usb_cmd_complete_cb_t *complete_cb;
+    void *context;
+} usb_cmd_batch_t;
+
+// Stages of the command transaction on the wire
+typedef enum
+{
+    USB_CMD_STAGE_COMMAND = 0,
+    USB_CMD_STAGE_TX_DATA,
+    USB_CMD_STAGE_RX_DATA,
+    USB_CMD_STAGE_STATUS,
+} usb_cmd_stage_t;
+
 typedef struct _usb_async_transfer_data_t
 {
     struct _usbcmd_context_t *usbcmd;
@@ -93,9 +142,23 @@ typedef struct _usbcmd_context_t
     void *stream_context;
     bool stream_going;
     usb_async_transfer_data_t *transfer_list[USB_CMD_MAX_XFR_COUNT];
+    uint32_t transfer_count; // Transfers the stream started with, restored after being held back over budget
     size_t stream_size;
     LOCK_HANDLE lock;
     THREAD_HANDLE stream_handle;
+
+    // Command transactions, see usbasync.c. The batch at the head of the queue is the one on the wire.
+    LOCK_HANDLE cmd_lock;
+    COND_HANDLE cmd_condition;
+    COND_HANDLE cmd_idle_condition; // Posted when the last queued batch completes
+    usb_cmd_batch_t *cmd_head;
+    usb_cmd_batch_t *cmd_tail;
+    struct libusb_transfer *cmd_transfer; // Reused for every stage, only one is outstanding
+    usb_cmd_stage_t cmd_stage;
+    usb_command_packet_t cmd_packet;
+    usb_command_response_t cmd_response;
+    THREAD_HANDLE cmd_thread; // Services libusb events for asynchronous callers
+    volatile bool cmd_thread_going;
 } usbcmd_context_t;
 
 ZSA_DECLARE_CONTEXT(usbcmd_t, usbcmd_context_t);
@@ -105,6 +168,9 @@ ZSA_DECLARE_CONTEXT(usbcmd_t, usbcmd_context_t);
 //******************* Function Prototypes ***********************
 void LIBUSB_CALL usb_cmd_libusb_cb(struct libusb_transfer *bulk_transfer);
 
+zsa_result_t usb_cmd_async_init(usbcmd_context_t *usbcmd);
+void usb_cmd_async_deinit(usbcmd_context_t *usbcmd);
+
 #ifdef __cplusplus
 }
 #endif
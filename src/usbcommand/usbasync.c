@@ -0,0 +1,475 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+//************************ Includes *****************************
+// This library
+#include <zsainternal/usbcommand.h>
+#include "usb_cmd_priv.h"
+
+// System dependencies
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+//**************Symbolic Constant Macros (defines)  *************
+#define USB_CMD_ASYNC_EVENT_TIMEOUT_USEC 100000
+
+//************************ Typedefs *****************************
+
+//************ Declarations (Statics and globals) ***************
+
+//******************* Function Prototypes ***********************
+static void LIBUSB_CALL usb_cmd_async_cb(struct libusb_transfer *transfer);
+static void usb_cmd_async_start_request(usbcmd_context_t *usbcmd);
+
+//*********************** Functions *****************************
+
+/**
+ *  Submits one stage of the transaction on the wire. Only called by the owner of the head batch; the stages of a
+ *  transaction and the transactions of the queue never overlap, so the one transfer is reused for all of them.
+ */
+static void usb_cmd_async_submit_stage(usbcmd_context_t *usbcmd, usb_cmd_stage_t stage)
+{
+    usb_cmd_batch_t *batch = usbcmd->cmd_head;
+    usb_cmd_request_t *request = &batch->requests[batch->current];
+    unsigned char endpoint = usbcmd->cmd_rx_endpoint;
+    uint8_t *buffer = (uint8_t *)&usbcmd->cmd_response;
+    int length = sizeof(usbcmd->cmd_response);
+    int err;
+
+    switch (stage)
+    {
+    case USB_CMD_STAGE_COMMAND:
+        endpoint = usbcmd->cmd_tx_endpoint;
+        buffer = (uint8_t *)&usbcmd->cmd_packet;
+        length = (int)(sizeof(usb_command_header_t) + request->cmd_data_size);
+        break;
+    case USB_CMD_STAGE_TX_DATA:
+        endpoint = usbcmd->cmd_tx_endpoint;
+        buffer = (uint8_t *)request->tx_data;
+        length = (int)request->data_size;
+        break;
+    case USB_CMD_STAGE_RX_DATA:
+        buffer = (uint8_t *)request->rx_data;
+        length = (int)request->data_size;
+        break;
+    case USB_CMD_STAGE_STATUS:
+        break;
+    }
+
+    usbcmd->cmd_stage = stage;
+    libusb_fill_bulk_transfer(usbcmd->cmd_transfer,
+                              usbcmd->libusb,
+                              endpoint,
+                              buffer,
+                              length,
+                              usb_cmd_async_cb,
+                              usbcmd,
+                              USB_CMD_MAX_WAIT_TIME);
+
+    if ((err = libusb_submit_transfer(usbcmd->cmd_transfer)) != LIBUSB_SUCCESS)
+    {
+        LOG_ERROR("Error calling libusb_submit_transfer for command(%08X) stage %d, result:%s",
+                  request->cmd,
+                  stage,
+                  libusb_error_name(err));
+
+        // Complete the stage as failed, as libusb would have
+        usbcmd->cmd_transfer->status = LIBUSB_TRANSFER_ERROR;
+        usbcmd->cmd_transfer->actual_length = 0;
+        usb_cmd_async_cb(usbcmd->cmd_transfer);
+    }
+}
+
+/**
+ *  Records the outcome of the request on the wire and moves on to the next request, batch, or stops when the queue is
+ *  empty.
+ */
+static void usb_cmd_async_finish_request(usbcmd_context_t *usbcmd, zsa_result_t result)
+{
+    usb_cmd_batch_t *batch = usbcmd->cmd_head;
+    usb_cmd_request_t *request = &batch->requests[batch->current];
+
+    request->result = result;
+    if (ZSA_FAILED(result) || request->cmd_status != 0)
+    {
+        batch->result = ZSA_RESULT_FAILED;
+    }
+
+    batch->current++;
+    if (ZSA_SUCCEEDED(batch->result) && batch->current < batch->count)
+    {
+        usb_cmd_async_start_request(usbcmd);
+        return;
+    }
+
+    for (uint32_t i = batch->current; i < batch->count; i++)
+    {
+        batch->requests[i].result = ZSA_RESULT_FAILED;
+    }
+
+    // Hand the wire to the next batch before running the callback, which may queue more work
+    Lock(usbcmd->cmd_lock);
+    usb_cmd_batch_t *next = batch->next;
+    usbcmd->cmd_head = next;
+    if (next == NULL)
+    {
+        usbcmd->cmd_tail = NULL;
+        Condition_Post(usbcmd->cmd_idle_condition);
+    }
+    Unlock(usbcmd->cmd_lock);
+
+    batch->complete_cb(batch->result, batch->requests, batch->count, batch->context);
+    free(batch);
+
+    if (next)
+    {
+        usb_cmd_async_start_request(usbcmd);
+    }
+}
+
+static void usb_cmd_async_start_request(usbcmd_context_t *usbcmd)
+{
+    usb_cmd_batch_t *batch = usbcmd->cmd_head;
+    usb_cmd_request_t *request = &batch->requests[batch->current];
+    const uint32_t *p_data = (const uint32_t *)request->cmd_data;
+
+    if (request->cmd_data_size >= 2 * sizeof(uint32_t) && p_data != NULL)
+    {
+        LOG_TRACE("XFR: Cmd=%08x, CmdLength=%u, PayloadSize=%zu, CmdData=%08x %08x...",
+                  request->cmd,
+                  request->cmd_data_size,
+                  request->data_size,
+                  p_data[0],
+                  p_data[1]);
+    }
+    else
+    {
+        LOG_TRACE("XFR: Cmd=%08x, PayloadSize=%zu", request->cmd, request->data_size);
+    }
+
+    request->cmd_status = 0;
+    request->transfer_count = 0;
+
+    // format up request and send command
+    usbcmd->cmd_packet.header.command = request->cmd;
+    usbcmd->cmd_packet.header.packet_type = USB_CMD_PACKET_TYPE;
+    usbcmd->cmd_packet.header.payload_size = (uint32_t)request->data_size;
+    usbcmd->cmd_packet.header.reserved = 0;
+    usbcmd->cmd_packet.header.packet_transaction_id = usbcmd->transaction_id++;
+    if (request->cmd_data_size > 0)
+    {
+        memcpy(usbcmd->cmd_packet.data, request->cmd_data, request->cmd_data_size);
+    }
+
+    usb_cmd_async_submit_stage(usbcmd, USB_CMD_STAGE_COMMAND);
+}
+
+/**
+ *  libusb completion of a command stage. A transaction has 3 stages:
+ *   1. Send command
+ *   2. Data transfer to or from the device, if the request has data
+ *   3. Receive response status
+ */
+static void LIBUSB_CALL usb_cmd_async_cb(struct libusb_transfer *transfer)
+{
+    usbcmd_context_t *usbcmd = (usbcmd_context_t *)transfer->user_data;
+    usb_cmd_batch_t *batch = usbcmd->cmd_head;
+    usb_cmd_request_t *request = &batch->requests[batch->current];
+
+    if (transfer->status != LIBUSB_TRANSFER_COMPLETED)
+    {
+        LOG_ERROR("Command(%08X) transfer failed in stage %d, libusb transfer status:%d",
+                  request->cmd,
+                  usbcmd->cmd_stage,
+                  transfer->status);
+        usb_cmd_async_finish_request(usbcmd, ZSA_RESULT_FAILED);
+        return;
+    }
+
+    switch (usbcmd->cmd_stage)
+    {
+    case USB_CMD_STAGE_COMMAND:
+        if (request->tx_data != NULL)
+        {
+            usb_cmd_async_submit_stage(usbcmd, USB_CMD_STAGE_TX_DATA);
+        }
+        else if (request->rx_data != NULL)
+        {
+            usb_cmd_async_submit_stage(usbcmd, USB_CMD_STAGE_RX_DATA);
+        }
+        else
+        {
+            usb_cmd_async_submit_stage(usbcmd, USB_CMD_STAGE_STATUS);
+        }
+        break;
+
+    case USB_CMD_STAGE_TX_DATA:
+    case USB_CMD_STAGE_RX_DATA:
+        request->transfer_count = (size_t)transfer->actual_length;
+        usb_cmd_async_submit_stage(usbcmd, USB_CMD_STAGE_STATUS);
+        break;
+
+    case USB_CMD_STAGE_STATUS:
+        // Check for errors in response packet. The packet status is checked by the caller in the
+        // success cases, so it shouldn't be checked here.
+        if ((transfer->actual_length != sizeof(usb_command_response_t)) ||
+            (usbcmd->cmd_response.packet_transaction_id != usbcmd->cmd_packet.header.packet_transaction_id) ||
+            (usbcmd->cmd_response.packet_type != USB_CMD_PACKET_TYPE_RESPONSE))
+        {
+            LOG_ERROR("Command(%08X) sequence ended in failure, "
+                      "transationId %08X == %08X "
+                      "Response size 0x%08X == 0x%08X "
+                      "Packet status 0x%08x == 0x%08x "
+                      "Packet type 0x%08x == 0x%08x",
+                      request->cmd,
+                      usbcmd->cmd_response.packet_transaction_id,
+                      usbcmd->cmd_packet.header.packet_transaction_id,
+                      transfer->actual_length,
+                      sizeof(usb_command_response_t),
+                      usbcmd->cmd_response.status,
+                      0,
+                      usbcmd->cmd_response.packet_type,
+                      USB_CMD_PACKET_TYPE_RESPONSE);
+            usb_cmd_async_finish_request(usbcmd, ZSA_RESULT_FAILED);
+        }
+        else
+        {
+            request->cmd_status = usbcmd->cmd_response.status;
+            usb_cmd_async_finish_request(usbcmd, ZSA_RESULT_SUCCEEDED);
+        }
+        break;
+    }
+}
+
+/**
+ *  Thread servicing libusb events while asynchronous batches are queued, so their completions run even when no stream
+ *  is active. Sleeps while the queue is empty.
+ */
+static int usb_cmd_async_thread(void *var)
+{
+    usbcmd_context_t *usbcmd = (usbcmd_context_t *)var;
+    struct timeval tv = { 0 };
+    int err;
+
+    tv.tv_usec = USB_CMD_ASYNC_EVENT_TIMEOUT_USEC;
+
+    Lock(usbcmd->cmd_lock);
+    while (usbcmd->cmd_thread_going)
+    {
+        if (usbcmd->cmd_head == NULL)
+        {
+            Condition_Wait(usbcmd->cmd_condition, usbcmd->cmd_lock, 0);
+            continue;
+        }
+
+        Unlock(usbcmd->cmd_lock);
+        if ((err = libusb_handle_events_timeout_completed(usbcmd->libusb_context, &tv, NULL)) < 0)
+        {
+            LOG_ERROR("Error calling libusb_handle_events_timeout failed, result:%s", libusb_error_name(err));
+        }
+        Lock(usbcmd->cmd_lock);
+    }
+    Unlock(usbcmd->cmd_lock);
+
+    ThreadAPI_Exit(0);
+    return 0;
+}
+
+static zsa_result_t usb_cmd_async_queue(usbcmd_context_t *usbcmd,
+                                        usb_cmd_request_t *requests,
+                                        uint32_t count,
+                                        usb_cmd_complete_cb_t *complete_cb,
+                                        void *context)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        requests[i].result = ZSA_RESULT_FAILED;
+        RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, requests[i].cmd_data_size > USB_MAX_TX_DATA);
+        RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, requests[i].cmd_data_size > 0 && requests[i].cmd_data == NULL);
+        RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, requests[i].tx_data != NULL && requests[i].rx_data != NULL);
+        RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, requests[i].data_size > INT32_MAX);
+    }
+
+    usb_cmd_batch_t *batch = (usb_cmd_batch_t *)calloc(1, sizeof(usb_cmd_batch_t));
+    zsa_result_t result = ZSA_RESULT_FROM_BOOL(batch != NULL);
+    bool start = false;
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        batch->requests = requests;
+        batch->count = count;
+        batch->result = ZSA_RESULT_SUCCEEDED;
+        batch->complete_cb = complete_cb;
+        batch->context = context;
+
+        Lock(usbcmd->cmd_lock);
+        if (usbcmd->cmd_tail)
+        {
+            usbcmd->cmd_tail->next = batch;
+        }
+        else
+        {
+            usbcmd->cmd_head = batch;
+            start = true;
+        }
+        usbcmd->cmd_tail = batch;
+        Condition_Post(usbcmd->cmd_condition);
+        Unlock(usbcmd->cmd_lock);
+    }
+
+    // The queue was idle, so this batch owns the wire
+    if (start)
+    {
+        usb_cmd_async_start_request(usbcmd);
+    }
+
+    return result;
+}
+
+zsa_result_t usb_cmd_submit(usbcmd_t usbcmd_handle,
+                            usb_cmd_request_t *requests,
+                            uint32_t count,
+                            usb_cmd_complete_cb_t *complete_cb,
+                            void *context)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_RESULT_FAILED, usbcmd_t, usbcmd_handle);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, requests == NULL);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, count == 0);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, complete_cb == NULL);
+
+    usbcmd_context_t *usbcmd = usbcmd_t_get_context(usbcmd_handle);
+    zsa_result_t result = ZSA_RESULT_SUCCEEDED;
+
+    // Asynchronous callers do not service libusb themselves, start the thread that does on first use
+    Lock(usbcmd->cmd_lock);
+    if (usbcmd->cmd_thread == NULL)
+    {
+        usbcmd->cmd_thread_going = true;
+        if (ThreadAPI_Create(&usbcmd->cmd_thread, usb_cmd_async_thread, usbcmd) != THREADAPI_OK)
+        {
+            usbcmd->cmd_thread_going = false;
+            usbcmd->cmd_thread = NULL;
+            LOG_ERROR("Could not start command thread", 0);
+            result = ZSA_RESULT_FAILED;
+        }
+    }
+    Unlock(usbcmd->cmd_lock);
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        result = TRACE_CALL(usb_cmd_async_queue(usbcmd, requests, count, complete_cb, context));
+    }
+
+    return result;
+}
+
+typedef struct _usb_cmd_execute_t
+{
+    int completed;
+    zsa_result_t result;
+} usb_cmd_execute_t;
+
+static void usb_cmd_execute_complete(zsa_result_t result, usb_cmd_request_t *requests, uint32_t count, void *context)
+{
+    (void)requests;
+    (void)count;
+    usb_cmd_execute_t *execute = (usb_cmd_execute_t *)context;
+    execute->result = result;
+    execute->completed = 1;
+}
+
+zsa_result_t usb_cmd_execute(usbcmd_t usbcmd_handle, usb_cmd_request_t *requests, uint32_t count)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_RESULT_FAILED, usbcmd_t, usbcmd_handle);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, requests == NULL);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, count == 0);
+
+    usbcmd_context_t *usbcmd = usbcmd_t_get_context(usbcmd_handle);
+    usb_cmd_execute_t execute = { 0, ZSA_RESULT_FAILED };
+    zsa_result_t result = TRACE_CALL(usb_cmd_async_queue(usbcmd, requests, count, usb_cmd_execute_complete, &execute));
+
+    // Service libusb on this thread until the batch completes, the way libusb_bulk_transfer() waits. Other threads
+    // handling events at the same time is fine, libusb wakes this one when any transfer completes.
+    while (ZSA_SUCCEEDED(result) && !execute.completed)
+    {
+        int err = libusb_handle_events_completed(usbcmd->libusb_context, &execute.completed);
+        if (err < 0 && err != LIBUSB_ERROR_INTERRUPTED)
+        {
+            // The transfers still complete or time out, keep waiting so the batch does not outlive this frame
+            LOG_ERROR("Error calling libusb_handle_events_completed, result:%s", libusb_error_name(err));
+        }
+    }
+
+    return ZSA_SUCCEEDED(result) ? execute.result : result;
+}
+
+zsa_result_t usb_cmd_async_init(usbcmd_context_t *usbcmd)
+{
+    zsa_result_t result = ZSA_RESULT_FROM_BOOL((usbcmd->cmd_lock = Lock_Init()) != NULL);
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        result = ZSA_RESULT_FROM_BOOL((usbcmd->cmd_condition = Condition_Init()) != NULL);
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        result = ZSA_RESULT_FROM_BOOL((usbcmd->cmd_idle_condition = Condition_Init()) != NULL);
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        result = ZSA_RESULT_FROM_BOOL((usbcmd->cmd_transfer = libusb_alloc_transfer(0)) != NULL);
+    }
+
+    return result;
+}
+
+void usb_cmd_async_deinit(usbcmd_context_t *usbcmd)
+{
+    if (usbcmd->cmd_lock)
+    {
+        // Let queued batches finish; their transfers complete or time out on their own
+        Lock(usbcmd->cmd_lock);
+        while (usbcmd->cmd_head != NULL)
+        {
+            Condition_Wait(usbcmd->cmd_idle_condition, usbcmd->cmd_lock, 0);
+        }
+
+        THREAD_HANDLE thread = usbcmd->cmd_thread;
+        usbcmd->cmd_thread_going = false;
+        usbcmd->cmd_thread = NULL;
+        Condition_Post(usbcmd->cmd_condition);
+        Unlock(usbcmd->cmd_lock);
+
+        if (thread)
+        {
+            ThreadAPI_Join(thread, NULL);
+        }
+    }
+
+    if (usbcmd->cmd_transfer)
+    {
+        libusb_free_transfer(usbcmd->cmd_transfer);
+        usbcmd->cmd_transfer = NULL;
+    }
+
+    if (usbcmd->cmd_idle_condition)
+    {
+        Condition_Deinit(usbcmd->cmd_idle_condition);
+        usbcmd->cmd_idle_condition = NULL;
+    }
+
+    if (usbcmd->cmd_condition)
+    {
+        Condition_Deinit(usbcmd->cmd_condition);
+        usbcmd->cmd_condition = NULL;
+    }
+
+    if (usbcmd->cmd_lock)
+    {
+        Lock_Deinit(usbcmd->cmd_lock);
+        usbcmd->cmd_lock = NULL;
+    }
+}
@@ -6,6 +6,10 @@
 // This library
 #include "usb_cmd_priv.h"
 
+// Dependent libraries
+#include <zsainternal/global.h>
+#include <zsainternal/rwlock.h>
+
 // System dependencies
 #include <stdlib.h>
 #include <string.h>
@@ -37,35 +41,9 @@ TraceLibUsbError(int err, const char *szCall, const char *szFile, int line, cons
 #define ZSA_RESULT_FROM_LIBUSB(_call_) TraceLibUsbError((_call_), #_call_, __FILE__, __LINE__, __func__)
 
 //**************Symbolic Constant Macros (defines)  *************
+#define USB_CMD_DEVICE_CACHE_SIZE 16
 
 //************************ Typedefs *****************************
-typedef struct _usb_command_header_t
-{
-    uint32_t packet_type;
-    uint32_t packet_transaction_id;
-    uint32_t payload_size;
-    uint32_t command;
-    uint32_t reserved; // Must be zero
-} usb_command_header_t;
-
-typedef struct _usb_command_packet_t
-{
-    usb_command_header_t header;
-    uint8_t data[USB_MAX_TX_DATA];
-} usb_command_packet_t;
-
-/////////////////////////////////////////////////////
-// This is the response structure going to the host.
-/////////////////////////////////////////////////////
-
-typedef struct _usb_command_response_t
-{
-    uint32_t packet_type;
-    uint32_t packet_transaction_id;
-    uint32_t status;
-    uint32_t reserved; // Will be zero
-} usb_command_response_t;
-
 typedef struct _descriptor_choice_t
 {
     uint16_t pid;
@@ -76,7 +54,32 @@ typedef struct _descriptor_choice_t
     usbcmd_context_t **handle_list;
 } descriptor_choice_t;
 
+// Descriptors read the last time a device was opened. A device gets a new address every time it enumerates, so the bus
+// number and address identify the same physical device until it is unplugged or reset.
+typedef struct _usb_cmd_cache_entry_t
+{
+    bool valid;
+    uint16_t pid;
+    uint8_t bus_number;
+    uint8_t device_address;
+    guid_t container_id;
+    unsigned char serial_number[MAX_SERIAL_NUMBER_LENGTH];
+} usb_cmd_cache_entry_t;
+
+typedef struct _usb_cmd_cache_global_t
+{
+    zsa_rwlock_t lock;
+    usb_cmd_cache_entry_t entries[USB_CMD_DEVICE_CACHE_SIZE];
+    uint32_t next_victim; // Entry replaced when a new device does not fit
+} usb_cmd_cache_global_t;
+
 //************ Declarations (Statics and globals) ***************
+static void usb_cmd_cache_global_init(usb_cmd_cache_global_t *cache)
+{
+    rwlock_init(&cache->lock);
+}
+
+ZSA_DECLARE_GLOBAL(usb_cmd_cache_global_t, usb_cmd_cache_global_init);
 
 //******************* Function Prototypes ***********************
 
@@ -145,6 +148,75 @@ static void libusb_logging_restore(libusb_context *context, enum libusb_log_leve
     // #endif
 }
 
+/**
+ *  Looks up the descriptors cached for a device, so reopening it only reads the serial number that identifies it.
+ *
+ *  @return
+ *   true when the device was opened before and has not enumerated again since
+ */
+static bool usb_cmd_cache_lookup(uint16_t pid, libusb_device *device, usb_cmd_cache_entry_t *entry)
+{
+    usb_cmd_cache_global_t *cache = usb_cmd_cache_global_t_get();
+    uint8_t bus_number = libusb_get_bus_number(device);
+    uint8_t device_address = libusb_get_device_address(device);
+    bool found = false;
+
+    rwlock_acquire_read(&cache->lock);
+    for (int i = 0; i < USB_CMD_DEVICE_CACHE_SIZE && !found; i++)
+    {
+        const usb_cmd_cache_entry_t *cached = &cache->entries[i];
+        if (cached->valid && cached->pid == pid && cached->bus_number == bus_number &&
+            cached->device_address == device_address)
+        {
+            *entry = *cached;
+            found = true;
+        }
+    }
+    rwlock_release_read(&cache->lock);
+
+    return found;
+}
+
+// Remembers the descriptors of an opened device
+static void usb_cmd_cache_store(const usbcmd_context_t *usbcmd)
+{
+    usb_cmd_cache_global_t *cache = usb_cmd_cache_global_t_get();
+    libusb_device *device = libusb_get_device(usbcmd->libusb);
+    uint8_t bus_number = libusb_get_bus_number(device);
+    uint8_t device_address = libusb_get_device_address(device);
+    usb_cmd_cache_entry_t *entry = NULL;
+
+    rwlock_acquire_write(&cache->lock);
+    for (int i = 0; i < USB_CMD_DEVICE_CACHE_SIZE; i++)
+    {
+        usb_cmd_cache_entry_t *cached = &cache->entries[i];
+        if (!cached->valid && entry == NULL)
+        {
+            entry = cached;
+        }
+        else if (cached->valid && cached->pid == usbcmd->pid && cached->bus_number == bus_number &&
+                 cached->device_address == device_address)
+        {
+            entry = cached;
+            break;
+        }
+    }
+
+    if (entry == NULL)
+    {
+        entry = &cache->entries[cache->next_victim];
+        cache->next_victim = (cache->next_victim + 1) % USB_CMD_DEVICE_CACHE_SIZE;
+    }
+
+    entry->valid = true;
+    entry->pid = usbcmd->pid;
+    entry->bus_number = bus_number;
+    entry->device_address = device_address;
+    entry->container_id = usbcmd->container_id;
+    memcpy(entry->serial_number, usbcmd->serial_number, sizeof(entry->serial_number));
+    rwlock_release_write(&cache->lock);
+}
+
 static zsa_result_t populate_container_id(usbcmd_context_t *usbcmd)
 {
     struct libusb_bos_descriptor *bos_desc = NULL;
@@ -280,6 +352,15 @@ static zsa_result_t find_libusb_device(uint32_t device_index,
                 }
             }
 
+            // A device opened before by this process is known without opening it again
+            usb_cmd_cache_entry_t cached;
+            bool is_cached = ZSA_SUCCEEDED(result) && usb_cmd_cache_lookup(usbcmd->pid, dev_list[loop], &cached);
+            if (is_cached && container_id != NULL &&
+                memcmp(container_id, &cached.container_id, sizeof(*container_id)) != 0)
+            {
+                continue;
+            }
+
             usbcmd->libusb = NULL;
             if (ZSA_SUCCEEDED(result))
             {
@@ -304,7 +385,22 @@ static zsa_result_t find_libusb_device(uint32_t device_index,
 
             if (ZSA_SUCCEEDED(result))
             {
-                result = populate_container_id(usbcmd);
+                // The serial number is always read from the device, it is what open by serial number checks. A
+                // different device enumerating at the address of a cached one reports another serial number, which
+                // drops the cached descriptors.
+                result = populate_serialnumber(usbcmd, desc);
+            }
+
+            if (ZSA_SUCCEEDED(result))
+            {
+                if (is_cached && strcmp((const char *)cached.serial_number, (const char *)usbcmd->serial_number) == 0)
+                {
+                    usbcmd->container_id = cached.container_id;
+                }
+                else
+                {
+                    result = populate_container_id(usbcmd);
+                }
             }
 
             if (ZSA_SUCCEEDED(result))
@@ -393,6 +489,11 @@ zsa_result_t usb_cmd_create(usb_command_device_type_t device_type,
         result = ZSA_RESULT_FROM_BOOL((usbcmd->lock = Lock_Init()) != NULL);
     }
 
+    if (ZSA_SUCCEEDED(result))
+    {
+        result = TRACE_CALL(usb_cmd_async_init(usbcmd));
+    }
+
     if (ZSA_SUCCEEDED(result))
     {
         if (device_type == USB_DEVICE_DEPTH_PROCESSOR)
@@ -418,7 +519,7 @@ zsa_result_t usb_cmd_create(usb_command_device_type_t device_type,
 
     if (ZSA_SUCCEEDED(result))
     {
-        result = populate_serialnumber(usbcmd, &desc);
+        usb_cmd_cache_store(usbcmd);
     }
 
     if (ZSA_SUCCEEDED(result))
@@ -476,12 +577,8 @@ void usb_cmd_destroy(usbcmd_t usbcmd_handle)
     // Implicit stop (Must be called prior to releasing any entry resources)
     usb_cmd_stream_stop(usbcmd_handle);
 
-    if (usbcmd->lock)
-    {
-        // Wait for any outstanding commands to process
-        Lock(usbcmd->lock);
-        Unlock(usbcmd->lock);
-    }
+    // Wait for any outstanding commands to process
+    usb_cmd_async_deinit(usbcmd);
 
     if (usbcmd->libusb)
     {
@@ -604,155 +701,29 @@ static zsa_result_t usb_cmd_io(usbcmd_t usbcmd_handle,
     RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, cmd_status == NULL);
     RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, p_rx_data != NULL && p_tx_data != NULL);
 
-    zsa_result_t result = ZSA_RESULT_FAILED;
-    usbcmd_context_t *usbcmd;
-    int cmd_pkt_length;
-    int err;
-    int rx_size;
-    usb_command_packet_t usb_cmd_pkt;
-    usb_command_response_t response_packet;
-    int usb_transfer_count = 0;
-    uint32_t *p_data = (uint32_t *)p_cmd_data;
-
-    size_t payload_size = (rx_data_size == 0 ? tx_data_size : rx_data_size);
+    usb_cmd_request_t request = { 0 };
+    request.cmd = cmd;
+    request.cmd_data = p_cmd_data;
+    request.cmd_data_size = cmd_data_size;
+    request.tx_data = p_tx_data;
+    request.rx_data = p_rx_data;
+    request.data_size = (rx_data_size == 0 ? tx_data_size : rx_data_size);
 
-    result = ZSA_RESULT_FROM_BOOL((usbcmd = usbcmd_t_get_context(usbcmd_handle)) != NULL);
+    // The transaction is queued behind any asynchronous batches; the device status is left to the caller, so only the
+    // outcome on the wire matters here
+    (void)usb_cmd_execute(usbcmd_handle, &request, 1);
 
-    if (ZSA_SUCCEEDED(result))
-    {
-        result = ZSA_RESULT_FROM_BOOL(cmd_data_size <= sizeof(usb_cmd_pkt.data));
-    }
-
-    if (ZSA_SUCCEEDED(result))
-    {
-        result = ZSA_RESULT_FROM_BOOL(payload_size <= INT32_MAX);
-    }
-
-    // Check for valid handle
-    // Lock
-    if (ZSA_SUCCEEDED(result))
+    if (ZSA_SUCCEEDED(request.result))
     {
-        result = ZSA_RESULT_FAILED;
-        if ((cmd_data_size > 0) && (p_data != NULL))
-        {
-            LOG_TRACE("XFR: Cmd=%08x, CmdLength=%u, PayloadSize=%zu, CmdData=%08x %08x...",
-                      cmd,
-                      cmd_data_size,
-                      payload_size,
-                      p_data[0],
-                      p_data[1]);
-        }
-        else
-        {
-            LOG_TRACE("XFR: Cmd=%08x, PayloadSize=%zu", cmd, payload_size);
-        }
-
-        Lock(usbcmd->lock);
-        // format up request and send command
-        usb_cmd_pkt.header.command = cmd;
-        usb_cmd_pkt.header.packet_type = USB_CMD_PACKET_TYPE;
-        usb_cmd_pkt.header.payload_size = (uint32_t)payload_size;
-        usb_cmd_pkt.header.reserved = 0;
-        usb_cmd_pkt.header.packet_transaction_id = usbcmd->transaction_id++;
-        memcpy(usb_cmd_pkt.data, p_cmd_data, cmd_data_size);
-
-        cmd_pkt_length = (int)(sizeof(usb_command_header_t) + cmd_data_size);
-
-        // A read transaction has 3 states.
-        //  1. Send Command
-        //  2. Data transfer to or from
-        //  3. Receive response status
-
-        // Send command
-        if ((err = libusb_bulk_transfer(usbcmd->libusb,
-                                        usbcmd->cmd_tx_endpoint,
-                                        (uint8_t *)&usb_cmd_pkt,
-                                        cmd_pkt_length,
-                                        NULL,
-                                        USB_CMD_MAX_WAIT_TIME)) == LIBUSB_SUCCESS)
-        {
-            // Send Data if data to send
-            if ((p_tx_data != NULL) && ((err = libusb_bulk_transfer(usbcmd->libusb,
-                                                                    usbcmd->cmd_tx_endpoint,
-                                                                    (uint8_t *)p_tx_data,
-                                                                    (int)payload_size,
-                                                                    &usb_transfer_count,
-                                                                    USB_CMD_MAX_WAIT_TIME))) != LIBUSB_SUCCESS)
-            {
-                usb_transfer_count = 0;
-                LOG_ERROR("Error calling libusb_bulk_transfer for tx, result:%s", libusb_error_name(err));
-                goto exit;
-            }
-
-            // Get Data if resources provided to read into
-            if ((p_rx_data != NULL) && ((err = libusb_bulk_transfer(usbcmd->libusb,
-                                                                    usbcmd->cmd_rx_endpoint,
-                                                                    (uint8_t *)p_rx_data,
-                                                                    (int)payload_size,
-                                                                    &usb_transfer_count,
-                                                                    USB_CMD_MAX_WAIT_TIME)) != LIBUSB_SUCCESS))
-            {
-                usb_transfer_count = 0;
-                LOG_ERROR("Error calling libusb_bulk_transfer for rx, result:%s", libusb_error_name(err));
-                goto exit;
-            }
-
-            // Get Status
-            if ((err = libusb_bulk_transfer(usbcmd->libusb,
-                                            usbcmd->cmd_rx_endpoint,
-                                            (uint8_t *)&response_packet,
-                                            sizeof(response_packet),
-                                            &rx_size,
-                                            USB_CMD_MAX_WAIT_TIME)) == LIBUSB_SUCCESS)
-            {
-                // Check for errors in response packet. The packet status is checked by the caller in the
-                // success cases, so it shouldn't be checked here.
-                if ((rx_size != sizeof(response_packet)) ||
-                    (response_packet.packet_transaction_id != usb_cmd_pkt.header.packet_transaction_id) ||
-                    (response_packet.packet_type != USB_CMD_PACKET_TYPE_RESPONSE))
-                {
-                    LOG_ERROR("Command(%08X) sequence ended in failure, "
-                              "transationId %08X == %08X "
-                              "Response size 0x%08X == 0x%08X "
-                              "Packet status 0x%08x == 0x%08x "
-                              "Packet type 0x%08x == 0x%08x",
-                              cmd,
-                              response_packet.packet_transaction_id,
-                              usb_cmd_pkt.header.packet_transaction_id,
-                              rx_size,
-                              sizeof(response_packet),
-                              response_packet.status,
-                              0,
-                              response_packet.packet_type,
-                              USB_CMD_PACKET_TYPE_RESPONSE);
-                }
-                else
-                {
-                    *cmd_status = response_packet.status;
-                    result = ZSA_RESULT_SUCCEEDED;
-                }
-            }
-            else
-            {
-                LOG_ERROR("Error calling libusb_bulk_transfer for status, result:%s", libusb_error_name(err));
-            }
-        }
-        else
-        {
-            LOG_ERROR("Error calling libusb_bulk_transfer for initial tx, result:%s", libusb_error_name(err));
-        }
-
-    exit:
         if (transfer_count != NULL)
         {
             // record the transfer size if requested
-            *transfer_count = (size_t)usb_transfer_count;
+            *transfer_count = request.transfer_count;
         }
-        // unlock
-        Unlock(usbcmd->lock);
+        *cmd_status = request.cmd_status;
     }
 
-    return result;
+    return request.result;
 }
 
 /**
@@ -1066,6 +1037,63 @@ zsa_result_t usb_cmd_get_device_count(uint32_t *p_device_count)
     return result;
 }
 
+zsa_result_t usb_cmd_find_device_index(usb_command_device_type_t device_type,
+                                       const char *serial_number,
+                                       uint32_t *p_device_index)
+{
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, device_type >= USB_DEVICE_TYPE_COUNT);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, serial_number == NULL);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, p_device_index == NULL);
+
+    uint16_t pid = device_type == USB_DEVICE_DEPTH_PROCESSOR ? ZSA_DEPTH_PID : ZSA_RGB_PID;
+    struct libusb_device_descriptor desc;
+    libusb_context *libusb_ctx = NULL;
+    libusb_device **dev_list = NULL;
+    ssize_t count = 0;
+    uint32_t list_index = 0;
+    bool found = false;
+
+    zsa_result_t result = ZSA_RESULT_FROM_LIBUSB(libusb_init(&libusb_ctx));
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        libusb_logging_disable(libusb_ctx);
+        count = libusb_get_device_list(libusb_ctx, &dev_list);
+        result = ZSA_RESULT_FROM_BOOL(count >= 0 && count < INT32_MAX);
+    }
+
+    // Same discovery order as find_libusb_device()
+    for (ssize_t loop = 0; ZSA_SUCCEEDED(result) && loop < count && !found; loop++)
+    {
+        usb_cmd_cache_entry_t cached;
+        if (libusb_get_device_descriptor(dev_list[loop], &desc) < 0 || desc.idVendor != ZSA_MSFT_VID ||
+            desc.idProduct != pid)
+        {
+            continue;
+        }
+
+        if (usb_cmd_cache_lookup(pid, dev_list[loop], &cached) &&
+            strcmp((const char *)cached.serial_number, serial_number) == 0)
+        {
+            *p_device_index = list_index;
+            found = true;
+        }
+        list_index++;
+    }
+
+    if (dev_list)
+    {
+        libusb_free_device_list(dev_list, (int)count);
+    }
+
+    if (libusb_ctx)
+    {
+        libusb_exit(libusb_ctx);
+    }
+
+    return ZSA_SUCCEEDED(result) && found ? ZSA_RESULT_SUCCEEDED : ZSA_RESULT_FAILED;
+}
+
 // Waiting on hot-plugging support
 #if 0
 /**
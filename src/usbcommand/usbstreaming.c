@@ -50,6 +50,102 @@ static void usb_cmd_release_xfr(struct libusb_transfer *bulk_transfer)
     free(transfer);
 }
 
+/**
+ *  Utility function counting the transfers in flight on the stream pipe
+ *
+ *  @param usbcmd
+ *   Command handle the stream belongs to
+ *
+ */
+static uint32_t usb_cmd_xfrs_in_flight(usbcmd_context_t *usbcmd)
+{
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < USB_CMD_MAX_XFR_COUNT; i++)
+    {
+        if (usbcmd->transfer_list[i] != NULL)
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+/**
+ *  Submits again the transfers held back while the stream was over its memory budget, as long as the budget has
+ *  room for their buffers
+ *
+ *  @param usbcmd
+ *   Command handle the stream belongs to
+ *
+ */
+static void usb_cmd_restore_xfrs(usbcmd_context_t *usbcmd)
+{
+    for (uint32_t i = 0; i < usbcmd->transfer_count; i++)
+    {
+        if (usbcmd->transfer_list[i] != NULL)
+        {
+            continue;
+        }
+        if (!allocator_within_budget(usbcmd->source, usbcmd->stream_size))
+        {
+            return;
+        }
+
+        usb_async_transfer_data_t *transfer = calloc(1, sizeof(usb_async_transfer_data_t));
+        zsa_result_t result = ZSA_RESULT_FROM_BOOL(transfer != NULL);
+        if (ZSA_SUCCEEDED(result))
+        {
+            transfer->usbcmd = usbcmd;
+            transfer->list_index = i;
+            transfer->bulk_transfer = libusb_alloc_transfer(0);
+            result = ZSA_RESULT_FROM_BOOL(transfer->bulk_transfer != NULL);
+        }
+
+        if (ZSA_SUCCEEDED(result))
+        {
+            result = TRACE_CALL(image_create_empty_internal(usbcmd->source, usbcmd->stream_size, &transfer->image));
+        }
+
+        if (ZSA_SUCCEEDED(result))
+        {
+            libusb_fill_bulk_transfer(transfer->bulk_transfer,
+                                      usbcmd->libusb,
+                                      usbcmd->stream_endpoint,
+                                      image_get_buffer(transfer->image),
+                                      (int)usbcmd->stream_size,
+                                      usb_cmd_libusb_cb,
+                                      transfer,
+                                      USB_CMD_MAX_WAIT_TIME);
+            int err = libusb_submit_transfer(transfer->bulk_transfer);
+            if (err != LIBUSB_SUCCESS)
+            {
+                LOG_WARNING("Transfer held back over the memory budget could not be submitted, error:%s",
+                            libusb_error_name(err));
+                result = ZSA_RESULT_FAILED;
+            }
+        }
+
+        if (ZSA_FAILED(result))
+        {
+            if (transfer)
+            {
+                if (transfer->image)
+                {
+                    image_dec_ref(transfer->image);
+                }
+                if (transfer->bulk_transfer)
+                {
+                    libusb_free_transfer(transfer->bulk_transfer);
+                }
+                free(transfer);
+            }
+            return;
+        }
+
+        usbcmd->transfer_list[i] = transfer;
+    }
+}
+
 /**
  *  Function for handling the callback from the libusb library as a result of a transfer request
  *
@@ -87,6 +183,14 @@ void LIBUSB_CALL usb_cmd_libusb_cb(struct libusb_transfer *bulk_transfer)
             image_dec_ref(transfer->image);
             transfer->image = NULL;
 
+            // Over the memory budget the stream goes on with fewer transfers in flight until memory is freed
+            if (!allocator_within_budget(usbcmd->source, usbcmd->stream_size) && usb_cmd_xfrs_in_flight(usbcmd) > 1)
+            {
+                allocator_record_shed(usbcmd->source);
+                usb_cmd_release_xfr(bulk_transfer);
+                return;
+            }
+
             // allocate next buffer and re-use transfer
             result = TRACE_CALL(image_create_empty_internal(usbcmd->source, usbcmd->stream_size, &transfer->image));
             if (ZSA_SUCCEEDED(result))
@@ -108,6 +212,11 @@ void LIBUSB_CALL usb_cmd_libusb_cb(struct libusb_transfer *bulk_transfer)
                     transfer->image = NULL;
                 }
             }
+
+            if (ZSA_SUCCEEDED(result))
+            {
+                usb_cmd_restore_xfrs(usbcmd);
+            }
         }
         else
         {
@@ -259,6 +368,8 @@ static int usb_cmd_lib_usb_thread(void *var)
     // loop servicing libusb
     if (result == ZSA_RESULT_SUCCEEDED)
     {
+        usbcmd->transfer_count = usb_cmd_xfrs_in_flight(usbcmd);
+
         while (usbcmd->stream_going)
         {
             if ((err = libusb_handle_events_timeout_completed(p_ctx, &tv, NULL)) < 0)
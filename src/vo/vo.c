@@ -0,0 +1,527 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+// This library
+#include "vo_priv.h"
+
+// Dependent libraries
+#include <zsainternal/capture.h>
+#include <zsainternal/common.h>
+#include <zsainternal/handle.h>
+#include <zsainternal/image.h>
+#include <zsainternal/logging.h>
+#include <zsainternal/queue.h>
+#include <azure_c_shared_utility/lock.h>
+#include <azure_c_shared_utility/threadapi.h>
+
+// System dependencies
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+// Fewer inliers than this and the motion estimate is not trusted
+#define VO_MIN_INLIERS (12)
+
+typedef struct _vo_feature_t
+{
+    float x; // Pixel position in the color image
+    float y;
+    float point[3]; // Camera coordinates in millimeters, valid if has_point
+    bool has_point;
+} vo_feature_t;
+
+typedef struct _vo_context_t
+{
+    vo_config_t config;
+    vo_pose_ready_cb_t *pose_ready_cb;
+    void *pose_ready_cb_context;
+
+    queue_t queue;
+    THREAD_HANDLE worker;
+    bool worker_started;
+
+    LOCK_HANDLE lock; // Serializes processing and vo_reset
+
+    vo_pyramid_pool_t pyramid_pool;
+    vo_pyramid_t *previous; // Pyramid of the last processed frame, NULL after a reset
+
+    vo_feature_t *features; // Features of the last processed frame
+    int feature_count;
+    vo_feature_t *next_features;
+
+    // Per frame scratch, sized for max_features
+    float *points;
+    float *observations;
+    int *pair_feature;
+    uint8_t *inliers;
+    vo_corner_t *corners;
+
+    // Feature grid scratch, sized for the frame
+    uint8_t *occupied;
+    vo_corner_t *cell_best;
+    int cell_capacity;
+
+    vo_rigid_t world_from_camera; // Pose of the last processed frame
+    vo_rigid_t motion;            // Last frame to frame motion, the prediction for the next frame
+} vo_context_t;
+
+ZSA_DECLARE_CONTEXT(vo_t, vo_context_t);
+
+static uint64_t vo_now_nsec(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER qpc = { 0 }, freq = { 0 };
+    QueryPerformanceCounter(&qpc);
+    QueryPerformanceFrequency(&freq);
+    return (uint64_t)(qpc.QuadPart / freq.QuadPart * 1000000000 +
+                      qpc.QuadPart % freq.QuadPart * 1000000000 / freq.QuadPart);
+#else
+    struct timespec ts_time;
+    clock_gettime(CLOCK_MONOTONIC, &ts_time);
+    return (uint64_t)ts_time.tv_sec * 1000000000 + (uint64_t)ts_time.tv_nsec;
+#endif
+}
+
+static void vo_reset_locked(vo_context_t *context)
+{
+    vo_pyramid_release(context->previous);
+    context->previous = NULL;
+    context->feature_count = 0;
+    vo_rigid_identity(&context->world_from_camera);
+    vo_rigid_identity(&context->motion);
+}
+
+// Camera coordinates of a color pixel from the depth image registered to the color camera
+static bool vo_lift_feature(const vo_config_t *config,
+                            const uint16_t *depth,
+                            int depth_stride,
+                            int depth_width,
+                            int depth_height,
+                            float scale_x,
+                            float scale_y,
+                            vo_feature_t *feature)
+{
+    int dx = (int)(feature->x * scale_x + 0.5f);
+    int dy = (int)(feature->y * scale_y + 0.5f);
+    feature->has_point = false;
+    if (dx < 0 || dy < 0 || dx >= depth_width || dy >= depth_height)
+    {
+        return false;
+    }
+
+    uint16_t z = *(const uint16_t *)((const uint8_t *)depth + (size_t)dy * (size_t)depth_stride + (size_t)dx * 2);
+    if (z == 0)
+    {
+        return false;
+    }
+
+    feature->point[0] = (feature->x - config->cx) * (float)z / config->fx;
+    feature->point[1] = (feature->y - config->cy) * (float)z / config->fy;
+    feature->point[2] = (float)z;
+    feature->has_point = true;
+    return true;
+}
+
+static bool vo_ensure_cells(vo_context_t *context, int width, int height)
+{
+    int cell_size = context->config.feature_cell_size;
+    int cell_count = ((width + cell_size - 1) / cell_size) * ((height + cell_size - 1) / cell_size);
+    if (cell_count <= context->cell_capacity)
+    {
+        return true;
+    }
+
+    free(context->occupied);
+    free(context->cell_best);
+    context->occupied = (uint8_t *)malloc((size_t)cell_count);
+    context->cell_best = (vo_corner_t *)malloc((size_t)cell_count * sizeof(vo_corner_t));
+    if (context->occupied == NULL || context->cell_best == NULL)
+    {
+        context->cell_capacity = 0;
+        LOG_ERROR("Failed to allocate %d feature cells", cell_count);
+        return false;
+    }
+    context->cell_capacity = cell_count;
+    return true;
+}
+
+static zsa_result_t vo_process_locked(vo_context_t *context, zsa_capture_t capture_handle, vo_pose_t *pose)
+{
+    const vo_config_t *config = &context->config;
+    uint64_t start = vo_now_nsec();
+
+    memset(pose, 0, sizeof(*pose));
+
+    zsa_image_t color = capture_get_color_image(capture_handle);
+    zsa_image_t depth = capture_get_depth_image(capture_handle);
+    zsa_result_t result = ZSA_RESULT_FROM_BOOL(color != NULL && depth != NULL);
+    if (ZSA_FAILED(result))
+    {
+        LOG_ERROR("Visual odometry needs a capture with both color and depth images", 0);
+    }
+
+    if (ZSA_SUCCEEDED(result) && image_get_format(depth) != ZSA_IMAGE_FORMAT_DEPTH16)
+    {
+        LOG_ERROR("Unsupported depth format %d for visual odometry", image_get_format(depth));
+        result = ZSA_RESULT_FAILED;
+    }
+
+    int width = 0;
+    int height = 0;
+    vo_pyramid_t *current = NULL;
+    if (ZSA_SUCCEEDED(result))
+    {
+        width = image_get_width_pixels(color);
+        height = image_get_height_pixels(color);
+        result = ZSA_RESULT_FROM_BOOL(vo_ensure_cells(context, width, height));
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        current = vo_pyramid_acquire(&context->pyramid_pool, width, height, config->pyramid_levels);
+        result = ZSA_RESULT_FROM_BOOL(current != NULL);
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        result = ZSA_RESULT_FROM_BOOL(vo_pyramid_from_image(color, current));
+    }
+
+    if (ZSA_SUCCEEDED(result) && context->previous != NULL &&
+        (context->previous->width[0] != width || context->previous->height[0] != height))
+    {
+        LOG_WARNING("Color resolution changed, restarting visual odometry", 0);
+        vo_reset_locked(context);
+    }
+
+    int kept = 0;
+    if (ZSA_SUCCEEDED(result) && context->previous != NULL)
+    {
+        // Track the previous features into this frame and pair the ones with depth for the motion estimate
+        int pairs = 0;
+        for (int i = 0; i < context->feature_count; i++)
+        {
+            const vo_feature_t *feature = &context->features[i];
+            vo_feature_t *tracked = &context->next_features[kept];
+            float position[2];
+            if (!vo_track_point(context->previous, current, config->track_window, feature->x, feature->y, position))
+            {
+                continue;
+            }
+
+            tracked->x = position[0];
+            tracked->y = position[1];
+            if (feature->has_point)
+            {
+                memcpy(context->points + pairs * 3, feature->point, sizeof(feature->point));
+                context->observations[pairs * 2] = position[0];
+                context->observations[pairs * 2 + 1] = position[1];
+                context->pair_feature[pairs] = kept;
+                pairs++;
+            }
+            kept++;
+        }
+        pose->tracked_features = kept;
+
+        vo_rigid_t motion = context->motion; // Constant velocity prediction
+        pose->inliers = vo_estimate_motion(
+            context->points, context->observations, pairs, config, &motion, context->inliers);
+        pose->valid = pose->inliers >= VO_MIN_INLIERS;
+
+        if (pose->valid)
+        {
+            vo_rigid_t camera_from_previous;
+            vo_rigid_invert(&motion, &camera_from_previous);
+            vo_rigid_compose(&context->world_from_camera, &camera_from_previous, &context->world_from_camera);
+            context->motion = motion;
+
+            // Drop the features that disagree with the motion; they sit on moving objects or were mistracked
+            for (int p = 0; p < pairs; p++)
+            {
+                if (!context->inliers[p])
+                {
+                    context->next_features[context->pair_feature[p]].x = -1;
+                }
+            }
+            int compacted = 0;
+            for (int i = 0; i < kept; i++)
+            {
+                if (context->next_features[i].x >= 0)
+                {
+                    context->next_features[compacted++] = context->next_features[i];
+                }
+            }
+            kept = compacted;
+        }
+        else
+        {
+            vo_rigid_identity(&context->motion);
+        }
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        // Top up with new corners in the grid cells left empty by the tracked features
+        int cell_size = config->feature_cell_size;
+        int cells_x = (width + cell_size - 1) / cell_size;
+        int cells_y = (height + cell_size - 1) / cell_size;
+        memset(context->occupied, 0, (size_t)(cells_x * cells_y));
+        for (int i = 0; i < kept; i++)
+        {
+            int cx = MIN((int)context->next_features[i].x / cell_size, cells_x - 1);
+            int cy = MIN((int)context->next_features[i].y / cell_size, cells_y - 1);
+            context->occupied[cy * cells_x + cx] = 1;
+        }
+
+        if (kept < config->max_features)
+        {
+            int found = vo_detect_corners(current->level[0],
+                                          width,
+                                          height,
+                                          config->fast_threshold,
+                                          cell_size,
+                                          config->track_window + 2,
+                                          context->occupied,
+                                          context->cell_best,
+                                          context->corners,
+                                          config->max_features - kept);
+            for (int i = 0; i < found; i++)
+            {
+                context->next_features[kept].x = context->corners[i].x;
+                context->next_features[kept].y = context->corners[i].y;
+                kept++;
+            }
+        }
+
+        // Features are lifted with this frame's depth so the next estimate is frame to frame
+        const uint16_t *depth_buffer = (const uint16_t *)image_get_buffer(depth);
+        int depth_width = image_get_width_pixels(depth);
+        int depth_height = image_get_height_pixels(depth);
+        int depth_stride = image_get_stride_bytes(depth);
+        float scale_x = (float)depth_width / (float)width;
+        float scale_y = (float)depth_height / (float)height;
+        for (int i = 0; i < kept; i++)
+        {
+            (void)vo_lift_feature(config,
+                                  depth_buffer,
+                                  depth_stride,
+                                  depth_width,
+                                  depth_height,
+                                  scale_x,
+                                  scale_y,
+                                  &context->next_features[i]);
+        }
+
+        vo_feature_t *features = context->features;
+        context->features = context->next_features;
+        context->next_features = features;
+        context->feature_count = kept;
+
+        vo_pyramid_release(context->previous);
+        context->previous = current;
+        current = NULL;
+
+        pose->device_timestamp_usec = image_get_device_timestamp_usec(color);
+        pose->system_timestamp_nsec = image_get_system_timestamp_nsec(color);
+        memcpy(pose->rotation, context->world_from_camera.rotation, sizeof(pose->rotation));
+        memcpy(pose->translation, context->world_from_camera.translation, sizeof(pose->translation));
+    }
+
+    vo_pyramid_release(current);
+    if (color)
+    {
+        image_dec_ref(color);
+    }
+    if (depth)
+    {
+        image_dec_ref(depth);
+    }
+
+    pose->processing_ms = (float)(vo_now_nsec() - start) / 1000000.0f;
+    return result;
+}
+
+static int vo_worker_thread(void *param)
+{
+    vo_context_t *context = (vo_context_t *)param;
+    zsa_capture_t capture_handle = NULL;
+
+    for (;;)
+    {
+        // queue_stop() fails the pop once vo_destroy() runs
+        zsa_wait_result_t wresult = queue_pop(context->queue, ZSA_WAIT_INFINITE, &capture_handle);
+        if (wresult == ZSA_WAIT_RESULT_TIMEOUT)
+        {
+            continue;
+        }
+        if (wresult != ZSA_WAIT_RESULT_SUCCEEDED)
+        {
+            break;
+        }
+        if (capture_handle == NULL)
+        {
+            continue;
+        }
+
+        vo_pose_t pose;
+        Lock(context->lock);
+        zsa_result_t result = vo_process_locked(context, capture_handle, &pose);
+        Unlock(context->lock);
+        capture_dec_ref(capture_handle);
+
+        if (ZSA_SUCCEEDED(result) && context->pose_ready_cb)
+        {
+            context->pose_ready_cb(&pose, context->pose_ready_cb_context);
+        }
+    }
+
+    return 0;
+}
+
+zsa_result_t vo_create(const vo_config_t *config,
+                       vo_pose_ready_cb_t *pose_ready_cb,
+                       void *pose_ready_cb_context,
+                       vo_t *vo_handle)
+{
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, config == NULL);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, vo_handle == NULL);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, config->fx <= 0 || config->fy <= 0);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED,
+                        config->pyramid_levels < 1 || config->pyramid_levels > VO_MAX_PYRAMID_LEVELS);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED,
+                        config->track_window < VO_MIN_TRACK_WINDOW || config->track_window > VO_MAX_TRACK_WINDOW);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, config->max_features <= 0);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, config->feature_cell_size <= 0);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, config->max_reprojection_error <= 0);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, config->queue_depth == 0);
+
+    vo_context_t *context = vo_t_create(vo_handle);
+    zsa_result_t result = ZSA_RESULT_FROM_BOOL(context != NULL);
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        context->config = *config;
+        context->pose_ready_cb = pose_ready_cb;
+        context->pose_ready_cb_context = pose_ready_cb_context;
+        vo_rigid_identity(&context->world_from_camera);
+        vo_rigid_identity(&context->motion);
+
+        size_t features = (size_t)config->max_features;
+        context->features = (vo_feature_t *)malloc(features * sizeof(vo_feature_t));
+        context->next_features = (vo_feature_t *)malloc(features * sizeof(vo_feature_t));
+        context->points = (float *)malloc(features * 3 * sizeof(float));
+        context->observations = (float *)malloc(features * 2 * sizeof(float));
+        context->pair_feature = (int *)malloc(features * sizeof(int));
+        context->inliers = (uint8_t *)malloc(features);
+        context->corners = (vo_corner_t *)malloc(features * sizeof(vo_corner_t));
+        result = ZSA_RESULT_FROM_BOOL(context->features != NULL && context->next_features != NULL &&
+                                      context->points != NULL && context->observations != NULL &&
+                                      context->pair_feature != NULL && context->inliers != NULL &&
+                                      context->corners != NULL);
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        context->lock = Lock_Init();
+        result = ZSA_RESULT_FROM_BOOL(context->lock != NULL);
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        result = TRACE_CALL(queue_create(config->queue_depth, "vo", &context->queue));
+    }
+
+    if (ZSA_SUCCEEDED(result))
+    {
+        queue_enable(context->queue);
+        result = ZSA_RESULT_FROM_BOOL(ThreadAPI_Create(&context->worker, vo_worker_thread, context) == THREADAPI_OK);
+        context->worker_started = ZSA_SUCCEEDED(result);
+    }
+
+    if (ZSA_FAILED(result) && context != NULL)
+    {
+        vo_destroy(*vo_handle);
+        *vo_handle = NULL;
+    }
+
+    return result;
+}
+
+void vo_destroy(vo_t vo_handle)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(VOID_VALUE, vo_t, vo_handle);
+    vo_context_t *context = vo_t_get_context(vo_handle);
+
+    if (context->queue)
+    {
+        queue_stop(context->queue);
+    }
+
+    if (context->worker_started)
+    {
+        int thread_result;
+        (void)ThreadAPI_Join(context->worker, &thread_result);
+    }
+
+    if (context->queue)
+    {
+        queue_destroy(context->queue);
+    }
+
+    if (context->lock)
+    {
+        Lock_Deinit(context->lock);
+    }
+
+    vo_pyramid_pool_free(&context->pyramid_pool);
+    free(context->features);
+    free(context->next_features);
+    free(context->points);
+    free(context->observations);
+    free(context->pair_feature);
+    free(context->inliers);
+    free(context->corners);
+    free(context->occupied);
+    free(context->cell_best);
+
+    vo_t_destroy(vo_handle);
+}
+
+zsa_result_t vo_submit_capture(vo_t vo_handle, zsa_capture_t capture_handle)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_RESULT_FAILED, vo_t, vo_handle);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, capture_handle == NULL);
+    vo_context_t *context = vo_t_get_context(vo_handle);
+
+    // The queue drops its oldest capture when full, so a slow worker never holds up capture delivery
+    queue_push(context->queue, capture_handle);
+    return ZSA_RESULT_SUCCEEDED;
+}
+
+zsa_result_t vo_process_capture(vo_t vo_handle, zsa_capture_t capture_handle, vo_pose_t *pose)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(ZSA_RESULT_FAILED, vo_t, vo_handle);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, capture_handle == NULL);
+    RETURN_VALUE_IF_ARG(ZSA_RESULT_FAILED, pose == NULL);
+    vo_context_t *context = vo_t_get_context(vo_handle);
+
+    Lock(context->lock);
+    zsa_result_t result = vo_process_locked(context, capture_handle, pose);
+    Unlock(context->lock);
+    return result;
+}
+
+void vo_reset(vo_t vo_handle)
+{
+    RETURN_VALUE_IF_HANDLE_INVALID(VOID_VALUE, vo_t, vo_handle);
+    vo_context_t *context = vo_t_get_context(vo_handle);
+
+    Lock(context->lock);
+    vo_reset_locked(context);
+    Unlock(context->lock);
+}
@@ -0,0 +1,419 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+// This library
+#include "vo_priv.h"
+
+// Dependent libraries
+#include <zsainternal/common.h>
+#include <zsainternal/image.h>
+#include <zsainternal/logging.h>
+
+// System dependencies
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VO_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define VO_NEON
+#endif
+
+// Coarse levels smaller than this carry too little texture to track
+#define VO_MIN_LEVEL_SIZE (16)
+
+// Bresenham circle of radius 3 used by the FAST segment test, clockwise from the top
+static const int8_t vo_fast_circle[16][2] = { { 0, -3 }, { 1, -3 },  { 2, -2 },  { 3, -1 }, { 3, 0 },   { 3, 1 },
+                                              { 2, 2 },  { 1, 3 },   { 0, 3 },   { -1, 3 }, { -2, 2 },  { -3, 1 },
+                                              { -3, 0 }, { -3, -1 }, { -2, -2 }, { -1, -3 } };
+
+vo_pyramid_t *vo_pyramid_acquire(vo_pyramid_pool_t *pool, int width, int height, int levels)
+{
+    vo_pyramid_t *pyramid = NULL;
+    for (int i = 0; i < VO_PYRAMID_POOL_SIZE && pyramid == NULL; i++)
+    {
+        if (!pool->pyramids[i].in_use)
+        {
+            pyramid = &pool->pyramids[i];
+        }
+    }
+
+    if (pyramid == NULL)
+    {
+        LOG_ERROR("All %d pyramids are in use", VO_PYRAMID_POOL_SIZE);
+        return NULL;
+    }
+
+    levels = MIN(MAX(levels, 1), VO_MAX_PYRAMID_LEVELS);
+
+    size_t size = 0;
+    int level_count = 0;
+    for (int w = width, h = height; level_count < levels; w /= 2, h /= 2, level_count++)
+    {
+        if (level_count > 0 && (w < VO_MIN_LEVEL_SIZE || h < VO_MIN_LEVEL_SIZE))
+        {
+            break;
+        }
+        pyramid->width[level_count] = w;
+        pyramid->height[level_count] = h;
+        size += (size_t)w * (size_t)h;
+    }
+
+    // Buffers only grow, so a steady stream of same sized frames reuses them without allocating
+    if (pyramid->buffer_size < size)
+    {
+        uint8_t *buffer = (uint8_t *)realloc(pyramid->buffer, size);
+        if (buffer == NULL)
+        {
+            LOG_ERROR("Failed to allocate %zu byte pyramid", size);
+            return NULL;
+        }
+        pyramid->buffer = buffer;
+        pyramid->buffer_size = size;
+    }
+
+    uint8_t *level = pyramid->buffer;
+    for (int l = 0; l < level_count; l++)
+    {
+        pyramid->level[l] = level;
+        level += (size_t)pyramid->width[l] * (size_t)pyramid->height[l];
+    }
+
+    pyramid->levels = level_count;
+    pyramid->in_use = true;
+    return pyramid;
+}
+
+void vo_pyramid_release(vo_pyramid_t *pyramid)
+{
+    if (pyramid != NULL)
+    {
+        pyramid->in_use = false;
+    }
+}
+
+void vo_pyramid_pool_free(vo_pyramid_pool_t *pool)
+{
+    for (int i = 0; i < VO_PYRAMID_POOL_SIZE; i++)
+    {
+        free(pool->pyramids[i].buffer);
+        memset(&pool->pyramids[i], 0, sizeof(pool->pyramids[i]));
+    }
+}
+
+static bool vo_gray_from_image(zsa_image_t color_image, uint8_t *gray, int width, int height)
+{
+    const uint8_t *src = image_get_buffer(color_image);
+    size_t stride = (size_t)image_get_stride_bytes(color_image);
+    zsa_image_format_t format = image_get_format(color_image);
+
+    switch (format)
+    {
+    case ZSA_IMAGE_FORMAT_COLOR_BGRA32:
+        for (int y = 0; y < height; y++)
+        {
+            const uint8_t *bgra = src + y * stride;
+            uint8_t *dst = gray + (size_t)y * (size_t)width;
+            for (int x = 0; x < width; x++)
+            {
+                // BT.601 luma in 8 bit fixed point
+                dst[x] = (uint8_t)((29 * bgra[4 * x] + 150 * bgra[4 * x + 1] + 77 * bgra[4 * x + 2] + 128) >> 8);
+            }
+        }
+        return true;
+
+    case ZSA_IMAGE_FORMAT_COLOR_YUY2:
+        for (int y = 0; y < height; y++)
+        {
+            const uint8_t *yuy2 = src + y * stride;
+            uint8_t *dst = gray + (size_t)y * (size_t)width;
+            for (int x = 0; x < width; x++)
+            {
+                dst[x] = yuy2[2 * x];
+            }
+        }
+        return true;
+
+    case ZSA_IMAGE_FORMAT_COLOR_NV12: // The luma plane comes first
+    case ZSA_IMAGE_FORMAT_CUSTOM8:
+        for (int y = 0; y < height; y++)
+        {
+            memcpy(gray + (size_t)y * (size_t)width, src + y * stride, (size_t)width);
+        }
+        return true;
+
+    default:
+        LOG_ERROR("Unsupported color format %d for visual odometry", format);
+        return false;
+    }
+}
+
+// 2x2 box filter from src (width x height) into dst (width / 2 x height / 2)
+static void vo_downsample(const uint8_t *src, int width, uint8_t *dst, int dst_width, int dst_height)
+{
+    for (int y = 0; y < dst_height; y++)
+    {
+        const uint8_t *row0 = src + (size_t)(2 * y) * (size_t)width;
+        const uint8_t *row1 = row0 + width;
+        uint8_t *out = dst + (size_t)y * (size_t)dst_width;
+        int x = 0;
+
+#if defined(VO_SSE2)
+        const __m128i even_mask = _mm_set1_epi16(0x00ff);
+        for (; x + 16 <= dst_width; x += 16)
+        {
+            __m128i a = _mm_avg_epu8(_mm_loadu_si128((const __m128i *)(row0 + 2 * x)),
+                                     _mm_loadu_si128((const __m128i *)(row1 + 2 * x)));
+            __m128i b = _mm_avg_epu8(_mm_loadu_si128((const __m128i *)(row0 + 2 * x + 16)),
+                                     _mm_loadu_si128((const __m128i *)(row1 + 2 * x + 16)));
+            __m128i a_sum = _mm_avg_epu16(_mm_and_si128(a, even_mask), _mm_srli_epi16(a, 8));
+            __m128i b_sum = _mm_avg_epu16(_mm_and_si128(b, even_mask), _mm_srli_epi16(b, 8));
+            _mm_storeu_si128((__m128i *)(out + x), _mm_packus_epi16(a_sum, b_sum));
+        }
+#elif defined(VO_NEON)
+        for (; x + 16 <= dst_width; x += 16)
+        {
+            uint8x16x2_t a = vld2q_u8(row0 + 2 * x);
+            uint8x16x2_t b = vld2q_u8(row1 + 2 * x);
+            vst1q_u8(out + x, vrhaddq_u8(vrhaddq_u8(a.val[0], a.val[1]), vrhaddq_u8(b.val[0], b.val[1])));
+        }
+#endif
+
+        for (; x < dst_width; x++)
+        {
+            out[x] = (uint8_t)((row0[2 * x] + row0[2 * x + 1] + row1[2 * x] + row1[2 * x + 1] + 2) >> 2);
+        }
+    }
+}
+
+bool vo_pyramid_from_image(zsa_image_t color_image, vo_pyramid_t *pyramid)
+{
+    if (!vo_gray_from_image(color_image, pyramid->level[0], pyramid->width[0], pyramid->height[0]))
+    {
+        return false;
+    }
+
+    for (int l = 1; l < pyramid->levels; l++)
+    {
+        vo_downsample(pyramid->level[l - 1],
+                      pyramid->width[l - 1],
+                      pyramid->level[l],
+                      pyramid->width[l],
+                      pyramid->height[l]);
+    }
+    return true;
+}
+
+// True if mask holds 9 contiguous bits on the circle
+static inline bool vo_fast_has_arc(uint32_t mask)
+{
+    mask |= mask << 16;
+    uint32_t run = mask;
+    for (int i = 1; i < 9; i++)
+    {
+        run &= mask >> i;
+    }
+    return run != 0;
+}
+
+// Full FAST-9 test of one pixel. Returns 0 if it is not a corner, otherwise the summed contrast of the arc.
+static int vo_fast_score(const uint8_t *p, const int offsets[16], int threshold)
+{
+    int hi = p[0] + threshold;
+    int lo = p[0] - threshold;
+    uint32_t bright = 0;
+    uint32_t dark = 0;
+    int bright_sum = 0;
+    int dark_sum = 0;
+
+    for (int i = 0; i < 16; i++)
+    {
+        int v = p[offsets[i]];
+        if (v > hi)
+        {
+            bright |= 1u << i;
+            bright_sum += v - hi;
+        }
+        else if (v < lo)
+        {
+            dark |= 1u << i;
+            dark_sum += lo - v;
+        }
+    }
+
+    int score = 0;
+    if (vo_fast_has_arc(bright))
+    {
+        score = bright_sum;
+    }
+    if (vo_fast_has_arc(dark))
+    {
+        score = MAX(score, dark_sum);
+    }
+    return score;
+}
+
+static inline void vo_keep_best(vo_corner_t *cell_best,
+                                const uint8_t *occupied,
+                                int cell_size,
+                                int cells_x,
+                                int x,
+                                int y,
+                                int score)
+{
+    int cell = (y / cell_size) * cells_x + x / cell_size;
+    if (score > cell_best[cell].score && !occupied[cell])
+    {
+        cell_best[cell].x = (float)x;
+        cell_best[cell].y = (float)y;
+        cell_best[cell].score = score;
+    }
+}
+
+static int vo_compare_corners(const void *a, const void *b)
+{
+    const vo_corner_t *ca = (const vo_corner_t *)a;
+    const vo_corner_t *cb = (const vo_corner_t *)b;
+    return (cb->score > ca->score) - (cb->score < ca->score);
+}
+
+int vo_detect_corners(const uint8_t *image,
+                      int width,
+                      int height,
+                      int threshold,
+                      int cell_size,
+                      int margin,
+                      uint8_t *occupied,
+                      vo_corner_t *cell_best,
+                      vo_corner_t *corners,
+                      int max_corners)
+{
+    int cells_x = (width + cell_size - 1) / cell_size;
+    int cells_y = (height + cell_size - 1) / cell_size;
+    int cell_count = cells_x * cells_y;
+
+    memset(cell_best, 0, (size_t)cell_count * sizeof(*cell_best));
+
+    int offsets[16];
+    for (int i = 0; i < 16; i++)
+    {
+        offsets[i] = vo_fast_circle[i][1] * width + vo_fast_circle[i][0];
+    }
+
+    margin = MAX(margin, 3);
+    threshold = MIN(MAX(threshold, 1), 254);
+
+    for (int y = margin; y < height - margin; y++)
+    {
+        const uint8_t *row = image + (size_t)y * (size_t)width;
+        int x = margin;
+
+#if defined(VO_SSE2)
+        // A 9 pixel arc covers two neighbouring compass points, so a corner has one of 0/8 and one of 4/12 on the same
+        // side of the center. Screen 16 pixels at a time on that and only run the full test on the survivors.
+        const __m128i t = _mm_set1_epi8((char)threshold);
+        const __m128i zero = _mm_setzero_si128();
+        for (; x + 16 <= width - margin; x += 16)
+        {
+            const uint8_t *p = row + x;
+            __m128i c = _mm_loadu_si128((const __m128i *)p);
+            __m128i hi = _mm_adds_epu8(c, t);
+            __m128i lo = _mm_subs_epu8(c, t);
+            __m128i p0 = _mm_loadu_si128((const __m128i *)(p + offsets[0]));
+            __m128i p4 = _mm_loadu_si128((const __m128i *)(p + offsets[4]));
+            __m128i p8 = _mm_loadu_si128((const __m128i *)(p + offsets[8]));
+            __m128i p12 = _mm_loadu_si128((const __m128i *)(p + offsets[12]));
+
+            __m128i bright = _mm_min_epu8(_mm_max_epu8(_mm_subs_epu8(p0, hi), _mm_subs_epu8(p8, hi)),
+                                          _mm_max_epu8(_mm_subs_epu8(p4, hi), _mm_subs_epu8(p12, hi)));
+            __m128i dark = _mm_min_epu8(_mm_max_epu8(_mm_subs_epu8(lo, p0), _mm_subs_epu8(lo, p8)),
+                                        _mm_max_epu8(_mm_subs_epu8(lo, p4), _mm_subs_epu8(lo, p12)));
+            int candidates = ~_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(bright, dark), zero)) & 0xffff;
+
+            while (candidates)
+            {
+                int lane = 0;
+                while (!(candidates & (1 << lane)))
+                {
+                    lane++;
+                }
+                candidates &= ~(1 << lane);
+
+                int score = vo_fast_score(p + lane, offsets, threshold);
+                if (score > 0)
+                {
+                    vo_keep_best(cell_best, occupied, cell_size, cells_x, x + lane, y, score);
+                }
+            }
+        }
+#elif defined(VO_NEON)
+        const uint8x16_t t = vdupq_n_u8((uint8_t)threshold);
+        for (; x + 16 <= width - margin; x += 16)
+        {
+            const uint8_t *p = row + x;
+            uint8x16_t c = vld1q_u8(p);
+            uint8x16_t hi = vqaddq_u8(c, t);
+            uint8x16_t lo = vqsubq_u8(c, t);
+            uint8x16_t p0 = vld1q_u8(p + offsets[0]);
+            uint8x16_t p4 = vld1q_u8(p + offsets[4]);
+            uint8x16_t p8 = vld1q_u8(p + offsets[8]);
+            uint8x16_t p12 = vld1q_u8(p + offsets[12]);
+
+            uint8x16_t bright = vminq_u8(vmaxq_u8(vqsubq_u8(p0, hi), vqsubq_u8(p8, hi)),
+                                         vmaxq_u8(vqsubq_u8(p4, hi), vqsubq_u8(p12, hi)));
+            uint8x16_t dark = vminq_u8(vmaxq_u8(vqsubq_u8(lo, p0), vqsubq_u8(lo, p8)),
+                                       vmaxq_u8(vqsubq_u8(lo, p4), vqsubq_u8(lo, p12)));
+            uint8x16_t any = vmaxq_u8(bright, dark);
+            uint64x2_t any64 = vreinterpretq_u64_u8(any);
+            if ((vgetq_lane_u64(any64, 0) | vgetq_lane_u64(any64, 1)) == 0)
+            {
+                continue;
+            }
+
+            uint8_t lanes[16];
+            vst1q_u8(lanes, any);
+            for (int lane = 0; lane < 16; lane++)
+            {
+                if (lanes[lane])
+                {
+                    int score = vo_fast_score(p + lane, offsets, threshold);
+                    if (score > 0)
+                    {
+                        vo_keep_best(cell_best, occupied, cell_size, cells_x, x + lane, y, score);
+                    }
+                }
+            }
+        }
+#endif
+
+        for (; x < width - margin; x++)
+        {
+            int score = vo_fast_score(row + x, offsets, threshold);
+            if (score > 0)
+            {
+                vo_keep_best(cell_best, occupied, cell_size, cells_x, x, y, score);
+            }
+        }
+    }
+
+    // Compact the cell winners, keep the strongest and mark their cells taken
+    int found = 0;
+    for (int cell = 0; cell < cell_count; cell++)
+    {
+        if (cell_best[cell].score > 0)
+        {
+            cell_best[found++] = cell_best[cell];
+        }
+    }
+    qsort(cell_best, (size_t)found, sizeof(*cell_best), vo_compare_corners);
+
+    int count = MIN(found, max_corners);
+    for (int i = 0; i < count; i++)
+    {
+        corners[i] = cell_best[i];
+        occupied[((int)corners[i].y / cell_size) * cells_x + (int)corners[i].x / cell_size] = 1;
+    }
+    return count;
+}
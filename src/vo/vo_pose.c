@@ -0,0 +1,307 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+// This library
+#include "vo_priv.h"
+
+// Dependent libraries
+#include <zsainternal/common.h>
+
+// System dependencies
+#include <math.h>
+#include <string.h>
+
+// Fewer correspondences than this do not constrain the six degrees of freedom reliably
+#define VO_MIN_POSE_POINTS (8)
+
+// Iterations of the robust fit over all correspondences, then of the refit over the inliers
+#define VO_ROBUST_ITERATIONS (10)
+#define VO_REFIT_ITERATIONS (5)
+
+// Points closer than this to the camera, in millimeters, are left out
+#define VO_MIN_POINT_DEPTH (1.0f)
+
+void vo_rigid_identity(vo_rigid_t *rigid)
+{
+    memset(rigid, 0, sizeof(*rigid));
+    rigid->rotation[0] = 1;
+    rigid->rotation[4] = 1;
+    rigid->rotation[8] = 1;
+}
+
+void vo_rigid_compose(const vo_rigid_t *a, const vo_rigid_t *b, vo_rigid_t *out)
+{
+    vo_rigid_t result;
+    for (int r = 0; r < 3; r++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            result.rotation[r * 3 + c] = a->rotation[r * 3] * b->rotation[c] +
+                                         a->rotation[r * 3 + 1] * b->rotation[3 + c] +
+                                         a->rotation[r * 3 + 2] * b->rotation[6 + c];
+        }
+        result.translation[r] = a->rotation[r * 3] * b->translation[0] + a->rotation[r * 3 + 1] * b->translation[1] +
+                                a->rotation[r * 3 + 2] * b->translation[2] + a->translation[r];
+    }
+    *out = result;
+}
+
+void vo_rigid_invert(const vo_rigid_t *in, vo_rigid_t *out)
+{
+    vo_rigid_t result;
+    for (int r = 0; r < 3; r++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            result.rotation[r * 3 + c] = in->rotation[c * 3 + r];
+        }
+    }
+    for (int r = 0; r < 3; r++)
+    {
+        result.translation[r] = -(result.rotation[r * 3] * in->translation[0] +
+                                  result.rotation[r * 3 + 1] * in->translation[1] +
+                                  result.rotation[r * 3 + 2] * in->translation[2]);
+    }
+    *out = result;
+}
+
+// Rotation matrix of the rotation vector omega (Rodrigues)
+static void vo_rotation_exp(const double omega[3], float rotation[9])
+{
+    double theta = sqrt(omega[0] * omega[0] + omega[1] * omega[1] + omega[2] * omega[2]);
+    double a, b;
+    if (theta < 1e-8)
+    {
+        a = 1.0;
+        b = 0.5;
+    }
+    else
+    {
+        a = sin(theta) / theta;
+        b = (1.0 - cos(theta)) / (theta * theta);
+    }
+
+    double x = omega[0], y = omega[1], z = omega[2];
+    rotation[0] = (float)(1.0 - b * (y * y + z * z));
+    rotation[1] = (float)(-a * z + b * x * y);
+    rotation[2] = (float)(a * y + b * x * z);
+    rotation[3] = (float)(a * z + b * x * y);
+    rotation[4] = (float)(1.0 - b * (x * x + z * z));
+    rotation[5] = (float)(-a * x + b * y * z);
+    rotation[6] = (float)(-a * y + b * x * z);
+    rotation[7] = (float)(a * x + b * y * z);
+    rotation[8] = (float)(1.0 - b * (x * x + y * y));
+}
+
+// Solves the 6x6 symmetric positive definite system h * x = g in place with a Cholesky factorization
+static bool vo_solve_6x6(double h[36], double g[6])
+{
+    for (int c = 0; c < 6; c++)
+    {
+        double diagonal = h[c * 6 + c];
+        for (int k = 0; k < c; k++)
+        {
+            diagonal -= h[c * 6 + k] * h[c * 6 + k];
+        }
+        if (diagonal <= 1e-12)
+        {
+            return false;
+        }
+        diagonal = sqrt(diagonal);
+        h[c * 6 + c] = diagonal;
+
+        for (int r = c + 1; r < 6; r++)
+        {
+            double value = h[r * 6 + c];
+            for (int k = 0; k < c; k++)
+            {
+                value -= h[r * 6 + k] * h[c * 6 + k];
+            }
+            h[r * 6 + c] = value / diagonal;
+        }
+    }
+
+    for (int r = 0; r < 6; r++)
+    {
+        for (int k = 0; k < r; k++)
+        {
+            g[r] -= h[r * 6 + k] * g[k];
+        }
+        g[r] /= h[r * 6 + r];
+    }
+    for (int r = 5; r >= 0; r--)
+    {
+        for (int k = r + 1; k < 6; k++)
+        {
+            g[r] -= h[k * 6 + r] * g[k];
+        }
+        g[r] /= h[r * 6 + r];
+    }
+    return true;
+}
+
+// Reprojection of point through motion. Returns false if it lands behind the camera.
+static inline bool vo_project(const vo_rigid_t *motion,
+                              const vo_config_t *config,
+                              const float point[3],
+                              float camera[3],
+                              float pixel[2])
+{
+    const float *r = motion->rotation;
+    camera[0] = r[0] * point[0] + r[1] * point[1] + r[2] * point[2] + motion->translation[0];
+    camera[1] = r[3] * point[0] + r[4] * point[1] + r[5] * point[2] + motion->translation[1];
+    camera[2] = r[6] * point[0] + r[7] * point[1] + r[8] * point[2] + motion->translation[2];
+    if (camera[2] < VO_MIN_POINT_DEPTH)
+    {
+        return false;
+    }
+    pixel[0] = config->fx * camera[0] / camera[2] + config->cx;
+    pixel[1] = config->fy * camera[1] / camera[2] + config->cy;
+    return true;
+}
+
+// One Gauss-Newton step on the reprojection error of the points with a set mask byte (all points if mask is NULL).
+// Errors beyond huber_threshold are down weighted. The update perturbs the transformed points on the left.
+static bool vo_gauss_newton_step(const float *points,
+                                 const float *observations,
+                                 int count,
+                                 const uint8_t *mask,
+                                 const vo_config_t *config,
+                                 float huber_threshold,
+                                 vo_rigid_t *motion)
+{
+    double h[36] = { 0 };
+    double g[6] = { 0 };
+    int used = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        if (mask && !mask[i])
+        {
+            continue;
+        }
+
+        float camera[3], pixel[2];
+        if (!vo_project(motion, config, points + i * 3, camera, pixel))
+        {
+            continue;
+        }
+
+        double ru = pixel[0] - observations[i * 2];
+        double rv = pixel[1] - observations[i * 2 + 1];
+        double error = sqrt(ru * ru + rv * rv);
+        double weight = error <= huber_threshold ? 1.0 : huber_threshold / error;
+
+        double x = camera[0], y = camera[1];
+        double inv_z = 1.0 / camera[2];
+        double xz = x * inv_z, yz = y * inv_z;
+        double fx = config->fx, fy = config->fy;
+
+        // d(pixel) / d(omega, tau)
+        double ju[6] = { -fx * xz * yz, fx * (1 + xz * xz), -fx * yz, fx * inv_z, 0, -fx * xz * inv_z };
+        double jv[6] = { -fy * (1 + yz * yz), fy * xz * yz, fy * xz, 0, fy * inv_z, -fy * yz * inv_z };
+
+        for (int r = 0; r < 6; r++)
+        {
+            for (int c = 0; c <= r; c++)
+            {
+                h[r * 6 + c] += weight * (ju[r] * ju[c] + jv[r] * jv[c]);
+            }
+            g[r] -= weight * (ju[r] * ru + jv[r] * rv);
+        }
+        used++;
+    }
+
+    if (used < VO_MIN_POSE_POINTS)
+    {
+        return false;
+    }
+
+    for (int r = 0; r < 6; r++)
+    {
+        h[r * 6 + r] *= 1.0 + 1e-6; // Keeps weakly constrained directions solvable
+        for (int c = r + 1; c < 6; c++)
+        {
+            h[r * 6 + c] = h[c * 6 + r];
+        }
+    }
+
+    if (!vo_solve_6x6(h, g))
+    {
+        return false;
+    }
+
+    vo_rigid_t update;
+    vo_rotation_exp(g, update.rotation);
+    update.translation[0] = (float)g[3];
+    update.translation[1] = (float)g[4];
+    update.translation[2] = (float)g[5];
+    vo_rigid_compose(&update, motion, motion);
+    return true;
+}
+
+static int vo_classify_inliers(const float *points,
+                               const float *observations,
+                               int count,
+                               const vo_config_t *config,
+                               const vo_rigid_t *motion,
+                               uint8_t *inliers)
+{
+    float threshold_squared = config->max_reprojection_error * config->max_reprojection_error;
+    int inlier_count = 0;
+    for (int i = 0; i < count; i++)
+    {
+        float camera[3], pixel[2];
+        inliers[i] = 0;
+        if (vo_project(motion, config, points + i * 3, camera, pixel))
+        {
+            float du = pixel[0] - observations[i * 2];
+            float dv = pixel[1] - observations[i * 2 + 1];
+            inliers[i] = du * du + dv * dv <= threshold_squared;
+        }
+        inlier_count += inliers[i];
+    }
+    return inlier_count;
+}
+
+int vo_estimate_motion(const float *points,
+                       const float *observations,
+                       int count,
+                       const vo_config_t *config,
+                       vo_rigid_t *motion,
+                       uint8_t *inliers)
+{
+    if (count < VO_MIN_POSE_POINTS)
+    {
+        memset(inliers, 0, (size_t)count);
+        return 0;
+    }
+
+    vo_rigid_t estimate = *motion;
+    bool converged = true;
+    for (int i = 0; i < VO_ROBUST_ITERATIONS && converged; i++)
+    {
+        converged = vo_gauss_newton_step(points, observations, count, NULL, config, config->max_reprojection_error,
+                                         &estimate);
+    }
+
+    if (converged)
+    {
+        (void)vo_classify_inliers(points, observations, count, config, &estimate, inliers);
+        for (int i = 0; i < VO_REFIT_ITERATIONS && converged; i++)
+        {
+            converged = vo_gauss_newton_step(points, observations, count, inliers, config,
+                                             config->max_reprojection_error, &estimate);
+        }
+    }
+
+    if (!converged)
+    {
+        memset(inliers, 0, (size_t)count);
+        return 0;
+    }
+
+    int inlier_count = vo_classify_inliers(points, observations, count, config, &estimate, inliers);
+    *motion = estimate;
+    return inlier_count;
+}
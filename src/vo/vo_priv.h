@@ -0,0 +1,113 @@
+/** \file vo_priv.h
+ * Copyright (c) Microsoft Corporation. All rights reserved.
+ * Licensed under the MIT License.
+ * Kinect For Azure SDK.
+ */
+
+#ifndef VO_PRIV_H
+#define VO_PRIV_H
+
+#include <zsainternal/vo.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define VO_MAX_PYRAMID_LEVELS (5)
+
+// Supported half widths of the tracked patch; the largest bounds the patch buffers on the stack
+#define VO_MIN_TRACK_WINDOW (2)
+#define VO_MAX_TRACK_WINDOW (15)
+
+// Pyramids held at once: the previous frame, the frame being processed and one spare
+#define VO_PYRAMID_POOL_SIZE (3)
+
+/** Gray image pyramid. Level 0 is full resolution, every further level halves both dimensions. Rows are packed. */
+typedef struct _vo_pyramid_t
+{
+    int levels;
+    int width[VO_MAX_PYRAMID_LEVELS];
+    int height[VO_MAX_PYRAMID_LEVELS];
+    uint8_t *level[VO_MAX_PYRAMID_LEVELS];
+
+    uint8_t *buffer; // Backing store of all levels, kept when the pyramid is released
+    size_t buffer_size;
+    bool in_use;
+} vo_pyramid_t;
+
+/** Pyramids recycled across frames so steady state processing does not allocate. */
+typedef struct _vo_pyramid_pool_t
+{
+    vo_pyramid_t pyramids[VO_PYRAMID_POOL_SIZE];
+} vo_pyramid_pool_t;
+
+vo_pyramid_t *vo_pyramid_acquire(vo_pyramid_pool_t *pool, int width, int height, int levels);
+void vo_pyramid_release(vo_pyramid_t *pyramid);
+void vo_pyramid_pool_free(vo_pyramid_pool_t *pool);
+
+/** Converts a color image to gray into level 0 of the pyramid and builds the remaining levels. */
+bool vo_pyramid_from_image(zsa_image_t color_image, vo_pyramid_t *pyramid);
+
+typedef struct _vo_corner_t
+{
+    float x;
+    float y;
+    int score;
+} vo_corner_t;
+
+/** FAST-9 detection keeping the best corner of each grid cell.
+ *
+ * \param occupied
+ *  One byte per cell, row major; cells with a non zero byte are skipped. Also receives the cells of the new corners.
+ *
+ * \return Number of corners written, the strongest first
+ */
+int vo_detect_corners(const uint8_t *image,
+                      int width,
+                      int height,
+                      int threshold,
+                      int cell_size,
+                      int margin,
+                      uint8_t *occupied,
+                      vo_corner_t *cell_best,
+                      vo_corner_t *corners,
+                      int max_corners);
+
+/** Pyramidal Lucas-Kanade tracking of one point from prev to next.
+ *
+ * \return false if the point was lost
+ */
+bool vo_track_point(const vo_pyramid_t *prev, const vo_pyramid_t *next, int window, float x, float y, float *out);
+
+/** Rigid transform p' = rotation * p + translation, rotation row major. */
+typedef struct _vo_rigid_t
+{
+    float rotation[3 * 3];
+    float translation[3];
+} vo_rigid_t;
+
+void vo_rigid_identity(vo_rigid_t *rigid);
+void vo_rigid_compose(const vo_rigid_t *a, const vo_rigid_t *b, vo_rigid_t *out); // out = a * b
+void vo_rigid_invert(const vo_rigid_t *in, vo_rigid_t *out);
+
+/** Camera motion from 3D points of the previous frame and their 2D observations in the next.
+ *
+ * Robust Gauss-Newton on the reprojection error, started from the initial value of motion, followed by a refit on
+ * the inliers.
+ *
+ * \return Number of inliers; motion is only updated when the estimate converged
+ */
+int vo_estimate_motion(const float *points,
+                       const float *observations,
+                       int count,
+                       const vo_config_t *config,
+                       vo_rigid_t *motion,
+                       uint8_t *inliers);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VO_PRIV_H */
@@ -0,0 +1,176 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+// This library
+#include "vo_priv.h"
+
+// Dependent libraries
+#include <zsainternal/common.h>
+
+// System dependencies
+#include <math.h>
+
+#define VO_MAX_PATCH_SIZE (2 * VO_MAX_TRACK_WINDOW + 3)
+
+#define VO_TRACK_MAX_ITERATIONS (20)
+
+// Updates smaller than this, in pixels, end the iterations of a level
+#define VO_TRACK_EPSILON (0.01f)
+
+// Smallest eigenvalue of the gradient matrix per patch pixel; flatter patches cannot be tracked
+#define VO_TRACK_MIN_EIGENVALUE (1.0f)
+
+// Largest mean absolute intensity difference between the patches once converged
+#define VO_TRACK_MAX_RESIDUAL (24.0f)
+
+// Samples a size x size patch whose top left corner is at (x, y). The subpixel offset is the same for every pixel, so
+// the bilinear weights are computed once.
+static void vo_sample_patch(const uint8_t *image, int width, float x, float y, int size, float *patch)
+{
+    float fx = floorf(x);
+    float fy = floorf(y);
+    float ax = x - fx;
+    float ay = y - fy;
+    float w00 = (1 - ax) * (1 - ay);
+    float w01 = ax * (1 - ay);
+    float w10 = (1 - ax) * ay;
+    float w11 = ax * ay;
+
+    const uint8_t *src = image + (size_t)fy * (size_t)width + (size_t)fx;
+    for (int j = 0; j < size; j++)
+    {
+        const uint8_t *row0 = src + (size_t)j * (size_t)width;
+        const uint8_t *row1 = row0 + width;
+        float *out = patch + j * size;
+        for (int i = 0; i < size; i++)
+        {
+            out[i] = w00 * row0[i] + w01 * row0[i + 1] + w10 * row1[i] + w11 * row1[i + 1];
+        }
+    }
+}
+
+// True if a size x size patch at (x, y) can be sampled bilinearly
+static inline bool vo_patch_inside(int width, int height, float x, float y, int size)
+{
+    return x >= 0 && y >= 0 && x + size + 1 < width && y + size + 1 < height;
+}
+
+bool vo_track_point(const vo_pyramid_t *prev, const vo_pyramid_t *next, int window, float x, float y, float *out)
+{
+    float template_patch[VO_MAX_PATCH_SIZE * VO_MAX_PATCH_SIZE];
+    float next_patch[VO_MAX_PATCH_SIZE * VO_MAX_PATCH_SIZE];
+    float gradient_x[VO_MAX_PATCH_SIZE * VO_MAX_PATCH_SIZE];
+    float gradient_y[VO_MAX_PATCH_SIZE * VO_MAX_PATCH_SIZE];
+
+    window = MIN(MAX(window, VO_MIN_TRACK_WINDOW), VO_MAX_TRACK_WINDOW);
+    int size = 2 * window + 1;
+    int border_size = size + 2; // One extra pixel around the patch for the gradients
+    int levels = MIN(prev->levels, next->levels);
+
+    // Displacement in the coordinates of the current level
+    float dx = 0;
+    float dy = 0;
+    float residual = 0;
+
+    for (int l = levels - 1; l >= 0; l--)
+    {
+        float scale = 1.0f / (float)(1 << l);
+        float px = x * scale - (float)window;
+        float py = y * scale - (float)window;
+        int width = prev->width[l];
+        int height = prev->height[l];
+
+        if (l < levels - 1)
+        {
+            dx *= 2;
+            dy *= 2;
+        }
+
+        if (!vo_patch_inside(width, height, px - 1, py - 1, border_size))
+        {
+            if (l == 0)
+            {
+                return false;
+            }
+            // Near the border the coarse levels are skipped; the finer ones still converge for small motion
+            continue;
+        }
+
+        vo_sample_patch(prev->level[l], width, px - 1, py - 1, border_size, template_patch);
+
+        float gxx = 0;
+        float gxy = 0;
+        float gyy = 0;
+        for (int j = 0; j < size; j++)
+        {
+            for (int i = 0; i < size; i++)
+            {
+                const float *t = template_patch + (j + 1) * border_size + i + 1;
+                float ix = 0.5f * (t[1] - t[-1]);
+                float iy = 0.5f * (t[border_size] - t[-border_size]);
+                gradient_x[j * size + i] = ix;
+                gradient_y[j * size + i] = iy;
+                gxx += ix * ix;
+                gxy += ix * iy;
+                gyy += iy * iy;
+            }
+        }
+
+        float pixel_count = (float)(size * size);
+        float min_eigenvalue = 0.5f * (gxx + gyy - sqrtf((gxx - gyy) * (gxx - gyy) + 4 * gxy * gxy));
+        if (min_eigenvalue < VO_TRACK_MIN_EIGENVALUE * pixel_count)
+        {
+            return false;
+        }
+        float det = gxx * gyy - gxy * gxy;
+
+        for (int iteration = 0; iteration < VO_TRACK_MAX_ITERATIONS; iteration++)
+        {
+            float qx = px + dx;
+            float qy = py + dy;
+            if (!vo_patch_inside(next->width[l], next->height[l], qx, qy, size))
+            {
+                return false;
+            }
+
+            vo_sample_patch(next->level[l], next->width[l], qx, qy, size, next_patch);
+
+            float bx = 0;
+            float by = 0;
+            residual = 0;
+            for (int j = 0; j < size; j++)
+            {
+                const float *t = template_patch + (j + 1) * border_size + 1;
+                const float *n = next_patch + j * size;
+                const float *ix = gradient_x + j * size;
+                const float *iy = gradient_y + j * size;
+                for (int i = 0; i < size; i++)
+                {
+                    float e = t[i] - n[i];
+                    bx += e * ix[i];
+                    by += e * iy[i];
+                    residual += fabsf(e);
+                }
+            }
+
+            float step_x = (gyy * bx - gxy * by) / det;
+            float step_y = (gxx * by - gxy * bx) / det;
+            dx += step_x;
+            dy += step_y;
+
+            if (step_x * step_x + step_y * step_y < VO_TRACK_EPSILON * VO_TRACK_EPSILON)
+            {
+                break;
+            }
+        }
+    }
+
+    if (residual > VO_TRACK_MAX_RESIDUAL * (float)(size * size))
+    {
+        return false;
+    }
+
+    out[0] = x + dx;
+    out[1] = y + dy;
+    return true;
+}
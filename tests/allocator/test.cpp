@@ -0,0 +1,546 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <zsainternal/allocator.h>
+#include <gtest/gtest.h>
+#include <utcommon.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+static bool is_aligned(const void *buffer, size_t alignment)
+{
+    return ((uintptr_t)buffer & (alignment - 1)) == 0;
+}
+
+// Allocate callbacks recording the calls made through them
+static std::atomic<int> g_allocations(0);
+static std::atomic<int> g_frees(0);
+static std::atomic<int> g_last_alignment(0);
+static std::atomic<int> g_last_size(0);
+static int g_context_tag = 0;
+
+static uint8_t *counting_alloc(int size, void **context)
+{
+    EXPECT_EQ(&g_context_tag, *context);
+    g_allocations++;
+    return (uint8_t *)malloc((size_t)size);
+}
+
+static uint8_t *counting_alloc_aligned(int size, int alignment, void **context)
+{
+    EXPECT_EQ(&g_context_tag, *context);
+    g_allocations++;
+    g_last_alignment = alignment;
+    g_last_size = size;
+    void *buffer = NULL;
+    return posix_memalign(&buffer, (size_t)alignment, (size_t)size) == 0 ? (uint8_t *)buffer : NULL;
+}
+
+static void counting_free(void *buffer, void *context)
+{
+    EXPECT_EQ(&g_context_tag, context);
+    g_frees++;
+    free(buffer);
+}
+
+class allocator_ut : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        g_allocations = 0;
+        g_frees = 0;
+        g_last_alignment = 0;
+        g_last_size = 0;
+    }
+
+    void TearDown() override
+    {
+        ASSERT_EQ(ZSA_RESULT_SUCCEEDED, allocator_set_source_allocator(ALLOCATION_SOURCE_USER, NULL, NULL, NULL));
+        ASSERT_EQ(ZSA_RESULT_SUCCEEDED, allocator_set_alignment(ALLOCATION_SOURCE_USER, ALLOCATOR_DEFAULT_ALIGNMENT));
+        ASSERT_EQ(0, allocator_test_for_leaks());
+    }
+};
+
+TEST_F(allocator_ut, color_is_cache_line_aligned)
+{
+    uint8_t *buffer = allocator_alloc(ALLOCATION_SOURCE_COLOR, 1000);
+    ASSERT_NE(nullptr, buffer);
+    ASSERT_TRUE(is_aligned(buffer, ALLOCATOR_CACHE_LINE_ALIGNMENT));
+    memset(buffer, 0xa5, 1000);
+    allocator_free(buffer);
+
+    buffer = allocator_alloc(ALLOCATION_SOURCE_DEPTH, 1000);
+    ASSERT_NE(nullptr, buffer);
+    ASSERT_TRUE(is_aligned(buffer, ALLOCATOR_DEFAULT_ALIGNMENT));
+    allocator_free(buffer);
+}
+
+TEST_F(allocator_ut, aligned_allocations)
+{
+    const size_t alignments[] = { 0,
+                                  ALLOCATOR_DEFAULT_ALIGNMENT,
+                                  32,
+                                  ALLOCATOR_CACHE_LINE_ALIGNMENT,
+                                  ALLOCATOR_PAGE_ALIGNMENT,
+                                  ALLOCATOR_HUGE_PAGE_ALIGNMENT };
+    for (size_t alignment : alignments)
+    {
+        for (size_t size : { (size_t)1, (size_t)100, (size_t)ALLOCATOR_PAGE_ALIGNMENT * 3 })
+        {
+            uint8_t *buffer = allocator_alloc_aligned(ALLOCATION_SOURCE_USER, size, alignment);
+            ASSERT_NE(nullptr, buffer);
+            ASSERT_TRUE(is_aligned(buffer, alignment ? alignment : ALLOCATOR_DEFAULT_ALIGNMENT)) << alignment;
+            memset(buffer, 0x5a, size);
+            allocator_free(buffer);
+        }
+    }
+
+    ASSERT_EQ(nullptr, allocator_alloc_aligned(ALLOCATION_SOURCE_USER, 100, 48));
+    ASSERT_EQ(nullptr, allocator_alloc_aligned(ALLOCATION_SOURCE_USER, 100, ALLOCATOR_HUGE_PAGE_ALIGNMENT * 2));
+}
+
+TEST_F(allocator_ut, source_alignment)
+{
+    ASSERT_EQ(ZSA_RESULT_FAILED, allocator_set_alignment(ALLOCATION_SOURCE_USER, 8));
+    ASSERT_EQ(ZSA_RESULT_FAILED, allocator_set_alignment(ALLOCATION_SOURCE_USER, 100));
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, allocator_set_alignment(ALLOCATION_SOURCE_USER, ALLOCATOR_PAGE_ALIGNMENT));
+
+    uint8_t *buffer = allocator_alloc(ALLOCATION_SOURCE_USER, ALLOCATOR_PAGE_ALIGNMENT);
+    ASSERT_NE(nullptr, buffer);
+    ASSERT_TRUE(is_aligned(buffer, ALLOCATOR_PAGE_ALIGNMENT));
+    allocator_free(buffer);
+}
+
+TEST_F(allocator_ut, padded_through_allocate_callback)
+{
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED,
+              allocator_set_source_allocator(ALLOCATION_SOURCE_USER, counting_alloc, counting_free, &g_context_tag));
+
+    uint8_t *buffer = allocator_alloc_aligned(ALLOCATION_SOURCE_USER, 5000, ALLOCATOR_PAGE_ALIGNMENT);
+    ASSERT_NE(nullptr, buffer);
+    ASSERT_TRUE(is_aligned(buffer, ALLOCATOR_PAGE_ALIGNMENT));
+    memset(buffer, 0x11, 5000);
+    ASSERT_EQ(1, g_allocations);
+
+    // The context travels with the buffer, not the source, which may have changed since
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, allocator_set_source_allocator(ALLOCATION_SOURCE_USER, NULL, NULL, NULL));
+    allocator_free(buffer);
+    ASSERT_EQ(1, g_frees);
+}
+
+TEST_F(allocator_ut, aligned_allocate_callback)
+{
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED,
+              allocator_set_source_allocator_aligned(ALLOCATION_SOURCE_USER,
+                                                     counting_alloc_aligned,
+                                                     counting_free,
+                                                     &g_context_tag));
+
+    uint8_t *buffer = allocator_alloc_aligned(ALLOCATION_SOURCE_USER, 5000, ALLOCATOR_PAGE_ALIGNMENT);
+    ASSERT_NE(nullptr, buffer);
+    ASSERT_TRUE(is_aligned(buffer, ALLOCATOR_PAGE_ALIGNMENT));
+    ASSERT_EQ(ALLOCATOR_PAGE_ALIGNMENT, g_last_alignment);
+    memset(buffer, 0x22, 5000);
+
+    // Below the default alignment the context is in front of the buffer
+    uint8_t *small = allocator_alloc(ALLOCATION_SOURCE_USER, 100);
+    ASSERT_NE(nullptr, small);
+    ASSERT_TRUE(is_aligned(small, ALLOCATOR_DEFAULT_ALIGNMENT));
+    ASSERT_EQ(ALLOCATOR_DEFAULT_ALIGNMENT, g_last_alignment);
+
+    allocator_free(buffer);
+    allocator_free(small);
+    ASSERT_EQ(2, g_allocations);
+    ASSERT_EQ(2, g_frees);
+}
+
+TEST_F(allocator_ut, huge_alignment_is_not_padded)
+{
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED,
+              allocator_set_source_allocator_aligned(ALLOCATION_SOURCE_USER,
+                                                     counting_alloc_aligned,
+                                                     counting_free,
+                                                     &g_context_tag));
+
+    // Beyond a page the header is kept out of band, the callback is asked for the buffer alone
+    uint8_t *buffer = allocator_alloc_aligned(ALLOCATION_SOURCE_USER, 5000, ALLOCATOR_HUGE_PAGE_ALIGNMENT);
+    ASSERT_NE(nullptr, buffer);
+    ASSERT_TRUE(is_aligned(buffer, ALLOCATOR_HUGE_PAGE_ALIGNMENT));
+    ASSERT_EQ(5000, g_last_size);
+    memset(buffer, 0x33, 5000);
+    allocator_free(buffer);
+
+    // Once the out of band slots run out, the header goes back in front of the buffer
+    std::vector<uint8_t *> buffers;
+    for (int i = 0; i < 200; i++)
+    {
+        buffers.push_back(allocator_alloc_aligned(ALLOCATION_SOURCE_USER, 100, 2 * ALLOCATOR_PAGE_ALIGNMENT));
+        ASSERT_NE(nullptr, buffers.back());
+        ASSERT_TRUE(is_aligned(buffers.back(), 2 * ALLOCATOR_PAGE_ALIGNMENT));
+    }
+    ASSERT_EQ(100 + 2 * ALLOCATOR_PAGE_ALIGNMENT, g_last_size);
+    for (uint8_t *b : buffers)
+    {
+        allocator_free(b);
+    }
+    ASSERT_EQ(201, g_allocations);
+    ASSERT_EQ(201, g_frees);
+}
+
+TEST_F(allocator_ut, concurrent_allocations)
+{
+    // Aligned and unaligned buffers allocated on one thread are freed on another
+    const int count = 2000;
+    std::vector<uint8_t *> buffers(count, nullptr);
+    std::thread producer([&buffers]() {
+        for (size_t i = 0; i < buffers.size(); i++)
+        {
+            allocation_source_t source = i % 2 ? ALLOCATION_SOURCE_COLOR : ALLOCATION_SOURCE_DEPTH;
+            buffers[i] = allocator_alloc(source, 64 + i);
+            memset(buffers[i], (int)i, 64 + i);
+        }
+    });
+    producer.join();
+
+    std::vector<std::thread> consumers;
+    for (int t = 0; t < 4; t++)
+    {
+        consumers.emplace_back([&buffers, t]() {
+            for (size_t i = (size_t)t; i < buffers.size(); i += 4)
+            {
+                ASSERT_EQ((uint8_t)i, buffers[i][63 + i]);
+                allocator_free(buffers[i]);
+            }
+        });
+    }
+    for (auto &consumer : consumers)
+    {
+        consumer.join();
+    }
+
+    allocator_memory_usage_t usage;
+    allocator_get_memory_usage(&usage);
+    ASSERT_EQ(0, usage.sources[ALLOCATION_SOURCE_COLOR].bytes_in_flight);
+    ASSERT_EQ(0, usage.sources[ALLOCATION_SOURCE_DEPTH].bytes_in_flight);
+}
+
+// Allocate callbacks counting the buffers they have outstanding in the counter passed as their context
+static uint8_t *outstanding_alloc(int size, void **context)
+{
+    (*(std::atomic<int> *)*context)++;
+    return (uint8_t *)malloc((size_t)size);
+}
+
+static void outstanding_free(void *buffer, void *context)
+{
+    (*(std::atomic<int> *)context)--;
+    free(buffer);
+}
+
+TEST_F(allocator_ut, config_published_while_allocating)
+{
+    // Allocations run concurrently with changes of the callbacks and alignment of their source. Each buffer is freed
+    // through the callbacks it was allocated with, and a replaced config stays valid until the allocations reading it
+    // are done.
+    std::atomic<int> outstanding[2];
+    outstanding[0] = 0;
+    outstanding[1] = 0;
+    std::atomic<bool> stop(false);
+    std::atomic<int> allocations(0);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++)
+    {
+        threads.emplace_back([&stop, &allocations, t]() {
+            std::vector<uint8_t *> buffers;
+            while (!stop || allocations < 1000)
+            {
+                const size_t alignment = t % 2 ? ALLOCATOR_DEFAULT_ALIGNMENT : ALLOCATOR_PAGE_ALIGNMENT;
+                uint8_t *buffer = allocator_alloc_aligned(ALLOCATION_SOURCE_USER, 100, alignment);
+                ASSERT_NE(nullptr, buffer);
+                ASSERT_TRUE(is_aligned(buffer, alignment));
+                memset(buffer, t, 100);
+                buffers.push_back(buffer);
+                allocations++;
+
+                // Free some buffers under a later config than they were allocated with
+                if (buffers.size() == 16)
+                {
+                    for (uint8_t *allocated : buffers)
+                    {
+                        ASSERT_EQ(t, allocated[99]);
+                        allocator_free(allocated);
+                    }
+                    buffers.clear();
+                }
+            }
+            for (uint8_t *allocated : buffers)
+            {
+                allocator_free(allocated);
+            }
+        });
+    }
+
+    for (int i = 0; i < 200; i++)
+    {
+        ASSERT_EQ(ZSA_RESULT_SUCCEEDED,
+                  allocator_set_source_allocator(ALLOCATION_SOURCE_USER,
+                                                 outstanding_alloc,
+                                                 outstanding_free,
+                                                 &outstanding[i % 2]));
+        ASSERT_EQ(ZSA_RESULT_SUCCEEDED,
+                  allocator_set_alignment(ALLOCATION_SOURCE_USER,
+                                          i % 3 ? ALLOCATOR_DEFAULT_ALIGNMENT : ALLOCATOR_CACHE_LINE_ALIGNMENT));
+    }
+    stop = true;
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    ASSERT_GE(allocations, 1000);
+    ASSERT_EQ(0, outstanding[0]);
+    ASSERT_EQ(0, outstanding[1]);
+}
+
+static allocator_backend_stats_t backend_stats(allocation_source_t source)
+{
+    allocator_backend_stats_t stats = {};
+    EXPECT_EQ(ZSA_RESULT_SUCCEEDED, allocator_get_backend_stats(source, &stats));
+    return stats;
+}
+
+TEST_F(allocator_ut, huge_page_backend)
+{
+    const size_t size = 3 * 1024 * 1024;
+    allocator_initialize();
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED,
+              allocator_set_backend(ALLOCATION_SOURCE_USB_DEPTH,
+                                    ALLOCATOR_BACKEND_HUGE_PAGES,
+                                    ALLOCATOR_NUMA_NODE_ANY));
+    allocator_backend_stats_t before = backend_stats(ALLOCATION_SOURCE_USB_DEPTH);
+
+    uint8_t *buffer = allocator_alloc(ALLOCATION_SOURCE_USB_DEPTH, size);
+    ASSERT_NE(nullptr, buffer);
+    ASSERT_TRUE(is_aligned(buffer, ALLOCATOR_CACHE_LINE_ALIGNMENT));
+    memset(buffer, 0x3c, size);
+
+    // Without reserved huge pages the mapping falls back to regular pages
+    allocator_backend_stats_t after = backend_stats(ALLOCATION_SOURCE_USB_DEPTH);
+    ASSERT_EQ(before.allocations + 1, after.allocations);
+    ASSERT_LE(after.huge_page_allocations - before.huge_page_allocations, 1u);
+    ASSERT_EQ(before.cached_allocations, after.cached_allocations);
+
+    // The next buffer of the same size reuses the mapping freed, one of another size does not
+    allocator_free(buffer);
+    uint8_t *reused = allocator_alloc(ALLOCATION_SOURCE_USB_DEPTH, size);
+    ASSERT_EQ(buffer, reused);
+    uint8_t *larger = allocator_alloc(ALLOCATION_SOURCE_USB_DEPTH, 3 * size);
+    ASSERT_NE(nullptr, larger);
+    memset(larger, 0x3c, 3 * size);
+
+    after = backend_stats(ALLOCATION_SOURCE_USB_DEPTH);
+    ASSERT_EQ(before.allocations + 3, after.allocations);
+    ASSERT_EQ(before.cached_allocations + 1, after.cached_allocations);
+    ASSERT_EQ(before.numa_bind_failures, after.numa_bind_failures);
+
+    allocator_memory_usage_t usage;
+    allocator_get_memory_usage(&usage);
+    ASSERT_EQ((int64_t)(4 * size), usage.sources[ALLOCATION_SOURCE_USB_DEPTH].bytes_in_flight);
+
+    allocator_free(reused);
+    allocator_free(larger);
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED,
+              allocator_set_backend(ALLOCATION_SOURCE_USB_DEPTH, ALLOCATOR_BACKEND_HEAP, ALLOCATOR_NUMA_NODE_ANY));
+    allocator_deinitialize();
+}
+
+TEST_F(allocator_ut, huge_page_backend_alignment)
+{
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED,
+              allocator_set_backend(ALLOCATION_SOURCE_USB_IMU, ALLOCATOR_BACKEND_HUGE_PAGES, ALLOCATOR_NUMA_NODE_ANY));
+
+    const size_t alignments[] = { ALLOCATOR_DEFAULT_ALIGNMENT,
+                                  ALLOCATOR_PAGE_ALIGNMENT,
+                                  ALLOCATOR_HUGE_PAGE_ALIGNMENT };
+    for (size_t alignment : alignments)
+    {
+        // The buffer starts the mapping, its header is kept out of band
+        uint8_t *buffer = allocator_alloc_aligned(ALLOCATION_SOURCE_USB_IMU, 100, alignment);
+        ASSERT_NE(nullptr, buffer);
+        ASSERT_TRUE(is_aligned(buffer, ALLOCATOR_HUGE_PAGE_ALIGNMENT)) << alignment;
+        memset(buffer, 0, 100);
+        allocator_free(buffer);
+    }
+
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED,
+              allocator_set_backend(ALLOCATION_SOURCE_USB_IMU, ALLOCATOR_BACKEND_HEAP, ALLOCATOR_NUMA_NODE_ANY));
+}
+
+TEST_F(allocator_ut, huge_page_backend_cache)
+{
+    const size_t size = 1024 * 1024;
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED,
+              allocator_set_backend(ALLOCATION_SOURCE_DEPTH, ALLOCATOR_BACKEND_HUGE_PAGES, ALLOCATOR_NUMA_NODE_ANY));
+    allocator_backend_stats_t before = backend_stats(ALLOCATION_SOURCE_DEPTH);
+
+    // Mappings are only kept while a session is open
+    allocator_free(allocator_alloc(ALLOCATION_SOURCE_DEPTH, size));
+    allocator_free(allocator_alloc(ALLOCATION_SOURCE_DEPTH, size));
+    ASSERT_EQ(before.cached_allocations, backend_stats(ALLOCATION_SOURCE_DEPTH).cached_allocations);
+
+    // Selecting the backend again drops the mappings kept, they may be on another node
+    allocator_initialize();
+    allocator_free(allocator_alloc(ALLOCATION_SOURCE_DEPTH, size));
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED,
+              allocator_set_backend(ALLOCATION_SOURCE_DEPTH, ALLOCATOR_BACKEND_HUGE_PAGES, ALLOCATOR_NUMA_NODE_ANY));
+    allocator_free(allocator_alloc(ALLOCATION_SOURCE_DEPTH, size));
+    ASSERT_EQ(before.cached_allocations, backend_stats(ALLOCATION_SOURCE_DEPTH).cached_allocations);
+
+    // No more than the cache holds are kept
+    std::vector<uint8_t *> buffers;
+    for (int i = 0; i < 6; i++)
+    {
+        buffers.push_back(allocator_alloc(ALLOCATION_SOURCE_DEPTH, size));
+    }
+    ASSERT_EQ(before.cached_allocations + 1, backend_stats(ALLOCATION_SOURCE_DEPTH).cached_allocations);
+    for (uint8_t *buffer : buffers)
+    {
+        allocator_free(buffer);
+    }
+    for (uint8_t *&buffer : buffers)
+    {
+        buffer = allocator_alloc(ALLOCATION_SOURCE_DEPTH, size);
+    }
+    ASSERT_EQ(before.cached_allocations + 5, backend_stats(ALLOCATION_SOURCE_DEPTH).cached_allocations);
+    for (uint8_t *buffer : buffers)
+    {
+        allocator_free(buffer);
+    }
+
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED,
+              allocator_set_backend(ALLOCATION_SOURCE_DEPTH, ALLOCATOR_BACKEND_HEAP, ALLOCATOR_NUMA_NODE_ANY));
+    allocator_deinitialize();
+}
+
+TEST_F(allocator_ut, huge_page_backend_invalid_arguments)
+{
+    ASSERT_EQ(ZSA_RESULT_FAILED,
+              allocator_set_backend(ALLOCATION_SOURCE_COM_DEPTH, ALLOCATOR_BACKEND_HEAP, ALLOCATOR_NUMA_NODE_ANY));
+    ASSERT_EQ(ZSA_RESULT_FAILED, allocator_set_backend(ALLOCATION_SOURCE_DEPTH, ALLOCATOR_BACKEND_HEAP, -2));
+    ASSERT_EQ(ZSA_RESULT_FAILED,
+              allocator_set_backend(ALLOCATION_SOURCE_DEPTH, ALLOCATOR_BACKEND_HEAP, ALLOCATOR_MAX_NUMA_NODES));
+    ASSERT_EQ(ZSA_RESULT_FAILED, allocator_get_backend_stats(ALLOCATION_SOURCE_DEPTH, NULL));
+}
+
+static allocator_source_usage_t source_usage(allocation_source_t source)
+{
+    allocator_memory_usage_t usage;
+    allocator_get_memory_usage(&usage);
+    return usage.sources[source];
+}
+
+TEST_F(allocator_ut, budget_fail)
+{
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, allocator_set_budget(ALLOCATION_SOURCE_IMU, 1000, ALLOCATOR_BUDGET_FAIL));
+    allocator_source_usage_t before = source_usage(ALLOCATION_SOURCE_IMU);
+    ASSERT_EQ(1000u, before.budget_bytes);
+    ASSERT_EQ(ALLOCATOR_BUDGET_FAIL, before.budget_policy);
+
+    uint8_t *first = allocator_alloc(ALLOCATION_SOURCE_IMU, 600);
+    ASSERT_NE(nullptr, first);
+    ASSERT_FALSE(allocator_within_budget(ALLOCATION_SOURCE_IMU, 600));
+
+    // Going over fails and counts nothing in flight
+    ASSERT_EQ(nullptr, allocator_alloc(ALLOCATION_SOURCE_IMU, 600));
+    allocator_source_usage_t after = source_usage(ALLOCATION_SOURCE_IMU);
+    ASSERT_EQ(600, after.bytes_in_flight);
+    ASSERT_GE(after.peak_bytes_in_flight, 600);
+    ASSERT_EQ(before.failed_allocations + 1, after.failed_allocations);
+
+    uint8_t *second = allocator_alloc(ALLOCATION_SOURCE_IMU, 400);
+    ASSERT_NE(nullptr, second);
+
+    // Freeing makes room again
+    allocator_free(first);
+    first = allocator_alloc(ALLOCATION_SOURCE_IMU, 600);
+    ASSERT_NE(nullptr, first);
+    ASSERT_EQ(before.failed_allocations + 1, source_usage(ALLOCATION_SOURCE_IMU).failed_allocations);
+
+    allocator_free(first);
+    allocator_free(second);
+    ASSERT_EQ(0, source_usage(ALLOCATION_SOURCE_IMU).bytes_in_flight);
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, allocator_set_budget(ALLOCATION_SOURCE_IMU, 0, ALLOCATOR_BUDGET_SHED));
+}
+
+TEST_F(allocator_ut, budget_shed)
+{
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, allocator_set_budget(ALLOCATION_SOURCE_IMU, 1000, ALLOCATOR_BUDGET_SHED));
+    allocator_source_usage_t before = source_usage(ALLOCATION_SOURCE_IMU);
+    ASSERT_TRUE(allocator_within_budget(ALLOCATION_SOURCE_IMU, 1000));
+    ASSERT_FALSE(allocator_within_budget(ALLOCATION_SOURCE_IMU, 1001));
+
+    uint8_t *first = allocator_alloc(ALLOCATION_SOURCE_IMU, 600);
+    ASSERT_NE(nullptr, first);
+
+    // The producer drops the next frame, allocations still succeed
+    ASSERT_FALSE(allocator_within_budget(ALLOCATION_SOURCE_IMU, 600));
+    allocator_record_shed(ALLOCATION_SOURCE_IMU);
+    uint8_t *second = allocator_alloc(ALLOCATION_SOURCE_IMU, 600);
+    ASSERT_NE(nullptr, second);
+
+    allocator_source_usage_t after = source_usage(ALLOCATION_SOURCE_IMU);
+    ASSERT_EQ(1200, after.bytes_in_flight);
+    ASSERT_GE(after.peak_bytes_in_flight, 1200);
+    ASSERT_EQ(before.shed_count + 1, after.shed_count);
+    ASSERT_EQ(before.failed_allocations, after.failed_allocations);
+
+    allocator_free(first);
+    allocator_free(second);
+    ASSERT_TRUE(allocator_within_budget(ALLOCATION_SOURCE_IMU, 1000));
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, allocator_set_budget(ALLOCATION_SOURCE_IMU, 0, ALLOCATOR_BUDGET_SHED));
+}
+
+TEST_F(allocator_ut, total_budget)
+{
+    // Each source applies its own policy to the total budget
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, allocator_set_budget(ALLOCATION_SOURCE_IMU, 0, ALLOCATOR_BUDGET_FAIL));
+    allocator_set_total_budget(1000);
+
+    allocator_memory_usage_t usage;
+    allocator_get_memory_usage(&usage);
+    ASSERT_EQ(1000u, usage.budget_bytes);
+    ASSERT_EQ(0, usage.bytes_in_flight);
+
+    uint8_t *shed = allocator_alloc(ALLOCATION_SOURCE_USB_IMU, 800);
+    ASSERT_NE(nullptr, shed);
+    ASSERT_FALSE(allocator_within_budget(ALLOCATION_SOURCE_USB_IMU, 800));
+    ASSERT_EQ(nullptr, allocator_alloc(ALLOCATION_SOURCE_IMU, 800));
+    uint8_t *fits = allocator_alloc(ALLOCATION_SOURCE_IMU, 200);
+    ASSERT_NE(nullptr, fits);
+
+    allocator_get_memory_usage(&usage);
+    ASSERT_EQ(1000, usage.bytes_in_flight);
+
+    allocator_free(shed);
+    allocator_free(fits);
+    allocator_set_total_budget(0);
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, allocator_set_budget(ALLOCATION_SOURCE_IMU, 0, ALLOCATOR_BUDGET_SHED));
+}
+
+TEST_F(allocator_ut, budget_invalid_arguments)
+{
+    ASSERT_EQ(ZSA_RESULT_FAILED, allocator_set_budget(ALLOCATION_SOURCE_COM_IMU, 1000, ALLOCATOR_BUDGET_FAIL));
+    ASSERT_EQ(ZSA_RESULT_FAILED, allocator_set_budget(ALLOCATION_SOURCE_IMU, 1000, (allocator_budget_policy_t)2));
+    ASSERT_FALSE(allocator_within_budget(ALLOCATION_SOURCE_COM_IMU, 0));
+}
+
+int main(int argc, char **argv)
+{
+    return zsa_test_common_main(argc, argv);
+}
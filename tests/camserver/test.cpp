@@ -0,0 +1,401 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <zsainternal/camserver.h>
+#include <zsainternal/allocator.h>
+#include <zsainternal/capture.h>
+#include <zsainternal/capturesync.h>
+#include <zsainternal/image.h>
+#include <gtest/gtest.h>
+#include <utcommon.h>
+
+#include <string>
+#include <unistd.h>
+
+static const int g_width = 64;
+static const int g_height = 32;
+
+// Allocator of the application, and decoder of color images, recording the calls made to them
+static int g_context_tag = 0;
+static int g_decodes = 0;
+
+static uint8_t *application_alloc(int size, void **context)
+{
+    (void)context;
+    return (uint8_t *)malloc((size_t)size);
+}
+
+static void application_free(void *buffer, void *context)
+{
+    (void)context;
+    free(buffer);
+}
+
+static zsa_result_t counting_decode(zsa_image_t source, const capture_color_decoder_t *decoder, zsa_image_t *decoded)
+{
+    (void)source;
+    (void)decoder;
+    g_decodes++;
+    *decoded = NULL;
+    return ZSA_RESULT_FAILED;
+}
+
+class camserver_ut : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        m_name = "camserver_ut_" + std::to_string(getpid());
+        ASSERT_EQ(ZSA_RESULT_SUCCEEDED, capturesync_create(&m_sync));
+
+        // Depth only, captures are published as they arrive. The device queue holds on to the newest only, so the
+        // slots in use are the ones of the ring and the clients.
+        zsa_device_configuration_t config = ZSA_DEVICE_CONFIG_INIT_DISABLE_ALL;
+        config.depth_mode = ZSA_DEPTH_MODE_NFOV_UNBINNED;
+        config.camera_fps = ZSA_FRAMES_PER_SECOND_30;
+        ASSERT_EQ(ZSA_RESULT_SUCCEEDED, capturesync_start(m_sync, &config));
+        ASSERT_EQ(ZSA_RESULT_SUCCEEDED, capturesync_set_overflow_policy(m_sync, QUEUE_OVERFLOW_KEEP_LATEST, 0));
+    }
+
+    void TearDown() override
+    {
+        if (m_server)
+        {
+            camserver_destroy(m_server);
+        }
+        capturesync_stop(m_sync);
+        capturesync_destroy(m_sync);
+    }
+
+    void start_server(uint32_t slot_count, uint32_t ring_size)
+    {
+        zsa_server_configuration_t config = { slot_count, (size_t)g_width * g_height * 2, ring_size };
+        ASSERT_EQ(ZSA_RESULT_SUCCEEDED, camserver_create(m_sync, m_name.c_str(), &config, &m_server));
+    }
+
+    // Adds a capture whose images are filled with the low byte of the timestamp. Depth images of
+    // ALLOCATION_SOURCE_DEPTH are allocated in a slot, IR images of ALLOCATION_SOURCE_USER are copied into one.
+    void add_capture(uint64_t timestamp_usec, bool depth)
+    {
+        zsa_capture_t capture = NULL;
+        zsa_image_t image = NULL;
+        ASSERT_EQ(ZSA_RESULT_SUCCEEDED, capture_create(&capture));
+
+        if (depth)
+        {
+            ASSERT_EQ(ZSA_RESULT_SUCCEEDED,
+                      image_create(ZSA_IMAGE_FORMAT_DEPTH16,
+                                   g_width,
+                                   g_height,
+                                   g_width * 2,
+                                   ALLOCATION_SOURCE_DEPTH,
+                                   &image));
+            memset(image_get_buffer(image), (int)(timestamp_usec & 0xff), image_get_size(image));
+            image_set_device_timestamp_usec(image, timestamp_usec);
+            capture_set_depth_image(capture, image);
+            image_dec_ref(image);
+        }
+
+        ASSERT_EQ(ZSA_RESULT_SUCCEEDED,
+                  image_create(ZSA_IMAGE_FORMAT_IR16, g_width, g_height, g_width * 2, ALLOCATION_SOURCE_USER, &image));
+        memset(image_get_buffer(image), (int)(timestamp_usec & 0xff), image_get_size(image));
+        image_set_device_timestamp_usec(image, timestamp_usec);
+        capture_set_ir_image(capture, image);
+        image_dec_ref(image);
+
+        capturesync_add_capture(m_sync, ZSA_RESULT_SUCCEEDED, capture, false);
+        capture_dec_ref(capture);
+    }
+
+    // Timestamp of the next capture a client reads, 0 if there is none
+    static uint64_t read_timestamp(camclient_t client, int32_t timeout_in_ms, zsa_capture_t *held = NULL)
+    {
+        zsa_capture_t capture = NULL;
+        if (camclient_get_capture(client, &capture, timeout_in_ms) != ZSA_WAIT_RESULT_SUCCEEDED)
+        {
+            return 0;
+        }
+
+        zsa_image_t image = capture_get_ir_image(capture);
+        uint64_t timestamp_usec = image_get_device_timestamp_usec(image);
+        image_dec_ref(image);
+
+        if (held)
+        {
+            *held = capture;
+        }
+        else
+        {
+            capture_dec_ref(capture);
+        }
+        return timestamp_usec;
+    }
+
+    // Reads until the capture of a timestamp, which tells that the server published every capture before it
+    static void read_until(camclient_t client, uint64_t timestamp_usec)
+    {
+        uint64_t read = 0;
+        while (read != timestamp_usec)
+        {
+            read = read_timestamp(client, 1000);
+            ASSERT_NE(0u, read);
+        }
+    }
+
+    static bool filled_with(zsa_image_t image, uint8_t value)
+    {
+        const uint8_t *buffer = image_get_buffer(image);
+        for (size_t i = 0; i < image_get_size(image); i++)
+        {
+            if (buffer[i] != value)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::string m_name;
+    capturesync_t m_sync = NULL;
+    camserver_t m_server = NULL;
+};
+
+TEST_F(camserver_ut, publishes_captures)
+{
+    start_server(8, 4);
+    camclient_t client = NULL;
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, camclient_open(m_name.c_str(), &client));
+
+    add_capture(0x101, true);
+
+    zsa_capture_t capture = NULL;
+    ASSERT_EQ(ZSA_WAIT_RESULT_SUCCEEDED, camclient_get_capture(client, &capture, 1000));
+
+    zsa_image_t depth = capture_get_depth_image(capture);
+    ASSERT_NE(nullptr, depth);
+    ASSERT_EQ(ZSA_IMAGE_FORMAT_DEPTH16, image_get_format(depth));
+    ASSERT_EQ(g_width, image_get_width_pixels(depth));
+    ASSERT_EQ(g_height, image_get_height_pixels(depth));
+    ASSERT_EQ(g_width * 2, image_get_stride_bytes(depth));
+    ASSERT_EQ(0x101u, image_get_device_timestamp_usec(depth));
+    ASSERT_TRUE(filled_with(depth, 0x01));
+    image_dec_ref(depth);
+
+    zsa_image_t ir = capture_get_ir_image(capture);
+    ASSERT_NE(nullptr, ir);
+    ASSERT_EQ(ZSA_IMAGE_FORMAT_IR16, image_get_format(ir));
+    ASSERT_TRUE(filled_with(ir, 0x01));
+    image_dec_ref(ir);
+
+    ASSERT_EQ(nullptr, capture_get_color_image(capture));
+    capture_dec_ref(capture);
+
+    ASSERT_EQ(ZSA_WAIT_RESULT_TIMEOUT, camclient_get_capture(client, &capture, 0));
+    camclient_close(client);
+}
+
+TEST_F(camserver_ut, held_images_keep_their_slots)
+{
+    start_server(8, 1);
+    camclient_t client = NULL;
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, camclient_open(m_name.c_str(), &client));
+
+    add_capture(0x111, true);
+    zsa_capture_t held = NULL;
+    ASSERT_EQ(0x111u, read_timestamp(client, 1000, &held));
+
+    // The ring entry of the capture held is reused and the server frees its images, the slots stay with the client
+    for (uint64_t timestamp_usec = 0x122; timestamp_usec <= 0x166; timestamp_usec += 0x11)
+    {
+        add_capture(timestamp_usec, true);
+    }
+    read_until(client, 0x166);
+
+    zsa_image_t depth = capture_get_depth_image(held);
+    zsa_image_t ir = capture_get_ir_image(held);
+    ASSERT_TRUE(filled_with(depth, 0x11));
+    ASSERT_TRUE(filled_with(ir, 0x11));
+    image_dec_ref(depth);
+    image_dec_ref(ir);
+    capture_dec_ref(held);
+
+    camclient_close(client);
+}
+
+TEST_F(camserver_ut, capture_dropped_without_free_slot)
+{
+    // Each capture takes the only slot for the copy of its IR image
+    start_server(1, 1);
+    camclient_t client = NULL;
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, camclient_open(m_name.c_str(), &client));
+
+    add_capture(1000, false);
+    zsa_capture_t held = NULL;
+    ASSERT_EQ(1000u, read_timestamp(client, 1000, &held));
+
+    add_capture(2000, false);
+    ASSERT_EQ(0u, read_timestamp(client, 300));
+
+    // Releasing the capture frees its slot for the next one
+    capture_dec_ref(held);
+    add_capture(3000, false);
+    ASSERT_EQ(3000u, read_timestamp(client, 1000));
+
+    camclient_close(client);
+}
+
+TEST_F(camserver_ut, client_falling_behind_skips_ahead)
+{
+    start_server(8, 2);
+    camclient_t lagging = NULL;
+    camclient_t probe = NULL;
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, camclient_open(m_name.c_str(), &lagging));
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, camclient_open(m_name.c_str(), &probe));
+
+    for (uint64_t timestamp_usec = 1000; timestamp_usec <= 5000; timestamp_usec += 1000)
+    {
+        add_capture(timestamp_usec, false);
+    }
+    read_until(probe, 5000);
+
+    // The oldest capture still in the ring is next, then captures are read in order
+    ASSERT_EQ(4000u, read_timestamp(lagging, 0));
+    ASSERT_EQ(5000u, read_timestamp(lagging, 0));
+    ASSERT_EQ(0u, read_timestamp(lagging, 0));
+
+    camclient_close(probe);
+    camclient_close(lagging);
+}
+
+TEST_F(camserver_ut, clients_fail_once_server_stops)
+{
+    start_server(8, 4);
+    camclient_t client = NULL;
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, camclient_open(m_name.c_str(), &client));
+
+    add_capture(0x121, true);
+    zsa_capture_t held = NULL;
+    ASSERT_EQ(0x121u, read_timestamp(client, 1000, &held));
+
+    camserver_destroy(m_server);
+    m_server = NULL;
+
+    zsa_capture_t capture = NULL;
+    ASSERT_EQ(ZSA_WAIT_RESULT_FAILED, camclient_get_capture(client, &capture, ZSA_WAIT_INFINITE));
+    camclient_close(client);
+
+    // Images read before stay mapped until released
+    zsa_image_t depth = capture_get_depth_image(held);
+    ASSERT_TRUE(filled_with(depth, 0x21));
+    image_dec_ref(depth);
+    capture_dec_ref(held);
+}
+
+TEST_F(camserver_ut, color_published_as_captured)
+{
+    start_server(8, 4);
+    camclient_t client = NULL;
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, camclient_open(m_name.c_str(), &client));
+
+    // An MJPEG color image that would be decoded by capture_get_color_decoded_image(), with the IR image of the depth
+    // capture it is synchronized with
+    static uint8_t jpeg[256];
+    memset(jpeg, 0x5a, sizeof(jpeg));
+    zsa_capture_t capture = NULL;
+    zsa_image_t color = NULL;
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, capture_create(&capture));
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED,
+              image_create_from_buffer(
+                  ZSA_IMAGE_FORMAT_COLOR_MJPG, g_width, g_height, 0, jpeg, sizeof(jpeg), NULL, NULL, &color));
+    capture_set_color_image(capture, color);
+    image_dec_ref(color);
+
+    zsa_image_t ir = NULL;
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED,
+              image_create(ZSA_IMAGE_FORMAT_IR16, g_width, g_height, g_width * 2, ALLOCATION_SOURCE_USER, &ir));
+    capture_set_ir_image(capture, ir);
+    image_dec_ref(ir);
+
+    capture_color_decoder_t decoder = {};
+    decoder.decode_cb = counting_decode;
+    capture_set_color_decoder(capture, &decoder);
+    g_decodes = 0;
+    capturesync_add_capture(m_sync, ZSA_RESULT_SUCCEEDED, capture, false);
+    capture_dec_ref(capture);
+
+    // The client gets the compressed image, the server did not decode it
+    ASSERT_EQ(ZSA_WAIT_RESULT_SUCCEEDED, camclient_get_capture(client, &capture, 1000));
+    color = capture_get_color_image(capture);
+    ASSERT_NE(nullptr, color);
+    ASSERT_EQ(ZSA_IMAGE_FORMAT_COLOR_MJPG, image_get_format(color));
+    ASSERT_EQ(sizeof(jpeg), image_get_size(color));
+    ASSERT_TRUE(filled_with(color, 0x5a));
+    image_dec_ref(color);
+    capture_dec_ref(capture);
+    ASSERT_EQ(0, g_decodes);
+
+    camclient_close(client);
+}
+
+TEST_F(camserver_ut, restores_application_allocators)
+{
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED,
+              allocator_set_source_allocator(ALLOCATION_SOURCE_DEPTH,
+                                             application_alloc,
+                                             application_free,
+                                             &g_context_tag));
+
+    // The server allocates depth frames while it runs
+    start_server(8, 4);
+    allocator_callbacks_t callbacks;
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, allocator_get_source_callbacks(ALLOCATION_SOURCE_DEPTH, &callbacks));
+    ASSERT_EQ(nullptr, callbacks.alloc);
+    ASSERT_NE((void *)&g_context_tag, callbacks.context);
+
+    camserver_destroy(m_server);
+    m_server = NULL;
+
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, allocator_get_source_callbacks(ALLOCATION_SOURCE_DEPTH, &callbacks));
+    ASSERT_EQ(application_alloc, callbacks.alloc);
+    ASSERT_EQ(application_free, callbacks.free);
+    ASSERT_EQ((void *)&g_context_tag, callbacks.context);
+
+    // Color had no allocator of the application, it is back to the default one
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, allocator_get_source_callbacks(ALLOCATION_SOURCE_COLOR, &callbacks));
+    ASSERT_NE(nullptr, callbacks.alloc);
+    ASSERT_EQ(nullptr, callbacks.context);
+
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, allocator_set_source_allocator(ALLOCATION_SOURCE_DEPTH, NULL, NULL, NULL));
+}
+
+TEST_F(camserver_ut, one_server_per_process)
+{
+    start_server(8, 4);
+
+    camserver_t second = NULL;
+    std::string other = m_name + "_other";
+    ASSERT_EQ(ZSA_RESULT_FAILED, camserver_create(m_sync, other.c_str(), NULL, &second));
+
+    camclient_t client = NULL;
+    ASSERT_EQ(ZSA_RESULT_FAILED, camclient_open(other.c_str(), &client));
+}
+
+TEST_F(camserver_ut, invalid_configuration)
+{
+    zsa_server_configuration_t config = { CAMSERVER_MAX_SLOTS + 1, 4096, 4 };
+    ASSERT_EQ(ZSA_RESULT_FAILED, camserver_create(m_sync, m_name.c_str(), &config, &m_server));
+
+    config.slot_count = 8;
+    config.ring_size = CAMSERVER_MAX_RING_SIZE + 1;
+    ASSERT_EQ(ZSA_RESULT_FAILED, camserver_create(m_sync, m_name.c_str(), &config, &m_server));
+
+    config.ring_size = 4;
+    config.slot_size_bytes = 0;
+    ASSERT_EQ(ZSA_RESULT_FAILED, camserver_create(m_sync, m_name.c_str(), &config, &m_server));
+    ASSERT_EQ(nullptr, m_server);
+}
+
+int main(int argc, char **argv)
+{
+    return zsa_test_common_main(argc, argv);
+}
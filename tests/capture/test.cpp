@@ -0,0 +1,170 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <zsainternal/capture.h>
+#include <zsainternal/image.h>
+#include <gtest/gtest.h>
+#include <utcommon.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+static std::atomic<int> g_decode_calls(0);
+
+// Stands in for the MJPEG decoder: a BGRA32 image of the scaled size, filled with the first byte of the source
+static zsa_result_t fake_decode(zsa_image_t source, const capture_color_decoder_t *decoder, zsa_image_t *decoded)
+{
+    g_decode_calls++;
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    const int shift = (int)decoder->scale;
+    const int width = image_get_width_pixels(source) >> shift;
+    const int height = image_get_height_pixels(source) >> shift;
+    zsa_result_t result =
+        image_create(ZSA_IMAGE_FORMAT_COLOR_BGRA32, width, height, width * 4, ALLOCATION_SOURCE_USER, decoded);
+    if (ZSA_SUCCEEDED(result))
+    {
+        memset(image_get_buffer(*decoded), image_get_buffer(source)[0], image_get_size(*decoded));
+    }
+    return result;
+}
+
+static zsa_result_t failing_decode(zsa_image_t source, const capture_color_decoder_t *decoder, zsa_image_t *decoded)
+{
+    (void)source;
+    (void)decoder;
+    (void)decoded;
+    g_decode_calls++;
+    return ZSA_RESULT_FAILED;
+}
+
+class capture_ut : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        g_decode_calls = 0;
+        ASSERT_EQ(ZSA_RESULT_SUCCEEDED, capture_create(&m_capture));
+        ASSERT_EQ(ZSA_RESULT_SUCCEEDED,
+                  image_create(ZSA_IMAGE_FORMAT_CUSTOM8, 64, 32, 64, ALLOCATION_SOURCE_USER, &m_color));
+        memset(image_get_buffer(m_color), 0x5a, image_get_size(m_color));
+        capture_set_color_image(m_capture, m_color);
+    }
+
+    void TearDown() override
+    {
+        image_dec_ref(m_color);
+        capture_dec_ref(m_capture);
+    }
+
+    zsa_capture_t m_capture = NULL;
+    zsa_image_t m_color = NULL;
+};
+
+TEST_F(capture_ut, no_decoder_returns_color_image)
+{
+    capture_color_decoder_t decoder;
+    ASSERT_FALSE(capture_get_color_decoder(m_capture, &decoder));
+
+    zsa_image_t image = capture_get_color_decoded_image(m_capture);
+    ASSERT_EQ(m_color, image);
+    image_dec_ref(image);
+}
+
+TEST_F(capture_ut, decodes_once_on_first_call)
+{
+    capture_color_decoder_t decoder = {};
+    decoder.decode_cb = fake_decode;
+    decoder.scale = ZSA_COLOR_SCALE_HALF;
+    capture_set_color_decoder(m_capture, &decoder);
+
+    // The color image stays the source
+    zsa_image_t color = capture_get_color_image(m_capture);
+    ASSERT_EQ(m_color, color);
+    image_dec_ref(color);
+    ASSERT_EQ(0, g_decode_calls);
+
+    zsa_image_t first = capture_get_color_decoded_image(m_capture);
+    ASSERT_NE(nullptr, first);
+    ASSERT_EQ(ZSA_IMAGE_FORMAT_COLOR_BGRA32, image_get_format(first));
+    ASSERT_EQ(32, image_get_width_pixels(first));
+    ASSERT_EQ(16, image_get_height_pixels(first));
+    ASSERT_EQ(0x5a, image_get_buffer(first)[0]);
+
+    zsa_image_t second = capture_get_color_decoded_image(m_capture);
+    ASSERT_EQ(first, second);
+    ASSERT_EQ(1, g_decode_calls);
+
+    image_dec_ref(first);
+    image_dec_ref(second);
+}
+
+TEST_F(capture_ut, concurrent_callers_share_one_decode)
+{
+    capture_color_decoder_t decoder = {};
+    decoder.decode_cb = fake_decode;
+    capture_set_color_decoder(m_capture, &decoder);
+
+    std::vector<zsa_image_t> images(8, nullptr);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        threads.emplace_back([this, &images, i]() { images[i] = capture_get_color_decoded_image(m_capture); });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    ASSERT_EQ(1, g_decode_calls);
+    for (zsa_image_t image : images)
+    {
+        ASSERT_NE(nullptr, image);
+        ASSERT_EQ(images[0], image);
+        image_dec_ref(image);
+    }
+}
+
+TEST_F(capture_ut, decode_failure_returns_null)
+{
+    capture_color_decoder_t decoder = {};
+    decoder.decode_cb = failing_decode;
+    capture_set_color_decoder(m_capture, &decoder);
+
+    ASSERT_EQ(nullptr, capture_get_color_decoded_image(m_capture));
+
+    // Nothing is cached, so the next call tries again
+    ASSERT_EQ(nullptr, capture_get_color_decoded_image(m_capture));
+    ASSERT_EQ(2, g_decode_calls);
+}
+
+TEST_F(capture_ut, replacing_color_image_drops_decoded_image)
+{
+    capture_color_decoder_t decoder = {};
+    decoder.decode_cb = fake_decode;
+    capture_set_color_decoder(m_capture, &decoder);
+
+    zsa_image_t first = capture_get_color_decoded_image(m_capture);
+    ASSERT_NE(nullptr, first);
+
+    zsa_image_t other = NULL;
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, image_create(ZSA_IMAGE_FORMAT_CUSTOM8, 64, 32, 64, ALLOCATION_SOURCE_USER, &other));
+    memset(image_get_buffer(other), 0x11, image_get_size(other));
+    capture_set_color_image(m_capture, other);
+    image_dec_ref(other);
+
+    zsa_image_t second = capture_get_color_decoded_image(m_capture);
+    ASSERT_NE(nullptr, second);
+    ASSERT_NE(first, second);
+    ASSERT_EQ(0x11, image_get_buffer(second)[0]);
+    ASSERT_EQ(2, g_decode_calls);
+
+    image_dec_ref(first);
+    image_dec_ref(second);
+}
+
+int main(int argc, char **argv)
+{
+    return zsa_test_common_main(argc, argv);
+}
@@ -0,0 +1,149 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <zsainternal/capturesync.h>
+#include <zsainternal/capture.h>
+#include <zsainternal/image.h>
+#include <zsainternal/queue.h>
+#include <gtest/gtest.h>
+#include <utcommon.h>
+
+class capturesync_ut : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        ASSERT_EQ(ZSA_RESULT_SUCCEEDED, capturesync_create(&m_sync));
+
+        // Depth only, captures are published as they arrive
+        zsa_device_configuration_t config = ZSA_DEVICE_CONFIG_INIT_DISABLE_ALL;
+        config.depth_mode = ZSA_DEPTH_MODE_NFOV_UNBINNED;
+        config.camera_fps = ZSA_FRAMES_PER_SECOND_30;
+        ASSERT_EQ(ZSA_RESULT_SUCCEEDED, capturesync_start(m_sync, &config));
+    }
+
+    void TearDown() override
+    {
+        capturesync_stop(m_sync);
+        capturesync_destroy(m_sync);
+    }
+
+    // Adds a depth capture with an IR image of the timestamp, returns it for comparison without holding a reference
+    zsa_capture_t add_depth_capture(uint64_t timestamp_usec)
+    {
+        zsa_capture_t capture = NULL;
+        zsa_image_t image = NULL;
+        EXPECT_EQ(ZSA_RESULT_SUCCEEDED, capture_create(&capture));
+        EXPECT_EQ(ZSA_RESULT_SUCCEEDED, image_create(ZSA_IMAGE_FORMAT_IR16, 4, 4, 8, ALLOCATION_SOURCE_USER, &image));
+        image_set_device_timestamp_usec(image, timestamp_usec);
+        capture_set_ir_image(capture, image);
+        image_dec_ref(image);
+
+        capturesync_add_capture(m_sync, ZSA_RESULT_SUCCEEDED, capture, false);
+        capture_dec_ref(capture);
+        return capture;
+    }
+
+    uint64_t pop_timestamp()
+    {
+        zsa_capture_t capture = NULL;
+        if (capturesync_get_capture(m_sync, &capture, 0) != ZSA_WAIT_RESULT_SUCCEEDED)
+        {
+            return 0;
+        }
+        zsa_image_t image = capture_get_ir_image(capture);
+        uint64_t timestamp_usec = image_get_device_timestamp_usec(image);
+        image_dec_ref(image);
+        capture_dec_ref(capture);
+        return timestamp_usec;
+    }
+
+    capturesync_t m_sync = NULL;
+};
+
+TEST_F(capturesync_ut, drop_oldest_by_default)
+{
+    // A full queue keeps dropping the oldest capture, and stopping does not wait on the consumer
+    const uint32_t depth = QUEUE_DEFAULT_SIZE / 2;
+    for (uint64_t i = 1; i <= depth + 2; i++)
+    {
+        add_depth_capture(i * 1000);
+    }
+
+    queue_stats_t stats;
+    capturesync_get_queue_stats(m_sync, &stats);
+    ASSERT_EQ(depth, stats.count);
+    ASSERT_EQ(2u, stats.dropped_oldest);
+    ASSERT_EQ(3000u, pop_timestamp());
+}
+
+TEST_F(capturesync_ut, keep_latest)
+{
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, capturesync_set_overflow_policy(m_sync, QUEUE_OVERFLOW_KEEP_LATEST, 0));
+
+    add_depth_capture(1000);
+    add_depth_capture(2000);
+    add_depth_capture(3000);
+
+    queue_stats_t stats;
+    capturesync_get_queue_stats(m_sync, &stats);
+    ASSERT_EQ(1u, stats.count);
+    ASSERT_EQ(3u, stats.pushed);
+    ASSERT_EQ(2u, stats.dropped_oldest);
+
+    ASSERT_EQ(3000u, pop_timestamp());
+    ASSERT_EQ(0u, pop_timestamp());
+}
+
+TEST_F(capturesync_ut, subscribers_share_captures)
+{
+    queue_t first = NULL;
+    queue_t second = NULL;
+    ASSERT_EQ(ZSA_RESULT_FAILED, capturesync_subscribe(m_sync, 2, QUEUE_OVERFLOW_BOUNDED_BYTES, 0, &first));
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, capturesync_subscribe(m_sync, 4, QUEUE_OVERFLOW_DROP_OLDEST, 0, &first));
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, capturesync_subscribe(m_sync, 1, QUEUE_OVERFLOW_DROP_NEWEST, 0, &second));
+
+    zsa_capture_t c[2];
+    c[0] = add_depth_capture(1000);
+    c[1] = add_depth_capture(2000);
+
+    // Every reader gets a reference to the same capture
+    zsa_capture_t captures[4] = {};
+    uint32_t count = 0;
+    ASSERT_EQ(ZSA_WAIT_RESULT_SUCCEEDED, queue_pop_batch(first, captures, 4, &count));
+    ASSERT_EQ(2u, count);
+    ASSERT_EQ(c[0], captures[0]);
+    ASSERT_EQ(c[1], captures[1]);
+    capture_dec_ref(captures[0]);
+    capture_dec_ref(captures[1]);
+
+    // The full subscriber drops its own capture only
+    ASSERT_EQ(ZSA_WAIT_RESULT_SUCCEEDED, queue_pop_batch(second, captures, 4, &count));
+    ASSERT_EQ(1u, count);
+    ASSERT_EQ(c[0], captures[0]);
+    capture_dec_ref(captures[0]);
+    queue_stats_t stats;
+    queue_get_stats(second, &stats);
+    ASSERT_EQ(1u, stats.dropped_newest);
+
+    ASSERT_EQ(1000u, pop_timestamp());
+    ASSERT_EQ(2000u, pop_timestamp());
+
+    // Once removed, a subscriber no longer receives captures
+    capturesync_unsubscribe(m_sync, second);
+    add_depth_capture(3000);
+    ASSERT_EQ(ZSA_WAIT_RESULT_SUCCEEDED, queue_pop_batch(first, captures, 4, &count));
+    ASSERT_EQ(1u, count);
+    capture_dec_ref(captures[0]);
+    ASSERT_EQ(3000u, pop_timestamp());
+
+    // Stopping fails the reads of the remaining subscriber
+    capturesync_stop(m_sync);
+    ASSERT_EQ(ZSA_WAIT_RESULT_FAILED, queue_pop_batch(first, captures, 4, &count));
+    capturesync_unsubscribe(m_sync, first);
+}
+
+int main(int argc, char **argv)
+{
+    return zsa_test_common_main(argc, argv);
+}
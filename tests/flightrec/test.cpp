@@ -0,0 +1,446 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <zsainternal/flightrec.h>
+#include <zsainternal/capture.h>
+#include <zsainternal/capturesync.h>
+#include <zsainternal/image.h>
+#include <gtest/gtest.h>
+#include <utcommon.h>
+
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
+// Depth image of 4x3 pixels, and an IR image of 5x3 bytes that is padded in the file
+static const size_t g_depth_size = 4 * 3 * 2;
+static const size_t g_ir_size = 5 * 3;
+static const size_t g_record_size = sizeof(flightrec_capture_header_t) + 2 * sizeof(flightrec_image_header_t) +
+                                    g_depth_size + 16;
+
+// A flight recorder file read back
+struct dump_t
+{
+    flightrec_file_header_t header;
+    std::vector<std::vector<uint8_t>> records;
+};
+
+static bool read_dump(const char *path, dump_t *dump)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        return false;
+    }
+
+    std::vector<uint8_t> bytes;
+    uint8_t buffer[4096];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        bytes.insert(bytes.end(), buffer, buffer + read);
+    }
+    fclose(file);
+
+    if (bytes.size() < sizeof(flightrec_file_header_t))
+    {
+        return false;
+    }
+    memcpy(&dump->header, bytes.data(), sizeof(flightrec_file_header_t));
+
+    dump->records.clear();
+    size_t offset = dump->header.header_size;
+    for (uint32_t i = 0; i < dump->header.capture_count; i++)
+    {
+        flightrec_capture_header_t capture_header;
+        if (offset + sizeof(capture_header) > bytes.size())
+        {
+            return false;
+        }
+        memcpy(&capture_header, &bytes[offset], sizeof(capture_header));
+        if (capture_header.size_bytes < sizeof(capture_header) || offset + capture_header.size_bytes > bytes.size())
+        {
+            return false;
+        }
+        dump->records.emplace_back(bytes.begin() + (ptrdiff_t)offset,
+                                   bytes.begin() + (ptrdiff_t)(offset + capture_header.size_bytes));
+        offset += capture_header.size_bytes;
+    }
+    return offset == bytes.size();
+}
+
+static flightrec_capture_header_t capture_header(const std::vector<uint8_t> &record)
+{
+    flightrec_capture_header_t header;
+    memcpy(&header, record.data(), sizeof(header));
+    return header;
+}
+
+static flightrec_image_header_t image_header(const std::vector<uint8_t> &record, uint32_t index)
+{
+    flightrec_image_header_t header;
+    memcpy(&header,
+           &record[sizeof(flightrec_capture_header_t) + index * sizeof(flightrec_image_header_t)],
+           sizeof(header));
+    return header;
+}
+
+class flightrec_ut : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        ASSERT_EQ(ZSA_RESULT_SUCCEEDED, capturesync_create(&m_sync));
+
+        // Depth only, captures are published as they arrive
+        zsa_device_configuration_t config = ZSA_DEVICE_CONFIG_INIT_DISABLE_ALL;
+        config.depth_mode = ZSA_DEPTH_MODE_NFOV_UNBINNED;
+        config.camera_fps = ZSA_FRAMES_PER_SECOND_30;
+        ASSERT_EQ(ZSA_RESULT_SUCCEEDED, capturesync_start(m_sync, &config));
+        ASSERT_EQ(ZSA_RESULT_SUCCEEDED, capturesync_set_overflow_policy(m_sync, QUEUE_OVERFLOW_KEEP_LATEST, 0));
+
+        m_path = "flightrec_ut_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    }
+
+    void TearDown() override
+    {
+        for (flightrec_t recorder : m_recorders)
+        {
+            flightrec_destroy(recorder);
+        }
+        capturesync_stop(m_sync);
+        capturesync_destroy(m_sync);
+        (void)remove(m_path.c_str());
+    }
+
+    flightrec_t start_recorder(uint32_t duration_ms, size_t memory_bytes, int dump_signal, const char *dump_path)
+    {
+        zsa_flight_recorder_configuration_t config = { duration_ms, memory_bytes, dump_signal, dump_path };
+        flightrec_t recorder = NULL;
+        EXPECT_EQ(ZSA_RESULT_SUCCEEDED, flightrec_create(m_sync, &config, &recorder));
+        if (recorder)
+        {
+            m_recorders.push_back(recorder);
+        }
+        return recorder;
+    }
+
+    // Adds a capture with a depth and an IR image, each filled with the low byte of the sequence
+    void add_capture(uint64_t sequence, int depth_width = 4)
+    {
+        zsa_capture_t capture = NULL;
+        zsa_image_t image = NULL;
+        ASSERT_EQ(ZSA_RESULT_SUCCEEDED, capture_create(&capture));
+        capture_set_temperature_c(capture, 20.0f + sequence);
+
+        ASSERT_EQ(ZSA_RESULT_SUCCEEDED,
+                  image_create(ZSA_IMAGE_FORMAT_DEPTH16,
+                               depth_width,
+                               3,
+                               depth_width * 2,
+                               ALLOCATION_SOURCE_USER,
+                               &image));
+        memset(image_get_buffer(image), (int)(sequence & 0xff), image_get_size(image));
+        image_set_device_timestamp_usec(image, (sequence + 1) * 1000);
+        capture_set_depth_image(capture, image);
+        image_dec_ref(image);
+
+        ASSERT_EQ(ZSA_RESULT_SUCCEEDED,
+                  image_create(ZSA_IMAGE_FORMAT_CUSTOM8, 5, 3, 5, ALLOCATION_SOURCE_USER, &image));
+        memset(image_get_buffer(image), (int)(sequence & 0xff), image_get_size(image));
+        image_set_device_timestamp_usec(image, (sequence + 1) * 1000);
+        capture_set_ir_image(capture, image);
+        image_dec_ref(image);
+
+        capturesync_add_capture(m_sync, ZSA_RESULT_SUCCEEDED, capture, false);
+        capture_dec_ref(capture);
+    }
+
+    // Dumps until the newest capture recorded has a sequence, the recorder copies captures on a thread of its own
+    void dump_until(flightrec_t recorder, uint64_t sequence, dump_t *dump)
+    {
+        for (int i = 0; i < 200; i++)
+        {
+            ASSERT_EQ(ZSA_RESULT_SUCCEEDED, flightrec_dump(recorder, m_path.c_str()));
+            ASSERT_TRUE(read_dump(m_path.c_str(), dump));
+            if (!dump->records.empty() && capture_header(dump->records.back()).sequence == sequence)
+            {
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        FAIL() << "Capture " << sequence << " was not recorded";
+    }
+
+    capturesync_t m_sync = NULL;
+    std::vector<flightrec_t> m_recorders;
+    std::string m_path;
+};
+
+TEST_F(flightrec_ut, dump_format)
+{
+    flightrec_t recorder = start_recorder(10000, 1024 * 1024, 0, NULL);
+    ASSERT_NE(nullptr, recorder);
+
+    for (uint64_t sequence = 0; sequence < 3; sequence++)
+    {
+        add_capture(sequence);
+    }
+    dump_t dump;
+    dump_until(recorder, 2, &dump);
+
+    const flightrec_file_header_t &header = dump.header;
+    ASSERT_STREQ(FLIGHTREC_FILE_MAGIC, header.magic);
+    ASSERT_EQ((uint32_t)FLIGHTREC_FILE_VERSION, header.version);
+    ASSERT_EQ(sizeof(flightrec_file_header_t), header.header_size);
+    ASSERT_EQ(sizeof(flightrec_capture_header_t), header.capture_header_size);
+    ASSERT_EQ(sizeof(flightrec_image_header_t), header.image_header_size);
+    ASSERT_EQ(3u, header.capture_count);
+    ASSERT_EQ(0u, header.lost_count);
+    ASSERT_EQ(10000u, header.duration_ms);
+    ASSERT_EQ(capture_header(dump.records.front()).recorded_nsec, header.first_recorded_nsec);
+    ASSERT_EQ(capture_header(dump.records.back()).recorded_nsec, header.last_recorded_nsec);
+    ASSERT_LE(header.first_recorded_nsec, header.last_recorded_nsec);
+
+    for (uint32_t i = 0; i < header.capture_count; i++)
+    {
+        const std::vector<uint8_t> &record = dump.records[i];
+        flightrec_capture_header_t capture = capture_header(record);
+        ASSERT_EQ((uint32_t)FLIGHTREC_CAPTURE_MAGIC, capture.magic);
+        ASSERT_EQ(g_record_size, capture.size_bytes);
+        ASSERT_EQ(i, capture.sequence);
+        ASSERT_EQ(20.0f + i, capture.temperature_c);
+        ASSERT_EQ(2u, capture.image_count);
+
+        // Images in the order of flightrec_image_type_t, their bytes after the headers
+        flightrec_image_header_t depth = image_header(record, 0);
+        flightrec_image_header_t ir = image_header(record, 1);
+        ASSERT_EQ((uint32_t)FLIGHTREC_IMAGE_DEPTH, depth.type);
+        ASSERT_EQ(ZSA_IMAGE_FORMAT_DEPTH16, depth.format);
+        ASSERT_EQ(4, depth.width_pixels);
+        ASSERT_EQ(3, depth.height_pixels);
+        ASSERT_EQ(8, depth.stride_bytes);
+        ASSERT_EQ(g_depth_size, depth.size_bytes);
+        ASSERT_EQ((i + 1) * 1000u, depth.device_timestamp_usec);
+        ASSERT_EQ((uint32_t)FLIGHTREC_IMAGE_IR, ir.type);
+        ASSERT_EQ(ZSA_IMAGE_FORMAT_CUSTOM8, ir.format);
+        ASSERT_EQ(g_ir_size, ir.size_bytes);
+
+        size_t data = sizeof(flightrec_capture_header_t) + 2 * sizeof(flightrec_image_header_t);
+        for (size_t j = 0; j < g_depth_size; j++)
+        {
+            ASSERT_EQ(i, record[data + j]);
+        }
+        data += g_depth_size;
+        for (size_t j = 0; j < g_ir_size; j++)
+        {
+            ASSERT_EQ(i, record[data + j]);
+        }
+        ASSERT_EQ(0, record[data + g_ir_size]);
+    }
+}
+
+TEST_F(flightrec_ut, evicts_oldest_when_ring_is_full)
+{
+    // Two records and a half fit, the third wraps to the start of the ring
+    flightrec_t recorder = start_recorder(10000, g_record_size * 5 / 2, 0, NULL);
+    ASSERT_NE(nullptr, recorder);
+
+    for (uint64_t sequence = 0; sequence < 6; sequence++)
+    {
+        add_capture(sequence);
+    }
+    dump_t dump;
+    dump_until(recorder, 5, &dump);
+
+    ASSERT_EQ(2u, dump.header.capture_count);
+    ASSERT_EQ(4u, capture_header(dump.records[0]).sequence);
+    ASSERT_EQ(5u, capture_header(dump.records[1]).sequence);
+
+    const size_t data = sizeof(flightrec_capture_header_t) + 2 * sizeof(flightrec_image_header_t);
+    ASSERT_EQ(4, dump.records[0][data]);
+    ASSERT_EQ(5, dump.records[1][data]);
+}
+
+TEST_F(flightrec_ut, drops_capture_larger_than_ring)
+{
+    flightrec_t recorder = start_recorder(10000, g_record_size * 5 / 2, 0, NULL);
+    ASSERT_NE(nullptr, recorder);
+
+    // The capture larger than the ring is dropped without evicting the records before it, nor taking a sequence
+    add_capture(0);
+    add_capture(1);
+    add_capture(2, 1024);
+    add_capture(3);
+    dump_t dump;
+    dump_until(recorder, 2, &dump);
+
+    ASSERT_EQ(2u, dump.header.capture_count);
+    ASSERT_EQ(1u, capture_header(dump.records[0]).sequence);
+    ASSERT_EQ(2u, capture_header(dump.records[1]).sequence);
+
+    const size_t data = sizeof(flightrec_capture_header_t) + 2 * sizeof(flightrec_image_header_t);
+    ASSERT_EQ(1, dump.records[0][data]);
+    ASSERT_EQ(3, dump.records[1][data]);
+}
+
+TEST_F(flightrec_ut, evicts_captures_older_than_window)
+{
+    flightrec_t recorder = start_recorder(200, 1024 * 1024, 0, NULL);
+    ASSERT_NE(nullptr, recorder);
+
+    add_capture(0);
+    dump_t dump;
+    dump_until(recorder, 0, &dump);
+    ASSERT_EQ(1u, dump.header.capture_count);
+    ASSERT_EQ(200u, dump.header.duration_ms);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    add_capture(1);
+    dump_until(recorder, 1, &dump);
+    ASSERT_EQ(1u, dump.header.capture_count);
+}
+
+TEST_F(flightrec_ut, empty_dump)
+{
+    flightrec_t recorder = start_recorder(10000, 1024 * 1024, 0, NULL);
+    ASSERT_NE(nullptr, recorder);
+
+    dump_t dump;
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, flightrec_dump(recorder, m_path.c_str()));
+    ASSERT_TRUE(read_dump(m_path.c_str(), &dump));
+    ASSERT_EQ(0u, dump.header.capture_count);
+    ASSERT_TRUE(dump.records.empty());
+}
+
+TEST_F(flightrec_ut, invalid_configuration)
+{
+    flightrec_t recorder = NULL;
+    zsa_flight_recorder_configuration_t config = { 0, 1024 * 1024, 0, NULL };
+    ASSERT_EQ(ZSA_RESULT_FAILED, flightrec_create(m_sync, &config, &recorder));
+
+    config.duration_ms = 1000;
+    config.memory_bytes = sizeof(flightrec_capture_header_t) - 1;
+    ASSERT_EQ(ZSA_RESULT_FAILED, flightrec_create(m_sync, &config, &recorder));
+
+    config.memory_bytes = 1024 * 1024;
+    config.dump_signal = SIGINT;
+    ASSERT_EQ(ZSA_RESULT_FAILED, flightrec_create(m_sync, &config, &recorder));
+
+    config.dump_signal = NSIG;
+    config.dump_path = m_path.c_str();
+    ASSERT_EQ(ZSA_RESULT_FAILED, flightrec_create(m_sync, &config, &recorder));
+    ASSERT_EQ(nullptr, recorder);
+}
+
+#ifndef _WIN32
+// Dump files written on a signal under a path prefix
+static std::vector<std::string> dump_files(const std::string &prefix)
+{
+    std::vector<std::string> files;
+    DIR *directory = opendir(".");
+    if (directory == NULL)
+    {
+        return files;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(directory)) != NULL)
+    {
+        if (strncmp(entry->d_name, prefix.c_str(), prefix.size()) == 0 && entry->d_name[prefix.size()] == '-')
+        {
+            files.push_back(entry->d_name);
+        }
+    }
+    closedir(directory);
+    return files;
+}
+
+static std::vector<std::string> wait_for_dump_files(const std::string &prefix)
+{
+    std::vector<std::string> files;
+    for (int i = 0; i < 100 && files.empty(); i++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        files = dump_files(prefix);
+    }
+    return files;
+}
+
+TEST_F(flightrec_ut, dump_signal_dumps_its_recorder_only)
+{
+    std::string first_path = m_path + "_first";
+    std::string second_path = m_path + "_second";
+    flightrec_t first = start_recorder(10000, 1024 * 1024, SIGUSR1, first_path.c_str());
+    flightrec_t second = start_recorder(10000, 1024 * 1024, SIGUSR2, second_path.c_str());
+    ASSERT_NE(nullptr, first);
+    ASSERT_NE(nullptr, second);
+
+    add_capture(0);
+    dump_t dump;
+    dump_until(first, 0, &dump);
+    dump_until(second, 0, &dump);
+
+    ASSERT_EQ(0, raise(SIGUSR1));
+    std::vector<std::string> first_files = wait_for_dump_files(first_path);
+    ASSERT_EQ(1u, first_files.size());
+    ASSERT_TRUE(read_dump(first_files[0].c_str(), &dump));
+    ASSERT_EQ(1u, dump.header.capture_count);
+
+    // The other recorder checks for its signal as often, and has nothing to write
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    ASSERT_TRUE(dump_files(second_path).empty());
+
+    ASSERT_EQ(0, raise(SIGUSR2));
+    std::vector<std::string> second_files = wait_for_dump_files(second_path);
+    ASSERT_EQ(1u, second_files.size());
+    ASSERT_EQ(1u, dump_files(first_path).size());
+
+    (void)remove(first_files[0].c_str());
+    (void)remove(second_files[0].c_str());
+}
+
+TEST_F(flightrec_ut, dump_signal_handled_by_one_recorder)
+{
+    struct sigaction ignore;
+    memset(&ignore, 0, sizeof(ignore));
+    ignore.sa_handler = SIG_IGN;
+    ASSERT_EQ(0, sigaction(SIGUSR1, &ignore, NULL));
+
+    std::string path = m_path + "_dump";
+    flightrec_t recorder = start_recorder(10000, 1024 * 1024, SIGUSR1, path.c_str());
+    ASSERT_NE(nullptr, recorder);
+
+    zsa_flight_recorder_configuration_t config = { 10000, 1024 * 1024, SIGUSR1, path.c_str() };
+    flightrec_t other = NULL;
+    ASSERT_EQ(ZSA_RESULT_FAILED, flightrec_create(m_sync, &config, &other));
+
+    // The recorder still handles the signal, and puts back the handler it replaced when it stops
+    struct sigaction current;
+    ASSERT_EQ(0, sigaction(SIGUSR1, NULL, &current));
+    ASSERT_NE(SIG_IGN, current.sa_handler);
+
+    flightrec_destroy(recorder);
+    m_recorders.clear();
+    ASSERT_EQ(0, sigaction(SIGUSR1, NULL, &current));
+    ASSERT_EQ(SIG_IGN, current.sa_handler);
+
+    struct sigaction restore;
+    memset(&restore, 0, sizeof(restore));
+    restore.sa_handler = SIG_DFL;
+    ASSERT_EQ(0, sigaction(SIGUSR1, &restore, NULL));
+}
+#endif
+
+int main(int argc, char **argv)
+{
+    return zsa_test_common_main(argc, argv);
+}
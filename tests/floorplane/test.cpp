@@ -0,0 +1,210 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <zsainternal/floorplane.h>
+#include <zsainternal/image.h>
+#include <gtest/gtest.h>
+#include <utcommon.h>
+
+#include <cmath>
+#include <vector>
+
+static const int g_width = 160;
+static const int g_height = 120;
+static const float g_focal = 120.0f;
+
+// Camera 1m above the floor, y down, pitched 20 degrees towards the floor
+static const float g_camera_height_mm = 1000;
+static const float g_pitch = 20 * 3.14159265f / 180;
+
+// Box obstacle 300mm tall, in floor coordinates: x to the right, z forward along the floor
+static const float g_box_height_mm = 300;
+static const float g_box_min_x = -200, g_box_max_x = 200;
+static const float g_box_min_z = 1500, g_box_max_z = 1800;
+
+static const float g_cell_size_mm = 50;
+static const int g_grid_width = 80;
+static const int g_grid_depth = 80;
+
+// Deterministic generator so that the test does not depend on rand()
+static uint32_t next_random(uint32_t *state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+static float random_range(uint32_t *state, float low, float high)
+{
+    return low + (high - low) * (float)next_random(state) / (float)(1u << 24);
+}
+
+// Point at height above the floor and forward distance z along it, in camera coordinates
+static void floor_to_camera(float x, float height, float z, float *p)
+{
+    const float world_y = g_camera_height_mm - height;
+    p[0] = x;
+    p[1] = world_y * std::cos(g_pitch) - z * std::sin(g_pitch);
+    p[2] = world_y * std::sin(g_pitch) + z * std::cos(g_pitch);
+}
+
+// Tilted floor with a box on it. Pixels looking above the horizon, and one in ten of the others, hold clutter more
+// than 2m above the floor that the floor search has to reject.
+static std::vector<float> make_scene()
+{
+    std::vector<float> xyz((size_t)g_width * g_height * 3, 0.0f);
+    uint32_t state = 1;
+
+    for (int v = 0; v < g_height; v++)
+    {
+        for (int u = 0; u < g_width; u++)
+        {
+            float *p = &xyz[((size_t)v * g_width + u) * 3];
+            const float rx = (u - g_width / 2) / g_focal;
+            const float ry = (v - g_height / 2) / g_focal;
+
+            // Direction of the pixel ray in floor coordinates, y down
+            const float down = ry * std::cos(g_pitch) + std::sin(g_pitch);
+            const float forward = -ry * std::sin(g_pitch) + std::cos(g_pitch);
+
+            if (down <= 0.05f || next_random(&state) % 10 == 0)
+            {
+                floor_to_camera(random_range(&state, -3000, 3000),
+                                random_range(&state, 2100, 3000),
+                                random_range(&state, 1000, 5000),
+                                p);
+                continue;
+            }
+
+            float t = g_camera_height_mm / down;
+            const float top = (g_camera_height_mm - g_box_height_mm) / down;
+            if (rx * top > g_box_min_x && rx * top < g_box_max_x && forward * top > g_box_min_z &&
+                forward * top < g_box_max_z)
+            {
+                t = top;
+            }
+
+            p[0] = rx * t;
+            p[1] = ry * t;
+            p[2] = t + random_range(&state, -3, 3);
+        }
+    }
+    return xyz;
+}
+
+class floorplane_ut : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        ASSERT_EQ(ZSA_RESULT_SUCCEEDED, floorplane_create(2, &m_floorplane));
+
+        m_config.up_hint.xyz.x = 0;
+        m_config.up_hint.xyz.y = -1;
+        m_config.up_hint.xyz.z = 0;
+        m_config.max_tilt_degrees = 45;
+        m_config.inlier_threshold_mm = 20;
+        m_config.ransac_iterations = 100;
+        m_config.sample_stride = 4;
+        m_config.min_inlier_ratio = 0.3f;
+        m_config.cell_size_mm = g_cell_size_mm;
+        m_config.grid_width_cells = g_grid_width;
+        m_config.grid_depth_cells = g_grid_depth;
+        m_config.max_height_mm = 2000;
+    }
+
+    void TearDown() override
+    {
+        floorplane_destroy(m_floorplane);
+    }
+
+    floorplane_t m_floorplane = NULL;
+    floorplane_config_t m_config = {};
+};
+
+static float map_cell(zsa_image_t map, float x, float z)
+{
+    const int column = (int)std::floor(x / g_cell_size_mm) + g_grid_width / 2;
+    const int row = (int)std::floor(z / g_cell_size_mm);
+    return ((const float *)image_get_buffer(map))[row * g_grid_width + column];
+}
+
+TEST_F(floorplane_ut, tilted_floor_with_outliers)
+{
+    std::vector<float> xyz = make_scene();
+    pointcloud_input_t input;
+    input.data = (const uint8_t *)xyz.data();
+    input.point_type = POINTCLOUD_POINT_FLOAT32_MM;
+    input.width_pixels = g_width;
+    input.height_pixels = g_height;
+    input.stride_bytes = g_width * 3 * (int)sizeof(float);
+
+    floorplane_result_t plane;
+    zsa_image_t map = NULL;
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, floorplane_process(m_floorplane, &input, &m_config, &plane, &map));
+    ASSERT_TRUE(plane.valid);
+    ASSERT_FALSE(plane.seeded);
+    ASSERT_NE(nullptr, map);
+
+    // Up is -y of the floor, seen from the pitched camera
+    ASSERT_NEAR(0, plane.normal.xyz.x, 0.01);
+    ASSERT_NEAR(-std::cos(g_pitch), plane.normal.xyz.y, 0.01);
+    ASSERT_NEAR(-std::sin(g_pitch), plane.normal.xyz.z, 0.01);
+    ASSERT_NEAR(g_camera_height_mm, plane.offset_mm, 10);
+    ASSERT_GT(plane.inlier_ratio, 0.5f);
+
+    ASSERT_EQ(g_grid_width, image_get_width_pixels(map));
+    ASSERT_EQ(g_grid_depth, image_get_height_pixels(map));
+
+    // Floor in front of the box, the top of the box, and cells the camera does not see
+    ASSERT_NEAR(0, map_cell(map, 0, 1200), 15);
+    ASSERT_NEAR(0, map_cell(map, -500, 2500), 15);
+    ASSERT_NEAR(g_box_height_mm, map_cell(map, 0, 1650), 15);
+    ASSERT_NEAR(g_box_height_mm, map_cell(map, 150, 1550), 15);
+    ASSERT_TRUE(std::isnan(map_cell(map, 0, 100)));
+    ASSERT_TRUE(std::isnan(map_cell(map, -1950, 500)));
+    image_dec_ref(map);
+
+    // The next frame of the same scene refines the floor instead of searching again
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, floorplane_process(m_floorplane, &input, &m_config, &plane, NULL));
+    ASSERT_TRUE(plane.valid);
+    ASSERT_TRUE(plane.seeded);
+    ASSERT_NEAR(g_camera_height_mm, plane.offset_mm, 10);
+
+    floorplane_reset(m_floorplane);
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, floorplane_process(m_floorplane, &input, &m_config, &plane, NULL));
+    ASSERT_FALSE(plane.seeded);
+}
+
+TEST_F(floorplane_ut, no_floor)
+{
+    // A wall facing the camera is too steep to be the floor
+    std::vector<float> xyz((size_t)g_width * g_height * 3);
+    for (int v = 0; v < g_height; v++)
+    {
+        for (int u = 0; u < g_width; u++)
+        {
+            float *p = &xyz[((size_t)v * g_width + u) * 3];
+            p[0] = (u - g_width / 2) * 10.0f;
+            p[1] = (v - g_height / 2) * 10.0f;
+            p[2] = 2000;
+        }
+    }
+
+    pointcloud_input_t input;
+    input.data = (const uint8_t *)xyz.data();
+    input.point_type = POINTCLOUD_POINT_FLOAT32_MM;
+    input.width_pixels = g_width;
+    input.height_pixels = g_height;
+    input.stride_bytes = g_width * 3 * (int)sizeof(float);
+
+    floorplane_result_t plane;
+    zsa_image_t map = NULL;
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, floorplane_process(m_floorplane, &input, &m_config, &plane, &map));
+    ASSERT_FALSE(plane.valid);
+    ASSERT_EQ(nullptr, map);
+}
+
+int main(int argc, char **argv)
+{
+    return zsa_test_common_main(argc, argv);
+}
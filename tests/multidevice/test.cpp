@@ -0,0 +1,184 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <zsainternal/multidevice.h>
+#include <zsainternal/allocator.h>
+#include <zsainternal/capture.h>
+#include <zsainternal/image.h>
+#include <gtest/gtest.h>
+#include <utcommon.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+// 30 FPS chain of a master and two subordinates, staggered so their lasers do not interfere
+#define FRAME_PERIOD_USEC (33333)
+#define DEVICE_COUNT (3)
+static const uint32_t g_delay_usec[DEVICE_COUNT] = { 0, 160, 320 };
+
+static multidevice_config_t make_config(bool synchronized_sets_only)
+{
+    multidevice_config_t config = {};
+    config.device_count = DEVICE_COUNT;
+    config.master_index = 0;
+    for (uint32_t i = 0; i < DEVICE_COUNT; i++)
+    {
+        config.subordinate_delay_off_master_usec[i] = g_delay_usec[i];
+    }
+    config.frame_period_usec = FRAME_PERIOD_USEC;
+    config.synchronized_sets_only = synchronized_sets_only;
+    config.queue_depth = 4;
+    return config;
+}
+
+static uint64_t device_timestamp(zsa_capture_t capture)
+{
+    zsa_image_t image = capture_get_color_image(capture);
+    uint64_t ts = image_get_device_timestamp_usec(image);
+    image_dec_ref(image);
+    return ts;
+}
+
+// Deliver the capture of one device for one pulse, with a little USB jitter on top of the device's delay
+static void add_capture(multidevice_t multidevice, uint32_t device, int pulse, int jitter_usec = 0)
+{
+    zsa_capture_t capture = NULL;
+    zsa_image_t image = NULL;
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, capture_create(&capture));
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, image_create(ZSA_IMAGE_FORMAT_CUSTOM8, 4, 4, 4, ALLOCATION_SOURCE_USER, &image));
+    image_set_device_timestamp_usec(image, (uint64_t)(1000000 + pulse * FRAME_PERIOD_USEC + g_delay_usec[device] +
+                                                      jitter_usec));
+    capture_set_color_image(capture, image);
+    image_dec_ref(image);
+
+    multidevice_add_capture(multidevice, device, ZSA_RESULT_SUCCEEDED, capture);
+    capture_dec_ref(capture);
+}
+
+static void release_set(zsa_capture_t *captures)
+{
+    for (int i = 0; i < DEVICE_COUNT; i++)
+    {
+        if (captures[i])
+        {
+            capture_dec_ref(captures[i]);
+        }
+    }
+}
+
+TEST(multidevice_ut, groups_captures_of_one_pulse)
+{
+    multidevice_config_t config = make_config(true);
+    multidevice_t multidevice = NULL;
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, multidevice_create(&config, &multidevice));
+
+    // Devices deliver out of order relative to each other
+    for (int pulse = 0; pulse < 3; pulse++)
+    {
+        add_capture(multidevice, 2, pulse, 40);
+        add_capture(multidevice, 0, pulse);
+        add_capture(multidevice, 1, pulse, -40);
+    }
+
+    zsa_capture_t captures[DEVICE_COUNT];
+    for (int pulse = 0; pulse < 3; pulse++)
+    {
+        ASSERT_EQ(ZSA_WAIT_RESULT_SUCCEEDED, multidevice_get_capture_set(multidevice, captures, 0));
+        uint64_t master_ts = device_timestamp(captures[0]);
+        EXPECT_EQ((uint64_t)(1000000 + pulse * FRAME_PERIOD_USEC), master_ts);
+        EXPECT_EQ(master_ts + g_delay_usec[1] - 40, device_timestamp(captures[1]));
+        EXPECT_EQ(master_ts + g_delay_usec[2] + 40, device_timestamp(captures[2]));
+        release_set(captures);
+    }
+    EXPECT_EQ(ZSA_WAIT_RESULT_TIMEOUT, multidevice_get_capture_set(multidevice, captures, 0));
+
+    multidevice_destroy(multidevice);
+}
+
+TEST(multidevice_ut, drops_pulse_a_subordinate_missed)
+{
+    multidevice_config_t config = make_config(true);
+    multidevice_t multidevice = NULL;
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, multidevice_create(&config, &multidevice));
+
+    // Subordinate 2 misses pulse 1, so only pulses 0 and 2 are complete
+    for (int pulse = 0; pulse < 3; pulse++)
+    {
+        add_capture(multidevice, 0, pulse);
+        add_capture(multidevice, 1, pulse);
+        if (pulse != 1)
+        {
+            add_capture(multidevice, 2, pulse);
+        }
+    }
+
+    zsa_capture_t captures[DEVICE_COUNT];
+    ASSERT_EQ(ZSA_WAIT_RESULT_SUCCEEDED, multidevice_get_capture_set(multidevice, captures, 0));
+    EXPECT_EQ(1000000u, device_timestamp(captures[0]));
+    release_set(captures);
+
+    ASSERT_EQ(ZSA_WAIT_RESULT_SUCCEEDED, multidevice_get_capture_set(multidevice, captures, 0));
+    EXPECT_EQ((uint64_t)(1000000 + 2 * FRAME_PERIOD_USEC), device_timestamp(captures[0]));
+    EXPECT_NE(nullptr, captures[2]);
+    release_set(captures);
+
+    EXPECT_EQ(ZSA_WAIT_RESULT_TIMEOUT, multidevice_get_capture_set(multidevice, captures, 0));
+    multidevice_destroy(multidevice);
+}
+
+TEST(multidevice_ut, releases_partial_set_when_subordinate_stalls)
+{
+    multidevice_config_t config = make_config(false);
+    multidevice_t multidevice = NULL;
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, multidevice_create(&config, &multidevice));
+
+    // Subordinate 2 stops delivering after pulse 0. Its absence is only certain two periods later.
+    add_capture(multidevice, 2, 0);
+    for (int pulse = 0; pulse < 4; pulse++)
+    {
+        add_capture(multidevice, 0, pulse);
+        add_capture(multidevice, 1, pulse);
+    }
+
+    zsa_capture_t captures[DEVICE_COUNT];
+    ASSERT_EQ(ZSA_WAIT_RESULT_SUCCEEDED, multidevice_get_capture_set(multidevice, captures, 0));
+    EXPECT_NE(nullptr, captures[2]);
+    release_set(captures);
+
+    ASSERT_EQ(ZSA_WAIT_RESULT_SUCCEEDED, multidevice_get_capture_set(multidevice, captures, 0));
+    EXPECT_EQ((uint64_t)(1000000 + FRAME_PERIOD_USEC), device_timestamp(captures[0]));
+    EXPECT_NE(nullptr, captures[1]);
+    EXPECT_EQ(nullptr, captures[2]);
+    release_set(captures);
+
+    // Pulse 2 still waits for subordinate 2
+    EXPECT_EQ(ZSA_WAIT_RESULT_TIMEOUT, multidevice_get_capture_set(multidevice, captures, 0));
+    multidevice_destroy(multidevice);
+}
+
+TEST(multidevice_ut, stop_releases_blocked_reader)
+{
+    multidevice_config_t config = make_config(true);
+    multidevice_t multidevice = NULL;
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, multidevice_create(&config, &multidevice));
+
+    std::atomic<int> wresult(-1);
+    std::thread reader([&]() {
+        zsa_capture_t captures[DEVICE_COUNT];
+        wresult = multidevice_get_capture_set(multidevice, captures, ZSA_WAIT_INFINITE);
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    add_capture(multidevice, 0, 0);
+    multidevice_stop(multidevice);
+    reader.join();
+    EXPECT_EQ(ZSA_WAIT_RESULT_FAILED, wresult);
+
+    multidevice_destroy(multidevice);
+}
+
+int main(int argc, char **argv)
+{
+    return zsa_test_common_main(argc, argv);
+}
@@ -0,0 +1,189 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <zsainternal/normals.h>
+#include <zsainternal/image.h>
+#include <zsainternal/threadpool.h>
+#include <gtest/gtest.h>
+#include <utcommon.h>
+
+#include <cmath>
+#include <vector>
+
+static const int g_width = 160;
+static const int g_height = 120;
+static const float g_focal = 140.0f;
+
+static pointcloud_input_t make_input(const std::vector<float> &xyz)
+{
+    pointcloud_input_t input;
+    input.data = (const uint8_t *)xyz.data();
+    input.point_type = POINTCLOUD_POINT_FLOAT32_MM;
+    input.width_pixels = g_width;
+    input.height_pixels = g_height;
+    input.stride_bytes = g_width * 3 * (int)sizeof(float);
+    return input;
+}
+
+// Unit ray of a pixel of a pinhole camera at the origin looking down +z
+static void pixel_ray(int x, int y, float *ray)
+{
+    ray[0] = (x - g_width / 2) / g_focal;
+    ray[1] = (y - g_height / 2) / g_focal;
+    ray[2] = 1;
+}
+
+class normals_ut : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        ASSERT_EQ(ZSA_RESULT_SUCCEEDED, normals_create(2, &m_normals));
+        ASSERT_EQ(ZSA_RESULT_SUCCEEDED,
+                  image_create(ZSA_IMAGE_FORMAT_CUSTOM,
+                               g_width,
+                               g_height,
+                               g_width * (int)sizeof(zsa_float3_t),
+                               ALLOCATION_SOURCE_USER,
+                               &m_image));
+    }
+
+    void TearDown() override
+    {
+        image_dec_ref(m_image);
+        normals_destroy(m_normals);
+    }
+
+    const zsa_float3_t &normal(int x, int y) const
+    {
+        return ((const zsa_float3_t *)image_get_buffer(m_image))[y * g_width + x];
+    }
+
+    normals_t m_normals = NULL;
+    zsa_image_t m_image = NULL;
+};
+
+TEST_F(normals_ut, tilted_plane)
+{
+    // z = 1500 + 0.3 x - 0.2 y, sampled along the pixel rays
+    const float a = 0.3f, b = -0.2f, c = 1500.0f;
+    std::vector<float> xyz((size_t)g_width * g_height * 3);
+    for (int y = 0; y < g_height; y++)
+    {
+        for (int x = 0; x < g_width; x++)
+        {
+            float ray[3];
+            pixel_ray(x, y, ray);
+            const float t = c / (ray[2] - a * ray[0] - b * ray[1]);
+            float *p = &xyz[((size_t)y * g_width + x) * 3];
+            p[0] = ray[0] * t;
+            p[1] = ray[1] * t;
+            p[2] = ray[2] * t;
+        }
+    }
+    xyz[((size_t)60 * g_width + 80) * 3 + 2] = 0;
+
+    pointcloud_input_t input = make_input(xyz);
+    normals_config_t config = { 4, 0 };
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, normals_compute(m_normals, &input, &config, m_image));
+
+    // Normal of the plane, towards the sensor
+    const float length = std::sqrt(a * a + b * b + 1);
+    const float expected[3] = { a / length, b / length, -1 / length };
+
+    int checked = 0;
+    for (int y = config.window_radius; y < g_height - config.window_radius; y++)
+    {
+        for (int x = config.window_radius; x < g_width - config.window_radius; x++)
+        {
+            if (x == 80 && y == 60)
+            {
+                continue;
+            }
+            const zsa_float3_t &n = normal(x, y);
+            ASSERT_NEAR(expected[0], n.xyz.x, 1e-3) << x << "," << y;
+            ASSERT_NEAR(expected[1], n.xyz.y, 1e-3) << x << "," << y;
+            ASSERT_NEAR(expected[2], n.xyz.z, 1e-3) << x << "," << y;
+            checked++;
+        }
+    }
+    ASSERT_GT(checked, 0);
+
+    // No normal at the border, nor where the point is missing
+    ASSERT_EQ(0, normal(0, 0).xyz.z);
+    ASSERT_EQ(0, normal(g_width - 1, g_height - 1).xyz.z);
+    ASSERT_EQ(0, normal(80, 60).xyz.z);
+}
+
+TEST_F(normals_ut, sphere)
+{
+    // Front of a sphere in the middle of the view, the background has no points
+    const float center[3] = { 0, 0, 2000 };
+    const float radius = 700;
+    std::vector<float> xyz((size_t)g_width * g_height * 3, 0.0f);
+    for (int y = 0; y < g_height; y++)
+    {
+        for (int x = 0; x < g_width; x++)
+        {
+            float ray[3];
+            pixel_ray(x, y, ray);
+            const float ray_length = std::sqrt(ray[0] * ray[0] + ray[1] * ray[1] + ray[2] * ray[2]);
+            const float dir[3] = { ray[0] / ray_length, ray[1] / ray_length, ray[2] / ray_length };
+            const float along = dir[0] * center[0] + dir[1] * center[1] + dir[2] * center[2];
+            const float discriminant = along * along - (center[2] * center[2] - radius * radius);
+            if (discriminant <= 0)
+            {
+                continue;
+            }
+            const float t = along - std::sqrt(discriminant);
+            float *p = &xyz[((size_t)y * g_width + x) * 3];
+            p[0] = dir[0] * t;
+            p[1] = dir[1] * t;
+            p[2] = dir[2] * t;
+        }
+    }
+
+    pointcloud_input_t input = make_input(xyz);
+    normals_config_t config = { 2, 100 };
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, normals_compute(m_normals, &input, &config, m_image));
+
+    // Away from the silhouette, the normal is the direction from the center to the point
+    int checked = 0;
+    for (int y = 0; y < g_height; y++)
+    {
+        for (int x = 0; x < g_width; x++)
+        {
+            const float *p = &xyz[((size_t)y * g_width + x) * 3];
+            const float dx = p[0] - center[0], dy = p[1] - center[1], dz = p[2] - center[2];
+            if (p[2] == 0 || dz > -0.7f * radius)
+            {
+                continue;
+            }
+            const zsa_float3_t &n = normal(x, y);
+            const float dot = (n.xyz.x * dx + n.xyz.y * dy + n.xyz.z * dz) / radius;
+            ASSERT_GT(dot, std::cos(2.0f * 3.14159265f / 180)) << x << "," << y;
+            checked++;
+        }
+    }
+    ASSERT_GT(checked, 1000);
+
+    // The depth edge at the silhouette gets no normal
+    ASSERT_EQ(0, normal(0, g_height / 2).xyz.z);
+}
+
+TEST_F(normals_ut, invalid_arguments)
+{
+    std::vector<float> xyz((size_t)g_width * g_height * 3, 1000.0f);
+    pointcloud_input_t input = make_input(xyz);
+    normals_config_t config = { 0, 0 };
+    ASSERT_EQ(ZSA_RESULT_FAILED, normals_compute(m_normals, &input, &config, m_image));
+
+    config.window_radius = 3;
+    input.width_pixels = g_width / 2;
+    ASSERT_EQ(ZSA_RESULT_FAILED, normals_compute(m_normals, &input, &config, m_image));
+}
+
+int main(int argc, char **argv)
+{
+    return zsa_test_common_main(argc, argv);
+}
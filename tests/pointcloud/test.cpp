@@ -0,0 +1,166 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <zsainternal/pointcloud.h>
+#include <zsainternal/threadpool.h>
+#include <gtest/gtest.h>
+#include <utcommon.h>
+
+#include <cmath>
+#include <vector>
+
+// Flat wall 1m away with 1mm between neighboring points
+static std::vector<int16_t> make_wall(int width, int height)
+{
+    std::vector<int16_t> xyz((size_t)width * height * 3);
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            int16_t *p = &xyz[((size_t)y * width + x) * 3];
+            p[0] = (int16_t)(x - width / 2);
+            p[1] = (int16_t)(y - height / 2);
+            p[2] = 1000;
+        }
+    }
+    return xyz;
+}
+
+static pointcloud_input_t make_input(const std::vector<int16_t> &xyz, int width, int height)
+{
+    pointcloud_input_t input;
+    input.data = (const uint8_t *)xyz.data();
+    input.point_type = POINTCLOUD_POINT_INT16_MM;
+    input.width_pixels = width;
+    input.height_pixels = height;
+    input.stride_bytes = width * 3 * (int)sizeof(int16_t);
+    return input;
+}
+
+class pointcloud_ut : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        ASSERT_EQ(ZSA_RESULT_SUCCEEDED, pointcloud_filter_create(3, &m_filter));
+    }
+
+    void TearDown() override
+    {
+        pointcloud_filter_destroy(m_filter);
+    }
+
+    pointcloud_filter_t m_filter = NULL;
+};
+
+TEST_F(pointcloud_ut, passthrough_drops_invalid_points)
+{
+    const int width = 64, height = 48;
+    std::vector<int16_t> xyz = make_wall(width, height);
+    xyz[2] = 0;
+    pointcloud_input_t input = make_input(xyz, width, height);
+    pointcloud_filter_config_t config = POINTCLOUD_FILTER_CONFIG_INIT_DISABLE_ALL;
+
+    size_t count = 0;
+    ASSERT_EQ(ZSA_BUFFER_RESULT_TOO_SMALL, pointcloud_filter_process(m_filter, &input, &config, NULL, 0, &count));
+    ASSERT_EQ((size_t)(width * height - 1), count);
+
+    std::vector<zsa_float3_t> points(count);
+    ASSERT_EQ(ZSA_BUFFER_RESULT_SUCCEEDED,
+              pointcloud_filter_process(m_filter, &input, &config, points.data(), points.size(), &count));
+    ASSERT_EQ(-width / 2 + 1, points[0].xyz.x);
+    ASSERT_EQ(1000, points.back().xyz.z);
+}
+
+TEST_F(pointcloud_ut, crop_roi_and_box)
+{
+    const int width = 64, height = 48;
+    std::vector<int16_t> xyz = make_wall(width, height);
+    pointcloud_input_t input = make_input(xyz, width, height);
+    pointcloud_filter_config_t config = POINTCLOUD_FILTER_CONFIG_INIT_DISABLE_ALL;
+    config.roi_x = 8;
+    config.roi_y = 4;
+    config.roi_width = 32;
+    config.roi_height = 20;
+
+    size_t count = 0;
+    ASSERT_EQ(ZSA_BUFFER_RESULT_TOO_SMALL, pointcloud_filter_process(m_filter, &input, &config, NULL, 0, &count));
+    ASSERT_EQ((size_t)(32 * 20), count);
+
+    config.crop_box_enabled = true;
+    config.crop_box_min_mm = { { -10, -1000, 0 } };
+    config.crop_box_max_mm = { { 5, 1000, 2000 } };
+    ASSERT_EQ(ZSA_BUFFER_RESULT_TOO_SMALL, pointcloud_filter_process(m_filter, &input, &config, NULL, 0, &count));
+    ASSERT_EQ((size_t)(16 * 20), count);
+
+    config.max_range_mm = 999;
+    ASSERT_EQ(ZSA_BUFFER_RESULT_TOO_SMALL, pointcloud_filter_process(m_filter, &input, &config, NULL, 0, &count));
+    ASSERT_EQ(0u, count);
+}
+
+TEST_F(pointcloud_ut, radius_outlier_removal)
+{
+    const int width = 64, height = 48;
+    std::vector<int16_t> xyz = make_wall(width, height);
+    xyz[((size_t)10 * width + 10) * 3 + 2] = 500;
+    pointcloud_input_t input = make_input(xyz, width, height);
+    pointcloud_filter_config_t config = POINTCLOUD_FILTER_CONFIG_INIT_DISABLE_ALL;
+    config.outlier_radius_mm = 5;
+    config.outlier_window = 2;
+    config.outlier_min_neighbors = 4;
+
+    size_t count = 0;
+    ASSERT_EQ(ZSA_BUFFER_RESULT_TOO_SMALL, pointcloud_filter_process(m_filter, &input, &config, NULL, 0, &count));
+    ASSERT_EQ((size_t)(width * height - 1), count);
+}
+
+TEST_F(pointcloud_ut, voxel_grid_centroids)
+{
+    const int width = 64, height = 48;
+    std::vector<int16_t> xyz = make_wall(width, height);
+    pointcloud_input_t input = make_input(xyz, width, height);
+    pointcloud_filter_config_t config = POINTCLOUD_FILTER_CONFIG_INIT_DISABLE_ALL;
+    config.voxel_size_mm = 8;
+
+    size_t count = 0;
+    ASSERT_EQ(ZSA_BUFFER_RESULT_TOO_SMALL, pointcloud_filter_process(m_filter, &input, &config, NULL, 0, &count));
+    ASSERT_EQ((size_t)((width / 8) * (height / 8)), count);
+
+    std::vector<zsa_float3_t> points(count);
+    ASSERT_EQ(ZSA_BUFFER_RESULT_SUCCEEDED,
+              pointcloud_filter_process(m_filter, &input, &config, points.data(), points.size(), &count));
+    for (const zsa_float3_t &point : points)
+    {
+        // Each voxel holds 8x8 points on a 1mm grid, so centroids sit 3.5mm into the voxel
+        ASSERT_FLOAT_EQ(3.5f, point.xyz.x - 8 * std::floor(point.xyz.x / 8));
+        ASSERT_FLOAT_EQ(3.5f, point.xyz.y - 8 * std::floor(point.xyz.y / 8));
+        ASSERT_FLOAT_EQ(1000, point.xyz.z);
+    }
+}
+
+TEST(threadpool_ut, runs_every_task_once)
+{
+    threadpool_t pool = NULL;
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, threadpool_create(THREADPOOL_DEFAULT_WORKERS, &pool));
+
+    std::vector<int> hits(1000);
+    for (int run = 0; run < 10; run++)
+    {
+        threadpool_run(pool,
+                       (uint32_t)hits.size(),
+                       [](void *context, uint32_t index) { (*(std::vector<int> *)context)[index]++; },
+                       &hits);
+    }
+
+    for (int hit : hits)
+    {
+        ASSERT_EQ(10, hit);
+    }
+
+    threadpool_destroy(pool);
+}
+
+int main(int argc, char **argv)
+{
+    return zsa_test_common_main(argc, argv);
+}
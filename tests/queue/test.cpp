@@ -0,0 +1,247 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <zsainternal/queue.h>
+#include <zsainternal/capture.h>
+#include <zsainternal/image.h>
+#include <gtest/gtest.h>
+#include <utcommon.h>
+
+#include <vector>
+
+#ifndef _WIN32
+#include <poll.h>
+#endif
+
+static const uint32_t g_depth = 3;
+
+class queue_ut : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        ASSERT_EQ(ZSA_RESULT_SUCCEEDED, queue_create(g_depth, "queue_ut", &m_queue));
+        queue_enable(m_queue);
+    }
+
+    void TearDown() override
+    {
+        queue_destroy(m_queue);
+        for (zsa_capture_t capture : m_captures)
+        {
+            capture_dec_ref(capture);
+        }
+    }
+
+    // Capture holding a depth image of size bytes, released by TearDown
+    zsa_capture_t make_capture(size_t size = 100)
+    {
+        zsa_capture_t capture = NULL;
+        zsa_image_t image = NULL;
+        EXPECT_EQ(ZSA_RESULT_SUCCEEDED, capture_create(&capture));
+        EXPECT_EQ(ZSA_RESULT_SUCCEEDED,
+                  image_create(ZSA_IMAGE_FORMAT_CUSTOM8, (int)size, 1, (int)size, ALLOCATION_SOURCE_USER, &image));
+        capture_set_depth_image(capture, image);
+        image_dec_ref(image);
+        m_captures.push_back(capture);
+        return capture;
+    }
+
+    // Pops the next capture, which must be expected
+    void expect_pop(zsa_capture_t expected)
+    {
+        zsa_capture_t capture = NULL;
+        ASSERT_EQ(ZSA_WAIT_RESULT_SUCCEEDED, queue_pop(m_queue, 0, &capture));
+        ASSERT_EQ(expected, capture);
+        capture_dec_ref(capture);
+    }
+
+    void expect_empty()
+    {
+        zsa_capture_t capture = NULL;
+        ASSERT_EQ(ZSA_WAIT_RESULT_TIMEOUT, queue_pop(m_queue, 0, &capture));
+    }
+
+    queue_t m_queue = NULL;
+    std::vector<zsa_capture_t> m_captures;
+};
+
+TEST_F(queue_ut, drop_oldest)
+{
+    zsa_capture_t c[4] = { make_capture(), make_capture(), make_capture(), make_capture() };
+    for (zsa_capture_t capture : c)
+    {
+        queue_push(m_queue, capture);
+    }
+
+    queue_stats_t stats;
+    queue_get_stats(m_queue, &stats);
+    ASSERT_EQ(g_depth, stats.count);
+    ASSERT_EQ(g_depth, stats.max_count);
+    ASSERT_EQ(300u, stats.bytes);
+    ASSERT_EQ(4u, stats.pushed);
+    ASSERT_EQ(1u, stats.dropped_oldest);
+    ASSERT_EQ(0u, stats.dropped_newest);
+
+    expect_pop(c[1]);
+    expect_pop(c[2]);
+    expect_pop(c[3]);
+    expect_empty();
+
+    queue_get_stats(m_queue, &stats);
+    ASSERT_EQ(0u, stats.count);
+    ASSERT_EQ(0u, stats.bytes);
+    ASSERT_EQ(3u, stats.popped);
+    ASSERT_EQ(0u, stats.lag_usec);
+}
+
+TEST_F(queue_ut, drop_newest)
+{
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, queue_set_overflow_policy(m_queue, QUEUE_OVERFLOW_DROP_NEWEST, 0));
+
+    zsa_capture_t c[4] = { make_capture(), make_capture(), make_capture(), make_capture() };
+    for (int i = 0; i < 3; i++)
+    {
+        queue_push(m_queue, c[i]);
+    }
+
+    // The rejected capture is handed back with a reference of the caller's own
+    zsa_capture_t dropped = NULL;
+    queue_push_w_dropped(m_queue, c[3], &dropped);
+    ASSERT_EQ(c[3], dropped);
+    capture_dec_ref(dropped);
+
+    queue_stats_t stats;
+    queue_get_stats(m_queue, &stats);
+    ASSERT_EQ(3u, stats.pushed);
+    ASSERT_EQ(0u, stats.dropped_oldest);
+    ASSERT_EQ(1u, stats.dropped_newest);
+
+    expect_pop(c[0]);
+    expect_pop(c[1]);
+    expect_pop(c[2]);
+    expect_empty();
+}
+
+TEST_F(queue_ut, keep_latest)
+{
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, queue_set_overflow_policy(m_queue, QUEUE_OVERFLOW_KEEP_LATEST, 0));
+
+    zsa_capture_t c[3] = { make_capture(), make_capture(), make_capture() };
+    for (zsa_capture_t capture : c)
+    {
+        queue_push(m_queue, capture);
+    }
+
+    queue_stats_t stats;
+    queue_get_stats(m_queue, &stats);
+    ASSERT_EQ(1u, stats.count);
+    ASSERT_EQ(1u, stats.max_count);
+    ASSERT_EQ(2u, stats.dropped_oldest);
+
+    expect_pop(c[2]);
+    expect_empty();
+}
+
+TEST_F(queue_ut, bounded_bytes)
+{
+    ASSERT_EQ(ZSA_RESULT_FAILED, queue_set_overflow_policy(m_queue, QUEUE_OVERFLOW_BOUNDED_BYTES, 0));
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, queue_set_overflow_policy(m_queue, QUEUE_OVERFLOW_BOUNDED_BYTES, 250));
+
+    zsa_capture_t small[3] = { make_capture(100), make_capture(100), make_capture(100) };
+    for (zsa_capture_t capture : small)
+    {
+        queue_push(m_queue, capture);
+    }
+
+    queue_stats_t stats;
+    queue_get_stats(m_queue, &stats);
+    ASSERT_EQ(2u, stats.count);
+    ASSERT_EQ(200u, stats.bytes);
+    ASSERT_EQ(1u, stats.dropped_oldest);
+
+    // Larger than the bound on its own, queued once everything else is dropped
+    zsa_capture_t large = make_capture(400);
+    queue_push(m_queue, large);
+    queue_get_stats(m_queue, &stats);
+    ASSERT_EQ(1u, stats.count);
+    ASSERT_EQ(400u, stats.bytes);
+    ASSERT_EQ(3u, stats.dropped_oldest);
+
+    expect_pop(large);
+    expect_empty();
+}
+
+TEST_F(queue_ut, pop_batch)
+{
+    zsa_capture_t captures[g_depth] = {};
+    uint32_t count = 0;
+    ASSERT_EQ(ZSA_WAIT_RESULT_TIMEOUT, queue_pop_batch(m_queue, captures, g_depth, &count));
+    ASSERT_EQ(0u, count);
+
+    zsa_capture_t c[3] = { make_capture(), make_capture(), make_capture() };
+    for (zsa_capture_t capture : c)
+    {
+        queue_push(m_queue, capture);
+    }
+
+    // Oldest first, up to the capacity
+    ASSERT_EQ(ZSA_WAIT_RESULT_SUCCEEDED, queue_pop_batch(m_queue, captures, 2, &count));
+    ASSERT_EQ(2u, count);
+    ASSERT_EQ(c[0], captures[0]);
+    ASSERT_EQ(c[1], captures[1]);
+    capture_dec_ref(captures[0]);
+    capture_dec_ref(captures[1]);
+
+    ASSERT_EQ(ZSA_WAIT_RESULT_SUCCEEDED, queue_pop_batch(m_queue, captures, g_depth, &count));
+    ASSERT_EQ(1u, count);
+    ASSERT_EQ(c[2], captures[0]);
+    capture_dec_ref(captures[0]);
+
+    queue_stats_t stats;
+    queue_get_stats(m_queue, &stats);
+    ASSERT_EQ(3u, stats.popped);
+
+    queue_stop(m_queue);
+    ASSERT_EQ(ZSA_WAIT_RESULT_FAILED, queue_pop_batch(m_queue, captures, g_depth, &count));
+    ASSERT_EQ(0u, count);
+}
+
+#ifndef _WIN32
+static bool is_readable(int fd)
+{
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    return poll(&pfd, 1, 0) == 1 && (pfd.revents & POLLIN);
+}
+
+TEST_F(queue_ut, event_fd)
+{
+    int fd = queue_get_event_fd(m_queue);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(fd, queue_get_event_fd(m_queue));
+    ASSERT_FALSE(is_readable(fd));
+
+    zsa_capture_t c[2] = { make_capture(), make_capture() };
+    queue_push(m_queue, c[0]);
+    queue_push(m_queue, c[1]);
+    ASSERT_TRUE(is_readable(fd));
+
+    // Level triggered, readable until the queue is drained
+    expect_pop(c[0]);
+    ASSERT_TRUE(is_readable(fd));
+    expect_pop(c[1]);
+    ASSERT_FALSE(is_readable(fd));
+
+    // Stopping wakes the event loop, which then finds out through a failed read
+    queue_stop(m_queue);
+    ASSERT_TRUE(is_readable(fd));
+    zsa_capture_t captures[g_depth] = {};
+    uint32_t count = 0;
+    ASSERT_EQ(ZSA_WAIT_RESULT_FAILED, queue_pop_batch(m_queue, captures, g_depth, &count));
+}
+#endif
+
+int main(int argc, char **argv)
+{
+    return zsa_test_common_main(argc, argv);
+}
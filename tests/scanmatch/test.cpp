@@ -0,0 +1,180 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <zsainternal/scanmatch.h>
+#include <gtest/gtest.h>
+#include <utcommon.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#define TEST_PI (3.14159265358979f)
+
+// Returns per revolution, as delivered by an RPLIDAR A1/A2
+#define SCAN_POINTS (360)
+
+struct segment_t
+{
+    float x0, y0, x1, y1;
+};
+
+// 8m x 6m room with an alcove and two pillars, in millimeters
+static const segment_t g_room[] = {
+    { -4000, -3000, 4000, -3000 }, { 4000, -3000, 4000, 3000 },   { 4000, 3000, 1000, 3000 },
+    { 1000, 3000, 1000, 2000 },    { 1000, 2000, -1000, 2000 },   { -1000, 2000, -1000, 3000 },
+    { -1000, 3000, -4000, 3000 },  { -4000, 3000, -4000, -3000 }, { 1500, -500, 1900, -500 },
+    { 1900, -500, 1900, -100 },    { 1900, -100, 1500, -100 },    { 1500, -100, 1500, -500 },
+    { -2200, 800, -2000, 800 },    { -2000, 800, -2000, 1200 },   { -2000, 1200, -2200, 1200 },
+    { -2200, 1200, -2200, 800 },
+};
+
+static float cast_ray(float x, float y, float dx, float dy)
+{
+    float nearest = 0;
+    for (const segment_t &s : g_room)
+    {
+        float ex = s.x1 - s.x0;
+        float ey = s.y1 - s.y0;
+        float denominator = dx * ey - dy * ex;
+        if (std::fabs(denominator) < 1e-9f)
+        {
+            continue;
+        }
+        float t = ((s.x0 - x) * ey - (s.y0 - y) * ex) / denominator;
+        float u = ((s.x0 - x) * dy - (s.y0 - y) * dx) / denominator;
+        if (t > 0 && u >= 0 && u <= 1 && (nearest == 0 || t < nearest))
+        {
+            nearest = t;
+        }
+    }
+    return nearest;
+}
+
+// Deterministic range noise of about +-10mm
+static float noise(uint32_t *state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return ((float)(*state >> 8) / (float)(1 << 24) - 0.5f) * 20.0f;
+}
+
+static void simulate_scan(float x, float y, float theta, uint32_t *state, std::vector<scanmatch_point_t> *points)
+{
+    points->resize(SCAN_POINTS);
+    for (int i = 0; i < SCAN_POINTS; i++)
+    {
+        float angle = 2 * TEST_PI * i / SCAN_POINTS;
+        float range = cast_ray(x, y, std::cos(theta + angle), std::sin(theta + angle));
+        (*points)[i].angle_rad = angle;
+        (*points)[i].range_mm = range > 0 ? range + noise(state) : 0;
+    }
+}
+
+static scanmatch_config_t make_config()
+{
+    scanmatch_config_t config = {};
+    config.resolution_mm = 50;
+    config.map_size_cells = 400;
+    config.min_range_mm = 150;
+    config.max_range_mm = 8000;
+    config.hit_sigma_mm = 50;
+    config.search_linear_mm = 300;
+    config.search_angular_degrees = 20;
+    config.map_scans = 20;
+    config.map_update_interval = 5;
+    config.min_score = 0.5f;
+    return config;
+}
+
+TEST(scanmatch_ut, tracks_path_through_room)
+{
+    scanmatch_config_t config = make_config();
+    scanmatch_t matcher = NULL;
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, scanmatch_create(&config, &matcher));
+
+    std::vector<scanmatch_point_t> points;
+    uint32_t state = 1;
+    int valid = 0;
+    double total_ms = 0;
+    double worst_ms = 0;
+    const int scan_count = 200;
+    float x = 0, y = 0, theta = 0;
+    scanmatch_pose_t pose = {};
+
+    // 10Hz scans while driving a circle around the room center at 0.26m/s and 12.6 degrees/s
+    for (int i = 0; i < scan_count; i++)
+    {
+        x = 1200.0f * std::sin(0.022f * i);
+        y = -1200.0f * std::cos(0.022f * i);
+        theta = 0.022f * i;
+        simulate_scan(x, y, theta, &state, &points);
+
+        scanmatch_scan_t scan = {};
+        scan.points = points.data();
+        scan.point_count = (uint32_t)points.size();
+        scan.device_timestamp_usec = (uint64_t)i * 100000;
+
+        auto start = std::chrono::steady_clock::now();
+        ASSERT_EQ(ZSA_RESULT_SUCCEEDED, scanmatch_process(matcher, &scan, &pose));
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        total_ms += ms;
+        worst_ms = std::max(worst_ms, ms);
+
+        ASSERT_EQ(scan.device_timestamp_usec, pose.device_timestamp_usec);
+        ASSERT_NE(0u, pose.system_timestamp_nsec);
+        valid += pose.valid;
+    }
+
+    // The first scan defines the origin, at (0, -1200) heading 0 in room coordinates
+    float dx = pose.x_mm - x;
+    float dy = pose.y_mm - (y + 1200.0f);
+    float error = std::sqrt(dx * dx + dy * dy);
+    float heading_error = std::remainder(pose.theta_rad - theta, 2 * TEST_PI);
+    printf("scanmatch: %d/%d scans matched, %.3f ms/scan mean, %.3f ms max, final error %.1f mm %.2f degrees\n",
+           valid,
+           scan_count - 1,
+           total_ms / scan_count,
+           worst_ms,
+           error,
+           heading_error * 180.0f / TEST_PI);
+
+    EXPECT_EQ(scan_count - 1, valid);
+    EXPECT_LT(error, 50.0f);
+    EXPECT_LT(std::fabs(heading_error), 1.0f * TEST_PI / 180.0f);
+
+    scanmatch_destroy(matcher);
+}
+
+TEST(scanmatch_ut, keeps_caller_timestamp)
+{
+    scanmatch_config_t config = make_config();
+    scanmatch_t matcher = NULL;
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, scanmatch_create(&config, &matcher));
+
+    std::vector<scanmatch_point_t> points;
+    uint32_t state = 7;
+    simulate_scan(0, 0, 0, &state, &points);
+
+    scanmatch_scan_t scan = {};
+    scan.points = points.data();
+    scan.point_count = (uint32_t)points.size();
+    scan.system_timestamp_nsec = 123456789;
+
+    scanmatch_pose_t pose;
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, scanmatch_process(matcher, &scan, &pose));
+    EXPECT_FALSE(pose.valid);
+    EXPECT_EQ(123456789u, pose.system_timestamp_nsec);
+
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, scanmatch_process(matcher, &scan, &pose));
+    EXPECT_TRUE(pose.valid);
+    EXPECT_NEAR(0.0f, pose.x_mm, 10.0f);
+    EXPECT_NEAR(0.0f, pose.y_mm, 10.0f);
+
+    scanmatch_destroy(matcher);
+}
+
+int main(int argc, char **argv)
+{
+    return zsa_test_common_main(argc, argv);
+}
@@ -0,0 +1,11 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#ifndef UTCOMMON_H
+#define UTCOMMON_H
+
+// Runs the tests of a unit test binary. Every test binary calls this from its main so that the definitions the
+// internal libraries expect from the SDK, such as the logging environment variable, are linked in.
+int zsa_test_common_main(int argc, char **argv);
+
+#endif /* UTCOMMON_H */
@@ -0,0 +1,15 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <utcommon.h>
+#include <zsainternal/logging.h>
+#include <gtest/gtest.h>
+
+// The SDK defines this in zsa.c, test binaries link the internal libraries without it
+char ZSA_ENV_VAR_LOG_TO_A_FILE[] = ZSA_ENABLE_LOG_TO_A_FILE;
+
+int zsa_test_common_main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
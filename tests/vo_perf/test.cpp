@@ -0,0 +1,307 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <zsainternal/vo.h>
+#include <zsainternal/allocator.h>
+#include <zsainternal/capture.h>
+#include <zsainternal/image.h>
+#include <gtest/gtest.h>
+#include <utcommon.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Directory of a recorded sequence, see load_sequence_frame(). A synthetic sequence is rendered when not set.
+static std::string g_sequence_path;
+
+// Frames rendered for the synthetic sequence
+#define SYNTHETIC_FRAMES (120)
+
+static vo_config_t make_config(float fx, float fy, float cx, float cy)
+{
+    vo_config_t config = {};
+    config.fx = fx;
+    config.fy = fy;
+    config.cx = cx;
+    config.cy = cy;
+    config.pyramid_levels = 3;
+    config.max_features = 400;
+    config.fast_threshold = 20;
+    config.feature_cell_size = 24;
+    config.track_window = 7;
+    config.max_reprojection_error = 2.0f;
+    config.queue_depth = 2;
+    return config;
+}
+
+static float noise_lattice(int x, int y)
+{
+    uint32_t h = (uint32_t)x * 374761393u + (uint32_t)y * 668265263u;
+    h = (h ^ (h >> 13)) * 1274126177u;
+    return (float)((h ^ (h >> 16)) & 0xff);
+}
+
+// Value noise with 20mm cells, bilinearly interpolated so the tracker sees smooth gradients
+static uint8_t texture(float x, float y)
+{
+    float fx = std::floor(x / 20.0f);
+    float fy = std::floor(y / 20.0f);
+    float ax = x / 20.0f - fx;
+    float ay = y / 20.0f - fy;
+    int ix = (int)fx;
+    int iy = (int)fy;
+    float v = (1 - ax) * (1 - ay) * noise_lattice(ix, iy) + ax * (1 - ay) * noise_lattice(ix + 1, iy) +
+              (1 - ax) * ay * noise_lattice(ix, iy + 1) + ax * ay * noise_lattice(ix + 1, iy + 1);
+    return (uint8_t)v;
+}
+
+// Camera pose of a synthetic frame: sliding sideways while turning slowly
+static void synthetic_pose(int frame, float rotation[9], float center[3])
+{
+    float yaw = 0.002f * frame;
+    rotation[0] = std::cos(yaw);
+    rotation[1] = 0;
+    rotation[2] = std::sin(yaw);
+    rotation[3] = 0;
+    rotation[4] = 1;
+    rotation[5] = 0;
+    rotation[6] = -std::sin(yaw);
+    rotation[7] = 0;
+    rotation[8] = std::cos(yaw);
+    center[0] = 4.0f * frame;
+    center[1] = -1.0f * frame;
+    center[2] = 2.0f * frame;
+}
+
+// Textured wall 2.5m ahead with a box 1.4m away, seen by a pinhole camera
+static void render_synthetic_frame(int frame,
+                                   const vo_config_t &config,
+                                   int width,
+                                   int height,
+                                   uint8_t *gray,
+                                   uint16_t *depth)
+{
+    float r[9], c[3];
+    synthetic_pose(frame, r, c);
+
+    for (int v = 0; v < height; v++)
+    {
+        for (int u = 0; u < width; u++)
+        {
+            float d[3] = { (u - config.cx) / config.fx, (v - config.cy) / config.fy, 1.0f };
+            float w[3] = { r[0] * d[0] + r[1] * d[1] + r[2] * d[2],
+                           r[3] * d[0] + r[4] * d[1] + r[5] * d[2],
+                           r[6] * d[0] + r[7] * d[1] + r[8] * d[2] };
+
+            // Distance along the ray in units of camera depth. The wall recedes to the right so the scene has depth
+            // variation everywhere, which keeps sideways motion and yaw apart.
+            float t = (2500.0f + 0.6f * c[0] - c[2]) / (w[2] - 0.6f * w[0]);
+            float box_t = (1400.0f - c[2]) / w[2];
+            float bx = c[0] + box_t * w[0];
+            float by = c[1] + box_t * w[1];
+            bool on_box = bx > -350 && bx < 250 && by > -250 && by < 200;
+            if (on_box)
+            {
+                t = box_t;
+            }
+
+            float px = c[0] + t * w[0];
+            float py = c[1] + t * w[1];
+            gray[v * width + u] = on_box ? texture(1.8f * px + 10000.0f, 1.8f * py) : texture(px, py);
+            depth[v * width + u] = (uint16_t)(t + 0.5f);
+        }
+    }
+}
+
+static bool read_pgm(const std::string &path, int bytes_per_pixel, int *width, int *height, std::vector<uint8_t> *data)
+{
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    int max_value = 0;
+    bool ok = fscanf(file, "P5 %d %d %d", width, height, &max_value) == 3 && fgetc(file) != EOF &&
+              (max_value > 255 ? 2 : 1) == bytes_per_pixel;
+    if (ok)
+    {
+        data->resize((size_t)*width * *height * bytes_per_pixel);
+        ok = fread(data->data(), 1, data->size(), file) == data->size();
+    }
+    fclose(file);
+
+    // 16 bit PGM samples are big endian
+    if (ok && bytes_per_pixel == 2)
+    {
+        for (size_t i = 0; i < data->size(); i += 2)
+        {
+            std::swap((*data)[i], (*data)[i + 1]);
+        }
+    }
+    return ok;
+}
+
+// A recorded sequence is a directory holding intrinsics.txt ("fx fy cx cy" of the color camera), then
+// color_000000.pgm (8 bit gray) and depth_000000.pgm (16 bit millimeters, registered to color), numbered from 0.
+static bool load_sequence_frame(int frame,
+                                int *width,
+                                int *height,
+                                std::vector<uint8_t> *gray,
+                                std::vector<uint8_t> *depth)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "/color_%06d.pgm", frame);
+    if (!read_pgm(g_sequence_path + name, 1, width, height, gray))
+    {
+        return false;
+    }
+
+    int depth_width, depth_height;
+    snprintf(name, sizeof(name), "/depth_%06d.pgm", frame);
+    return read_pgm(g_sequence_path + name, 2, &depth_width, &depth_height, depth);
+}
+
+static zsa_capture_t make_capture(int frame, int width, int height, const uint8_t *gray, const uint8_t *depth)
+{
+    zsa_capture_t capture = NULL;
+    zsa_image_t color_image = NULL;
+    zsa_image_t depth_image = NULL;
+    EXPECT_EQ(ZSA_RESULT_SUCCEEDED, capture_create(&capture));
+    EXPECT_EQ(ZSA_RESULT_SUCCEEDED,
+              image_create(ZSA_IMAGE_FORMAT_CUSTOM8, width, height, width, ALLOCATION_SOURCE_USER, &color_image));
+    EXPECT_EQ(ZSA_RESULT_SUCCEEDED,
+              image_create(ZSA_IMAGE_FORMAT_DEPTH16, width, height, width * 2, ALLOCATION_SOURCE_USER, &depth_image));
+
+    memcpy(image_get_buffer(color_image), gray, (size_t)width * height);
+    memcpy(image_get_buffer(depth_image), depth, (size_t)width * height * 2);
+    image_set_device_timestamp_usec(color_image, (uint64_t)frame * 33333);
+
+    capture_set_color_image(capture, color_image);
+    capture_set_depth_image(capture, depth_image);
+    image_dec_ref(color_image);
+    image_dec_ref(depth_image);
+    return capture;
+}
+
+static void report(const char *name, const std::vector<float> &ms, int valid)
+{
+    std::vector<float> sorted = ms;
+    std::sort(sorted.begin(), sorted.end());
+    double total = 0;
+    for (float m : ms)
+    {
+        total += m;
+    }
+    printf("%s: %zu frames, %.2f ms/frame mean, %.2f ms median, %.2f ms max, %d/%zu poses valid\n",
+           name,
+           ms.size(),
+           total / ms.size(),
+           sorted[sorted.size() / 2],
+           sorted.back(),
+           valid,
+           ms.size() - 1);
+}
+
+TEST(vo_perf, synthetic_sequence)
+{
+    const int width = 640;
+    const int height = 480;
+    vo_config_t config = make_config(525.0f, 525.0f, 319.5f, 239.5f);
+
+    vo_t vo = NULL;
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, vo_create(&config, NULL, NULL, &vo));
+
+    std::vector<uint8_t> gray((size_t)width * height);
+    std::vector<uint16_t> depth((size_t)width * height);
+    std::vector<float> ms;
+    vo_pose_t pose = {};
+    int valid = 0;
+
+    for (int frame = 0; frame < SYNTHETIC_FRAMES; frame++)
+    {
+        render_synthetic_frame(frame, config, width, height, gray.data(), depth.data());
+        zsa_capture_t capture = make_capture(frame, width, height, gray.data(), (const uint8_t *)depth.data());
+        ASSERT_EQ(ZSA_RESULT_SUCCEEDED, vo_process_capture(vo, capture, &pose));
+        capture_dec_ref(capture);
+
+        ms.push_back(pose.processing_ms);
+        valid += pose.valid;
+    }
+
+    report("vo_perf synthetic", ms, valid);
+
+    // The first camera defines the world frame, which is also how the scene was rendered
+    float r[9], c[3];
+    synthetic_pose(SYNTHETIC_FRAMES - 1, r, c);
+    float travelled = std::sqrt(c[0] * c[0] + c[1] * c[1] + c[2] * c[2]);
+    float drift = std::sqrt((pose.translation[0] - c[0]) * (pose.translation[0] - c[0]) +
+                            (pose.translation[1] - c[1]) * (pose.translation[1] - c[1]) +
+                            (pose.translation[2] - c[2]) * (pose.translation[2] - c[2]));
+    printf("vo_perf synthetic: drift %.1f mm over %.1f mm, yaw %.3f rad (expected %.3f)\n",
+           drift,
+           travelled,
+           std::atan2(pose.rotation[2], pose.rotation[0]),
+           std::atan2(r[2], r[0]));
+
+    EXPECT_GE(valid, SYNTHETIC_FRAMES - 2);
+    EXPECT_LT(drift, 0.05f * travelled);
+
+    vo_destroy(vo);
+}
+
+TEST(vo_perf, recorded_sequence)
+{
+    if (g_sequence_path.empty())
+    {
+        printf("vo_perf recorded: pass --sequence=<dir> to benchmark a recorded sequence\n");
+        return;
+    }
+
+    float fx, fy, cx, cy;
+    FILE *file = fopen((g_sequence_path + "/intrinsics.txt").c_str(), "r");
+    ASSERT_NE(nullptr, file);
+    ASSERT_EQ(4, fscanf(file, "%f %f %f %f", &fx, &fy, &cx, &cy));
+    fclose(file);
+
+    vo_config_t config = make_config(fx, fy, cx, cy);
+    vo_t vo = NULL;
+    ASSERT_EQ(ZSA_RESULT_SUCCEEDED, vo_create(&config, NULL, NULL, &vo));
+
+    std::vector<uint8_t> gray, depth;
+    std::vector<float> ms;
+    int width, height;
+    int valid = 0;
+    for (int frame = 0; load_sequence_frame(frame, &width, &height, &gray, &depth); frame++)
+    {
+        zsa_capture_t capture = make_capture(frame, width, height, gray.data(), depth.data());
+        vo_pose_t pose;
+        ASSERT_EQ(ZSA_RESULT_SUCCEEDED, vo_process_capture(vo, capture, &pose));
+        capture_dec_ref(capture);
+
+        ms.push_back(pose.processing_ms);
+        valid += pose.valid;
+    }
+
+    ASSERT_GT(ms.size(), 1u);
+    report("vo_perf recorded", ms, valid);
+
+    vo_destroy(vo);
+}
+
+int main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "--sequence=", 11) == 0)
+        {
+            g_sequence_path = argv[i] + 11;
+        }
+    }
+
+    return zsa_test_common_main(argc, argv);
+}